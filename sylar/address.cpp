@@ -0,0 +1,489 @@
+#include "address.h"
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include "log.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+// 低(位宽-bits)位为1的主机部分掩码
+template <typename T>
+static T CreateMask(uint32_t bits) {
+    return bits >= sizeof(T) * 8 ? 0 : static_cast<T>((static_cast<uint64_t>(1) << (sizeof(T) * 8 - bits)) - 1);
+}
+
+template <typename T>
+static uint32_t CountBits(T value) {
+    uint32_t result = 0;
+    for (; value; ++result) {
+        value &= value - 1;
+    }
+    return result;
+}
+
+Address::ptr Address::Create(const sockaddr *addr, socklen_t addrlen) {
+    if (addr == nullptr) {
+        return nullptr;
+    }
+
+    switch (addr->sa_family) {
+        case AF_INET:
+            return std::make_shared<IPv4Address>(*reinterpret_cast<const sockaddr_in *>(addr));
+        case AF_INET6:
+            return std::make_shared<IPv6Address>(*reinterpret_cast<const sockaddr_in6 *>(addr));
+        case AF_UNIX: {
+            UnixAddress::ptr result = std::make_shared<UnixAddress>();
+            memcpy(result->getAddr(), addr, std::min<size_t>(addrlen, sizeof(sockaddr_un)));
+            result->setAddrLen(addrlen);
+            return result;
+        }
+        default:
+            return std::make_shared<UnknownAddress>(addr, addrlen);
+    }
+}
+
+bool Address::Lookup(std::vector<Address::ptr> &result, const std::string &host, int family, int type,
+                     int protocol) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(addrinfo));
+    hints.ai_family = family;
+    hints.ai_socktype = type;
+    hints.ai_protocol = protocol;
+
+    std::string node;
+    const char *service = nullptr;
+
+    // [ipv6]:port
+    if (!host.empty() && host[0] == '[') {
+        const char *endIpv6 = static_cast<const char *>(memchr(host.c_str() + 1, ']', host.size() - 1));
+        if (endIpv6) {
+            if (*(endIpv6 + 1) == ':') {
+                service = endIpv6 + 2;
+            }
+            node = host.substr(1, endIpv6 - host.c_str() - 1);
+        }
+    }
+
+    // host:port, 多个':'时视为不带端口的ipv6
+    if (node.empty()) {
+        const char *colon = static_cast<const char *>(memchr(host.c_str(), ':', host.size()));
+        if (colon && !memchr(colon + 1, ':', host.c_str() + host.size() - colon - 1)) {
+            node = host.substr(0, colon - host.c_str());
+            service = colon + 1;
+        }
+    }
+
+    if (node.empty()) {
+        node = host;
+    }
+
+    addrinfo *results = nullptr;
+    int error = getaddrinfo(node.c_str(), service, &hints, &results);
+    if (error) {
+        SYLAR_LOG_ERROR(g_logger) << "Address::Lookup getaddrinfo(" << host << ", " << family << ", " << type
+                                  << ") err=" << error << " errstr=" << gai_strerror(error);
+        return false;
+    }
+
+    for (addrinfo *next = results; next; next = next->ai_next) {
+        if (Address::ptr addr = Create(next->ai_addr, next->ai_addrlen)) {
+            result.push_back(addr);
+        }
+    }
+
+    freeaddrinfo(results);
+    return !result.empty();
+}
+
+Address::ptr Address::LookupAny(const std::string &host, int family, int type, int protocol) {
+    std::vector<Address::ptr> result;
+    if (Lookup(result, host, family, type, protocol)) {
+        return result[0];
+    }
+    return nullptr;
+}
+
+IPAddress::ptr Address::LookupAnyIPAddress(const std::string &host, int family, int type, int protocol) {
+    std::vector<Address::ptr> result;
+    if (Lookup(result, host, family, type, protocol)) {
+        for (const auto &addr : result) {
+            if (IPAddress::ptr ip = std::dynamic_pointer_cast<IPAddress>(addr)) {
+                return ip;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool Address::GetInterfaceAddresses(std::multimap<std::string, std::pair<Address::ptr, uint32_t>> &result,
+                                    int family) {
+    ifaddrs *results = nullptr;
+    if (getifaddrs(&results) != 0) {
+        SYLAR_LOG_ERROR(g_logger) << "Address::GetInterfaceAddresses getifaddrs err=" << errno
+                                  << " errstr=" << strerror(errno);
+        return false;
+    }
+
+    for (ifaddrs *next = results; next; next = next->ifa_next) {
+        if (!next->ifa_addr) {
+            continue;
+        }
+        int ifaFamily = next->ifa_addr->sa_family;
+        if (family != AF_UNSPEC && family != ifaFamily) {
+            continue;
+        }
+
+        Address::ptr addr;
+        uint32_t prefixLen = ~0u;
+        if (ifaFamily == AF_INET) {
+            addr = Create(next->ifa_addr, sizeof(sockaddr_in));
+            if (next->ifa_netmask) {
+                prefixLen = CountBits(reinterpret_cast<const sockaddr_in *>(next->ifa_netmask)->sin_addr.s_addr);
+            }
+        } else if (ifaFamily == AF_INET6) {
+            addr = Create(next->ifa_addr, sizeof(sockaddr_in6));
+            if (next->ifa_netmask) {
+                const in6_addr &mask = reinterpret_cast<const sockaddr_in6 *>(next->ifa_netmask)->sin6_addr;
+                prefixLen = 0;
+                for (int i = 0; i < 16; ++i) {
+                    prefixLen += CountBits(mask.s6_addr[i]);
+                }
+            }
+        }
+
+        if (addr) {
+            result.insert(std::make_pair(next->ifa_name, std::make_pair(addr, prefixLen)));
+        }
+    }
+
+    freeifaddrs(results);
+    return !result.empty();
+}
+
+bool Address::GetInterfaceAddresses(std::vector<std::pair<Address::ptr, uint32_t>> &result,
+                                    const std::string &iface, int family) {
+    if (iface.empty() || iface == "*") {
+        if (family == AF_INET || family == AF_UNSPEC) {
+            result.push_back(std::make_pair(std::make_shared<IPv4Address>(), 0u));
+        }
+        if (family == AF_INET6 || family == AF_UNSPEC) {
+            result.push_back(std::make_pair(std::make_shared<IPv6Address>(), 0u));
+        }
+        return true;
+    }
+
+    std::multimap<std::string, std::pair<Address::ptr, uint32_t>> results;
+    if (!GetInterfaceAddresses(results, family)) {
+        return false;
+    }
+
+    auto its = results.equal_range(iface);
+    for (auto it = its.first; it != its.second; ++it) {
+        result.push_back(it->second);
+    }
+    return !result.empty();
+}
+
+int Address::getFamily() const { return getAddr()->sa_family; }
+
+std::string Address::toString() const {
+    MutexType::Lock lock{m_mutex};
+    if (m_str.empty()) {
+        std::stringstream ss;
+        insert(ss);
+        m_str = ss.str();
+    }
+    return m_str;
+}
+
+void Address::resetString() {
+    MutexType::Lock lock{m_mutex};
+    m_str.clear();
+}
+
+bool Address::operator<(const Address &rhs) const {
+    socklen_t minLen = std::min(getAddrLen(), rhs.getAddrLen());
+    int result = memcmp(getAddr(), rhs.getAddr(), minLen);
+    if (result != 0) {
+        return result < 0;
+    }
+    return getAddrLen() < rhs.getAddrLen();
+}
+
+bool Address::operator==(const Address &rhs) const {
+    return getAddrLen() == rhs.getAddrLen() && memcmp(getAddr(), rhs.getAddr(), getAddrLen()) == 0;
+}
+
+bool Address::operator!=(const Address &rhs) const { return !(*this == rhs); }
+
+IPAddress::ptr IPAddress::Create(const char *address, uint16_t port) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(addrinfo));
+    hints.ai_flags = AI_NUMERICHOST;
+    hints.ai_family = AF_UNSPEC;
+
+    addrinfo *results = nullptr;
+    int error = getaddrinfo(address, nullptr, &hints, &results);
+    if (error) {
+        SYLAR_LOG_ERROR(g_logger) << "IPAddress::Create(" << address << ", " << port << ") err=" << error
+                                  << " errstr=" << gai_strerror(error);
+        return nullptr;
+    }
+
+    IPAddress::ptr result =
+        std::dynamic_pointer_cast<IPAddress>(Address::Create(results->ai_addr, results->ai_addrlen));
+    if (result) {
+        result->setPort(port);
+    }
+    freeaddrinfo(results);
+    return result;
+}
+
+IPv4Address::ptr IPv4Address::Create(const char *address, uint16_t port) {
+    IPv4Address::ptr result = std::make_shared<IPv4Address>();
+    result->m_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &result->m_addr.sin_addr) <= 0) {
+        SYLAR_LOG_ERROR(g_logger) << "IPv4Address::Create(" << address << ", " << port << ") invalid address";
+        return nullptr;
+    }
+    return result;
+}
+
+IPv4Address::IPv4Address(const sockaddr_in &address) : m_addr{address} {}
+
+IPv4Address::IPv4Address(uint32_t address, uint16_t port) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin_family = AF_INET;
+    m_addr.sin_port = htons(port);
+    m_addr.sin_addr.s_addr = htonl(address);
+}
+
+const sockaddr *IPv4Address::getAddr() const { return reinterpret_cast<const sockaddr *>(&m_addr); }
+
+sockaddr *IPv4Address::getAddr() { return reinterpret_cast<sockaddr *>(&m_addr); }
+
+socklen_t IPv4Address::getAddrLen() const { return sizeof(m_addr); }
+
+std::ostream &IPv4Address::insert(std::ostream &os) const {
+    char buf[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &m_addr.sin_addr, buf, sizeof buf);
+    return os << buf << ":" << ntohs(m_addr.sin_port);
+}
+
+IPAddress::ptr IPv4Address::broadcastAddress(uint32_t prefixLen) {
+    if (prefixLen > 32) {
+        return nullptr;
+    }
+
+    sockaddr_in baddr{m_addr};
+    baddr.sin_addr.s_addr |= htonl(CreateMask<uint32_t>(prefixLen));
+    return std::make_shared<IPv4Address>(baddr);
+}
+
+IPAddress::ptr IPv4Address::networkAddress(uint32_t prefixLen) {
+    if (prefixLen > 32) {
+        return nullptr;
+    }
+
+    sockaddr_in baddr{m_addr};
+    baddr.sin_addr.s_addr &= htonl(~CreateMask<uint32_t>(prefixLen));
+    return std::make_shared<IPv4Address>(baddr);
+}
+
+IPAddress::ptr IPv4Address::subnetMask(uint32_t prefixLen) {
+    if (prefixLen > 32) {
+        return nullptr;
+    }
+
+    sockaddr_in subnet;
+    memset(&subnet, 0, sizeof(subnet));
+    subnet.sin_family = AF_INET;
+    subnet.sin_addr.s_addr = htonl(~CreateMask<uint32_t>(prefixLen));
+    return std::make_shared<IPv4Address>(subnet);
+}
+
+uint16_t IPv4Address::getPort() const { return ntohs(m_addr.sin_port); }
+
+void IPv4Address::setPort(uint16_t port) {
+    m_addr.sin_port = htons(port);
+    resetString();
+}
+
+IPv6Address::ptr IPv6Address::Create(const char *address, uint16_t port) {
+    IPv6Address::ptr result = std::make_shared<IPv6Address>();
+    result->m_addr.sin6_port = htons(port);
+    if (inet_pton(AF_INET6, address, &result->m_addr.sin6_addr) <= 0) {
+        SYLAR_LOG_ERROR(g_logger) << "IPv6Address::Create(" << address << ", " << port << ") invalid address";
+        return nullptr;
+    }
+    return result;
+}
+
+IPv6Address::IPv6Address() {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin6_family = AF_INET6;
+}
+
+IPv6Address::IPv6Address(const sockaddr_in6 &address) : m_addr{address} {}
+
+IPv6Address::IPv6Address(const uint8_t address[16], uint16_t port) : IPv6Address{} {
+    m_addr.sin6_port = htons(port);
+    memcpy(&m_addr.sin6_addr.s6_addr, address, 16);
+}
+
+const sockaddr *IPv6Address::getAddr() const { return reinterpret_cast<const sockaddr *>(&m_addr); }
+
+sockaddr *IPv6Address::getAddr() { return reinterpret_cast<sockaddr *>(&m_addr); }
+
+socklen_t IPv6Address::getAddrLen() const { return sizeof(m_addr); }
+
+std::ostream &IPv6Address::insert(std::ostream &os) const {
+    char buf[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET6, &m_addr.sin6_addr, buf, sizeof buf);
+    return os << "[" << buf << "]:" << ntohs(m_addr.sin6_port);
+}
+
+IPAddress::ptr IPv6Address::broadcastAddress(uint32_t prefixLen) {
+    if (prefixLen > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 baddr{m_addr};
+    if (prefixLen < 128) {
+        baddr.sin6_addr.s6_addr[prefixLen / 8] |= CreateMask<uint8_t>(prefixLen % 8);
+        for (uint32_t i = prefixLen / 8 + 1; i < 16; ++i) {
+            baddr.sin6_addr.s6_addr[i] = 0xff;
+        }
+    }
+    return std::make_shared<IPv6Address>(baddr);
+}
+
+IPAddress::ptr IPv6Address::networkAddress(uint32_t prefixLen) {
+    if (prefixLen > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 baddr{m_addr};
+    if (prefixLen < 128) {
+        baddr.sin6_addr.s6_addr[prefixLen / 8] &= ~CreateMask<uint8_t>(prefixLen % 8);
+        for (uint32_t i = prefixLen / 8 + 1; i < 16; ++i) {
+            baddr.sin6_addr.s6_addr[i] = 0x00;
+        }
+    }
+    return std::make_shared<IPv6Address>(baddr);
+}
+
+IPAddress::ptr IPv6Address::subnetMask(uint32_t prefixLen) {
+    if (prefixLen > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 subnet;
+    memset(&subnet, 0, sizeof(subnet));
+    subnet.sin6_family = AF_INET6;
+    for (uint32_t i = 0; i < prefixLen / 8; ++i) {
+        subnet.sin6_addr.s6_addr[i] = 0xff;
+    }
+    if (prefixLen < 128) {
+        subnet.sin6_addr.s6_addr[prefixLen / 8] = ~CreateMask<uint8_t>(prefixLen % 8);
+    }
+    return std::make_shared<IPv6Address>(subnet);
+}
+
+uint16_t IPv6Address::getPort() const { return ntohs(m_addr.sin6_port); }
+
+void IPv6Address::setPort(uint16_t port) {
+    m_addr.sin6_port = htons(port);
+    resetString();
+}
+
+static constexpr size_t MAX_PATH_LEN = sizeof(sockaddr_un::sun_path) - 1;
+
+UnixAddress::UnixAddress() {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    m_length = offsetof(sockaddr_un, sun_path) + MAX_PATH_LEN;
+}
+
+UnixAddress::UnixAddress(const std::string &path) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    // 普通路径带上结尾的'\0', 抽象地址按实际长度
+    m_length = path.size() + 1;
+    if (!path.empty() && path[0] == '\0') {
+        --m_length;
+    }
+
+    if (m_length > sizeof(m_addr.sun_path)) {
+        throw std::logic_error{"unix socket path too long: " + path};
+    }
+    memcpy(m_addr.sun_path, path.data(), path.size());
+    m_length += offsetof(sockaddr_un, sun_path);
+}
+
+UnixAddress::ptr UnixAddress::CreateAbstract(const std::string &name) {
+    return std::make_shared<UnixAddress>(std::string(1, '\0') + name);
+}
+
+const sockaddr *UnixAddress::getAddr() const { return reinterpret_cast<const sockaddr *>(&m_addr); }
+
+sockaddr *UnixAddress::getAddr() { return reinterpret_cast<sockaddr *>(&m_addr); }
+
+socklen_t UnixAddress::getAddrLen() const { return m_length; }
+
+void UnixAddress::setAddrLen(socklen_t len) {
+    m_length = len;
+    resetString();
+}
+
+std::string UnixAddress::getPath() const {
+    size_t len = m_length > offsetof(sockaddr_un, sun_path) ? m_length - offsetof(sockaddr_un, sun_path) : 0;
+    if (len > 0 && m_addr.sun_path[0] == '\0') {
+        return std::string{m_addr.sun_path, len};
+    }
+    return std::string{m_addr.sun_path, strnlen(m_addr.sun_path, len)};
+}
+
+bool UnixAddress::isAbstract() const {
+    return m_length > offsetof(sockaddr_un, sun_path) && m_addr.sun_path[0] == '\0';
+}
+
+std::ostream &UnixAddress::insert(std::ostream &os) const {
+    std::string path = getPath();
+    if (!path.empty() && path[0] == '\0') {
+        return os << "\\0" << path.substr(1);
+    }
+    return os << path;
+}
+
+UnknownAddress::UnknownAddress(int family) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.ss_family = family;
+    m_length = sizeof(m_addr);
+}
+
+UnknownAddress::UnknownAddress(const sockaddr *addr, socklen_t addrlen) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_length = std::min<socklen_t>(addrlen, sizeof(m_addr));
+    memcpy(&m_addr, addr, m_length);
+}
+
+const sockaddr *UnknownAddress::getAddr() const { return reinterpret_cast<const sockaddr *>(&m_addr); }
+
+sockaddr *UnknownAddress::getAddr() { return reinterpret_cast<sockaddr *>(&m_addr); }
+
+socklen_t UnknownAddress::getAddrLen() const { return m_length; }
+
+std::ostream &UnknownAddress::insert(std::ostream &os) const {
+    return os << "[UnknownAddress family=" << m_addr.ss_family << "]";
+}
+
+std::ostream &operator<<(std::ostream &os, const Address &addr) { return addr.insert(os); }
+
+}  // namespace sylar
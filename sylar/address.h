@@ -0,0 +1,211 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "mutex.h"
+
+namespace sylar {
+
+class IPAddress;
+
+class Address {
+public:
+    using ptr = std::shared_ptr<Address>;
+    using MutexType = CASLock;
+
+    // 按sockaddr的地址族创建对应的子类, 无法识别时为UnknownAddress
+    static Address::ptr Create(const sockaddr *addr, socklen_t addrlen);
+
+    // host形如"www.example.com:80"、"127.0.0.1"、"[::1]:8080", 解析失败返回false
+    static bool Lookup(std::vector<Address::ptr> &result, const std::string &host, int family = AF_INET,
+                       int type = 0, int protocol = 0);
+
+    static Address::ptr LookupAny(const std::string &host, int family = AF_INET, int type = 0, int protocol = 0);
+
+    static std::shared_ptr<IPAddress> LookupAnyIPAddress(const std::string &host, int family = AF_INET,
+                                                         int type = 0, int protocol = 0);
+
+    // 网卡名 -> (地址, 前缀长度)
+    static bool GetInterfaceAddresses(std::multimap<std::string, std::pair<Address::ptr, uint32_t>> &result,
+                                      int family = AF_INET);
+
+    static bool GetInterfaceAddresses(std::vector<std::pair<Address::ptr, uint32_t>> &result,
+                                      const std::string &iface, int family = AF_INET);
+
+    virtual ~Address() {}
+
+    int getFamily() const;
+
+    virtual const sockaddr *getAddr() const = 0;
+
+    // 供内核填充地址(recvfrom、getpeername等), 填充已有的地址后须调用resetString刷新toString的缓存
+    virtual sockaddr *getAddr() = 0;
+
+    virtual socklen_t getAddrLen() const = 0;
+
+    virtual std::ostream &insert(std::ostream &os) const = 0;
+
+    // 首次调用时格式化并缓存, 地址被修改后重新生成
+    std::string toString() const;
+
+    bool operator<(const Address &rhs) const;
+
+    bool operator==(const Address &rhs) const;
+
+    bool operator!=(const Address &rhs) const;
+
+    void resetString();
+
+private:
+    mutable MutexType m_mutex;
+    mutable std::string m_str;
+};
+
+class IPAddress : public Address {
+public:
+    using ptr = std::shared_ptr<IPAddress>;
+
+    // 只接受数字形式的地址, 不做域名解析
+    static IPAddress::ptr Create(const char *address, uint16_t port = 0);
+
+    virtual IPAddress::ptr broadcastAddress(uint32_t prefixLen) = 0;
+
+    virtual IPAddress::ptr networkAddress(uint32_t prefixLen) = 0;
+
+    virtual IPAddress::ptr subnetMask(uint32_t prefixLen) = 0;
+
+    virtual uint16_t getPort() const = 0;
+
+    virtual void setPort(uint16_t port) = 0;
+};
+
+class IPv4Address : public IPAddress {
+public:
+    using ptr = std::shared_ptr<IPv4Address>;
+
+    static IPv4Address::ptr Create(const char *address, uint16_t port = 0);
+
+    IPv4Address(const sockaddr_in &address);
+
+    IPv4Address(uint32_t address = INADDR_ANY, uint16_t port = 0);
+
+    const sockaddr *getAddr() const override;
+
+    sockaddr *getAddr() override;
+
+    socklen_t getAddrLen() const override;
+
+    std::ostream &insert(std::ostream &os) const override;
+
+    IPAddress::ptr broadcastAddress(uint32_t prefixLen) override;
+
+    IPAddress::ptr networkAddress(uint32_t prefixLen) override;
+
+    IPAddress::ptr subnetMask(uint32_t prefixLen) override;
+
+    uint16_t getPort() const override;
+
+    void setPort(uint16_t port) override;
+
+private:
+    sockaddr_in m_addr;
+};
+
+class IPv6Address : public IPAddress {
+public:
+    using ptr = std::shared_ptr<IPv6Address>;
+
+    static IPv6Address::ptr Create(const char *address, uint16_t port = 0);
+
+    IPv6Address();
+
+    IPv6Address(const sockaddr_in6 &address);
+
+    IPv6Address(const uint8_t address[16], uint16_t port = 0);
+
+    const sockaddr *getAddr() const override;
+
+    sockaddr *getAddr() override;
+
+    socklen_t getAddrLen() const override;
+
+    std::ostream &insert(std::ostream &os) const override;
+
+    IPAddress::ptr broadcastAddress(uint32_t prefixLen) override;
+
+    IPAddress::ptr networkAddress(uint32_t prefixLen) override;
+
+    IPAddress::ptr subnetMask(uint32_t prefixLen) override;
+
+    uint16_t getPort() const override;
+
+    void setPort(uint16_t port) override;
+
+private:
+    sockaddr_in6 m_addr;
+};
+
+class UnixAddress : public Address {
+public:
+    using ptr = std::shared_ptr<UnixAddress>;
+
+    UnixAddress();
+
+    // 以'\0'开头的path为抽象命名空间地址
+    UnixAddress(const std::string &path);
+
+    // 抽象命名空间地址, 不在文件系统中创建文件, 最后一个引用关闭时自动释放
+    static UnixAddress::ptr CreateAbstract(const std::string &name);
+
+    const sockaddr *getAddr() const override;
+
+    sockaddr *getAddr() override;
+
+    socklen_t getAddrLen() const override;
+
+    // accept/getpeername等由内核填充地址后设置实际长度
+    void setAddrLen(socklen_t len);
+
+    std::string getPath() const;
+
+    bool isAbstract() const;
+
+    std::ostream &insert(std::ostream &os) const override;
+
+private:
+    sockaddr_un m_addr;
+    socklen_t m_length;
+};
+
+class UnknownAddress : public Address {
+public:
+    using ptr = std::shared_ptr<UnknownAddress>;
+
+    UnknownAddress(int family);
+
+    UnknownAddress(const sockaddr *addr, socklen_t addrlen);
+
+    const sockaddr *getAddr() const override;
+
+    sockaddr *getAddr() override;
+
+    socklen_t getAddrLen() const override;
+
+    std::ostream &insert(std::ostream &os) const override;
+
+private:
+    sockaddr_storage m_addr;
+    socklen_t m_length;
+};
+
+std::ostream &operator<<(std::ostream &os, const Address &addr);
+
+}  // namespace sylar
@@ -0,0 +1,490 @@
+#include "binlog.h"
+#include <sys/stat.h>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+
+#include "config.h"
+#include "macro.h"
+#include "thread.h"
+#include "util.h"
+
+namespace sylar {
+
+using LogSiteMgr = sylar::Singleton<LogSiteManager>;
+
+const LogSite *LogSiteManager::add(const std::string &file, int32_t line, LogLevel::Level level,
+                                   const std::string &fmt) {
+    std::string key = file + ":" + std::to_string(line) + ":" + std::to_string(level) + ":" + fmt;
+    {
+        RWMutexType::ReadLock rlock{m_mutex};
+        if (auto it = m_index.find(key); it != m_index.end()) {
+            return it->second;
+        }
+    }
+
+    RWMutexType::WriteLock wlock{m_mutex};
+    if (auto it = m_index.find(key); it != m_index.end()) {
+        return it->second;
+    }
+    LogSite &site = m_sites.emplace_back();
+    site.m_id = m_sites.size();
+    site.m_level = level;
+    site.m_line = line;
+    site.m_file = file;
+    site.m_fmt = fmt;
+    m_index[key] = &site;
+    return &site;
+}
+
+const LogSite *LogSiteManager::get(uint32_t id) {
+    RWMutexType::ReadLock rlock{m_mutex};
+    if (id == 0 || id > m_sites.size()) {
+        return nullptr;
+    }
+    return &m_sites[id - 1];
+}
+
+namespace binlog {
+
+static thread_local std::string t_record_buf;
+static thread_local pid_t t_thread_id = 0;
+
+static void PutShortString(std::string &buf, const std::string &str) {
+    uint8_t len = str.size() > UINT8_MAX ? UINT8_MAX : str.size();
+    buf.push_back(static_cast<char>(len));
+    buf.append(str.data(), len);
+}
+
+static void EncodeHeader(std::string &buf, uint32_t siteId, uint64_t time, uint64_t elapse, uint32_t threadId,
+                         uint64_t fiberId, const std::string &threadName, const std::string &loggerName) {
+    buf.clear();
+    PutPod<uint32_t>(buf, siteId);
+    PutPod<uint64_t>(buf, time);
+    PutPod<uint64_t>(buf, elapse);
+    PutPod<uint32_t>(buf, threadId);
+    PutPod<uint64_t>(buf, fiberId);
+    PutShortString(buf, threadName);
+    PutShortString(buf, loggerName);
+}
+
+const LogSite *RegisterSite(const char *file, int32_t line, LogLevel::Level level, const char *fmt) {
+    return LogSiteMgr::GetInstance()->add(file, line, level, fmt);
+}
+
+std::string &BeginRecord(const Logger::ptr &logger, const LogSite *site) {
+    if (SYLAR_UNLIKELY(t_thread_id == 0)) {
+        t_thread_id = sylar::GetThreadId();
+    }
+    std::string &buf = t_record_buf;
+    EncodeHeader(buf, site->m_id, time(0), sylar::GetElapsedMS() - logger->getCreateTime(), t_thread_id,
+                 sylar::GetFiberId(), sylar::Thread::GetName(), logger->getName());
+    return buf;
+}
+
+// 从payload中按顺序取值, 越界时置错误标记
+class Cursor {
+public:
+    Cursor(const char *data, size_t len) : m_data{data}, m_left{len} {}
+
+    template <typename T>
+    T get() {
+        T val{};
+        if (m_left < sizeof(T)) {
+            m_error = true;
+            m_left = 0;
+            return val;
+        }
+        memcpy(&val, m_data, sizeof(T));
+        m_data += sizeof(T);
+        m_left -= sizeof(T);
+        return val;
+    }
+
+    std::string getString(size_t len) {
+        if (m_left < len) {
+            m_error = true;
+            len = m_left;
+        }
+        std::string str{m_data, len};
+        m_data += len;
+        m_left -= len;
+        return str;
+    }
+
+    bool empty() const { return m_left == 0; }
+
+    bool isError() const { return m_error; }
+
+private:
+    const char *m_data;
+    size_t m_left;
+    bool m_error = false;
+};
+
+struct Arg {
+    ArgType m_type = ARG_INT64;
+    int64_t m_int = 0;
+    uint64_t m_uint = 0;
+    double m_double = 0;
+    std::string m_str;
+};
+
+static std::vector<Arg> DecodeArgs(Cursor &cursor) {
+    std::vector<Arg> args;
+    while (!cursor.empty() && !cursor.isError()) {
+        Arg arg;
+        arg.m_type = static_cast<ArgType>(cursor.get<uint8_t>());
+        switch (arg.m_type) {
+            case ARG_INT32:
+                arg.m_int = cursor.get<int32_t>();
+                arg.m_uint = arg.m_int;
+                break;
+            case ARG_UINT32:
+                arg.m_uint = cursor.get<uint32_t>();
+                arg.m_int = arg.m_uint;
+                break;
+            case ARG_INT64:
+                arg.m_int = cursor.get<int64_t>();
+                arg.m_uint = arg.m_int;
+                break;
+            case ARG_UINT64:
+            case ARG_POINTER:
+                arg.m_uint = cursor.get<uint64_t>();
+                arg.m_int = arg.m_uint;
+                break;
+            case ARG_DOUBLE:
+                arg.m_double = cursor.get<double>();
+                break;
+            case ARG_STRING:
+                arg.m_str = cursor.getString(cursor.get<uint32_t>());
+                break;
+            default:
+                return args;
+        }
+        args.push_back(std::move(arg));
+    }
+    return args;
+}
+
+static std::string ArgToString(const Arg &arg) {
+    switch (arg.m_type) {
+        case ARG_INT32:
+        case ARG_INT64:
+            return std::to_string(arg.m_int);
+        case ARG_UINT32:
+        case ARG_UINT64:
+            return std::to_string(arg.m_uint);
+        case ARG_DOUBLE:
+            return std::to_string(arg.m_double);
+        case ARG_POINTER: {
+            char buf[32];
+            snprintf(buf, sizeof buf, "0x%" PRIx64, arg.m_uint);
+            return buf;
+        }
+        default:
+            return arg.m_str;
+    }
+}
+
+// 按printf格式串渲染参数, 长度修饰符以记录中的实际类型为准
+static std::string Render(const std::string &fmt, const std::vector<Arg> &args) {
+    std::string out;
+    out.reserve(fmt.size() + args.size() * 8);
+    size_t argIdx = 0;
+    char buf[128];
+    size_t i = 0;
+    while (i < fmt.size()) {
+        if (fmt[i] != '%') {
+            out.push_back(fmt[i++]);
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+            out.push_back('%');
+            i += 2;
+            continue;
+        }
+
+        std::string spec = "%";
+        ++i;
+        while (i < fmt.size() && strchr("-+ #0", fmt[i])) {
+            spec.push_back(fmt[i++]);
+        }
+        while (i < fmt.size() && (isdigit(fmt[i]) || fmt[i] == '.')) {
+            spec.push_back(fmt[i++]);
+        }
+        while (i < fmt.size() && strchr("hlLqjzt", fmt[i])) {
+            ++i;
+        }
+        if (i >= fmt.size()) {
+            out.append(spec);
+            break;
+        }
+        char conv = fmt[i++];
+        if (argIdx >= args.size()) {
+            out.append("<missing>");
+            continue;
+        }
+
+        const Arg &arg = args[argIdx++];
+        switch (conv) {
+            case 'd':
+            case 'i':
+                spec += "lld";
+                snprintf(buf, sizeof buf, spec.c_str(),
+                         arg.m_type == ARG_DOUBLE ? static_cast<long long>(arg.m_double)
+                                                  : static_cast<long long>(arg.m_int));
+                out.append(buf);
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec += "ll";
+                spec.push_back(conv);
+                snprintf(buf, sizeof buf, spec.c_str(),
+                         arg.m_type == ARG_DOUBLE ? static_cast<unsigned long long>(arg.m_double)
+                                                  : static_cast<unsigned long long>(arg.m_uint));
+                out.append(buf);
+                break;
+            case 'c':
+                spec.push_back(conv);
+                snprintf(buf, sizeof buf, spec.c_str(), static_cast<int>(arg.m_int));
+                out.append(buf);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec.push_back(conv);
+                snprintf(buf, sizeof buf, spec.c_str(),
+                         arg.m_type == ARG_DOUBLE ? arg.m_double : static_cast<double>(arg.m_int));
+                out.append(buf);
+                break;
+            case 'p':
+                snprintf(buf, sizeof buf, "0x%" PRIx64, arg.m_uint);
+                out.append(buf);
+                break;
+            case 's': {
+                std::string str = ArgToString(arg);
+                if (spec.size() == 1) {
+                    out.append(str);
+                } else {
+                    spec.push_back('s');
+                    int len = snprintf(nullptr, 0, spec.c_str(), str.c_str());
+                    std::string tmp(len, '\0');
+                    snprintf(tmp.data(), len + 1, spec.c_str(), str.c_str());
+                    out.append(tmp);
+                }
+                break;
+            }
+            default:
+                out.append(ArgToString(arg));
+                break;
+        }
+    }
+    return out;
+}
+
+LogEvent::ptr DecodeRecord(const LogSite *site, const char *data, size_t len) {
+    Cursor cursor{data, len};
+    cursor.get<uint32_t>();
+    time_t time = cursor.get<uint64_t>();
+    int64_t elapse = cursor.get<uint64_t>();
+    uint32_t threadId = cursor.get<uint32_t>();
+    uint64_t fiberId = cursor.get<uint64_t>();
+    std::string threadName = cursor.getString(cursor.get<uint8_t>());
+    std::string loggerName = cursor.getString(cursor.get<uint8_t>());
+    if (cursor.isError()) {
+        return nullptr;
+    }
+
+    LogEvent::ptr event = std::make_shared<LogEvent>(loggerName, site->m_level, site->m_file.c_str(), site->m_line,
+                                                     elapse, threadId, fiberId, time, threadName);
+    event->getSS() << Render(site->m_fmt, DecodeArgs(cursor));
+    return event;
+}
+
+}  // namespace binlog
+
+BinaryLogAppender::BinaryLogAppender(const std::string &file) : LogAppender{std::make_shared<LogFormatter>()} {
+    m_filename = file;
+    if (!reopen()) {
+        printf("reopen file %s error\n", m_filename.c_str());
+    }
+}
+
+void BinaryLogAppender::log(LogEvent::ptr event) {
+    // 文本事件以"%s"描述符写出, 内容已在调用方格式化
+    // 描述符缓存在调用点, 同一调用点以不同级别输出时才重新查找
+    LogSiteCache *cache = event->getSiteCache();
+    const LogSite *site = cache ? cache->load(std::memory_order_acquire) : nullptr;
+    if (!site || site->m_level != event->getLevel()) {
+        site = LogSiteMgr::GetInstance()->add(event->getFile(), event->getLine(), event->getLevel(), "%s");
+        if (cache) {
+            cache->store(site, std::memory_order_release);
+        }
+    }
+    std::string buf;
+    binlog::EncodeHeader(buf, site->m_id, event->getTime(), event->getElapse(), event->getThreadId(),
+                         event->getFiberId(), event->getThreadName(), event->getLoggerName());
+    binlog::EncodeArg(buf, event->getContent());
+    logBinary(site, buf.data(), buf.size());
+}
+
+void BinaryLogAppender::checkReopen() {
+    uint64_t now = time(0);
+    uint64_t last = m_lastTime.load(std::memory_order_relaxed);
+    // 只有更新了时间的线程重新打开文件
+    if (now >= last + 3 && m_lastTime.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        if (!reopen()) {
+            printf("reopen file %s error\n", m_filename.c_str());
+        }
+    }
+}
+
+void BinaryLogAppender::logBinary(const LogSite *site, const char *data, size_t len) {
+    if (len > binlog::MAX_CHUNK_LEN) {
+        return;
+    }
+    checkReopen();
+
+    MutexType::Lock lock{m_mutex};
+    if (m_reopenError) {
+        return;
+    }
+    if (site->m_id >= m_sitesWritten.size()) {
+        m_sitesWritten.resize(site->m_id * 2 + 1, false);
+    }
+    if (!m_sitesWritten[site->m_id]) {
+        writeSite(site);
+        m_sitesWritten[site->m_id] = true;
+    }
+    writeChunk(binlog::CHUNK_RECORD, data, len);
+}
+
+void BinaryLogAppender::writeChunk(char kind, const char *data, size_t len) {
+    uint32_t len32 = len;
+    m_filestream.put(kind);
+    m_filestream.write(reinterpret_cast<const char *>(&len32), sizeof len32);
+    m_filestream.write(data, len);
+}
+
+void BinaryLogAppender::writeSite(const LogSite *site) {
+    std::string buf;
+    binlog::PutPod<uint32_t>(buf, site->m_id);
+    binlog::PutPod<int32_t>(buf, site->m_level);
+    binlog::PutPod<int32_t>(buf, site->m_line);
+    binlog::PutPod<uint16_t>(buf, site->m_file.size());
+    buf.append(site->m_file);
+    binlog::PutPod<uint16_t>(buf, site->m_fmt.size());
+    buf.append(site->m_fmt);
+    writeChunk(binlog::CHUNK_SITE, buf.data(), buf.size());
+}
+
+bool BinaryLogAppender::reopen() {
+    MutexType::Lock lock{m_mutex};
+    struct stat st;
+    // 路径仍是当前打开的文件且没有被截断, 不用重新打开, 也不重复输出头和描述符
+    if (m_filestream && !stat(m_filename.c_str(), &st) && st.st_dev == m_dev && st.st_ino == m_ino &&
+        st.st_size > 0) {
+        return true;
+    }
+    if (m_filestream.is_open()) {
+        m_filestream.close();
+    }
+    m_filestream.clear();
+    m_filestream.open(m_filename, std::ios::app | std::ios::binary);
+    m_reopenError = !m_filestream;
+    if (m_reopenError) {
+        return false;
+    }
+    // 新文件(首次打开、被轮转或截断): 描述符id只在本进程内有效, 写入头并重新输出描述符
+    // 头立即刷到文件, 之后文件大小为0说明被截断
+    writeChunk(binlog::CHUNK_HEADER, binlog::MAGIC, strlen(binlog::MAGIC));
+    m_filestream.flush();
+    m_sitesWritten.assign(m_sitesWritten.size(), false);
+    if (!stat(m_filename.c_str(), &st)) {
+        m_dev = st.st_dev;
+        m_ino = st.st_ino;
+    }
+    return true;
+}
+
+void BinaryLogAppender::flush() {
+    MutexType::Lock lock{m_mutex};
+    m_filestream.flush();
+}
+
+std::string BinaryLogAppender::toYamlString() {
+    MutexType::Lock lock{m_mutex};
+    YAML::Node node;
+    node["type"] = "BinaryLogAppender";
+    node["file"] = m_filename;
+    node["pattern"] = m_formatter ? m_formatter->getPattern() : m_defaultFormatter->getPattern();
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+BinLogReader::BinLogReader(const std::string &file) : m_ifs{file, std::ios::in | std::ios::binary} {
+    if (m_ifs.seekg(0, std::ios::end)) {
+        m_size = m_ifs.tellg();
+        m_ifs.seekg(0, std::ios::beg);
+    }
+}
+
+LogEvent::ptr BinLogReader::next() {
+    std::string payload;
+    while (m_ifs) {
+        char kind = 0;
+        uint32_t len = 0;
+        if (!m_ifs.get(kind) || !m_ifs.read(reinterpret_cast<char *>(&len), sizeof len)) {
+            return nullptr;
+        }
+        // 长度来自文件, 损坏时可能是任意值, 先检查再分配
+        uint64_t pos = m_ifs.tellg();
+        if (len > binlog::MAX_CHUNK_LEN || len > m_size - std::min(pos, m_size)) {
+            return nullptr;
+        }
+        payload.resize(len);
+        if (!m_ifs.read(payload.data(), len)) {
+            return nullptr;
+        }
+
+        if (kind == binlog::CHUNK_HEADER) {
+            m_sites.clear();
+        } else if (kind == binlog::CHUNK_SITE) {
+            binlog::Cursor cursor{payload.data(), payload.size()};
+            auto site = std::make_unique<LogSite>();
+            site->m_id = cursor.get<uint32_t>();
+            site->m_level = static_cast<LogLevel::Level>(cursor.get<int32_t>());
+            site->m_line = cursor.get<int32_t>();
+            site->m_file = cursor.getString(cursor.get<uint16_t>());
+            site->m_fmt = cursor.getString(cursor.get<uint16_t>());
+            if (!cursor.isError()) {
+                m_sites[site->m_id] = std::move(site);
+            }
+        } else if (kind == binlog::CHUNK_RECORD) {
+            if (payload.size() < sizeof(uint32_t)) {
+                continue;
+            }
+            uint32_t siteId = 0;
+            memcpy(&siteId, payload.data(), sizeof siteId);
+            auto it = m_sites.find(siteId);
+            if (it == m_sites.end()) {
+                continue;
+            }
+            if (LogEvent::ptr event = binlog::DecodeRecord(it->second.get(), payload.data(), payload.size()); event) {
+                return event;
+            }
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace sylar
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "log.h"
+#include "mutex.h"
+#include "singleton.h"
+
+// 每个调用点只注册一次格式描述符(文件、行号、级别、格式串)，之后只返回静态指针
+#define SYLAR_LOG_SITE(level, fmt)                                                                         \
+    []() {                                                                                                 \
+        static const sylar::LogSite *s_site = sylar::binlog::RegisterSite(__FILE__, __LINE__, level, fmt); \
+        return s_site;                                                                                     \
+    }()
+
+#define SYLAR_LOG_BIN_LEVEL(logger, level, fmt, ...) \
+    if (level <= logger->getLevel())                  \
+    sylar::BinLogWrite(logger, SYLAR_LOG_SITE(level, fmt), ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_FATAL(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_ALERT(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::ALERT, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_CRIT(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::CRIT, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_ERROR(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_WARN(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::WARN, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_NOTICE(logger, fmt, ...) \
+    SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::NOTICE, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_INFO(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::INFO, fmt, ##__VA_ARGS__)
+
+#define SYLAR_LOG_BIN_DEBUG(logger, fmt, ...) SYLAR_LOG_BIN_LEVEL(logger, sylar::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+
+namespace sylar {
+
+struct LogSite {
+    uint32_t m_id = 0;
+    LogLevel::Level m_level = LogLevel::NOTSET;
+    int32_t m_line = 0;
+    std::string m_file;
+    std::string m_fmt;
+};
+
+class LogSiteManager {
+public:
+    using RWMutexType = RWMutex;
+
+    const LogSite *add(const std::string &file, int32_t line, LogLevel::Level level, const std::string &fmt);
+
+    const LogSite *get(uint32_t id);
+
+private:
+    RWMutexType m_mutex;
+    // deque保证已注册描述符的地址稳定, id从1开始
+    std::deque<LogSite> m_sites;
+    std::unordered_map<std::string, const LogSite *> m_index;
+};
+
+namespace binlog {
+
+// 二进制日志文件由若干chunk组成: kind(1字节) + payload长度(4字节) + payload
+enum ChunkKind : char {
+    CHUNK_HEADER = 'H',  // 文件(重新)打开标记, 读取方需清空描述符表
+    CHUNK_SITE = 'D',    // 调用点描述符
+    CHUNK_RECORD = 'R',  // 日志记录
+};
+
+enum ArgType : uint8_t {
+    ARG_INT32 = 1,
+    ARG_UINT32 = 2,
+    ARG_INT64 = 3,
+    ARG_UINT64 = 4,
+    ARG_DOUBLE = 5,
+    ARG_STRING = 6,
+    ARG_POINTER = 7,
+};
+
+static constexpr const char *MAGIC = "SYLARBL1";
+
+// 单个块的长度上限, 超过的记录不写出; 读取时超过上限视为文件损坏
+static constexpr uint32_t MAX_CHUNK_LEN = 16 << 20;
+
+template <typename T>
+inline void PutPod(std::string &buf, T val) {
+    buf.append(reinterpret_cast<const char *>(&val), sizeof val);
+}
+
+inline void PutString(std::string &buf, const char *str, size_t len) {
+    buf.push_back(static_cast<char>(ARG_STRING));
+    PutPod<uint32_t>(buf, len);
+    buf.append(str, len);
+}
+
+inline void EncodeArg(std::string &buf, const char *str) {
+    if (str == nullptr) {
+        str = "(null)";
+    }
+    PutString(buf, str, strlen(str));
+}
+
+inline void EncodeArg(std::string &buf, char *str) { EncodeArg(buf, static_cast<const char *>(str)); }
+
+inline void EncodeArg(std::string &buf, const std::string &str) { PutString(buf, str.data(), str.size()); }
+
+inline void EncodeArg(std::string &buf, std::string_view str) { PutString(buf, str.data(), str.size()); }
+
+template <typename T>
+inline void EncodeArg(std::string &buf, T val) {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_enum_v<U>) {
+        EncodeArg(buf, static_cast<std::underlying_type_t<U>>(val));
+    } else if constexpr (std::is_floating_point_v<U>) {
+        buf.push_back(static_cast<char>(ARG_DOUBLE));
+        PutPod<double>(buf, val);
+    } else if constexpr (std::is_pointer_v<U>) {
+        buf.push_back(static_cast<char>(ARG_POINTER));
+        PutPod<uint64_t>(buf, reinterpret_cast<uintptr_t>(val));
+    } else {
+        static_assert(std::is_integral_v<U>, "unsupported binary log argument type");
+        if constexpr (sizeof(U) <= 4 && std::is_signed_v<U>) {
+            buf.push_back(static_cast<char>(ARG_INT32));
+            PutPod<int32_t>(buf, val);
+        } else if constexpr (sizeof(U) <= 4) {
+            buf.push_back(static_cast<char>(ARG_UINT32));
+            PutPod<uint32_t>(buf, val);
+        } else if constexpr (std::is_signed_v<U>) {
+            buf.push_back(static_cast<char>(ARG_INT64));
+            PutPod<int64_t>(buf, val);
+        } else {
+            buf.push_back(static_cast<char>(ARG_UINT64));
+            PutPod<uint64_t>(buf, val);
+        }
+    }
+}
+
+// 调用点统一经由库内的注册函数, 描述符表不暴露给使用方
+const LogSite *RegisterSite(const char *file, int32_t line, LogLevel::Level level, const char *fmt);
+
+// 写入记录头(描述符id、时间、线程、协程、日志器名称)，返回线程局部的编码缓冲区
+std::string &BeginRecord(const Logger::ptr &logger, const LogSite *site);
+
+// 把record的payload按site的格式串还原为文本日志事件
+LogEvent::ptr DecodeRecord(const LogSite *site, const char *data, size_t len);
+
+}  // namespace binlog
+
+template <typename... Args>
+void BinLogWrite(const Logger::ptr &logger, const LogSite *site, Args &&...args) {
+    std::string &buf = binlog::BeginRecord(logger, site);
+    (binlog::EncodeArg(buf, std::forward<Args>(args)), ...);
+    logger->logBinary(site, buf.data(), buf.size());
+}
+
+class BinaryLogAppender : public LogAppender {
+public:
+    using ptr = std::shared_ptr<BinaryLogAppender>;
+
+    BinaryLogAppender(const std::string &file);
+
+    void log(LogEvent::ptr event) override;
+
+    void logBinary(const LogSite *site, const char *data, size_t len) override;
+
+    bool reopen();
+
+    void flush();
+
+    std::string toYamlString() override;
+
+private:
+    void checkReopen();
+
+    void writeChunk(char kind, const char *data, size_t len);
+
+    void writeSite(const LogSite *site);
+
+private:
+    std::string m_filename;
+    std::ofstream m_filestream;
+    std::atomic<uint64_t> m_lastTime{0};
+    // 由m_mutex保护
+    bool m_reopenError = false;
+    // 当前打开的文件, 路径仍指向它时定期检查不重新打开
+    dev_t m_dev = 0;
+    ino_t m_ino = 0;
+    // 当前打开的文件中已写出描述符的调用点
+    std::vector<bool> m_sitesWritten;
+};
+
+// 读取二进制日志文件, 逐条还原为LogEvent
+class BinLogReader {
+public:
+    BinLogReader(const std::string &file);
+
+    bool isOpen() const { return m_ifs.is_open(); }
+
+    LogEvent::ptr next();
+
+private:
+    std::ifstream m_ifs;
+    // 打开时的文件大小, 块长度不能超过剩余部分
+    uint64_t m_size = 0;
+    std::unordered_map<uint32_t, std::unique_ptr<LogSite>> m_sites;
+};
+
+}  // namespace sylar
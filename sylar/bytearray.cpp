@@ -0,0 +1,551 @@
+#include "bytearray.h"
+#include <endian.h>
+#include <limits.h>
+#include <string.h>
+#include <stdexcept>
+#include <type_traits>
+#include "hook.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace sylar {
+
+static std::atomic<uint64_t> s_block_allocs{0};
+static std::atomic<uint64_t> s_block_reuses{0};
+
+// 线程本地的空闲块链表, 链接指针存放在块的数据区
+static constexpr size_t MAX_CACHED_BLOCKS = 64;
+static thread_local ByteArray::Block *t_free_blocks = nullptr;
+static thread_local size_t t_free_count = 0;
+static thread_local bool t_cache_closed = false;
+
+static ByteArray::Block *&NextFree(ByteArray::Block *block) {
+    return *reinterpret_cast<ByteArray::Block **>(block->data());
+}
+
+struct BlockCacheCleaner {
+    ~BlockCacheCleaner() {
+        t_cache_closed = true;
+        while (t_free_blocks) {
+            ByteArray::Block *next = NextFree(t_free_blocks);
+            free(t_free_blocks);
+            t_free_blocks = next;
+        }
+        t_free_count = 0;
+    }
+};
+
+static thread_local BlockCacheCleaner t_cache_cleaner;
+
+template <typename T>
+static T ByteSwap(T value) {
+    if constexpr (sizeof(T) == 1) {
+        return value;
+    } else if constexpr (sizeof(T) == 2) {
+        return static_cast<T>(__builtin_bswap16(static_cast<uint16_t>(value)));
+    } else if constexpr (sizeof(T) == 4) {
+        return static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(value)));
+    } else {
+        return static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(value)));
+    }
+}
+
+static constexpr bool HOST_LITTLE_ENDIAN = BYTE_ORDER == LITTLE_ENDIAN;
+
+// varint最多10字节
+static constexpr size_t MAX_VARINT_SIZE = 10;
+
+static size_t EncodeVarint(uint64_t value, uint8_t *out) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+ByteArray::Block *ByteArray::Block::Create(size_t capacity) {
+    SYLAR_ASSERT(capacity >= sizeof(Block *) && capacity <= UINT32_MAX);
+    Block *block = nullptr;
+    if (capacity == DEFAULT_BLOCK_SIZE && t_free_blocks) {
+        block = t_free_blocks;
+        t_free_blocks = NextFree(block);
+        --t_free_count;
+        s_block_reuses.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        block = static_cast<Block *>(malloc(sizeof(Block) + capacity));
+        if (SYLAR_UNLIKELY(!block)) {
+            throw std::bad_alloc{};
+        }
+        block->m_capacity = capacity;
+        s_block_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    block->m_refs.store(1, std::memory_order_relaxed);
+    return block;
+}
+
+void ByteArray::Block::unref() {
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    // 其他线程释放的块进入当前线程的链表
+    if (m_capacity == DEFAULT_BLOCK_SIZE && !t_cache_closed && t_free_count < MAX_CACHED_BLOCKS) {
+        (void)&t_cache_cleaner;
+        NextFree(this) = t_free_blocks;
+        t_free_blocks = this;
+        ++t_free_count;
+        return;
+    }
+    free(this);
+}
+
+uint64_t ByteArray::GetBlockAllocs() { return s_block_allocs.load(std::memory_order_relaxed); }
+
+uint64_t ByteArray::GetBlockReuses() { return s_block_reuses.load(std::memory_order_relaxed); }
+
+ByteArray::ByteArray(size_t blockSize) : m_blockSize{std::max(blockSize, sizeof(Block *))} {}
+
+void ByteArray::clear() {
+    m_slices.clear();
+    m_size = 0;
+}
+
+size_t ByteArray::tailRoom() const {
+    if (m_slices.empty()) {
+        return 0;
+    }
+    const Slice &tail = m_slices.back();
+    return tail.unique() ? tail.m_block->m_capacity - tail.m_end : 0;
+}
+
+size_t ByteArray::headRoom() const {
+    if (m_slices.empty()) {
+        return 0;
+    }
+    const Slice &head = m_slices.front();
+    return head.unique() ? head.m_begin : 0;
+}
+
+ByteArray::Slice ByteArray::newSlice(bool forPrepend) const {
+    Block *block = Block::Create(m_blockSize);
+    uint32_t pos = forPrepend ? block->m_capacity : 0;
+    return Slice{block, pos, pos};
+}
+
+void ByteArray::append(const void *buf, size_t size) {
+    const char *p = static_cast<const char *>(buf);
+    while (size > 0) {
+        size_t room = tailRoom();
+        if (room == 0) {
+            m_slices.push_back(newSlice(false));
+            room = m_slices.back().m_block->m_capacity;
+        }
+        Slice &tail = m_slices.back();
+        size_t n = std::min(room, size);
+        memcpy(tail.m_block->data() + tail.m_end, p, n);
+        tail.m_end += n;
+        m_size += n;
+        p += n;
+        size -= n;
+    }
+}
+
+void ByteArray::append(const ByteArray &other) {
+    // 按下标遍历, other为自身时也只追加原有的块
+    size_t count = other.m_slices.size();
+    size_t size = other.m_size;
+    for (size_t i = 0; i < count; ++i) {
+        if (other.m_slices[i].size() > 0) {
+            m_slices.push_back(other.m_slices[i]);
+        }
+    }
+    m_size += size;
+}
+
+void ByteArray::prepend(const void *buf, size_t size) {
+    const char *end = static_cast<const char *>(buf) + size;
+    while (size > 0) {
+        size_t room = headRoom();
+        if (room == 0) {
+            m_slices.push_front(newSlice(true));
+            room = m_slices.front().m_begin;
+        }
+        Slice &head = m_slices.front();
+        size_t n = std::min(room, size);
+        head.m_begin -= n;
+        end -= n;
+        memcpy(head.m_block->data() + head.m_begin, end, n);
+        m_size += n;
+        size -= n;
+    }
+}
+
+ByteArray ByteArray::split(size_t size) {
+    if (size > m_size) {
+        throw std::out_of_range{"ByteArray::split size=" + std::to_string(size) + " > " + std::to_string(m_size)};
+    }
+    ByteArray result{m_blockSize};
+    result.m_littleEndian = m_littleEndian;
+    while (size > 0) {
+        Slice &head = m_slices.front();
+        if (head.size() <= size) {
+            size -= head.size();
+            result.m_size += head.size();
+            m_size -= head.size();
+            if (head.size() > 0) {
+                result.m_slices.push_back(std::move(head));
+            }
+            m_slices.pop_front();
+            continue;
+        }
+        // 边界上的块由两者共享
+        Slice part{head};
+        part.m_end = part.m_begin + size;
+        head.m_begin += size;
+        result.m_slices.push_back(std::move(part));
+        result.m_size += size;
+        m_size -= size;
+        size = 0;
+    }
+    return result;
+}
+
+ByteArray ByteArray::slice(size_t offset, size_t size) const {
+    if (offset > m_size || size > m_size - offset) {
+        throw std::out_of_range{"ByteArray::slice offset=" + std::to_string(offset) + " size=" + std::to_string(size) +
+                                " > " + std::to_string(m_size)};
+    }
+    ByteArray result{m_blockSize};
+    result.m_littleEndian = m_littleEndian;
+    for (const auto &s : m_slices) {
+        if (size == 0) {
+            break;
+        }
+        if (offset >= s.size()) {
+            offset -= s.size();
+            continue;
+        }
+        Slice part{s};
+        part.m_begin += offset;
+        part.m_end = part.m_begin + std::min<size_t>(size, part.size());
+        offset = 0;
+        size -= part.size();
+        result.m_size += part.size();
+        result.m_slices.push_back(std::move(part));
+    }
+    return result;
+}
+
+void ByteArray::consume(size_t size) {
+    if (size > m_size) {
+        throw std::out_of_range{"ByteArray::consume size=" + std::to_string(size) + " > " + std::to_string(m_size)};
+    }
+    m_size -= size;
+    while (size > 0) {
+        Slice &head = m_slices.front();
+        if (head.size() <= size) {
+            size -= head.size();
+            m_slices.pop_front();
+        } else {
+            head.m_begin += size;
+            size = 0;
+        }
+    }
+}
+
+void ByteArray::peek(void *buf, size_t size, size_t offset) const {
+    if (offset > m_size || size > m_size - offset) {
+        throw std::out_of_range{"ByteArray::peek offset=" + std::to_string(offset) + " size=" + std::to_string(size) +
+                                " > " + std::to_string(m_size)};
+    }
+    char *p = static_cast<char *>(buf);
+    for (const auto &s : m_slices) {
+        if (size == 0) {
+            break;
+        }
+        if (offset >= s.size()) {
+            offset -= s.size();
+            continue;
+        }
+        size_t n = std::min(size, s.size() - offset);
+        memcpy(p, s.data() + offset, n);
+        offset = 0;
+        p += n;
+        size -= n;
+    }
+}
+
+void ByteArray::read(void *buf, size_t size) {
+    peek(buf, size);
+    consume(size);
+}
+
+std::string ByteArray::toString() const {
+    std::string str(m_size, '\0');
+    if (m_size) {
+        peek(&str[0], m_size);
+    }
+    return str;
+}
+
+size_t ByteArray::getReadBuffers(std::vector<iovec> &buffers, size_t size) const {
+    size_t total = 0;
+    for (const auto &s : m_slices) {
+        if (total >= size) {
+            break;
+        }
+        if (s.size() == 0) {
+            continue;
+        }
+        size_t n = std::min(s.size(), size - total);
+        buffers.push_back({s.data(), n});
+        total += n;
+    }
+    return total;
+}
+
+// 链尾预留的空块及其之前仍有空闲空间的独占块都可以写入
+size_t ByteArray::getWriteBuffers(std::vector<iovec> &buffers, size_t size) {
+    size_t i = m_slices.size();
+    while (i > 0 && m_slices[i - 1].size() == 0) {
+        --i;
+    }
+    if (i > 0 && m_slices[i - 1].unique() && m_slices[i - 1].m_end < m_slices[i - 1].m_block->m_capacity) {
+        --i;
+    }
+
+    size_t total = 0;
+    for (; i < m_slices.size(); ++i) {
+        Slice &s = m_slices[i];
+        size_t room = s.m_block->m_capacity - s.m_end;
+        if (room > 0) {
+            buffers.push_back({s.m_block->data() + s.m_end, room});
+            total += room;
+        }
+    }
+    while (total < size) {
+        m_slices.push_back(newSlice(false));
+        Slice &s = m_slices.back();
+        buffers.push_back({s.m_block->data(), s.m_block->m_capacity});
+        total += s.m_block->m_capacity;
+    }
+    return total;
+}
+
+void ByteArray::commit(size_t size) {
+    size_t i = m_slices.size();
+    while (i > 0 && m_slices[i - 1].size() == 0) {
+        --i;
+    }
+    if (i > 0 && m_slices[i - 1].unique() && m_slices[i - 1].m_end < m_slices[i - 1].m_block->m_capacity) {
+        --i;
+    }
+
+    for (; size > 0 && i < m_slices.size(); ++i) {
+        Slice &s = m_slices[i];
+        size_t n = std::min<size_t>(size, s.m_block->m_capacity - s.m_end);
+        s.m_end += n;
+        m_size += n;
+        size -= n;
+    }
+    SYLAR_ASSERT2(size == 0, "commit more than getWriteBuffers reserved");
+}
+
+ssize_t ByteArray::readFd(int fd, size_t size) {
+    std::vector<iovec> buffers;
+    getWriteBuffers(buffers, size);
+    if (buffers.size() > IOV_MAX) {
+        buffers.resize(IOV_MAX);
+    }
+    ssize_t rt = ::readv(fd, buffers.data(), buffers.size());
+    if (rt > 0) {
+        commit(rt);
+    }
+    return rt;
+}
+
+ssize_t ByteArray::writeFd(int fd) {
+    std::vector<iovec> buffers;
+    getReadBuffers(buffers);
+    if (buffers.size() > IOV_MAX) {
+        buffers.resize(IOV_MAX);
+    }
+    ssize_t rt = ::writev(fd, buffers.data(), buffers.size());
+    if (rt > 0) {
+        consume(rt);
+    }
+    return rt;
+}
+
+template <typename T>
+void ByteArray::writeFixed(T value) {
+    if (m_littleEndian != HOST_LITTLE_ENDIAN) {
+        value = ByteSwap(value);
+    }
+    if (SYLAR_LIKELY(tailRoom() >= sizeof(T))) {
+        Slice &tail = m_slices.back();
+        memcpy(tail.m_block->data() + tail.m_end, &value, sizeof(T));
+        tail.m_end += sizeof(T);
+        m_size += sizeof(T);
+        return;
+    }
+    append(&value, sizeof(T));
+}
+
+template <typename T>
+T ByteArray::peekFixed() const {
+    T value;
+    if (SYLAR_LIKELY(!m_slices.empty() && m_slices.front().size() >= sizeof(T))) {
+        memcpy(&value, m_slices.front().data(), sizeof(T));
+    } else {
+        peek(&value, sizeof(T));
+    }
+    return m_littleEndian != HOST_LITTLE_ENDIAN ? ByteSwap(value) : value;
+}
+
+template <typename T>
+T ByteArray::readFixed() {
+    T value = peekFixed<T>();
+    consume(sizeof(T));
+    return value;
+}
+
+#define XX(name, type)                                            \
+    void ByteArray::write##name(type value) { writeFixed(value); } \
+    type ByteArray::read##name() { return readFixed<type>(); }
+XX(Fint8, int8_t)
+XX(Fuint8, uint8_t)
+XX(Fint16, int16_t)
+XX(Fuint16, uint16_t)
+XX(Fint32, int32_t)
+XX(Fuint32, uint32_t)
+XX(Fint64, int64_t)
+XX(Fuint64, uint64_t)
+#undef XX
+
+void ByteArray::writeFloat(float value) {
+    uint32_t v;
+    memcpy(&v, &value, sizeof value);
+    writeFixed(v);
+}
+
+void ByteArray::writeDouble(double value) {
+    uint64_t v;
+    memcpy(&v, &value, sizeof value);
+    writeFixed(v);
+}
+
+float ByteArray::readFloat() {
+    uint32_t v = readFixed<uint32_t>();
+    float value;
+    memcpy(&value, &v, sizeof v);
+    return value;
+}
+
+double ByteArray::readDouble() {
+    uint64_t v = readFixed<uint64_t>();
+    double value;
+    memcpy(&value, &v, sizeof v);
+    return value;
+}
+
+void ByteArray::writeUint64(uint64_t value) {
+    if (SYLAR_LIKELY(tailRoom() >= MAX_VARINT_SIZE)) {
+        Slice &tail = m_slices.back();
+        size_t n = EncodeVarint(value, reinterpret_cast<uint8_t *>(tail.m_block->data() + tail.m_end));
+        tail.m_end += n;
+        m_size += n;
+        return;
+    }
+    uint8_t tmp[MAX_VARINT_SIZE];
+    append(tmp, EncodeVarint(value, tmp));
+}
+
+void ByteArray::writeUint32(uint32_t value) { writeUint64(value); }
+
+void ByteArray::writeInt32(int32_t value) { writeUint64(EncodeZigzag32(value)); }
+
+void ByteArray::writeInt64(int64_t value) { writeUint64(EncodeZigzag64(value)); }
+
+size_t ByteArray::peekVarint(uint64_t &value, size_t offset) const {
+    value = 0;
+    size_t n = 0;
+    for (const auto &s : m_slices) {
+        if (offset >= s.size()) {
+            offset -= s.size();
+            continue;
+        }
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(s.data()) + offset;
+        const uint8_t *end = reinterpret_cast<const uint8_t *>(s.data()) + s.size();
+        offset = 0;
+        for (; p < end; ++p) {
+            if (SYLAR_UNLIKELY(n == MAX_VARINT_SIZE)) {
+                throw std::invalid_argument{"ByteArray varint longer than 10 bytes"};
+            }
+            value |= static_cast<uint64_t>(*p & 0x7f) << (7 * n);
+            ++n;
+            if (!(*p & 0x80)) {
+                return n;
+            }
+        }
+    }
+    return 0;
+}
+
+uint64_t ByteArray::readUint64() {
+    uint64_t value;
+    size_t n = peekVarint(value);
+    if (SYLAR_UNLIKELY(n == 0)) {
+        throw std::out_of_range{"ByteArray::readUint64 incomplete varint"};
+    }
+    consume(n);
+    return value;
+}
+
+uint32_t ByteArray::readUint32() { return static_cast<uint32_t>(readUint64()); }
+
+int32_t ByteArray::readInt32() { return DecodeZigzag32(readUint32()); }
+
+int64_t ByteArray::readInt64() { return DecodeZigzag64(readUint64()); }
+
+#define XX(name, type)                                        \
+    void ByteArray::writeString##name(const std::string &value) { \
+        writeFixed(static_cast<type>(value.size()));          \
+        append(value);                                        \
+    }                                                         \
+    std::string ByteArray::readString##name() { return readString(peekFixed<type>(), sizeof(type)); }
+XX(F16, uint16_t)
+XX(F32, uint32_t)
+XX(F64, uint64_t)
+#undef XX
+
+void ByteArray::writeStringVint(const std::string &value) {
+    writeUint64(value.size());
+    append(value);
+}
+
+std::string ByteArray::readStringVint() {
+    uint64_t size;
+    size_t prefix = peekVarint(size);
+    if (SYLAR_UNLIKELY(prefix == 0)) {
+        throw std::out_of_range{"ByteArray::readStringVint incomplete varint"};
+    }
+    return readString(size, prefix);
+}
+
+std::string ByteArray::readString(uint64_t size, size_t prefix) {
+    if (SYLAR_UNLIKELY(m_size < prefix || size > m_size - prefix)) {
+        throw std::out_of_range{"ByteArray::readString size=" + std::to_string(size) + " > " +
+                                std::to_string(m_size - prefix)};
+    }
+    consume(prefix);
+    std::string value(size, '\0');
+    if (size) {
+        read(&value[0], size);
+    }
+    return value;
+}
+
+}  // namespace sylar
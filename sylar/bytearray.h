@@ -0,0 +1,253 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sylar {
+
+// 由引用计数内存块组成的链式缓冲区
+// 拷贝, split, slice只增加块的引用计数, 不复制数据; 只有独占的块才会在原地追加或前插
+// 读写接口直接产出iovec, 交给hook的readv/writev/sendmsg/recvmsg
+class ByteArray {
+public:
+    using ptr = std::shared_ptr<ByteArray>;
+
+    // 默认大小的块在线程本地的空闲链表中复用
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 4096;
+
+    struct Block {
+        std::atomic<uint32_t> m_refs;
+        uint32_t m_capacity;
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+
+        static Block *Create(size_t capacity);
+
+        void ref() { m_refs.fetch_add(1, std::memory_order_relaxed); }
+
+        void unref();
+    };
+
+    // 块中[m_begin, m_end)的一段, 持有块的一个引用
+    struct Slice {
+        Block *m_block = nullptr;
+        uint32_t m_begin = 0;
+        uint32_t m_end = 0;
+
+        Slice() = default;
+
+        // 接管block已有的引用
+        Slice(Block *block, uint32_t begin, uint32_t end) : m_block{block}, m_begin{begin}, m_end{end} {}
+
+        Slice(const Slice &rhs) : m_block{rhs.m_block}, m_begin{rhs.m_begin}, m_end{rhs.m_end} {
+            if (m_block) {
+                m_block->ref();
+            }
+        }
+
+        Slice(Slice &&rhs) noexcept : m_block{rhs.m_block}, m_begin{rhs.m_begin}, m_end{rhs.m_end} {
+            rhs.m_block = nullptr;
+        }
+
+        Slice &operator=(Slice rhs) noexcept {
+            std::swap(m_block, rhs.m_block);
+            m_begin = rhs.m_begin;
+            m_end = rhs.m_end;
+            return *this;
+        }
+
+        ~Slice() {
+            if (m_block) {
+                m_block->unref();
+            }
+        }
+
+        size_t size() const { return m_end - m_begin; }
+
+        char *data() const { return m_block->data() + m_begin; }
+
+        bool unique() const { return m_block->m_refs.load(std::memory_order_acquire) == 1; }
+    };
+
+    // 本进程调用malloc分配的块数 / 从空闲链表复用的块数
+    static uint64_t GetBlockAllocs();
+
+    static uint64_t GetBlockReuses();
+
+    explicit ByteArray(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    size_t getBlockSize() const { return m_blockSize; }
+
+    // 默认网络字节序(大端)
+    bool isLittleEndian() const { return m_littleEndian; }
+
+    void setLittleEndian(bool val) { m_littleEndian = val; }
+
+    void clear();
+
+    void append(const void *buf, size_t size);
+
+    void append(const std::string &str) { append(str.data(), str.size()); }
+
+    // 共享other的数据块
+    void append(const ByteArray &other);
+
+    void prepend(const void *buf, size_t size);
+
+    // 拆出前size字节, 与本对象共享边界上的块
+    ByteArray split(size_t size);
+
+    // [offset, offset + size)的共享视图
+    ByteArray slice(size_t offset, size_t size) const;
+
+    void consume(size_t size);
+
+    void peek(void *buf, size_t size, size_t offset = 0) const;
+
+    void read(void *buf, size_t size);
+
+    std::string toString() const;
+
+    // 可读数据的iovec, 最多size字节, 返回实际字节数
+    size_t getReadBuffers(std::vector<iovec> &buffers, size_t size = ~0ull) const;
+
+    // 在链尾预留至少size字节的空闲空间并返回其iovec, 写入后调用commit
+    size_t getWriteBuffers(std::vector<iovec> &buffers, size_t size);
+
+    void commit(size_t size);
+
+    // 一次readv填充链尾的空闲空间
+    ssize_t readFd(int fd, size_t size);
+
+    // 一次writev写出可读数据并消费已写出的部分
+    ssize_t writeFd(int fd);
+
+    // 固定长度
+    void writeFint8(int8_t value);
+
+    void writeFuint8(uint8_t value);
+
+    void writeFint16(int16_t value);
+
+    void writeFuint16(uint16_t value);
+
+    void writeFint32(int32_t value);
+
+    void writeFuint32(uint32_t value);
+
+    void writeFint64(int64_t value);
+
+    void writeFuint64(uint64_t value);
+
+    void writeFloat(float value);
+
+    void writeDouble(double value);
+
+    // varint, 有符号数先做zigzag
+    void writeInt32(int32_t value);
+
+    void writeUint32(uint32_t value);
+
+    void writeInt64(int64_t value);
+
+    void writeUint64(uint64_t value);
+
+    // 长度前缀 + 数据
+    void writeStringF16(const std::string &value);
+
+    void writeStringF32(const std::string &value);
+
+    void writeStringF64(const std::string &value);
+
+    void writeStringVint(const std::string &value);
+
+    // 数据不足时抛出std::out_of_range, 且不消费任何数据
+    int8_t readFint8();
+
+    uint8_t readFuint8();
+
+    int16_t readFint16();
+
+    uint16_t readFuint16();
+
+    int32_t readFint32();
+
+    uint32_t readFuint32();
+
+    int64_t readFint64();
+
+    uint64_t readFuint64();
+
+    float readFloat();
+
+    double readDouble();
+
+    int32_t readInt32();
+
+    uint32_t readUint32();
+
+    int64_t readInt64();
+
+    uint64_t readUint64();
+
+    std::string readStringF16();
+
+    std::string readStringF32();
+
+    std::string readStringF64();
+
+    std::string readStringVint();
+
+    static uint32_t EncodeZigzag32(int32_t v) {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+
+    static uint64_t EncodeZigzag64(int64_t v) {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+
+    static int32_t DecodeZigzag32(uint32_t v) { return static_cast<int32_t>((v >> 1) ^ -(v & 1)); }
+
+    static int64_t DecodeZigzag64(uint64_t v) { return static_cast<int64_t>((v >> 1) ^ -(v & 1)); }
+
+private:
+    template <typename T>
+    void writeFixed(T value);
+
+    template <typename T>
+    T peekFixed() const;
+
+    template <typename T>
+    T readFixed();
+
+    // 链尾/链首可以原地写入的字节数
+    size_t tailRoom() const;
+
+    size_t headRoom() const;
+
+    // 新块; forPrepend为true时空闲空间留在数据之前
+    Slice newSlice(bool forPrepend) const;
+
+    // 从offset处解码varint, 返回编码占用的字节数, 数据不足返回0
+    size_t peekVarint(uint64_t &value, size_t offset = 0) const;
+
+    std::string readString(uint64_t size, size_t prefix);
+
+private:
+    size_t m_blockSize;
+    size_t m_size = 0;
+    bool m_littleEndian = false;
+    std::deque<Slice> m_slices;
+};
+
+}  // namespace sylar
@@ -1,9 +1,15 @@
 #include "config.h"
 #include "env.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unordered_set>
 
 namespace sylar {
 
@@ -15,44 +21,133 @@ ConfigVarBase::ptr Config::LookupBase(const std::string &name) {
     return it == GetDatas().end() ? nullptr : it->second;
 }
 
-static void ListAllMember(const std::string &prefix, const YAML::Node &node,
-                          std::list<std::pair<std::string, const YAML::Node>> &output) {
-    if (prefix.find_first_not_of("abcdefghikjlmnopqrstuvwxyz._012345678") != std::string::npos) {
-        SYLAR_LOG_ERROR(g_logger) << "Config invalid name: " << prefix << " : " << node;
-        return;
+static constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+static inline uint64_t HashBytes(uint64_t hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * FNV_PRIME;
     }
+    return hash;
+}
 
-    output.push_back({prefix, node});
-    if (node.IsMap()) {
+static inline uint64_t HashMix(uint64_t hash, uint64_t val) {
+    return HashBytes(hash, reinterpret_cast<const char *>(&val), sizeof val);
+}
+
+// 子树哈希, 节点类型参与计算以区分结构; 子节点的哈希依次并入父节点, 因此一次自底向上的遍历就能得到每棵子树的哈希
+// 结果不为0, 0表示没有从YAML加载过
+static uint64_t HashNode(const YAML::Node &node) {
+    char type = static_cast<char>(node.Type());
+    uint64_t hash = HashBytes(FNV_OFFSET, &type, 1);
+    if (node.IsScalar()) {
+        const std::string &scalar = node.Scalar();
+        hash = HashBytes(hash, scalar.data(), scalar.size() + 1);
+    } else if (node.IsSequence()) {
+        for (const auto &child : node) {
+            hash = HashMix(hash, HashNode(child));
+        }
+    } else if (node.IsMap()) {
         for (auto it = node.begin(); it != node.end(); ++it) {
-            ListAllMember(prefix.empty() ? it->first.Scalar() : prefix + "." + it->first.Scalar(), it->second, output);
+            hash = HashMix(hash, HashNode(it->first));
+            hash = HashMix(hash, HashNode(it->second));
         }
     }
+    return hash ? hash : 1;
 }
 
-void Config::LoadFromYaml(const YAML::Node &root) {
-    std::list<std::pair<std::string, const YAML::Node>> all_nodes;
-    ListAllMember("", root, all_nodes);
+uint64_t Config::CollectUpdates(std::string &prefix, const YAML::Node &node, bool force, YamlHashes *hashes,
+                                std::vector<PendingUpdate> &updates) {
+    uint64_t hash;
+    if (!node.IsMap()) {
+        hash = HashNode(node);
+    } else {
+        // 与HashNode相同的算法, 子树的哈希由递归返回, 不重复计算
+        char type = static_cast<char>(node.Type());
+        hash = HashBytes(FNV_OFFSET, &type, 1);
+        size_t len = prefix.size();
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            const std::string &key = it->first.Scalar();
+            if (len) {
+                prefix.push_back('.');
+            }
+            for (char c : key) {
+                prefix.push_back(::tolower(c));
+            }
+            uint64_t child;
+            if (prefix.find_first_not_of("abcdefghikjlmnopqrstuvwxyz._012345678", len) != std::string::npos) {
+                SYLAR_LOG_ERROR(g_logger) << "Config invalid name: " << prefix << " : " << it->second;
+                child = HashNode(it->second);
+            } else {
+                child = CollectUpdates(prefix, it->second, force, hashes, updates);
+            }
+            prefix.resize(len);
+            hash = HashMix(hash, HashNode(it->first));
+            hash = HashMix(hash, child);
+        }
+        hash = hash ? hash : 1;
+    }
 
-    for (auto &[name, node] : all_nodes) {
-        if (name.empty()) {
-            continue;
+    if (!prefix.empty()) {
+        if (auto it = GetDatas().find(prefix); it != GetDatas().end()) {
+            uint64_t last = 0;
+            if (!hashes) {
+                last = it->second->getYamlHash();
+            } else if (auto h = hashes->find(prefix); h != hashes->end()) {
+                last = h->second;
+            }
+            if (force || hash != last) {
+                updates.push_back({it->second, node, hash, hashes});
+            }
         }
+    }
+    return hash;
+}
 
-        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
-        if (ConfigVarBase::ptr var = LookupBase(name); var) {
-            if (node.IsScalar()) {
-                var->fromString(node.Scalar());
-            } else {
-                std::stringstream ss;
-                ss << node;
-                var->fromString(ss.str());
+size_t Config::ApplyUpdates(const std::vector<PendingUpdate> &updates) {
+    // 转换在提交之前完成, 不占用提交锁
+    std::vector<ConfigVarBase::Change::ptr> changes;
+    size_t count = 0;
+    for (const auto &update : updates) {
+        ConfigVarBase::Change::ptr change;
+        if (update.m_var->prepareYaml(update.m_node, update.m_hash, change)) {
+            ++count;
+            if (update.m_hashes) {
+                (*update.m_hashes)[update.m_var->getName()] = update.m_hash;
             }
         }
+        if (change) {
+            changes.push_back(std::move(change));
+        }
+    }
+    ConfigVarBase::Commit(std::move(changes));
+    return count;
+}
+
+size_t Config::LoadFromYaml(const YAML::Node &root, bool force) {
+    std::vector<PendingUpdate> updates;
+    {
+        // 只在收集时持有一次读锁, 应用时释放, 监听器中可以再调用Lookup
+        RWMutexType::ReadLock lock{GetMutex()};
+        std::string prefix;
+        CollectUpdates(prefix, root, force, nullptr, updates);
     }
+    return ApplyUpdates(updates);
+}
+
+size_t Config::LoadFromYaml(const YAML::Node &root, YamlHashes &hashes, bool force) {
+    std::vector<PendingUpdate> updates;
+    {
+        RWMutexType::ReadLock lock{GetMutex()};
+        std::string prefix;
+        CollectUpdates(prefix, root, force, &hashes, updates);
+    }
+    return ApplyUpdates(updates);
 }
 
 static std::map<std::string, uint64_t> s_file2modifytime;
+// 每个文件上次应用的各配置项子树哈希
+static std::map<std::string, Config::YamlHashes> s_file2hashes;
 static sylar::Mutex s_mutex;
 
 void Config::LoadFromConfDir(const std::string &path, bool force) {
@@ -60,7 +155,11 @@ void Config::LoadFromConfDir(const std::string &path, bool force) {
     std::vector<std::string> files;
     FSUtil::ListAllFile(files, absolute_path, ".yml");
 
+    // 目录下所有变化的文件作为一个批次提交; 各文件的哈希表先取出, 提交后再写回
+    std::map<std::string, YamlHashes> file2hashes;
+    std::vector<PendingUpdate> updates;
     for (const auto &file : files) {
+        YamlHashes *hashes;
         {
             struct stat st;
             lstat(file.c_str(), &st);
@@ -69,21 +168,273 @@ void Config::LoadFromConfDir(const std::string &path, bool force) {
                 continue;
             }
             s_file2modifytime[file] = st.st_mtime;
+            hashes = &file2hashes[file];
+            *hashes = s_file2hashes[file];
         }
 
         try {
             YAML::Node root = YAML::LoadFile(file);
-            LoadFromYaml(root);
+            RWMutexType::ReadLock lock{GetMutex()};
+            std::string prefix;
+            CollectUpdates(prefix, root, force, hashes, updates);
             SYLAR_LOG_INFO(g_logger) << "LoadConfFile file=" << file << " ok";
         } catch (...) {
             SYLAR_LOG_ERROR(g_logger) << "LoadConfFile file=" << file << " failed";
         }
     }
+    ApplyUpdates(updates);
+
+    sylar::Mutex::Lock lock{s_mutex};
+    for (auto &[file, hashes] : file2hashes) {
+        s_file2hashes[file] = std::move(hashes);
+    }
+}
+
+// 快照格式: 头部 magic(8) + version(u32) + count(u32) + fingerprint(u64)
+// 之后每项: name(u32长度+内容) + type(u32长度+内容) + yaml hash(u64) + value(u32长度+内容)
+// yaml hash为0表示该项使用默认值, value为空
+static constexpr const char *SNAPSHOT_MAGIC = "SYLARCS1";
+static constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+uint64_t Config::Fingerprint(const std::string &path) {
+    std::vector<std::string> files;
+    FSUtil::ListAllFile(files, sylar::EnvMgr::GetInstance()->getAbsolutePath(path), ".yml");
+    std::sort(files.begin(), files.end());
+
+    uint64_t hash = FNV_OFFSET;
+    for (const auto &file : files) {
+        struct stat st;
+        if (stat(file.c_str(), &st)) {
+            continue;
+        }
+        uint64_t meta[] = {(uint64_t)st.st_mtim.tv_sec, (uint64_t)st.st_mtim.tv_nsec, (uint64_t)st.st_size};
+        hash = HashBytes(hash, file.c_str(), file.size() + 1);
+        hash = HashBytes(hash, reinterpret_cast<const char *>(meta), sizeof meta);
+    }
+    return hash;
+}
+
+bool Config::SaveSnapshot(const std::string &file, uint64_t fingerprint) {
+    std::string buf{SNAPSHOT_MAGIC};
+    BinaryCast<uint32_t>::Encode(buf, SNAPSHOT_VERSION);
+    BinaryCast<uint32_t>::Encode(buf, 0);
+    BinaryCast<uint64_t>::Encode(buf, fingerprint);
+
+    uint32_t count = 0;
+    std::string value;
+    {
+        RWMutexType::ReadLock lock{GetMutex()};
+        for (const auto &[name, var] : GetDatas()) {
+            BinaryCast<std::string>::Encode(buf, name);
+            BinaryCast<std::string>::Encode(buf, var->getTypeName());
+            // 没有从YAML加载过的配置项只记录名称, 保留程序中的默认值
+            uint64_t hash = var->getYamlHash();
+            BinaryCast<uint64_t>::Encode(buf, hash);
+            value.clear();
+            if (hash) {
+                var->toBinary(value);
+            }
+            BinaryCast<std::string>::Encode(buf, value);
+            ++count;
+        }
+    }
+    memcpy(&buf[8 + sizeof(uint32_t)], &count, sizeof count);
+
+    // 先写临时文件再改名, 读取方不会看到写了一半的快照
+    std::string tmp = file + ".tmp";
+    {
+        std::ofstream ofs{tmp, std::ios::binary | std::ios::trunc};
+        if (!ofs || !ofs.write(buf.data(), buf.size())) {
+            SYLAR_LOG_ERROR(g_logger) << "SaveSnapshot write " << tmp << " failed";
+            return false;
+        }
+    }
+    if (rename(tmp.c_str(), file.c_str())) {
+        SYLAR_LOG_ERROR(g_logger) << "SaveSnapshot rename " << tmp << " errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Config::LoadSnapshot(const std::string &file, uint64_t fingerprint) {
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < 24) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    std::unique_ptr<void, std::function<void(void *)>> guard{addr, [size](void *ptr) { munmap(ptr, size); }};
+
+    const char *ptr = static_cast<const char *>(addr);
+    const char *end = ptr + size;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    uint64_t fp = 0;
+    if (memcmp(ptr, SNAPSHOT_MAGIC, 8)) {
+        SYLAR_LOG_WARN(g_logger) << "LoadSnapshot " << file << " bad magic";
+        return false;
+    }
+    ptr += 8;
+    BinaryCast<uint32_t>::Decode(ptr, end, version);
+    BinaryCast<uint32_t>::Decode(ptr, end, count);
+    BinaryCast<uint64_t>::Decode(ptr, end, fp);
+    if (version != SNAPSHOT_VERSION || fp != fingerprint) {
+        SYLAR_LOG_INFO(g_logger) << "LoadSnapshot " << file << " outdated, version=" << version;
+        return false;
+    }
+
+    struct Entry {
+        ConfigVarBase::ptr m_var;
+        const char *m_data;
+        uint32_t m_len;
+        uint64_t m_hash;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(count);
+    {
+        // 先校验全部条目再应用, 任何一项不匹配都回退到YAML
+        RWMutexType::ReadLock lock{GetMutex()};
+        std::string name;
+        std::string type;
+        std::unordered_set<std::string> covered;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t hash = 0;
+            uint32_t len = 0;
+            if (!BinaryCast<std::string>::Decode(ptr, end, name) || !BinaryCast<std::string>::Decode(ptr, end, type) ||
+                !BinaryCast<uint64_t>::Decode(ptr, end, hash) || !BinaryCast<uint32_t>::Decode(ptr, end, len) ||
+                static_cast<size_t>(end - ptr) < len) {
+                SYLAR_LOG_WARN(g_logger) << "LoadSnapshot " << file << " truncated";
+                return false;
+            }
+            const char *data = ptr;
+            ptr += len;
+
+            // 程序中已删除的配置项直接忽略
+            auto it = GetDatas().find(name);
+            if (it == GetDatas().end()) {
+                continue;
+            }
+            if (type != it->second->getTypeName()) {
+                SYLAR_LOG_INFO(g_logger) << "LoadSnapshot " << file << " type changed name=" << name;
+                return false;
+            }
+            covered.insert(name);
+            if (hash) {
+                entries.push_back({it->second, data, len, hash});
+            }
+        }
+        if (covered.size() != GetDatas().size()) {
+            SYLAR_LOG_INFO(g_logger) << "LoadSnapshot " << file << " misses "
+                                     << GetDatas().size() - covered.size() << " config vars";
+            return false;
+        }
+    }
+
+    std::vector<ConfigVarBase::Change::ptr> changes;
+    for (const auto &entry : entries) {
+        ConfigVarBase::Change::ptr change;
+        if (!entry.m_var->prepareBinary(entry.m_data, entry.m_len, entry.m_hash, change)) {
+            SYLAR_LOG_ERROR(g_logger) << "LoadSnapshot " << file << " decode failed name=" << entry.m_var->getName();
+            return false;
+        }
+        if (change) {
+            changes.push_back(std::move(change));
+        }
+    }
+    ConfigVarBase::Commit(std::move(changes));
+    return true;
+}
+
+void Config::LoadFromConfDirCached(const std::string &path, const std::string &snapshot) {
+    uint64_t fingerprint = Fingerprint(path);
+    if (LoadSnapshot(snapshot, fingerprint)) {
+        // 记录修改时间, 之后的LoadFromConfDir只处理真正变化的文件
+        std::vector<std::string> files;
+        FSUtil::ListAllFile(files, sylar::EnvMgr::GetInstance()->getAbsolutePath(path), ".yml");
+        sylar::Mutex::Lock lock{s_mutex};
+        for (const auto &file : files) {
+            struct stat st;
+            lstat(file.c_str(), &st);
+            s_file2modifytime[file] = st.st_mtime;
+        }
+        SYLAR_LOG_INFO(g_logger) << "LoadConfDir " << path << " from snapshot " << snapshot;
+        return;
+    }
+
+    LoadFromConfDir(path, true);
+    SaveSnapshot(snapshot, fingerprint);
+}
+
+// 提交互斥, 保证同一时刻只有一个批次在发布
+static sylar::Mutex s_commit_mutex;
+static sylar::Mutex s_executor_mutex;
+static Config::Executor s_executor;
+
+void ConfigVarBase::Commit(std::vector<Change::ptr> changes) {
+    if (changes.empty()) {
+        return;
+    }
+    {
+        sylar::Mutex::Lock lock{s_commit_mutex};
+        uint64_t version = s_version.load(std::memory_order_relaxed);
+        s_version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (auto &change : changes) {
+            change->publish();
+        }
+        s_version.store(version + 2, std::memory_order_release);
+        // 整个批次只等待一次, 之后旧值可以回收
+        RcuDomain::Synchronize();
+        for (auto &change : changes) {
+            change->reclaim();
+        }
+    }
+
+    Config::Executor executor;
+    {
+        sylar::Mutex::Lock lock{s_executor_mutex};
+        executor = s_executor;
+    }
+    if (!executor) {
+        for (auto &change : changes) {
+            change->notify();
+        }
+        return;
+    }
+    auto batch = std::make_shared<std::vector<Change::ptr>>(std::move(changes));
+    executor([batch]() {
+        for (auto &change : *batch) {
+            change->notify();
+        }
+    });
+}
+
+void Config::SetListenerExecutor(Executor executor) {
+    sylar::Mutex::Lock lock{s_executor_mutex};
+    s_executor = std::move(executor);
 }
 
 void Config::Visit(std::function<void(ConfigVarBase::ptr)> cb) {
-    RWMutexType::ReadLock lock{GetMutex()};
-    for (const auto &[_, varBase] : GetDatas()) {
+    // 读锁不可重入, 不能在持锁时执行cb
+    std::vector<ConfigVarBase::ptr> vars;
+    {
+        RWMutexType::ReadLock lock{GetMutex()};
+        vars.reserve(GetDatas().size());
+        for (const auto &[_, varBase] : GetDatas()) {
+            vars.push_back(varBase);
+        }
+    }
+    for (const auto &varBase : vars) {
         cb(varBase);
     }
 }
@@ -2,6 +2,8 @@
 
 #include <yaml-cpp/yaml.h>
 #include <boost/lexical_cast.hpp>
+#include <atomic>
+#include <cstring>
 #include <functional>
 #include <list>
 #include <map>
@@ -9,12 +11,14 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "log.h"
 #include "mutex.h"
+#include "rcu.h"
 #include "util.h"
 
 namespace sylar {
@@ -38,11 +42,74 @@ public:
 
     virtual bool fromString(const std::string &val) = 0;
 
+    // 单个配置项的待提交变更, 由Commit统一发布
+    class Change {
+    public:
+        using ptr = std::unique_ptr<Change>;
+
+        virtual ~Change() {}
+
+        // 在提交锁内发布新值, 旧值暂不回收
+        virtual void publish() = 0;
+
+        // 旧值的读者全部退出后回收
+        virtual void reclaim() = 0;
+
+        // 以提交时的旧值/新值调用监听器
+        virtual void notify() = 0;
+    };
+
+    // 直接由YAML节点转换, hash为该节点子树的哈希, 用于下次加载时跳过未变化的子树
+    // 转换失败返回false; 值未变化时change为空
+    virtual bool prepareYaml(const YAML::Node &node, uint64_t hash, Change::ptr &change) = 0;
+
+    // 配置快照使用的二进制编码
+    virtual void toBinary(std::string &buf) = 0;
+
+    virtual bool prepareBinary(const char *data, size_t len, uint64_t hash, Change::ptr &change) = 0;
+
     virtual std::string getTypeName() const = 0;
 
+    uint64_t getYamlHash() const { return m_yamlHash.load(std::memory_order_relaxed); }
+
+    // 一批变更作为一次提交发布, 只等待一次旧值读者退出
+    // 读取都等待进行中的提交结束, 读到某批次的任一新值后, 之后的读取都能看到整个批次
+    // 多个配置项需要读到同一批次时使用Config::ReadConsistent
+    // 监听器在整批发布之后才通过Config::SetListenerExecutor设置的执行器调用, 此时读到的已是新值
+    static void Commit(std::vector<Change::ptr> changes);
+
+    // 在没有提交进行的区间内执行read, 期间有提交时重新执行; read须可重复执行且不能让出协程
+    // 提交中先短暂自旋再让出CPU, 不与提交线程抢占
+    template <typename F>
+    static void ReadPublished(F &&read) {
+        for (uint32_t spins = 0;; ++spins) {
+            uint64_t version = s_version.load(std::memory_order_acquire);
+            if (!(version & 1)) {
+                read();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s_version.load(std::memory_order_relaxed) == version) {
+                    return;
+                }
+            }
+            if (spins < futex::MaxSpin()) {
+                futex::CpuRelax();
+            } else {
+                sched_yield();
+            }
+        }
+    }
+
+    // 提交次数的序号, 提交过程中为奇数
+    static uint64_t GetVersion() { return s_version.load(std::memory_order_acquire); }
+
 protected:
     std::string m_name;
     std::string m_description;
+    // 最近一次从YAML加载的子树哈希, 值被其他途径修改后清零
+    std::atomic<uint64_t> m_yamlHash{0};
+
+private:
+    inline static std::atomic<uint64_t> s_version{0};
 };
 
 template <typename F, typename T>
@@ -231,6 +298,160 @@ public:
     }
 };
 
+// YAML节点直接转换为T, 容器逐个转换子节点, 避免先序列化成字符串再解析
+template <typename T>
+class YamlCast {
+public:
+    T operator()(const YAML::Node &node) {
+        if (node.IsScalar()) {
+            return LexicalCast<std::string, T>{}(node.Scalar());
+        }
+        std::stringstream ss;
+        ss << node;
+        return LexicalCast<std::string, T>{}(ss.str());
+    }
+};
+
+#define XX(Container, insert)                                  \
+    template <typename T>                                      \
+    class YamlCast<Container<T>> {                             \
+    public:                                                    \
+        Container<T> operator()(const YAML::Node &node) {      \
+            Container<T> res;                                  \
+            for (const auto &child : node) {                   \
+                res.insert(YamlCast<T>{}(child));              \
+            }                                                  \
+            return res;                                        \
+        }                                                      \
+    };
+
+XX(std::vector, push_back)
+XX(std::list, push_back)
+XX(std::set, insert)
+XX(std::unordered_set, insert)
+#undef XX
+
+#define XX(Map)                                                                 \
+    template <typename T>                                                       \
+    class YamlCast<Map<std::string, T>> {                                       \
+    public:                                                                     \
+        Map<std::string, T> operator()(const YAML::Node &node) {                \
+            Map<std::string, T> res;                                            \
+            for (auto it = node.begin(); it != node.end(); ++it) {              \
+                res.insert({it->first.Scalar(), YamlCast<T>{}(it->second)});    \
+            }                                                                   \
+            return res;                                                         \
+        }                                                                       \
+    };
+
+XX(std::map)
+XX(std::unordered_map)
+#undef XX
+
+// 快照中值的二进制编码: 算术类型按内存布局, 字符串和容器带u32长度前缀; 不支持的类型存toString()的结果
+template <typename T, typename = void>
+class BinaryCast : public std::false_type {};
+
+template <typename T>
+class BinaryCast<T, std::enable_if_t<std::is_arithmetic_v<T>>> : public std::true_type {
+public:
+    static void Encode(std::string &buf, const T &val) { buf.append(reinterpret_cast<const char *>(&val), sizeof val); }
+
+    static bool Decode(const char *&ptr, const char *end, T &val) {
+        if (static_cast<size_t>(end - ptr) < sizeof val) {
+            return false;
+        }
+        memcpy(&val, ptr, sizeof val);
+        ptr += sizeof val;
+        return true;
+    }
+};
+
+template <>
+class BinaryCast<std::string> : public std::true_type {
+public:
+    static void Encode(std::string &buf, const std::string &val) {
+        BinaryCast<uint32_t>::Encode(buf, val.size());
+        buf.append(val);
+    }
+
+    static bool Decode(const char *&ptr, const char *end, std::string &val) {
+        uint32_t len = 0;
+        if (!BinaryCast<uint32_t>::Decode(ptr, end, len) || static_cast<size_t>(end - ptr) < len) {
+            return false;
+        }
+        val.assign(ptr, len);
+        ptr += len;
+        return true;
+    }
+};
+
+#define XX(Container)                                                                    \
+    template <typename T>                                                                \
+    class BinaryCast<Container<T>, std::enable_if_t<BinaryCast<T>::value>> : public std::true_type { \
+    public:                                                                              \
+        static void Encode(std::string &buf, const Container<T> &val) {                  \
+            BinaryCast<uint32_t>::Encode(buf, val.size());                               \
+            for (const auto &item : val) {                                               \
+                BinaryCast<T>::Encode(buf, item);                                        \
+            }                                                                            \
+        }                                                                                \
+                                                                                         \
+        static bool Decode(const char *&ptr, const char *end, Container<T> &val) {       \
+            uint32_t count = 0;                                                          \
+            if (!BinaryCast<uint32_t>::Decode(ptr, end, count)) {                        \
+                return false;                                                            \
+            }                                                                            \
+            for (uint32_t i = 0; i < count; ++i) {                                       \
+                T item;                                                                  \
+                if (!BinaryCast<T>::Decode(ptr, end, item)) {                            \
+                    return false;                                                        \
+                }                                                                        \
+                val.insert(val.end(), std::move(item));                                  \
+            }                                                                            \
+            return true;                                                                 \
+        }                                                                                \
+    };
+
+XX(std::vector)
+XX(std::list)
+XX(std::set)
+XX(std::unordered_set)
+#undef XX
+
+#define XX(Map)                                                                                         \
+    template <typename T>                                                                               \
+    class BinaryCast<Map<std::string, T>, std::enable_if_t<BinaryCast<T>::value>> : public std::true_type { \
+    public:                                                                                             \
+        static void Encode(std::string &buf, const Map<std::string, T> &val) {                          \
+            BinaryCast<uint32_t>::Encode(buf, val.size());                                              \
+            for (const auto &[key, item] : val) {                                                       \
+                BinaryCast<std::string>::Encode(buf, key);                                              \
+                BinaryCast<T>::Encode(buf, item);                                                       \
+            }                                                                                           \
+        }                                                                                               \
+                                                                                                        \
+        static bool Decode(const char *&ptr, const char *end, Map<std::string, T> &val) {               \
+            uint32_t count = 0;                                                                         \
+            if (!BinaryCast<uint32_t>::Decode(ptr, end, count)) {                                       \
+                return false;                                                                           \
+            }                                                                                           \
+            for (uint32_t i = 0; i < count; ++i) {                                                      \
+                std::string key;                                                                        \
+                T item;                                                                                 \
+                if (!BinaryCast<std::string>::Decode(ptr, end, key) || !BinaryCast<T>::Decode(ptr, end, item)) { \
+                    return false;                                                                       \
+                }                                                                                       \
+                val.insert({std::move(key), std::move(item)});                                          \
+            }                                                                                           \
+            return true;                                                                                \
+        }                                                                                               \
+    };
+
+XX(std::map)
+XX(std::unordered_map)
+#undef XX
+
 template <typename T, typename FromStr = LexicalCast<std::string, T>, typename ToStr = LexicalCast<T, std::string>>
 class ConfigVar : public ConfigVarBase {
 public:
@@ -238,13 +459,30 @@ public:
     using ptr = std::shared_ptr<ConfigVar>;
     using on_change_cb = std::function<void(const T &old_value, const T &new_value)>;
 
+    using ValuePtr = std::shared_ptr<const T>;
+
+    // 读快照: 持有期间值不会被回收, 没有提交时只有三次原子读取; 不能跨协程切换持有
+    class Snapshot : Noncopyable {
+    public:
+        Snapshot(const ConfigVar &var) {
+            ReadPublished([&]() { m_val = var.m_val.get()->get(); });
+        }
+
+        const T &operator*() const { return *m_val; }
+
+        const T *operator->() const { return m_val; }
+
+    private:
+        RcuReadGuard m_guard;
+        const T *m_val = nullptr;
+    };
+
     ConfigVar(const std::string &name, const T &default_value, const std::string &description = "")
-        : ConfigVarBase{name, description}, m_val{default_value} {}
+        : ConfigVarBase{name, description}, m_val{new ValuePtr{std::make_shared<const T>(default_value)}} {}
 
     std::string toString() override {
         try {
-            RWMutexType::ReadLock lock{m_mutex};
-            return ToStr{}(m_val);
+            return ToStr{}(*getShared());
         } catch (std::exception &e) {
             SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ConfigVar::toString exception " << e.what()
                                               << " convert: " << TypeToName<T>() << " to string" << " name=" << m_name;
@@ -255,6 +493,7 @@ public:
     bool fromString(const std::string &val) override {
         try {
             setValue(FromStr{}(val));
+            return true;
         } catch (std::exception &e) {
             SYLAR_LOG_ERROR(SYLAR_LOG_ROOT())
                 << "ConfigVar::fromString exception " << e.what() << " convert: string to " << TypeToName<T>()
@@ -263,23 +502,75 @@ public:
         return false;
     }
 
-    const T getValue() {
-        RWMutexType::ReadLock lock{m_mutex};
-        return m_val;
+    bool prepareYaml(const YAML::Node &node, uint64_t hash, ConfigVarBase::Change::ptr &change) override {
+        try {
+            // 自定义了FromStr的类型仍走字符串转换
+            if constexpr (DefaultCast) {
+                change = prepare(std::make_shared<const T>(YamlCast<T>{}(node)), hash);
+            } else {
+                std::stringstream ss;
+                ss << node;
+                change = prepare(std::make_shared<const T>(FromStr{}(node.IsScalar() ? node.Scalar() : ss.str())), hash);
+            }
+            return true;
+        } catch (std::exception &e) {
+            SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ConfigVar::prepareYaml exception " << e.what()
+                                              << " convert: yaml to " << TypeToName<T>() << " name=" << m_name;
+        }
+        return false;
     }
 
-    void setValue(const T &val) {
-        {
-            RWMutexType::ReadLock lock{m_mutex};
-            if (m_val == val) {
-                return;
-            }
-            for (const auto &[_, cb] : m_cbs) {
-                cb(m_val, val);
+    void toBinary(std::string &buf) override {
+        if constexpr (UseBinaryCast) {
+            BinaryCast<T>::Encode(buf, *getSnapshot());
+        } else {
+            buf.append(toString());
+        }
+    }
+
+    bool prepareBinary(const char *data, size_t len, uint64_t hash, ConfigVarBase::Change::ptr &change) override {
+        try {
+            if constexpr (UseBinaryCast) {
+                auto val = std::make_shared<T>();
+                const char *ptr = data;
+                if (!BinaryCast<T>::Decode(ptr, data + len, *val) || ptr != data + len) {
+                    return false;
+                }
+                change = prepare(std::move(val), hash);
+            } else {
+                change = prepare(std::make_shared<const T>(FromStr{}(std::string{data, len})), hash);
             }
+            return true;
+        } catch (std::exception &e) {
+            SYLAR_LOG_ERROR(SYLAR_LOG_ROOT()) << "ConfigVar::prepareBinary exception " << e.what()
+                                              << " convert: binary to " << TypeToName<T>() << " name=" << m_name;
         }
-        RWMutexType::WriteLock lock{m_mutex};
-        m_val = val;
+        return false;
+    }
+
+    const T getValue() const {
+        Snapshot snapshot{*this};
+        return *snapshot;
+    }
+
+    Snapshot getSnapshot() const { return Snapshot{*this}; }
+
+    // 需要长期持有或跨协程切换时使用, 比Snapshot多一次引用计数操作
+    ValuePtr getShared() const {
+        RcuReadGuard guard;
+        ValuePtr val;
+        ReadPublished([&]() { val = *m_val.get(); });
+        return val;
+    }
+
+    // 单独提交一个配置项, 监听器在新值发布之后调用
+    void setValue(const T &val) {
+        if (*getSnapshot() == val) {
+            return;
+        }
+        std::vector<ConfigVarBase::Change::ptr> changes;
+        changes.emplace_back(new Change{this, std::make_shared<const T>(val), 0});
+        Commit(std::move(changes));
     }
 
     std::string getTypeName() const override { return TypeToName<T>(); }
@@ -308,16 +599,68 @@ public:
         m_cbs.clear();
     }
 
+private:
+    class Change : public ConfigVarBase::Change {
+    public:
+        Change(ConfigVar *var, ValuePtr val, uint64_t hash) : m_var{var}, m_new{std::move(val)}, m_hash{hash} {}
+
+        void publish() override {
+            {
+                RWMutexType::ReadLock lock{m_var->m_mutex};
+                m_cbs.reserve(m_var->m_cbs.size());
+                for (const auto &[_, cb] : m_var->m_cbs) {
+                    m_cbs.push_back(cb);
+                }
+            }
+            m_retired.reset(m_var->m_val.exchange(new ValuePtr{m_new}));
+            m_old = *m_retired;
+            m_var->m_yamlHash.store(m_hash, std::memory_order_relaxed);
+        }
+
+        void reclaim() override { m_retired.reset(); }
+
+        // 不再访问配置项本身, 执行器上延后调用时配置项可能已经析构
+        void notify() override {
+            for (const auto &cb : m_cbs) {
+                cb(*m_old, *m_new);
+            }
+        }
+
+    private:
+        ConfigVar *m_var;
+        ValuePtr m_old;
+        ValuePtr m_new;
+        uint64_t m_hash;
+        std::unique_ptr<ValuePtr> m_retired;
+        std::vector<on_change_cb> m_cbs;
+    };
+
+    // 值未变化时只记录YAML哈希, 不产生变更
+    ConfigVarBase::Change::ptr prepare(ValuePtr val, uint64_t hash) {
+        if (*getSnapshot() == *val) {
+            if (hash) {
+                m_yamlHash.store(hash, std::memory_order_relaxed);
+            }
+            return nullptr;
+        }
+        return ConfigVarBase::Change::ptr{new Change{this, std::move(val), hash}};
+    }
+
+private:
+    static constexpr bool DefaultCast =
+        std::is_same_v<FromStr, LexicalCast<std::string, T>> && std::is_same_v<ToStr, LexicalCast<T, std::string>>;
+    static constexpr bool UseBinaryCast = DefaultCast && BinaryCast<T>::value;
+
 private:
     RWMutexType m_mutex;
-    T m_val;
+    RcuPtr<ValuePtr> m_val;
     std::map<uint64_t, on_change_cb> m_cbs;
 };
 
 class Config {
 public:
     using ConfigVarMap = std::unordered_map<std::string, ConfigVarBase::ptr>;
-    using RWMutexType = RWMutex;
+    using RWMutexType = BRRWMutex;
 
     template <typename T>
     static typename ConfigVar<T>::ptr Lookup(const std::string &name, const T &default_value,
@@ -358,15 +701,70 @@ public:
         return std::dynamic_pointer_cast<ConfigVar<T>>(it->second);
     }
 
-    static void LoadFromYaml(const YAML::Node &root);
+    // 一个来源(通常是一个配置文件)上次应用的各配置项子树哈希
+    using YamlHashes = std::unordered_map<std::string, uint64_t>;
+
+    // 一次遍历配置树, 自底向上计算子树哈希, 每个节点只哈希一次
+    // 哈希与配置项当前值来源相同的配置项不做转换直接跳过; force为true时全部重新应用
+    // 返回实际应用的配置项数
+    static size_t LoadFromYaml(const YAML::Node &root, bool force = false);
+
+    // 与hashes中记录的该来源上次的哈希比较, 多个文件设置同一配置项时互不影响; 由调用方保证hashes不被并发访问
+    static size_t LoadFromYaml(const YAML::Node &root, YamlHashes &hashes, bool force = false);
 
     static void LoadFromConfDir(const std::string &path, bool force = false);
 
+    // 配置目录下所有.yml文件的路径、修改时间和大小的指纹
+    static uint64_t Fingerprint(const std::string &path);
+
+    // 把所有配置项的当前值写入二进制快照, fingerprint为生成这些值的配置目录的指纹
+    static bool SaveSnapshot(const std::string &file, uint64_t fingerprint);
+
+    // 指纹一致且快照覆盖了所有已注册的配置项时才应用, 否则返回false且不修改任何值
+    static bool LoadSnapshot(const std::string &file, uint64_t fingerprint);
+
+    // 配置目录未变化时从快照加载, 否则解析YAML并重新生成快照
+    static void LoadFromConfDirCached(const std::string &path, const std::string &snapshot);
+
     static ConfigVarBase::ptr LookupBase(const std::string &name);
 
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // 设置监听器的执行器, 例如 [iom](auto cb) { iom->schedule(cb); }; 为空时在提交线程上直接调用
+    // 同一次提交的监听器按顺序在一个任务中执行
+    static void SetListenerExecutor(Executor executor);
+
+    // 提交次数的序号, 提交过程中为奇数
+    static uint64_t GetVersion() { return ConfigVarBase::GetVersion(); }
+
+    // 在同一批次的配置上执行cb, 期间有提交时重新执行, cb须可重复执行且不能让出协程
+    template <typename F>
+    static void ReadConsistent(F &&cb) {
+        ConfigVarBase::ReadPublished([&]() {
+            RcuReadGuard guard;
+            cb();
+        });
+    }
+
+    // cb在锁外对配置项列表的快照执行, 其中可以调用Lookup; 遍历期间新注册的配置项不会被访问
     static void Visit(std::function<void(ConfigVarBase::ptr)> cb);
 
 private:
+    struct PendingUpdate {
+        ConfigVarBase::ptr m_var;
+        YAML::Node m_node;
+        uint64_t m_hash;
+        // 转换成功后把m_hash记入该来源的哈希表, 为空时只记在配置项上
+        YamlHashes *m_hashes;
+    };
+
+    // 返回node的子树哈希; hashes为空时与配置项上记录的哈希比较
+    static uint64_t CollectUpdates(std::string &prefix, const YAML::Node &node, bool force, YamlHashes *hashes,
+                                   std::vector<PendingUpdate> &updates);
+
+    // 转换成功的更新作为一个批次提交, 返回应用的配置项数
+    static size_t ApplyUpdates(const std::vector<PendingUpdate> &updates);
+
     static ConfigVarMap &GetDatas() {
         static ConfigVarMap s_datas;
         return s_datas;
@@ -0,0 +1,201 @@
+#include "config_watcher.h"
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "config.h"
+#include "env.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint32_t>::ptr g_config_watch_debounce =
+    sylar::Config::Lookup("config.watch.debounce", (uint32_t)200, "config watcher debounce interval(ms)");
+
+static constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+
+static bool IsConfFile(const std::string &file) {
+    return file.size() > 4 && file.compare(file.size() - 4, 4, ".yml") == 0;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string &path, IOManager *iom, Scheduler *executor)
+    : m_path{EnvMgr::GetInstance()->getAbsolutePath(path)}, m_iom{iom}, m_executor{executor} {
+    if (!m_executor) {
+        m_ownExecutor.reset(new IOManager{1, false, "config_watcher"});
+        m_executor = m_ownExecutor.get();
+    }
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stop();
+    // 先停掉内部executor, 确保没有正在执行的重新加载
+    m_ownExecutor.reset();
+}
+
+bool ConfigWatcher::start() {
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd == -1) {
+        SYLAR_LOG_ERROR(g_logger) << "inotify_init1 errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    if (!addWatch(m_path)) {
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    std::vector<std::string> files;
+    FSUtil::ListAllFile(files, m_path, ".yml");
+    for (const auto &file : files) {
+        reloadFile(file);
+    }
+
+    MutexType::Lock lock{m_mutex};
+    if (!arm()) {
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void ConfigWatcher::stop() {
+    MutexType::Lock lock{m_mutex};
+    if (m_fd == -1 || m_stopping) {
+        return;
+    }
+    m_stopping = true;
+    if (m_timer) {
+        m_timer->cancel();
+        m_timer = nullptr;
+    }
+    // 在锁内注销并关闭: onReadable持锁检查m_stopping后才重新注册, 不会注册到已关闭或被复用的fd上
+    m_iom->cancelEvent(m_fd, IOManager::READ);
+    close(m_fd);
+    m_fd = -1;
+}
+
+bool ConfigWatcher::addWatch(const std::string &dir) {
+    int wd = inotify_add_watch(m_fd, dir.c_str(), WATCH_MASK);
+    if (wd == -1) {
+        SYLAR_LOG_ERROR(g_logger) << "inotify_add_watch(" << dir << ") errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        return false;
+    }
+    m_dirs[wd] = dir;
+
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return true;
+    }
+    while (struct dirent *dp = readdir(d)) {
+        if (dp->d_type == DT_DIR && strcmp(dp->d_name, ".") && strcmp(dp->d_name, "..")) {
+            addWatch(dir + "/" + dp->d_name);
+        }
+    }
+    closedir(d);
+    return true;
+}
+
+bool ConfigWatcher::arm() {
+    if (m_stopping) {
+        return false;
+    }
+    std::weak_ptr<ConfigWatcher> weak = shared_from_this();
+    auto cb = [weak]() {
+        if (auto self = weak.lock(); self) {
+            self->onReadable();
+        }
+    };
+    if (!m_iom->addEvent(m_fd, IOManager::READ, cb)) {
+        SYLAR_LOG_ERROR(g_logger) << "ConfigWatcher addEvent(" << m_fd << ") failed, stop watching " << m_path;
+        return false;
+    }
+    return true;
+}
+
+void ConfigWatcher::onReadable() {
+    MutexType::Lock lock{m_mutex};
+    if (m_stopping) {
+        return;
+    }
+
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = read(m_fd, buf, sizeof buf)) > 0) {
+        for (char *ptr = buf; ptr < buf + n;) {
+            auto event = reinterpret_cast<inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            auto it = m_dirs.find(event->wd);
+            if (it == m_dirs.end()) {
+                continue;
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                m_dirs.erase(it);
+                continue;
+            }
+            std::string file = it->second + "/" + (event->len ? event->name : "");
+            if (event->mask & IN_ISDIR) {
+                // 新建的子目录: 加入监听, 其中已有的配置文件一并重新加载
+                if (addWatch(file)) {
+                    std::vector<std::string> files;
+                    FSUtil::ListAllFile(files, file, ".yml");
+                    m_pending.insert(files.begin(), files.end());
+                }
+            } else if (!(event->mask & IN_CREATE) && IsConfFile(file)) {
+                // 新建文件等到写完关闭(IN_CLOSE_WRITE)时再处理
+                m_pending.insert(file);
+            }
+        }
+    }
+
+    if (!m_pending.empty()) {
+        uint64_t debounce = g_config_watch_debounce->getValue();
+        if (!m_timer || !m_timer->reset(debounce, true)) {
+            std::weak_ptr<ConfigWatcher> weak = shared_from_this();
+            m_timer = m_iom->addTimer(debounce, [weak]() {
+                if (auto self = weak.lock(); self) {
+                    self->onDebounce();
+                }
+            });
+        }
+    }
+    arm();
+}
+
+void ConfigWatcher::onDebounce() {
+    std::set<std::string> files;
+    {
+        MutexType::Lock lock{m_mutex};
+        if (m_stopping) {
+            return;
+        }
+        m_timer = nullptr;
+        files.swap(m_pending);
+    }
+    std::weak_ptr<ConfigWatcher> weak = shared_from_this();
+    m_executor->schedule([weak, files]() {
+        if (auto self = weak.lock(); self) {
+            for (const auto &file : files) {
+                self->reloadFile(file);
+            }
+        }
+    });
+}
+
+void ConfigWatcher::reloadFile(const std::string &file) {
+    MutexType::Lock lock{m_reloadMutex};
+    try {
+        YAML::Node root = YAML::LoadFile(file);
+        size_t count = Config::LoadFromYaml(root, m_hashes[file]);
+        ++m_reloadCount;
+        SYLAR_LOG_INFO(g_logger) << "ConfigWatcher reload file=" << file << " changed=" << count;
+    } catch (...) {
+        SYLAR_LOG_ERROR(g_logger) << "ConfigWatcher reload file=" << file << " failed";
+    }
+}
+
+}  // namespace sylar
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "config.h"
+#include "iomanager.h"
+#include "mutex.h"
+#include "noncopyable.h"
+
+namespace sylar {
+
+// 用inotify监听配置目录, 合并一段时间内的变更事件后只重新加载变化的文件中值有变化的配置项
+// inotify fd注册在iom上, 重新加载和监听器回调在executor上执行, 不占用iom的线程
+class ConfigWatcher : public std::enable_shared_from_this<ConfigWatcher>, Noncopyable {
+public:
+    using ptr = std::shared_ptr<ConfigWatcher>;
+    using MutexType = Mutex;
+
+    // executor为空时内部创建一个单线程的IOManager执行重新加载
+    ConfigWatcher(const std::string &path, IOManager *iom, Scheduler *executor = nullptr);
+
+    ~ConfigWatcher();
+
+    // 加载一遍目录下所有配置文件并开始监听
+    bool start();
+
+    void stop();
+
+    const std::string &getPath() const { return m_path; }
+
+    uint64_t getReloadCount() const { return m_reloadCount; }
+
+private:
+    bool addWatch(const std::string &dir);
+
+    // 须持有m_mutex, 停止后不再注册
+    bool arm();
+
+    void onReadable();
+
+    void onDebounce();
+
+    void reloadFile(const std::string &file);
+
+private:
+    std::string m_path;
+    IOManager *m_iom;
+    Scheduler *m_executor;
+    std::unique_ptr<IOManager> m_ownExecutor;
+    int m_fd = -1;
+    bool m_stopping = false;
+    MutexType m_mutex;
+    // inotify watch描述符 -> 目录
+    std::map<int, std::string> m_dirs;
+    // 防抖期间变化的文件
+    std::set<std::string> m_pending;
+    Timer::ptr m_timer;
+    MutexType m_reloadMutex;
+    // 每个文件上次应用的各配置项子树哈希
+    std::unordered_map<std::string, Config::YamlHashes> m_hashes;
+    std::atomic<uint64_t> m_reloadCount{0};
+};
+
+}  // namespace sylar
@@ -2,107 +2,203 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <limits>
+#include <algorithm>
+#include <sstream>
 #include "hook.h"
+#include "iomanager.h"
 
 namespace sylar {
 
-FdCtx::FdCtx(int fd)
-    : m_isInit{false},
-      m_isSocket{false},
-      m_sysNonBlock{false},
-      m_userNonBlock{false},
-      m_isClosed{false},
-      m_fd{fd},
-      m_recvTimeout{std::numeric_limits<uint64_t>::max()},
-      m_sendTimeout{std::numeric_limits<uint64_t>::max()} {
-    init();
+const char *FdCtx::MetricToString(Metric metric) {
+    switch (metric) {
+#define XX(name) \
+    case name:   \
+        return #name;
+        XX(BYTES_READ);
+        XX(BYTES_WRITTEN);
+        XX(SYSCALLS);
+        XX(PARKS);
+        XX(PARK_TIME);
+        XX(TIMEOUTS);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
 }
 
-FdCtx::~FdCtx() {}
+std::string FdCtx::Stats::toString() const {
+    std::stringstream ss;
+    ss << "fd=" << m_fd;
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        ss << " " << MetricToString(static_cast<Metric>(i)) << "=" << m_values[i];
+    }
+    return ss.str();
+}
 
-bool FdCtx::init() {
-    if (m_isInit) {
-        return true;
+void FdCtx::setFlag(uint32_t flag, bool val) {
+    if (val) {
+        m_flags.fetch_or(flag, std::memory_order_acq_rel);
+    } else {
+        m_flags.fetch_and(~flag, std::memory_order_acq_rel);
     }
-    m_recvTimeout = std::numeric_limits<uint64_t>::max();
-    m_sendTimeout = std::numeric_limits<uint64_t>::max();
+}
 
+bool FdCtx::init() {
+    m_recvTimeout.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    m_sendTimeout.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+
+    uint32_t flags = 0;
     struct stat fdStat;
-    if (-1 == fstat(m_fd, &fdStat)) {
-        m_isInit = false;
-        m_isSocket = false;
-    } else {
-        m_isInit = true;
-        m_isSocket = S_ISSOCK(fdStat.st_mode);
+    if (-1 != fstat(m_fd, &fdStat)) {
+        flags |= INIT;
+        if (S_ISSOCK(fdStat.st_mode)) {
+            flags |= SOCKET;
+        }
     }
 
-    if (m_isSocket) {
-        int flags = fcntl_f(m_fd, F_GETFL, 0);
-        if (!(flags & O_NONBLOCK)) {
-            fcntl_f(m_fd, F_SETFL, flags | O_NONBLOCK);
+    if (flags & SOCKET) {
+        int fl = fcntl_f(m_fd, F_GETFL, 0);
+        if (!(fl & O_NONBLOCK)) {
+            fcntl_f(m_fd, F_SETFL, fl | O_NONBLOCK);
         }
-        m_sysNonBlock = true;
-    } else {
-        m_sysNonBlock = false;
+        flags |= SYS_NONBLOCK;
     }
 
-    m_userNonBlock = false;
-    m_isClosed = false;
-    return m_isInit;
+    for (auto &stat : m_stats) {
+        stat.store(0, std::memory_order_relaxed);
+    }
+
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    m_flags.store(flags, std::memory_order_release);
+    return flags & INIT;
+}
+
+void FdCtx::reset() {
+    m_flags.store(CLOSED, std::memory_order_release);
+    m_generation.fetch_add(1, std::memory_order_acq_rel);
+    m_recvTimeout.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    m_sendTimeout.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    // 不论close是否在开启hook的线程上调用, 事件都交还给注册它的IOManager
+    if (m_events && m_iomanager) {
+        m_iomanager->cancelAllLocked(this);
+    }
+    m_events = 0;
+    m_iomanager = nullptr;
+    IOManager::ResetEventContext(m_readCtx);
+    IOManager::ResetEventContext(m_writeCtx);
+    IOManager::ResetEventContext(m_errorCtx);
 }
 
 void FdCtx::setTimeout(int type, uint64_t val) {
     if (type == SO_RCVTIMEO) {
-        m_recvTimeout = val;
+        m_recvTimeout.store(val, std::memory_order_relaxed);
     } else {
-        m_sendTimeout = val;
+        m_sendTimeout.store(val, std::memory_order_relaxed);
     }
 }
 
-uint64_t FdCtx::getTimeout(int type) {
+uint64_t FdCtx::getTimeout(int type) const {
     if (type == SO_RCVTIMEO) {
-        return m_recvTimeout;
+        return m_recvTimeout.load(std::memory_order_relaxed);
     }
 
-    return m_sendTimeout;
+    return m_sendTimeout.load(std::memory_order_relaxed);
 }
 
-FdManager::FdManager() { m_datas.resize(64); }
+FdCtx::Stats FdCtx::getStats() const {
+    Stats stats;
+    stats.m_fd = m_fd;
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        stats.m_values[i] = m_stats[i].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
 
-FdCtx::ptr FdManager::get(int fd, bool autoCreate) {
-    if (fd == -1) {
+FdManager::FdManager() {
+    for (auto &segment : m_segments) {
+        segment.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+FdCtx *FdManager::create(int fd) {
+    FdCtx *ctx = slot(fd, true);
+    if (!ctx) {
         return nullptr;
     }
 
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (static_cast<int>(m_datas.size()) <= fd) {
-            if (autoCreate == false) {
-                return nullptr;
-            }
-        } else {
-            if (m_datas[fd] || !autoCreate) {
-                return m_datas[fd];
-            }
-        }
+    FdCtx::MutexType::Lock lock{ctx->m_mutex};
+    if (!ctx->isInit() && !ctx->init()) {
+        return nullptr;
+    }
+    return ctx;
+}
+
+FdCtx *FdManager::attach(int fd) {
+    FdCtx *ctx = slot(fd, true);
+    if (!ctx) {
+        return nullptr;
     }
 
-    RWMutexType::WriteLock wlock{m_mutex};
-    FdCtx::ptr ctx{new FdCtx{fd}};
-    if (fd >= static_cast<int>(m_datas.size())) {
-        m_datas.resize(fd * 1.5);
+    FdCtx::MutexType::Lock lock{ctx->m_mutex};
+    if (ctx->isInit()) {
+        ctx->reset();
+    }
+    if (!ctx->init()) {
+        return nullptr;
     }
-    m_datas[fd] = ctx;
     return ctx;
 }
 
+FdCtx *FdManager::allocSegment(int fd) {
+    std::atomic<FdCtx *> &entry = m_segments[fd >> SEGMENT_BITS];
+    FdCtx *segment = new FdCtx[SEGMENT_SIZE];
+    int base = fd & ~(SEGMENT_SIZE - 1);
+    for (int i = 0; i < SEGMENT_SIZE; ++i) {
+        segment[i].m_fd = base + i;
+    }
+
+    // 并发分配时只保留一个段; 已发布的段不再释放, 槽位地址在进程生命周期内有效
+    FdCtx *expected = nullptr;
+    if (!entry.compare_exchange_strong(expected, segment, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        delete[] segment;
+        segment = expected;
+    }
+    return segment + (fd & (SEGMENT_SIZE - 1));
+}
+
 void FdManager::del(int fd) {
-    RWMutexType::WriteLock wlock{m_mutex};
-    if (static_cast<int>(m_datas.size()) <= fd) {
+    FdCtx *ctx = slot(fd);
+    if (!ctx) {
         return;
     }
-    m_datas[fd].reset();
+
+    FdCtx::MutexType::Lock lock{ctx->m_mutex};
+    if (ctx->isInit()) {
+        ctx->reset();
+    }
+}
+
+std::vector<FdCtx::Stats> FdManager::topN(FdCtx::Metric metric, size_t n) {
+    std::vector<FdCtx::Stats> result;
+    for (auto &entry : m_segments) {
+        FdCtx *segment = entry.load(std::memory_order_acquire);
+        if (!segment) {
+            continue;
+        }
+        for (int i = 0; i < SEGMENT_SIZE; ++i) {
+            if (segment[i].isInit()) {
+                result.push_back(segment[i].getStats());
+            }
+        }
+    }
+
+    n = std::min(n, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+                      [metric](const FdCtx::Stats &a, const FdCtx::Stats &b) {
+                          return a.m_values[metric] > b.m_values[metric];
+                      });
+    result.resize(n);
+    return result;
 }
 
-}  // namespace sylar
\ No newline at end of file
+}  // namespace sylar
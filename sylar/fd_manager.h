@@ -1,67 +1,170 @@
 #pragma once
 
-#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
 #include <vector>
+#include "fiber.h"
 #include "mutex.h"
 #include "singleton.h"
 
 namespace sylar {
 
-class FdCtx : public std::enable_shared_from_this<FdCtx> {
+class IOManager;
+class Scheduler;
+
+// fd表中的一个槽位, 同时保存hook状态与IOManager的事件状态; 地址在进程生命周期内不变
+class alignas(64) FdCtx {
+    friend class FdManager;
+    friend class IOManager;
+
 public:
-    using ptr = std::shared_ptr<FdCtx>;
+    using MutexType = FutexMutex;
+
+    enum Flag : uint32_t {
+        INIT = 0x1,
+        SOCKET = 0x2,
+        SYS_NONBLOCK = 0x4,
+        USER_NONBLOCK = 0x8,
+        CLOSED = 0x10,
+    };
+
+    struct EventContext {
+        Scheduler *m_scheduler = nullptr;
+        Fiber::ptr m_fiber;
+        std::function<void()> m_cb;
+    };
+
+    // hook的do_io中累计的统计项, 编译时未定义SYLAR_FD_STATS则全部为0
+    enum Metric {
+        BYTES_READ = 0,
+        BYTES_WRITTEN,
+        SYSCALLS,
+        PARKS,       // 遇到EAGAIN挂起等待的次数
+        PARK_TIME,   // 挂起等待的总时长(us)
+        TIMEOUTS,
+        METRIC_COUNT,
+    };
 
-    FdCtx(int fd);
+    struct Stats {
+        int m_fd = -1;
+        uint64_t m_values[METRIC_COUNT] = {0};
 
-    ~FdCtx();
+        std::string toString() const;
+    };
 
-    bool isInit() const { return m_isInit; }
+    static const char *MetricToString(Metric metric);
 
-    bool isSocket() const { return m_isSocket; }
+    int getFd() const { return m_fd; }
 
-    bool isClose() const { return m_isClosed; }
+    // 每次初始化、关闭都会递增, 用于识别fd被关闭后复用
+    uint32_t getGeneration() const { return m_generation.load(std::memory_order_acquire); }
 
-    void setUserNonblock(bool val) { m_userNonBlock = val; }
+    bool isInit() const { return getFlags() & INIT; }
 
-    bool getUserNonBlock() const { return m_userNonBlock; }
+    bool isSocket() const { return getFlags() & SOCKET; }
 
-    void setSysNonBlock(bool val) { m_sysNonBlock = val; }
+    bool isClose() const { return getFlags() & CLOSED; }
 
-    bool getSysNonBlock() const { return m_sysNonBlock; }
+    void setUserNonblock(bool val) { setFlag(USER_NONBLOCK, val); }
+
+    bool getUserNonBlock() const { return getFlags() & USER_NONBLOCK; }
+
+    void setSysNonBlock(bool val) { setFlag(SYS_NONBLOCK, val); }
+
+    bool getSysNonBlock() const { return getFlags() & SYS_NONBLOCK; }
 
     void setTimeout(int type, uint64_t val);
 
-    uint64_t getTimeout(int type);
+    uint64_t getTimeout(int type) const;
+
+#ifdef SYLAR_FD_STATS
+    void addStat(Metric metric, uint64_t val) { m_stats[metric].fetch_add(val, std::memory_order_relaxed); }
+#else
+    void addStat(Metric, uint64_t) {}
+#endif
+
+    Stats getStats() const;
 
 private:
+    uint32_t getFlags() const { return m_flags.load(std::memory_order_acquire); }
+
+    void setFlag(uint32_t flag, bool val);
+
+    // 以下两个函数需持有m_mutex
     bool init();
 
+    // 先递增generation再唤醒仍在等待的协程, 它们恢复后得到EBADF, 不会在即将关闭的fd上重新注册事件
+    void reset();
+
 private:
-    bool m_isInit : 1;
-    bool m_isSocket : 1;
-    bool m_sysNonBlock : 1;
-    bool m_userNonBlock : 1;
-    bool m_isClosed : 1;
-    int m_fd;
-    uint64_t m_recvTimeout;
-    uint64_t m_sendTimeout;
+    // hook热路径只读取第一个cache line
+    std::atomic<uint32_t> m_flags{0};
+    std::atomic<uint32_t> m_generation{0};
+    std::atomic<uint64_t> m_recvTimeout{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> m_sendTimeout{std::numeric_limits<uint64_t>::max()};
+    int m_fd = -1;
+    // 以下由IOManager在m_mutex保护下读写
+    uint32_t m_events = 0;
+    IOManager *m_iomanager = nullptr;  // 注册m_events的IOManager
+    MutexType m_mutex;
+    EventContext m_readCtx;
+    EventContext m_writeCtx;
+    EventContext m_errorCtx;
+    // 不随SYLAR_FD_STATS变化, 保证FdCtx的布局一致, 关闭时只是不再累计
+    std::atomic<uint64_t> m_stats[METRIC_COUNT]{};
 };
 
+// 分段的fd表: 段按需分配且不移动、不释放, 查找只需读取段指针与槽位
 class FdManager {
 public:
-    using RWMutexType = RWMutex;
+    static constexpr int SEGMENT_BITS = 8;
+    static constexpr int SEGMENT_SIZE = 1 << SEGMENT_BITS;
+    static constexpr int MAX_SEGMENTS = 4096;
+    static constexpr int MAX_FD = SEGMENT_SIZE * MAX_SEGMENTS;
 
     FdManager();
 
-    FdCtx::ptr get(int fd, bool autoCreate = false);
+    // 返回已被hook接管的fd槽位, autoCreate时对未初始化的槽位做初始化
+    FdCtx *get(int fd, bool autoCreate = false) {
+        FdCtx *ctx = slot(fd);
+        if (ctx && ctx->isInit()) {
+            return ctx;
+        }
+        return autoCreate ? create(fd) : nullptr;
+    }
+
+    // hook刚创建的fd(socket、accept等)调用: 槽位可能残留着经fclose等途径关闭、hook没有看到的旧fd, 先重置再初始化
+    FdCtx *attach(int fd);
+
+    // 返回fd对应的槽位(不要求被hook接管), alloc时按需分配所在的段; fd越界时返回nullptr
+    FdCtx *slot(int fd, bool alloc = false) {
+        if (static_cast<unsigned>(fd) >= static_cast<unsigned>(MAX_FD)) {
+            return nullptr;
+        }
+        FdCtx *segment = m_segments[fd >> SEGMENT_BITS].load(std::memory_order_acquire);
+        if (!segment) {
+            return alloc ? allocSegment(fd) : nullptr;
+        }
+        return segment + (fd & (SEGMENT_SIZE - 1));
+    }
 
     void del(int fd);
 
+    // 按metric从大到小返回前n个已打开fd的统计
+    std::vector<FdCtx::Stats> topN(FdCtx::Metric metric, size_t n);
+
+private:
+    FdCtx *create(int fd);
+
+    FdCtx *allocSegment(int fd);
+
 private:
-    RWMutexType m_mutex;
-    std::vector<FdCtx::ptr> m_datas;
+    std::atomic<FdCtx *> m_segments[MAX_SEGMENTS];
 };
 
 using FdMgr = Singleton<FdManager>;
 
-}  // namespace sylar
\ No newline at end of file
+}  // namespace sylar
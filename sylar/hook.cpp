@@ -1,14 +1,21 @@
 #include "hook.h"
 #include <dlfcn.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <cstdarg>
 #include <functional>
+#include <type_traits>
 
 #include "config.h"
 #include "fd_manager.h"
 #include "fiber.h"
 #include "iomanager.h"
 #include "log.h"
+#include "log_limit.h"
 #include "macro.h"
+#include "offload.h"
+#include "util.h"
 
 static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
 
@@ -17,6 +24,9 @@ namespace sylar {
 static sylar::ConfigVar<int>::ptr g_tcp_connect_timeout =
     sylar::Config::Lookup("tcp.connect.timeout", 5000, "tcp connect timeout");
 
+static sylar::ConfigVar<bool>::ptr g_offload_file_io =
+    sylar::Config::Lookup("offload.file_io", false, "run regular file read/write/pread/pwrite in the offload pool");
+
 static thread_local bool t_hook_enable = false;
 
 #define HOOK_FUNC(XX) \
@@ -28,14 +38,21 @@ static thread_local bool t_hook_enable = false;
     XX(accept)        \
     XX(read)          \
     XX(readv)         \
+    XX(pread)         \
     XX(recv)          \
     XX(recvfrom)      \
     XX(recvmsg)       \
+    XX(recvmmsg)      \
     XX(write)         \
     XX(writev)        \
+    XX(pwrite)        \
     XX(send)          \
     XX(sendto)        \
     XX(sendmsg)       \
+    XX(sendmmsg)      \
+    XX(sendfile)      \
+    XX(splice)        \
+    XX(tee)           \
     XX(close)         \
     XX(fcntl)         \
     XX(ioctl)         \
@@ -54,6 +71,7 @@ void hook_init() {
 }
 
 static uint64_t s_connect_timeout = -1;
+static std::atomic<bool> s_offload_file_io{false};
 
 struct _HookIniter {
     _HookIniter() {
@@ -64,6 +82,9 @@ struct _HookIniter {
             SYLAR_LOG_INFO(g_logger) << "tcp connect timeout changed from " << oldValue << " to " << newValue;
             s_connect_timeout = newValue;
         });
+
+        s_offload_file_io = g_offload_file_io->getValue();
+        g_offload_file_io->addListener([](const bool, const bool newValue) { s_offload_file_io = newValue; });
     }
 };
 
@@ -86,30 +107,29 @@ static ssize_t do_io(int fd, OriginFunc func, const char *hook_func_name, uint32
         return func(fd, std::forward<Args>(args)...);
     }
 
-    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+    sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
     if (!ctx) {
         return func(fd, std::forward<Args>(args)...);
     }
 
-    if (ctx->isClose()) {
-        errno = EBADF;
-        return -1;
-    }
-
     if (!ctx->isSocket() || ctx->getUserNonBlock()) {
         return func(fd, std::forward<Args>(args)...);
     }
 
+    uint32_t generation = ctx->getGeneration();
     uint64_t timeout = ctx->getTimeout(timeoutSo);
     std::shared_ptr<TimerInfo> tInfo{new TimerInfo};
 
 retry:
     ssize_t n = func(fd, std::forward<Args>(args)...);
+    ctx->addStat(sylar::FdCtx::SYSCALLS, 1);
     while (n == -1 && errno == EINTR) {
         n = func(fd, std::forward<Args>(args)...);
+        ctx->addStat(sylar::FdCtx::SYSCALLS, 1);
     }
 
     if (n == -1 && errno == EAGAIN) {
+        ctx->addStat(sylar::FdCtx::PARKS, 1);
         sylar::IOManager *iom = sylar::IOManager::GetThis();
         sylar::Timer::ptr timer;
         std::weak_ptr<TimerInfo> wInfo{tInfo};
@@ -117,40 +137,151 @@ retry:
         if (timeout != std::numeric_limits<uint64_t>::max()) {
             timer = iom->addConditionTimer(
                 timeout,
-                [wInfo, fd, iom, event]() {
+                [wInfo, fd, iom, event, generation]() {
                     auto timerInfo = wInfo.lock();
                     if (!timerInfo || timerInfo->cancelled) {
                         return;
                     }
                     timerInfo->cancelled = ETIMEDOUT;
-                    iom->cancelEvent(fd, static_cast<sylar::IOManager::Event>(event));
+                    iom->cancelEvent(fd, static_cast<sylar::IOManager::Event>(event), generation);
                 },
                 wInfo);
         }
 
-        int ret = iom->addEvent(fd, static_cast<sylar::IOManager::Event>(event));
-        if (SYLAR_UNLIKELY(ret)) {
-            SYLAR_LOG_ERROR(g_logger) << hook_func_name << " addEvent(" << fd << ", " << event << ")";
+        if (SYLAR_UNLIKELY(!iom->addEvent(fd, static_cast<sylar::IOManager::Event>(event)))) {
+            SYLAR_LOG_LIMIT_ERROR(g_logger) << hook_func_name << " addEvent(" << fd << ", " << event << ")";
             if (timer) {
                 timer->cancel();
             }
             return -1;
         }
 
+#ifdef SYLAR_FD_STATS
+        uint64_t parkStart = sylar::GetCurrentUS();
+#endif
         sylar::Fiber::GetThis()->yield();
+#ifdef SYLAR_FD_STATS
+        ctx->addStat(sylar::FdCtx::PARK_TIME, sylar::GetCurrentUS() - parkStart);
+#endif
         if (timer) {
             timer->cancel();
         }
         if (tInfo->cancelled) {
+            if (tInfo->cancelled == ETIMEDOUT) {
+                ctx->addStat(sylar::FdCtx::TIMEOUTS, 1);
+            }
             errno = tInfo->cancelled;
             return -1;
         }
+        // 等待期间fd被关闭(并可能已被复用)
+        if (ctx->getGeneration() != generation) {
+            errno = EBADF;
+            return -1;
+        }
         goto retry;
     }
 
+    // accept返回的是新fd, recvmmsg/sendmmsg返回的是消息数, 都不是字节数
+    if constexpr (!std::is_same_v<OriginFunc, accept_func> && !std::is_same_v<OriginFunc, recvmmsg_func> &&
+                  !std::is_same_v<OriginFunc, sendmmsg_func>) {
+        if (n > 0) {
+            ctx->addStat(event == sylar::IOManager::READ ? sylar::FdCtx::BYTES_READ : sylar::FdCtx::BYTES_WRITTEN, n);
+        }
+    }
     return n;
 }
 
+// recvmmsg/sendmmsg的字节数在各条消息的msg_len中
+static void add_mmsg_bytes(int fd, const struct mmsghdr *msgvec, int n, sylar::FdCtx::Metric metric) {
+#ifdef SYLAR_FD_STATS
+    sylar::FdCtx *ctx = n > 0 && sylar::t_hook_enable ? sylar::FdMgr::GetInstance()->get(fd) : nullptr;
+    if (!ctx) {
+        return;
+    }
+    uint64_t bytes = 0;
+    for (int i = 0; i < n; ++i) {
+        bytes += msgvec[i].msg_len;
+    }
+    ctx->addStat(metric, bytes);
+#endif
+}
+
+// 普通文件读写会阻塞线程, 开启offload.file_io时交给OffloadPool执行
+// 普通文件不登记到fd表: 它们常由fclose关闭, hook看不到, 残留的槽位会被之后复用该fd的socket误用; 每次调用fstat判断
+static bool is_offload_file(int fd) {
+    if (!sylar::t_hook_enable || !sylar::s_offload_file_io.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
+    if (ctx && ctx->isSocket()) {
+        return false;
+    }
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// 在管道上挂起直到event就绪; 管道由hook的close关闭, 槽位随之清理, 等待期间被关闭时返回false
+static bool wait_pipe(int fd, sylar::IOManager::Event event, const char *hook_func_name) {
+    sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd, true);
+    if (!ctx) {
+        errno = EBADF;
+        return false;
+    }
+    uint32_t generation = ctx->getGeneration();
+    if (SYLAR_UNLIKELY(!sylar::IOManager::GetThis()->addEvent(fd, event))) {
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << hook_func_name << " addEvent(" << fd << ", " << event << ")";
+        return false;
+    }
+    sylar::Fiber::GetThis()->yield();
+    if (ctx->getGeneration() != generation) {
+        errno = EBADF;
+        return false;
+    }
+    return true;
+}
+
+// splice/tee的另一端是管道: 优先等待写端的socket, 否则等待读端的socket; 都不是socket时直接调用
+// 非阻塞管道读端为空或写端已满时也返回EAGAIN, 此时socket仍就绪, 等待socket会立即醒来空转;
+// 先用poll检查管道一端, 未就绪时在管道上等待, 就绪时才交给do_io等待socket
+// 在管道上等待不受socket超时限制
+template <typename Call>
+static ssize_t do_pipe_io(int fdIn, int fdOut, Call call, const char *hook_func_name) {
+    if (!sylar::t_hook_enable) {
+        return call();
+    }
+    sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fdOut);
+    bool outSocket = ctx && ctx->isSocket();
+    if (!outSocket) {
+        ctx = sylar::FdMgr::GetInstance()->get(fdIn);
+    }
+    // 用户设置了非阻塞的socket由do_io直接调用, 也不在管道上等待
+    if (!ctx || !ctx->isSocket() || ctx->getUserNonBlock()) {
+        return call();
+    }
+
+    int pipeFd = outSocket ? fdIn : fdOut;
+    auto pipe_call = [&](int) -> ssize_t {
+        while (true) {
+            ssize_t n = call();
+            if (n != -1 || errno != EAGAIN) {
+                return n;
+            }
+            pollfd pfd{pipeFd, static_cast<short>(outSocket ? POLLIN : POLLOUT), 0};
+            if (poll(&pfd, 1, 0) != 0) {
+                errno = EAGAIN;
+                return -1;
+            }
+            if (!wait_pipe(pipeFd, outSocket ? sylar::IOManager::READ : sylar::IOManager::WRITE, hook_func_name)) {
+                return -1;
+            }
+        }
+    };
+    if (outSocket) {
+        return do_io(fdOut, pipe_call, hook_func_name, sylar::IOManager::WRITE, SO_SNDTIMEO);
+    }
+    return do_io(fdIn, pipe_call, hook_func_name, sylar::IOManager::READ, SO_RCVTIMEO);
+}
+
 extern "C" {
 #define XX(name) name##_func name##_f = nullptr;
 HOOK_FUNC(XX);
@@ -208,7 +339,7 @@ int socket(int domain, int type, int protocol) {
         return fd;
     }
 
-    sylar::FdMgr::GetInstance()->get(fd, true);
+    sylar::FdMgr::GetInstance()->attach(fd);
 
     return fd;
 }
@@ -218,7 +349,7 @@ int connect_with_timeout(int fd, const struct sockaddr *addr, socklen_t addrlen,
         return connect_f(fd, addr, addrlen);
     }
 
-    sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+    sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
     if (!ctx || ctx->isClose()) {
         errno = EBADF;
         return -1;
@@ -232,7 +363,10 @@ int connect_with_timeout(int fd, const struct sockaddr *addr, socklen_t addrlen,
         return connect_f(fd, addr, addrlen);
     }
 
+    uint32_t generation = ctx->getGeneration();
+
     int n = connect_f(fd, addr, addrlen);
+    ctx->addStat(sylar::FdCtx::SYSCALLS, 1);
     if (n == 0) {
         return 0;
     } else if (n != -1 || errno != EINPROGRESS) {
@@ -247,24 +381,33 @@ int connect_with_timeout(int fd, const struct sockaddr *addr, socklen_t addrlen,
     if (timeoutMs != std::numeric_limits<uint64_t>::max()) {
         timer = iom->addConditionTimer(
             timeoutMs,
-            [wInfo, fd, iom]() {
+            [wInfo, fd, iom, generation]() {
                 auto timerInfo = wInfo.lock();
                 if (!timerInfo || timerInfo->cancelled) {
                     return;
                 }
                 timerInfo->cancelled = ETIMEDOUT;
-                iom->cancelEvent(fd, sylar::IOManager::WRITE);
+                iom->cancelEvent(fd, sylar::IOManager::WRITE, generation);
             },
             wInfo);
     }
 
-    int ret = iom->addEvent(fd, sylar::IOManager::WRITE);
-    if (ret == 0) {
+    if (iom->addEvent(fd, sylar::IOManager::WRITE)) {
+        ctx->addStat(sylar::FdCtx::PARKS, 1);
+#ifdef SYLAR_FD_STATS
+        uint64_t parkStart = sylar::GetCurrentUS();
+#endif
         sylar::Fiber::GetThis()->yield();
+#ifdef SYLAR_FD_STATS
+        ctx->addStat(sylar::FdCtx::PARK_TIME, sylar::GetCurrentUS() - parkStart);
+#endif
         if (timer) {
             timer->cancel();
         }
         if (tInfo->cancelled) {
+            if (tInfo->cancelled == ETIMEDOUT) {
+                ctx->addStat(sylar::FdCtx::TIMEOUTS, 1);
+            }
             errno = tInfo->cancelled;
             return -1;
         }
@@ -272,7 +415,7 @@ int connect_with_timeout(int fd, const struct sockaddr *addr, socklen_t addrlen,
         if (timer) {
             timer->cancel();
         }
-        SYLAR_LOG_ERROR(g_logger) << "connect addEvent(" << fd << ", WRITE) error";
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "connect addEvent(" << fd << ", WRITE) error";
     }
 
     int error = 0;
@@ -296,12 +439,15 @@ int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen) {
 int accept(int socket, struct sockaddr *addr, socklen_t *addrlen) {
     int fd = do_io(socket, accept_f, "accept", sylar::IOManager::READ, SO_RCVTIMEO, addr, addrlen);
     if (fd >= 0) {
-        sylar::FdMgr::GetInstance()->get(fd, true);
+        sylar::FdMgr::GetInstance()->attach(fd);
     }
     return fd;
 }
 
 ssize_t read(int fd, void *buf, size_t count) {
+    if (is_offload_file(fd)) {
+        return sylar::Offload([=] { return read_f(fd, buf, count); });
+    }
     return do_io(fd, read_f, "read", sylar::IOManager::READ, SO_RCVTIMEO, buf, count);
 }
 
@@ -309,6 +455,13 @@ ssize_t readv(int fd, const struct iovec *iov, int iovcnt) {
     return do_io(fd, readv_f, "readv", sylar::IOManager::READ, SO_RCVTIMEO, iov, iovcnt);
 }
 
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+    if (is_offload_file(fd)) {
+        return sylar::Offload([=] { return pread_f(fd, buf, count, offset); });
+    }
+    return pread_f(fd, buf, count, offset);
+}
+
 ssize_t recv(int sockfd, void *buf, size_t len, int flags) {
     return do_io(sockfd, recv_f, "recv", sylar::IOManager::READ, SO_RCVTIMEO, buf, len, flags);
 }
@@ -322,7 +475,16 @@ ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags) {
     return do_io(sockfd, recvmsg_f, "recvmsg", sylar::IOManager::READ, SO_RCVTIMEO, msg, flags);
 }
 
+int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout) {
+    int n = do_io(sockfd, recvmmsg_f, "recvmmsg", sylar::IOManager::READ, SO_RCVTIMEO, msgvec, vlen, flags, timeout);
+    add_mmsg_bytes(sockfd, msgvec, n, sylar::FdCtx::BYTES_READ);
+    return n;
+}
+
 ssize_t write(int fd, const void *buf, size_t count) {
+    if (is_offload_file(fd)) {
+        return sylar::Offload([=] { return write_f(fd, buf, count); });
+    }
     return do_io(fd, write_f, "write", sylar::IOManager::WRITE, SO_SNDTIMEO, buf, count);
 }
 
@@ -330,6 +492,13 @@ ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
     return do_io(fd, writev_f, "writev", sylar::IOManager::WRITE, SO_SNDTIMEO, iov, iovcnt);
 }
 
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+    if (is_offload_file(fd)) {
+        return sylar::Offload([=] { return pwrite_f(fd, buf, count, offset); });
+    }
+    return pwrite_f(fd, buf, count, offset);
+}
+
 ssize_t send(int s, const void *msg, size_t len, int flags) {
     return do_io(s, send_f, "send", sylar::IOManager::WRITE, SO_SNDTIMEO, msg, len, flags);
 }
@@ -342,15 +511,27 @@ ssize_t sendmsg(int s, const struct msghdr *msg, int flags) {
     return do_io(s, sendmsg_f, "sendmsg", sylar::IOManager::WRITE, SO_SNDTIMEO, msg, flags);
 }
 
-int close(int fd) {
-    if (!sylar::t_hook_enable) {
-        return close_f(fd);
-    }
+int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags) {
+    int n = do_io(sockfd, sendmmsg_f, "sendmmsg", sylar::IOManager::WRITE, SO_SNDTIMEO, msgvec, vlen, flags);
+    add_mmsg_bytes(sockfd, msgvec, n, sylar::FdCtx::BYTES_WRITTEN);
+    return n;
+}
 
-    if (sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd); ctx) {
-        if (auto *iom = sylar::IOManager::GetThis(); iom != nullptr) {
-            iom->cancelAll(fd);
-        }
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+    return do_io(out_fd, sendfile_f, "sendfile", sylar::IOManager::WRITE, SO_SNDTIMEO, in_fd, offset, count);
+}
+
+ssize_t splice(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len, unsigned int flags) {
+    return do_pipe_io(fd_in, fd_out, [=] { return splice_f(fd_in, off_in, fd_out, off_out, len, flags); }, "splice");
+}
+
+ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags) {
+    return do_pipe_io(fd_in, fd_out, [=] { return tee_f(fd_in, fd_out, len, flags); }, "tee");
+}
+
+int close(int fd) {
+    // 未开启hook的线程也要清理槽位, 否则fd复用后会沿用旧的状态; 等待中的事件在del中一并取消
+    if (sylar::FdMgr::GetInstance()->get(fd)) {
         sylar::FdMgr::GetInstance()->del(fd);
     }
 
@@ -364,7 +545,7 @@ int fcntl(int fd, int cmd, ...) {
         case F_SETFL: {
             int arg = va_arg(va, int);
             va_end(va);
-            sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+            sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
             if (!ctx || ctx->isClose() || !ctx->isSocket()) {
                 return fcntl_f(fd, cmd, arg);
             }
@@ -379,7 +560,7 @@ int fcntl(int fd, int cmd, ...) {
         case F_GETFL: {
             va_end(va);
             int arg = fcntl_f(fd, cmd);
-            sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(fd);
+            sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
             if (!ctx || ctx->isClose() || !ctx->isSocket()) {
                 return arg;
             }
@@ -442,7 +623,7 @@ int ioctl(int d, unsigned long int request, ...) {
 
     if (FIONBIO == request) {
         bool userNonBlock = !!*(int *)arg;
-        sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(d);
+        sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(d);
         if (!ctx || ctx->isClose() || !ctx->isSocket()) {
             return ioctl_f(d, request, arg);
         }
@@ -463,7 +644,7 @@ int setsockopt(int sockfd, int level, int optname, const void *optval, socklen_t
 
     if (level == SOL_SOCKET) {
         if (optname == SO_RCVTIMEO || optname == SO_SNDTIMEO) {
-            sylar::FdCtx::ptr ctx = sylar::FdMgr::GetInstance()->get(sockfd);
+            sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(sockfd);
             if (ctx) {
                 const timeval *val = static_cast<const timeval *>(optval);
                 ctx->setTimeout(optname, val->tv_sec * 1000 + val->tv_usec / 1000);
@@ -42,6 +42,9 @@ extern read_func read_f;
 using readv_func = ssize_t (*)(int fd, const struct iovec *iov, int iovcnt);
 extern readv_func readv_f;
 
+using pread_func = ssize_t (*)(int fd, void *buf, size_t count, off_t offset);
+extern pread_func pread_f;
+
 using recv_func = ssize_t (*)(int sockfd, void *buf, size_t len, int flags);
 extern recv_func recv_f;
 
@@ -52,6 +55,10 @@ extern recvfrom_func recvfrom_f;
 using recvmsg_func = ssize_t (*)(int sockfd, struct msghdr *msg, int flags);
 extern recvmsg_func recvmsg_f;
 
+using recvmmsg_func = int (*)(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+                              struct timespec *timeout);
+extern recvmmsg_func recvmmsg_f;
+
 // write
 using write_func = ssize_t (*)(int fd, const void *buf, size_t count);
 extern write_func write_f;
@@ -59,6 +66,9 @@ extern write_func write_f;
 using writev_func = ssize_t (*)(int fd, const struct iovec *iov, int iovcnt);
 extern writev_func writev_f;
 
+using pwrite_func = ssize_t (*)(int fd, const void *buf, size_t count, off_t offset);
+extern pwrite_func pwrite_f;
+
 using send_func = ssize_t (*)(int s, const void *msg, size_t len, int flags);
 extern send_func send_f;
 
@@ -69,6 +79,20 @@ extern sendto_func sendto_f;
 using sendmsg_func = ssize_t (*)(int s, const struct msghdr *msg, int flags);
 extern sendmsg_func sendmsg_f;
 
+using sendmmsg_func = int (*)(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+extern sendmmsg_func sendmmsg_f;
+
+// zero copy, 只在socket一端挂起等待; 管道和文件一端保持原语义
+using sendfile_func = ssize_t (*)(int out_fd, int in_fd, off_t *offset, size_t count);
+extern sendfile_func sendfile_f;
+
+using splice_func = ssize_t (*)(int fd_in, loff_t *off_in, int fd_out, loff_t *off_out, size_t len,
+                                unsigned int flags);
+extern splice_func splice_f;
+
+using tee_func = ssize_t (*)(int fd_in, int fd_out, size_t len, unsigned int flags);
+extern tee_func tee_f;
+
 using close_func = int (*)(int fd);
 extern close_func close_f;
 
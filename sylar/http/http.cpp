@@ -0,0 +1,209 @@
+#include "http.h"
+#include <strings.h>
+#include <algorithm>
+#include <sstream>
+
+namespace sylar {
+namespace http {
+
+HttpMethod StringToHttpMethod(std::string_view m) {
+#define XX(num, name, string)      \
+    if (m == #string) {            \
+        return HttpMethod::name;   \
+    }
+    HTTP_METHOD_MAP(XX);
+#undef XX
+    return HttpMethod::INVALID_METHOD;
+}
+
+static const char *s_method_string[] = {
+#define XX(num, name, string) #string,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+};
+
+const char *HttpMethodToString(const HttpMethod &m) {
+    uint32_t idx = static_cast<uint32_t>(m);
+    if (idx >= sizeof(s_method_string) / sizeof(s_method_string[0])) {
+        return "<unknown>";
+    }
+    return s_method_string[idx];
+}
+
+const char *HttpStatusToString(const HttpStatus &s) {
+    switch (s) {
+#define XX(code, name, msg) \
+    case HttpStatus::name:  \
+        return #msg;
+        HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+    return lhs.size() == rhs.size() && strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+static const char *VersionToString(uint8_t version) { return version == 0x10 ? "HTTP/1.0" : "HTTP/1.1"; }
+
+HttpRequest::HttpRequest(uint8_t version, bool close)
+    : m_method{HttpMethod::GET}, m_version{version}, m_close{close}, m_chunked{false}, m_path{"/"} {}
+
+std::string_view HttpRequest::getHeader(std::string_view key, std::string_view def) const {
+    std::string_view val;
+    return hasHeader(key, &val) ? val : def;
+}
+
+bool HttpRequest::hasHeader(std::string_view key, std::string_view *val) const {
+    for (const auto &header : m_headers) {
+        if (EqualsIgnoreCase(header.first, key)) {
+            if (val) {
+                *val = header.second;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void HttpRequest::reset() {
+    m_method = HttpMethod::GET;
+    m_version = 0x11;
+    m_close = true;
+    m_chunked = false;
+    m_path = "/";
+    m_query = {};
+    m_fragment = {};
+    m_body = {};
+    m_headers.clear();
+}
+
+void HttpRequest::serialize(std::string &out) const {
+    out.append(HttpMethodToString(m_method)).push_back(' ');
+    out.append(m_path);
+    if (!m_query.empty()) {
+        out.append(1, '?').append(m_query);
+    }
+    out.push_back(' ');
+    out.append(VersionToString(m_version)).append("\r\n");
+    for (const auto &header : m_headers) {
+        if (EqualsIgnoreCase(header.first, "connection") || EqualsIgnoreCase(header.first, "content-length") ||
+            EqualsIgnoreCase(header.first, "transfer-encoding")) {
+            continue;
+        }
+        out.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    out.append(m_close ? "Connection: close\r\n" : "Connection: keep-alive\r\n");
+    if (!m_body.empty() || m_method == HttpMethod::POST || m_method == HttpMethod::PUT ||
+        m_method == HttpMethod::PATCH) {
+        out.append("Content-Length: ").append(std::to_string(m_body.size())).append("\r\n");
+    }
+    out.append("\r\n").append(m_body);
+}
+
+std::ostream &HttpRequest::dump(std::ostream &os) const {
+    os << HttpMethodToString(m_method) << " " << m_path << (m_query.empty() ? "" : "?") << m_query
+       << (m_fragment.empty() ? "" : "#") << m_fragment << " " << VersionToString(m_version) << "\r\n";
+    for (const auto &header : m_headers) {
+        os << header.first << ": " << header.second << "\r\n";
+    }
+    return os << "\r\n" << m_body;
+}
+
+std::string HttpRequest::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+HttpResponse::HttpResponse(uint8_t version, bool close)
+    : m_status{HttpStatus::OK}, m_version{version}, m_close{close} {}
+
+std::string HttpResponse::getHeader(std::string_view key, const std::string &def) const {
+    std::string val;
+    return hasHeader(key, &val) ? val : def;
+}
+
+bool HttpResponse::hasHeader(std::string_view key, std::string *val) const {
+    for (const auto &header : m_headers) {
+        if (EqualsIgnoreCase(header.first, key)) {
+            if (val) {
+                *val = header.second;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void HttpResponse::setHeader(std::string_view key, std::string_view val) {
+    for (auto &header : m_headers) {
+        if (EqualsIgnoreCase(header.first, key)) {
+            header.second = val;
+            return;
+        }
+    }
+    m_headers.emplace_back(key, val);
+}
+
+void HttpResponse::delHeader(std::string_view key) {
+    m_headers.erase(std::remove_if(m_headers.begin(), m_headers.end(),
+                                   [key](const Header &header) { return EqualsIgnoreCase(header.first, key); }),
+                    m_headers.end());
+}
+
+void HttpResponse::reset() {
+    m_status = HttpStatus::OK;
+    m_version = 0x11;
+    m_close = true;
+    m_body.clear();
+    m_reason.clear();
+    m_headers.clear();
+    m_stream = nullptr;
+}
+
+void HttpResponse::serialize(std::string &out, bool withBody) const {
+    out.append(VersionToString(m_version));
+    out.push_back(' ');
+    out.append(std::to_string(static_cast<int>(m_status)));
+    out.push_back(' ');
+    out.append(m_reason.empty() ? HttpStatusToString(m_status) : m_reason);
+    out.append("\r\n");
+    for (const auto &header : m_headers) {
+        if (EqualsIgnoreCase(header.first, "connection") || EqualsIgnoreCase(header.first, "content-length") ||
+            EqualsIgnoreCase(header.first, "transfer-encoding")) {
+            continue;
+        }
+        out.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    out.append(m_close ? "Connection: close\r\n" : "Connection: keep-alive\r\n");
+    if (m_stream) {
+        out.append("Transfer-Encoding: chunked\r\n\r\n");
+        return;
+    }
+    out.append("Content-Length: ").append(std::to_string(m_body.size())).append("\r\n\r\n");
+    if (withBody) {
+        out.append(m_body);
+    }
+}
+
+std::ostream &HttpResponse::dump(std::ostream &os) const {
+    std::string out;
+    serialize(out);
+    return os << out;
+}
+
+std::string HttpResponse::toString() const {
+    std::string out;
+    serialize(out);
+    return out;
+}
+
+std::ostream &operator<<(std::ostream &os, const HttpRequest &req) { return req.dump(os); }
+
+std::ostream &operator<<(std::ostream &os, const HttpResponse &rsp) { return rsp.dump(os); }
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sylar {
+namespace http {
+
+/* Request Methods */
+#define HTTP_METHOD_MAP(XX) \
+    XX(0, DELETE, DELETE)   \
+    XX(1, GET, GET)         \
+    XX(2, HEAD, HEAD)       \
+    XX(3, POST, POST)       \
+    XX(4, PUT, PUT)         \
+    XX(5, CONNECT, CONNECT) \
+    XX(6, OPTIONS, OPTIONS) \
+    XX(7, TRACE, TRACE)     \
+    XX(8, PATCH, PATCH)
+
+/* Status Codes */
+#define HTTP_STATUS_MAP(XX)                                                 \
+    XX(100, CONTINUE, Continue)                                             \
+    XX(101, SWITCHING_PROTOCOLS, Switching Protocols)                       \
+    XX(200, OK, OK)                                                         \
+    XX(201, CREATED, Created)                                               \
+    XX(202, ACCEPTED, Accepted)                                             \
+    XX(204, NO_CONTENT, No Content)                                         \
+    XX(206, PARTIAL_CONTENT, Partial Content)                               \
+    XX(301, MOVED_PERMANENTLY, Moved Permanently)                           \
+    XX(302, FOUND, Found)                                                   \
+    XX(304, NOT_MODIFIED, Not Modified)                                     \
+    XX(307, TEMPORARY_REDIRECT, Temporary Redirect)                         \
+    XX(308, PERMANENT_REDIRECT, Permanent Redirect)                         \
+    XX(400, BAD_REQUEST, Bad Request)                                       \
+    XX(401, UNAUTHORIZED, Unauthorized)                                     \
+    XX(403, FORBIDDEN, Forbidden)                                           \
+    XX(404, NOT_FOUND, Not Found)                                           \
+    XX(405, METHOD_NOT_ALLOWED, Method Not Allowed)                         \
+    XX(408, REQUEST_TIMEOUT, Request Timeout)                               \
+    XX(411, LENGTH_REQUIRED, Length Required)                               \
+    XX(413, PAYLOAD_TOO_LARGE, Payload Too Large)                           \
+    XX(414, URI_TOO_LONG, URI Too Long)                                     \
+    XX(415, UNSUPPORTED_MEDIA_TYPE, Unsupported Media Type)                 \
+    XX(429, TOO_MANY_REQUESTS, Too Many Requests)                           \
+    XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
+    XX(500, INTERNAL_SERVER_ERROR, Internal Server Error)                   \
+    XX(501, NOT_IMPLEMENTED, Not Implemented)                               \
+    XX(502, BAD_GATEWAY, Bad Gateway)                                       \
+    XX(503, SERVICE_UNAVAILABLE, Service Unavailable)                       \
+    XX(504, GATEWAY_TIMEOUT, Gateway Timeout)                               \
+    XX(505, HTTP_VERSION_NOT_SUPPORTED, HTTP Version Not Supported)
+
+enum class HttpMethod {
+#define XX(num, name, string) name = num,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+    INVALID_METHOD
+};
+
+enum class HttpStatus {
+#define XX(code, name, desc) name = code,
+    HTTP_STATUS_MAP(XX)
+#undef XX
+};
+
+HttpMethod StringToHttpMethod(std::string_view m);
+
+const char *HttpMethodToString(const HttpMethod &m);
+
+const char *HttpStatusToString(const HttpStatus &s);
+
+// 忽略大小写比较, 用于头部名称
+bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs);
+
+// 由解析器填充的请求, 各字段都是连接接收缓冲区的视图, 只在处理该请求期间有效
+class HttpRequest {
+public:
+    using ptr = std::shared_ptr<HttpRequest>;
+    using Header = std::pair<std::string_view, std::string_view>;
+
+    // version: 0x11为HTTP/1.1, 0x10为HTTP/1.0
+    HttpRequest(uint8_t version = 0x11, bool close = true);
+
+    HttpMethod getMethod() const { return m_method; }
+
+    uint8_t getVersion() const { return m_version; }
+
+    std::string_view getPath() const { return m_path; }
+
+    std::string_view getQuery() const { return m_query; }
+
+    std::string_view getFragment() const { return m_fragment; }
+
+    std::string_view getBody() const { return m_body; }
+
+    const std::vector<Header> &getHeaders() const { return m_headers; }
+
+    // 同名头部返回第一个
+    std::string_view getHeader(std::string_view key, std::string_view def = {}) const;
+
+    bool hasHeader(std::string_view key, std::string_view *val = nullptr) const;
+
+    // 处理完后是否关闭连接, 由版本和Connection头决定
+    bool isClose() const { return m_close; }
+
+    bool isChunked() const { return m_chunked; }
+
+    void setMethod(HttpMethod v) { m_method = v; }
+
+    void setVersion(uint8_t v) { m_version = v; }
+
+    void setPath(std::string_view v) { m_path = v; }
+
+    void setQuery(std::string_view v) { m_query = v; }
+
+    void setFragment(std::string_view v) { m_fragment = v; }
+
+    void setBody(std::string_view v) { m_body = v; }
+
+    void addHeader(std::string_view key, std::string_view val) { m_headers.emplace_back(key, val); }
+
+    void setClose(bool v) { m_close = v; }
+
+    void setChunked(bool v) { m_chunked = v; }
+
+    void reset();
+
+    // 客户端发送请求时使用, Connection/Content-Length由此生成, 不包含fragment
+    void serialize(std::string &out) const;
+
+    std::ostream &dump(std::ostream &os) const;
+
+    std::string toString() const;
+
+private:
+    HttpMethod m_method;
+    uint8_t m_version;
+    bool m_close;
+    bool m_chunked;
+    std::string_view m_path;
+    std::string_view m_query;
+    std::string_view m_fragment;
+    std::string_view m_body;
+    std::vector<Header> m_headers;
+};
+
+class HttpResponse {
+public:
+    using ptr = std::shared_ptr<HttpResponse>;
+    using Header = std::pair<std::string, std::string>;
+    // 流式响应: 每次调用填充下一块数据, 返回false表示结束; 以chunked编码发送
+    using Stream = std::function<bool(std::string &chunk)>;
+
+    HttpResponse(uint8_t version = 0x11, bool close = true);
+
+    HttpStatus getStatus() const { return m_status; }
+
+    uint8_t getVersion() const { return m_version; }
+
+    const std::string &getBody() const { return m_body; }
+
+    const std::string &getReason() const { return m_reason; }
+
+    const std::vector<Header> &getHeaders() const { return m_headers; }
+
+    bool isClose() const { return m_close; }
+
+    const Stream &getStream() const { return m_stream; }
+
+    void setStatus(HttpStatus v) { m_status = v; }
+
+    void setVersion(uint8_t v) { m_version = v; }
+
+    void setBody(std::string v) { m_body = std::move(v); }
+
+    void setReason(const std::string &v) { m_reason = v; }
+
+    void setClose(bool v) { m_close = v; }
+
+    void setStream(Stream v) { m_stream = std::move(v); }
+
+    std::string getHeader(std::string_view key, const std::string &def = "") const;
+
+    bool hasHeader(std::string_view key, std::string *val = nullptr) const;
+
+    // 替换同名头部
+    void setHeader(std::string_view key, std::string_view val);
+
+    void addHeader(std::string_view key, std::string_view val) { m_headers.emplace_back(key, val); }
+
+    void delHeader(std::string_view key);
+
+    void reset();
+
+    // 状态行和头部追加到out, Connection/Content-Length/Transfer-Encoding由此生成; withBody时也追加body
+    void serialize(std::string &out, bool withBody = true) const;
+
+    std::ostream &dump(std::ostream &os) const;
+
+    std::string toString() const;
+
+private:
+    HttpStatus m_status;
+    uint8_t m_version;
+    bool m_close;
+    std::string m_body;
+    std::string m_reason;
+    std::vector<Header> m_headers;
+    Stream m_stream;
+};
+
+std::ostream &operator<<(std::ostream &os, const HttpRequest &req);
+
+std::ostream &operator<<(std::ostream &os, const HttpResponse &rsp);
+
+}  // namespace http
+}  // namespace sylar
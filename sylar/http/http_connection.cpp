@@ -0,0 +1,467 @@
+#include "http_connection.h"
+#include <string.h>
+#include <algorithm>
+#include <sstream>
+#include "sylar/config.h"
+#include "sylar/hook.h"
+#include "sylar/log.h"
+#include "sylar/util.h"
+
+namespace sylar {
+namespace http {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint32_t>::ptr g_http_client_max_idle = sylar::Config::Lookup(
+    "http.client.max_idle", static_cast<uint32_t>(16), "http client max idle connections per host");
+
+static sylar::ConfigVar<uint32_t>::ptr g_http_client_max_total = sylar::Config::Lookup(
+    "http.client.max_total", static_cast<uint32_t>(64), "http client max connections per host");
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_client_idle_timeout = sylar::Config::Lookup(
+    "http.client.idle_timeout", static_cast<uint64_t>(30 * 1000), "http client idle connection timeout(ms)");
+
+static sylar::ConfigVar<uint32_t>::ptr g_http_client_max_requests = sylar::Config::Lookup(
+    "http.client.max_requests", static_cast<uint32_t>(0), "http client max requests per connection, 0 is unlimited");
+
+std::string HttpResult::toString() const {
+    std::stringstream ss;
+    ss << "[HttpResult result=" << static_cast<int>(m_result) << " error=" << m_error
+       << " response=" << (m_response ? m_response->toString() : "nullptr") << "]";
+    return ss.str();
+}
+
+HttpConnection::HttpConnection(Socket::ptr sock)
+    : m_sock{std::move(sock)},
+      m_buffer{new char[4096]},
+      m_capacity{4096},
+      m_createTime{GetCurrentMS()},
+      m_lastUsed{m_createTime} {}
+
+HttpConnection::~HttpConnection() { close(); }
+
+void HttpConnection::close() {
+    if (m_sock) {
+        m_sock->close();
+    }
+}
+
+bool HttpConnection::setTimeout(bool send, uint64_t deadline) {
+    uint64_t timeout = std::numeric_limits<uint64_t>::max();
+    if (deadline) {
+        uint64_t now = GetCurrentMS();
+        if (now >= deadline) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        timeout = deadline - now;
+    }
+    send ? m_sock->setSendTimeout(timeout) : m_sock->setRecvTimeout(timeout);
+    return true;
+}
+
+bool HttpConnection::sendRequest(const HttpRequest &req, uint64_t deadline) {
+    std::string out;
+    req.serialize(out);
+    size_t sent = 0;
+    while (sent < out.size()) {
+        if (!setTimeout(true, deadline)) {
+            return false;
+        }
+        ssize_t n = m_sock->send(out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    ++m_requests;
+    return true;
+}
+
+HttpResponse::ptr HttpConnection::recvResponse(bool head, uint64_t deadline) {
+    m_parser.reset(head);
+    m_size = 0;
+    while (true) {
+        auto rt = m_parser.execute(m_buffer.get(), m_size);
+        if (rt == HttpResponseParser::Result::DONE) {
+            break;
+        }
+        if (rt == HttpResponseParser::Result::FAILED) {
+            SYLAR_LOG_DEBUG(g_logger) << "invalid http response from " << *m_sock;
+            return nullptr;
+        }
+        if (m_size == m_capacity) {
+            std::unique_ptr<char[]> buffer{new char[m_capacity * 2]};
+            memcpy(buffer.get(), m_buffer.get(), m_size);
+            m_buffer.swap(buffer);
+            m_capacity *= 2;
+        }
+        if (!setTimeout(false, deadline)) {
+            return nullptr;
+        }
+        ssize_t n = m_sock->recv(m_buffer.get() + m_size, m_capacity - m_size);
+        if (n == 0 && m_parser.executeEof(m_buffer.get(), m_size) == HttpResponseParser::Result::DONE) {
+            break;
+        }
+        if (n <= 0) {
+            errno = n == 0 ? ECONNRESET : errno;
+            return nullptr;
+        }
+        m_size += n;
+    }
+
+    const HttpResponse::ptr &rsp = m_parser.getResponse();
+    // 响应之后还有数据, 连接上的消息边界已经不可信
+    if (m_parser.getMessageSize() != m_size) {
+        rsp->setClose(true);
+    }
+    m_lastUsed = GetCurrentMS();
+    return rsp;
+}
+
+bool HttpConnection::isHealthy() const {
+    if (!m_sock->isConnected()) {
+        return false;
+    }
+    char c;
+    ssize_t n = recv_f(m_sock->getSocket(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+HttpConnectionPool::HttpConnectionPool(const std::string &host, uint16_t port, uint32_t maxIdle, uint32_t maxTotal,
+                                       uint64_t idleTimeoutMs, uint32_t maxRequests, IOManager *iom)
+    : m_host{host},
+      m_vhost{port == 80 ? host : host + ":" + std::to_string(port)},
+      m_port{port},
+      m_maxIdle{maxIdle},
+      m_maxTotal{std::max<uint32_t>(maxTotal, 1)},
+      m_idleTimeout{idleTimeoutMs},
+      m_maxRequests{maxRequests},
+      m_iom{iom} {}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    if (m_timer) {
+        m_timer->cancel();
+    }
+}
+
+uint32_t HttpConnectionPool::getTotal() {
+    MutexType::Lock lock{m_mutex};
+    return m_total;
+}
+
+uint32_t HttpConnectionPool::getIdle() {
+    MutexType::Lock lock{m_mutex};
+    return m_idle.size();
+}
+
+uint32_t HttpConnectionPool::getWaiters() {
+    MutexType::Lock lock{m_mutex};
+    return m_waiters.size();
+}
+
+HttpConnection::ptr HttpConnectionPool::checkout(uint64_t deadline, HttpResult::Error &error) {
+    std::vector<HttpConnection::ptr> invalids;
+    MutexType::Lock lock{m_mutex};
+    uint64_t now = GetCurrentMS();
+    while (!m_idle.empty()) {
+        HttpConnection::ptr conn = m_idle.back();
+        m_idle.pop_back();
+        // idle_timeout为0时不按空闲时长淘汰, 与release中不启动淘汰定时器一致
+        if ((!m_idleTimeout || now - conn->getLastUsed() < m_idleTimeout) && conn->isHealthy()) {
+            ++m_reused;
+            return conn;
+        }
+        --m_total;
+        invalids.push_back(conn);
+    }
+    if (m_total < m_maxTotal) {
+        ++m_total;
+        lock.unlock();
+        invalids.clear();
+        return create(deadline, error);
+    }
+    if (deadline && now >= deadline) {
+        error = HttpResult::Error::POOL_TIMEOUT;
+        return nullptr;
+    }
+
+    // 挂起当前协程, 由release或定时器唤醒
+    auto waiter = std::make_shared<Waiter>();
+    waiter->m_scheduler = Scheduler::GetThis();
+    waiter->m_fiber = Fiber::GetThis();
+    waiter->m_thread = GetThreadId();
+    m_waiters.push_back(waiter);
+    Timer::ptr timer;
+    if (deadline) {
+        std::weak_ptr<Waiter> weak{waiter};
+        timer = m_iom->addConditionTimer(
+            deadline - now,
+            [this, weak]() {
+                auto waiter = weak.lock();
+                MutexType::Lock lock{m_mutex};
+                auto it = std::find(m_waiters.begin(), m_waiters.end(), waiter);
+                if (it == m_waiters.end()) {
+                    return;
+                }
+                m_waiters.erase(it);
+                waiter->m_scheduler->schedule(waiter->m_fiber, waiter->m_thread);
+            },
+            weak);
+    }
+    lock.unlock();
+    Fiber::GetThis()->yield();
+    if (timer) {
+        timer->cancel();
+    }
+
+    if (waiter->m_conn) {
+        ++m_reused;
+        return waiter->m_conn;
+    }
+    if (waiter->m_slot) {
+        return create(deadline, error);
+    }
+    error = HttpResult::Error::POOL_TIMEOUT;
+    return nullptr;
+}
+
+HttpConnection::ptr HttpConnectionPool::create(uint64_t deadline, HttpResult::Error &error) {
+    Address::ptr addr;
+    {
+        MutexType::Lock lock{m_mutex};
+        addr = m_address;
+    }
+    if (!addr) {
+        IPAddress::ptr ip = Address::LookupAnyIPAddress(m_host);
+        if (ip) {
+            ip->setPort(m_port);
+            addr = ip;
+            MutexType::Lock lock{m_mutex};
+            m_address = addr;
+        }
+    }
+
+    uint64_t now = GetCurrentMS();
+    if (!addr || (deadline && now >= deadline)) {
+        error = addr ? HttpResult::Error::TIMEOUT : HttpResult::Error::INVALID_HOST;
+        MutexType::Lock lock{m_mutex};
+        releaseSlot(lock);
+        return nullptr;
+    }
+
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if (!sock->connect(addr, deadline ? deadline - now : std::numeric_limits<uint64_t>::max())) {
+        error = errno == ETIMEDOUT ? HttpResult::Error::TIMEOUT : HttpResult::Error::CONNECT_FAIL;
+        SYLAR_LOG_DEBUG(g_logger) << "connect " << *addr << " fail, errno=" << errno << " " << strerror(errno);
+        MutexType::Lock lock{m_mutex};
+        // 地址可能已经变化, 下次重新解析
+        m_address.reset();
+        releaseSlot(lock);
+        return nullptr;
+    }
+    sock->setNoDelay(true);
+    ++m_created;
+    return std::make_shared<HttpConnection>(sock);
+}
+
+void HttpConnectionPool::releaseSlot(MutexType::Lock &lock) {
+    if (m_waiters.empty()) {
+        --m_total;
+        return;
+    }
+    auto waiter = m_waiters.front();
+    m_waiters.pop_front();
+    waiter->m_slot = true;
+    waiter->m_scheduler->schedule(waiter->m_fiber, waiter->m_thread);
+}
+
+void HttpConnectionPool::release(HttpConnection::ptr conn, bool reusable) {
+    reusable = reusable && (!m_maxRequests || conn->getRequests() < m_maxRequests);
+    MutexType::Lock lock{m_mutex};
+    if (reusable && !m_waiters.empty()) {
+        auto waiter = m_waiters.front();
+        m_waiters.pop_front();
+        waiter->m_conn = std::move(conn);
+        waiter->m_scheduler->schedule(waiter->m_fiber, waiter->m_thread);
+        return;
+    }
+    if (reusable && m_idle.size() < m_maxIdle) {
+        conn->setLastUsed(GetCurrentMS());
+        m_idle.push_back(std::move(conn));
+        if (!m_timer && m_idleTimeout) {
+            m_timer = m_iom->addTimer(std::max<uint64_t>(m_idleTimeout / 2, 10),
+                                      std::bind(&HttpConnectionPool::onIdleTimer, this), true);
+        }
+        return;
+    }
+    releaseSlot(lock);
+    lock.unlock();
+    conn->close();
+}
+
+void HttpConnectionPool::onIdleTimer() {
+    std::vector<HttpConnection::ptr> expired;
+    MutexType::Lock lock{m_mutex};
+    uint64_t now = GetCurrentMS();
+    // 空闲队列按归还时间排列, 过期的都在前面
+    auto it = std::find_if(m_idle.begin(), m_idle.end(), [this, now](const HttpConnection::ptr &conn) {
+        return now - conn->getLastUsed() < m_idleTimeout;
+    });
+    expired.assign(m_idle.begin(), it);
+    m_idle.erase(m_idle.begin(), it);
+    m_total -= expired.size();
+    lock.unlock();
+    if (!expired.empty()) {
+        SYLAR_LOG_DEBUG(g_logger) << "http pool " << m_vhost << " evict " << expired.size() << " idle connections";
+    }
+}
+
+HttpResult::ptr HttpConnectionPool::doGet(const std::string &path, uint64_t timeoutMs,
+                                          const std::map<std::string, std::string> &headers, const std::string &body) {
+    return doRequest(HttpMethod::GET, path, timeoutMs, headers, body);
+}
+
+HttpResult::ptr HttpConnectionPool::doPost(const std::string &path, uint64_t timeoutMs,
+                                           const std::map<std::string, std::string> &headers, const std::string &body) {
+    return doRequest(HttpMethod::POST, path, timeoutMs, headers, body);
+}
+
+HttpResult::ptr HttpConnectionPool::doRequest(HttpMethod method, const std::string &path, uint64_t timeoutMs,
+                                              const std::map<std::string, std::string> &headers,
+                                              const std::string &body) {
+    uint64_t deadline = timeoutMs ? GetCurrentMS() + timeoutMs : 0;
+
+    HttpRequest req;
+    req.reset();
+    req.setMethod(method);
+    std::string_view uri = path.empty() ? std::string_view("/") : std::string_view(path);
+    size_t query = uri.find('?');
+    req.setPath(uri.substr(0, query));
+    if (query != std::string_view::npos) {
+        req.setQuery(uri.substr(query + 1));
+    }
+    req.setClose(false);
+    bool hasHost = false;
+    for (const auto &header : headers) {
+        if (EqualsIgnoreCase(header.first, "connection")) {
+            req.setClose(EqualsIgnoreCase(header.second, "close"));
+            continue;
+        }
+        hasHost = hasHost || EqualsIgnoreCase(header.first, "host");
+        req.addHeader(header.first, header.second);
+    }
+    if (!hasHost) {
+        req.addHeader("Host", m_vhost);
+    }
+    req.setBody(body);
+
+    // 幂等请求在复用的连接上没有收到任何响应时, 认为是对端恰好关闭了空闲连接, 换一个连接重试一次
+    bool idempotent = method != HttpMethod::POST && method != HttpMethod::PATCH;
+    for (int retry = 0;; ++retry) {
+        HttpResult::Error error = HttpResult::Error::OK;
+        HttpConnection::ptr conn = checkout(deadline, error);
+        if (!conn) {
+            return std::make_shared<HttpResult>(error, nullptr, "checkout connection to " + m_vhost + " fail");
+        }
+        bool reused = conn->getRequests() > 0;
+        if (!conn->sendRequest(req, deadline)) {
+            int err = errno;
+            release(conn, false);
+            if (err == ETIMEDOUT) {
+                return std::make_shared<HttpResult>(HttpResult::Error::TIMEOUT, nullptr, "send request timeout");
+            }
+            if (reused && idempotent && retry == 0) {
+                continue;
+            }
+            return std::make_shared<HttpResult>(HttpResult::Error::SEND_FAIL, nullptr,
+                                                "send request fail, errno=" + std::to_string(err));
+        }
+        HttpResponse::ptr rsp = conn->recvResponse(method == HttpMethod::HEAD, deadline);
+        if (!rsp) {
+            int err = errno;
+            bool empty = conn->isResponseEmpty();
+            release(conn, false);
+            if (err == ETIMEDOUT) {
+                return std::make_shared<HttpResult>(HttpResult::Error::TIMEOUT, nullptr, "recv response timeout");
+            }
+            if (reused && idempotent && empty && retry == 0) {
+                continue;
+            }
+            return std::make_shared<HttpResult>(HttpResult::Error::RECV_FAIL, nullptr, "recv response fail");
+        }
+        release(conn, !rsp->isClose() && !req.isClose());
+        return std::make_shared<HttpResult>(HttpResult::Error::OK, rsp, "ok");
+    }
+}
+
+HttpClient::HttpClient(IOManager *iom) : m_iom{iom} {}
+
+HttpConnectionPool::ptr HttpClient::getPool(const std::string &host, uint16_t port) {
+    std::string key = host + ":" + std::to_string(port);
+    {
+        RWMutexType::ReadLock lock{m_mutex};
+        auto it = m_pools.find(key);
+        if (it != m_pools.end()) {
+            return it->second;
+        }
+    }
+    RWMutexType::WriteLock lock{m_mutex};
+    auto &pool = m_pools[key];
+    if (!pool) {
+        pool = std::make_shared<HttpConnectionPool>(host, port, g_http_client_max_idle->getValue(),
+                                                    g_http_client_max_total->getValue(),
+                                                    g_http_client_idle_timeout->getValue(),
+                                                    g_http_client_max_requests->getValue(), m_iom);
+    }
+    return pool;
+}
+
+HttpResult::ptr HttpClient::doGet(const std::string &url, uint64_t timeoutMs,
+                                  const std::map<std::string, std::string> &headers, const std::string &body) {
+    return doRequest(HttpMethod::GET, url, timeoutMs, headers, body);
+}
+
+HttpResult::ptr HttpClient::doPost(const std::string &url, uint64_t timeoutMs,
+                                   const std::map<std::string, std::string> &headers, const std::string &body) {
+    return doRequest(HttpMethod::POST, url, timeoutMs, headers, body);
+}
+
+HttpResult::ptr HttpClient::doRequest(HttpMethod method, const std::string &url, uint64_t timeoutMs,
+                                      const std::map<std::string, std::string> &headers, const std::string &body) {
+    // 只支持http://host[:port][/path][?query]
+    std::string_view u(url);
+    if (u.substr(0, 7) != "http://") {
+        return std::make_shared<HttpResult>(HttpResult::Error::INVALID_URL, nullptr, "invalid url: " + url);
+    }
+    u.remove_prefix(7);
+    size_t slash = u.find_first_of("/?#");
+    std::string_view authority = u.substr(0, slash);
+    std::string path = slash == std::string_view::npos ? "/" : std::string(u.substr(slash));
+    path = path.substr(0, path.find('#'));
+    if (path[0] == '?') {
+        path.insert(0, 1, '/');
+    }
+
+    std::string host(authority);
+    uint16_t port = 80;
+    size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+        int p = atoi(std::string(authority.substr(colon + 1)).c_str());
+        if (p <= 0 || p > 65535) {
+            return std::make_shared<HttpResult>(HttpResult::Error::INVALID_URL, nullptr, "invalid port: " + url);
+        }
+        port = p;
+        host = std::string(authority.substr(0, colon));
+    }
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    if (host.empty()) {
+        return std::make_shared<HttpResult>(HttpResult::Error::INVALID_URL, nullptr, "invalid host: " + url);
+    }
+    return getPool(host, port)->doRequest(method, path, timeoutMs, headers, body);
+}
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http.h"
+#include "http_parser.h"
+#include "sylar/iomanager.h"
+#include "sylar/mutex.h"
+#include "sylar/socket.h"
+
+namespace sylar {
+namespace http {
+
+struct HttpResult {
+    using ptr = std::shared_ptr<HttpResult>;
+
+    enum class Error {
+        OK = 0,
+        INVALID_URL,
+        INVALID_HOST,
+        CONNECT_FAIL,
+        SEND_FAIL,
+        RECV_FAIL,
+        TIMEOUT,
+        // 在超时时间内没有等到空闲连接
+        POOL_TIMEOUT,
+    };
+
+    HttpResult(Error result, HttpResponse::ptr response, const std::string &error)
+        : m_result{result}, m_response{std::move(response)}, m_error{error} {}
+
+    std::string toString() const;
+
+    Error m_result;
+    HttpResponse::ptr m_response;
+    std::string m_error;
+};
+
+// 客户端的一个连接, 可以顺序发送多个请求
+class HttpConnection {
+public:
+    using ptr = std::shared_ptr<HttpConnection>;
+
+    HttpConnection(Socket::ptr sock);
+
+    ~HttpConnection();
+
+    // deadline为绝对时间(ms), 每次阻塞前把剩余时间写入fd的超时设置; 0表示不超时
+    bool sendRequest(const HttpRequest &req, uint64_t deadline = 0);
+
+    // 返回nullptr时连接不能再使用, errno为ETIMEDOUT表示超时
+    HttpResponse::ptr recvResponse(bool head = false, uint64_t deadline = 0);
+
+    // 上一次recvResponse失败时是否一个字节都没有收到
+    bool isResponseEmpty() const { return m_size == 0; }
+
+    // 空闲连接的检查: 连接上不应有可读数据, 可读说明对端已关闭或发来了多余的数据
+    bool isHealthy() const;
+
+    const Socket::ptr &getSocket() const { return m_sock; }
+
+    uint64_t getCreateTime() const { return m_createTime; }
+
+    uint64_t getLastUsed() const { return m_lastUsed; }
+
+    void setLastUsed(uint64_t v) { m_lastUsed = v; }
+
+    uint32_t getRequests() const { return m_requests; }
+
+    void close();
+
+private:
+    bool setTimeout(bool send, uint64_t deadline);
+
+private:
+    Socket::ptr m_sock;
+    HttpResponseParser m_parser;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_capacity;
+    size_t m_size = 0;
+    uint64_t m_createTime;
+    uint64_t m_lastUsed;
+    uint32_t m_requests = 0;
+};
+
+// 同一个host的连接池
+// 空闲连接后进先出, 由定时器按idle_timeout回收; 连接数达到max_total时请求方协程挂起, 等待其他协程归还连接
+class HttpConnectionPool {
+public:
+    using ptr = std::shared_ptr<HttpConnectionPool>;
+    using MutexType = Mutex;
+
+    // maxRequests: 一个连接最多发送的请求数, 0表示不限制
+    HttpConnectionPool(const std::string &host, uint16_t port, uint32_t maxIdle, uint32_t maxTotal,
+                       uint64_t idleTimeoutMs, uint32_t maxRequests = 0, IOManager *iom = IOManager::GetThis());
+
+    ~HttpConnectionPool();
+
+    HttpResult::ptr doGet(const std::string &path, uint64_t timeoutMs,
+                          const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    HttpResult::ptr doPost(const std::string &path, uint64_t timeoutMs,
+                           const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    // path可以带query
+    HttpResult::ptr doRequest(HttpMethod method, const std::string &path, uint64_t timeoutMs,
+                              const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    // 检出一个连接, 必须在IOManager的协程中调用; 失败时返回nullptr, error为原因
+    HttpConnection::ptr checkout(uint64_t deadline, HttpResult::Error &error);
+
+    // 归还连接, reusable为false时关闭
+    void release(HttpConnection::ptr conn, bool reusable);
+
+    const std::string &getHost() const { return m_host; }
+
+    uint16_t getPort() const { return m_port; }
+
+    uint32_t getTotal();
+
+    uint32_t getIdle();
+
+    uint32_t getWaiters();
+
+    // 新建连接数 / 复用空闲连接的次数
+    uint64_t getCreated() const { return m_created; }
+
+    uint64_t getReused() const { return m_reused; }
+
+private:
+    struct Waiter {
+        Scheduler *m_scheduler;
+        Fiber::ptr m_fiber;
+        // 固定在挂起时的线程上恢复: 该线程要等协程yield返回后才会取到它, 不会与尚未完成的yield竞争
+        int m_thread;
+        // 归还的连接直接交给等待者
+        HttpConnection::ptr m_conn;
+        // 连接被关闭时把名额交给等待者, 由它新建连接
+        bool m_slot = false;
+    };
+
+    HttpConnection::ptr create(uint64_t deadline, HttpResult::Error &error);
+
+    // 放弃一个连接名额, 有等待者时转交给它; 需持有锁
+    void releaseSlot(MutexType::Lock &lock);
+
+    void onIdleTimer();
+
+private:
+    std::string m_host;
+    std::string m_vhost;
+    uint16_t m_port;
+    uint32_t m_maxIdle;
+    uint32_t m_maxTotal;
+    uint64_t m_idleTimeout;
+    uint32_t m_maxRequests;
+    IOManager *m_iom;
+
+    MutexType m_mutex;
+    Address::ptr m_address;
+    // 包括空闲的, 使用中的和正在建立的连接
+    uint32_t m_total = 0;
+    std::vector<HttpConnection::ptr> m_idle;
+    std::list<std::shared_ptr<Waiter>> m_waiters;
+    Timer::ptr m_timer;
+    std::atomic<uint64_t> m_created{0};
+    std::atomic<uint64_t> m_reused{0};
+};
+
+// 按host:port管理连接池, 池的参数取自http.client配置
+class HttpClient {
+public:
+    using ptr = std::shared_ptr<HttpClient>;
+    using RWMutexType = RWMutex;
+
+    HttpClient(IOManager *iom = IOManager::GetThis());
+
+    // url形如http://host[:port]/path?query
+    HttpResult::ptr doGet(const std::string &url, uint64_t timeoutMs,
+                          const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    HttpResult::ptr doPost(const std::string &url, uint64_t timeoutMs,
+                           const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    HttpResult::ptr doRequest(HttpMethod method, const std::string &url, uint64_t timeoutMs,
+                              const std::map<std::string, std::string> &headers = {}, const std::string &body = "");
+
+    HttpConnectionPool::ptr getPool(const std::string &host, uint16_t port);
+
+private:
+    IOManager *m_iom;
+    RWMutexType m_mutex;
+    std::unordered_map<std::string, HttpConnectionPool::ptr> m_pools;
+};
+
+}  // namespace http
+}  // namespace sylar
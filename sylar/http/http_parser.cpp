@@ -0,0 +1,583 @@
+#include "http_parser.h"
+#include <string.h>
+#include "sylar/config.h"
+
+namespace sylar {
+namespace http {
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_request_max_header_size = sylar::Config::Lookup(
+    "http.request.max_header_size", static_cast<uint64_t>(64 * 1024), "http request max header size");
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_request_max_body_size = sylar::Config::Lookup(
+    "http.request.max_body_size", static_cast<uint64_t>(64 * 1024 * 1024), "http request max body size");
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_response_max_body_size = sylar::Config::Lookup(
+    "http.response.max_body_size", static_cast<uint64_t>(64 * 1024 * 1024), "http response max body size");
+
+static uint64_t s_http_request_max_header_size = 0;
+static uint64_t s_http_request_max_body_size = 0;
+static uint64_t s_http_response_max_body_size = 0;
+
+uint64_t HttpRequestParser::GetMaxHeaderSize() { return s_http_request_max_header_size; }
+
+uint64_t HttpRequestParser::GetMaxBodySize() { return s_http_request_max_body_size; }
+
+uint64_t HttpResponseParser::GetMaxBodySize() { return s_http_response_max_body_size; }
+
+struct _HttpParserIniter {
+    _HttpParserIniter() {
+        s_http_request_max_header_size = g_http_request_max_header_size->getValue();
+        s_http_request_max_body_size = g_http_request_max_body_size->getValue();
+        s_http_response_max_body_size = g_http_response_max_body_size->getValue();
+        g_http_request_max_header_size->addListener(
+            [](const uint64_t &oldValue, const uint64_t &newValue) { s_http_request_max_header_size = newValue; });
+        g_http_request_max_body_size->addListener(
+            [](const uint64_t &oldValue, const uint64_t &newValue) { s_http_request_max_body_size = newValue; });
+        g_http_response_max_body_size->addListener(
+            [](const uint64_t &oldValue, const uint64_t &newValue) { s_http_response_max_body_size = newValue; });
+    }
+};
+
+static _HttpParserIniter s_http_parser_initer;
+
+// 逗号分隔的列表中是否包含token, 忽略大小写
+static bool HasToken(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (EqualsIgnoreCase(item, token)) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// 十六进制的chunk大小, 之后可以跟chunk扩展; 溢出时size为SIZE_MAX
+static bool ParseChunkSize(const char *begin, const char *end, size_t &size) {
+    size = 0;
+    const char *p = begin;
+    for (; p < end && isxdigit(static_cast<unsigned char>(*p)); ++p) {
+        if (size >> 60) {
+            size = SIZE_MAX;
+            return true;
+        }
+        size = size * 16 + (*p <= '9' ? *p - '0' : (*p | 0x20) - 'a' + 10);
+    }
+    return p != begin && (p == end || *p == ';' || *p == ' ' || *p == '\t');
+}
+
+static bool ParseContentLength(std::string_view value, size_t &length) {
+    if (value.empty() || value.size() > 19) {
+        return false;
+    }
+    length = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        length = length * 10 + (c - '0');
+    }
+    return true;
+}
+
+// chunked必须是最后一个编码
+static bool IsChunkedLast(std::string_view value) {
+    size_t comma = value.rfind(',');
+    std::string_view last = comma == std::string_view::npos ? value : value.substr(comma + 1);
+    while (!last.empty() && (last.front() == ' ' || last.front() == '\t')) {
+        last.remove_prefix(1);
+    }
+    return EqualsIgnoreCase(last, "chunked");
+}
+
+HttpRequestParser::HttpRequestParser() : m_request{std::make_shared<HttpRequest>()} { reset(); }
+
+void HttpRequestParser::reset() {
+    m_state = REQUEST_LINE;
+    m_error = HttpStatus::BAD_REQUEST;
+    m_pos = 0;
+    m_lineStart = 0;
+    m_method = HttpMethod::INVALID_METHOD;
+    m_version = 0x11;
+    m_path = m_query = m_fragment = Span{};
+    m_headers.clear();
+    m_chunked = false;
+    m_close = false;
+    m_bodyStart = 0;
+    m_bodyLength = 0;
+    m_contentLength = 0;
+    m_chunkRemain = 0;
+}
+
+HttpRequestParser::Result HttpRequestParser::fail(HttpStatus status) {
+    m_error = status;
+    return FAILED;
+}
+
+HttpRequestParser::Result HttpRequestParser::execute(char *data, size_t size) {
+    while (m_state != COMPLETE) {
+        if (m_state == BODY) {
+            if (size - m_bodyStart < m_contentLength) {
+                return AGAIN;
+            }
+            m_bodyLength = m_contentLength;
+            m_pos = m_bodyStart + m_contentLength;
+            finish(data);
+            break;
+        }
+
+        if (m_state == CHUNK_DATA) {
+            size_t n = std::min(size - m_pos, m_chunkRemain);
+            size_t to = m_bodyStart + m_bodyLength;
+            if (to != m_pos) {
+                memmove(data + to, data + m_pos, n);
+            }
+            m_bodyLength += n;
+            m_pos += n;
+            m_chunkRemain -= n;
+            if (m_chunkRemain > 0) {
+                return AGAIN;
+            }
+            m_state = CHUNK_DATA_END;
+            m_lineStart = m_pos;
+            continue;
+        }
+
+        // 其余状态按行解析, 已扫描过的字节不再重复扫描; glibc的memchr已按CPU选择向量化实现
+        const char *nl = static_cast<const char *>(memchr(data + m_pos, '\n', size - m_pos));
+        if (!nl) {
+            m_pos = size;
+            if (m_state == REQUEST_LINE || m_state == HEADERS) {
+                if (size > GetMaxHeaderSize()) {
+                    return fail(m_state == REQUEST_LINE ? HttpStatus::URI_TOO_LONG
+                                                        : HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+                }
+            } else if (size - m_lineStart > 1024) {
+                return fail(HttpStatus::BAD_REQUEST);
+            }
+            return AGAIN;
+        }
+
+        m_pos = nl - data + 1;
+        size_t eol = nl - data;
+        if (eol > m_lineStart && data[eol - 1] == '\r') {
+            --eol;
+        }
+
+        Result rt = DONE;
+        switch (m_state) {
+            case REQUEST_LINE:
+                rt = parseRequestLine(data, eol);
+                break;
+            case HEADERS:
+                rt = parseHeader(data, eol);
+                break;
+            case CHUNK_SIZE: {
+                size_t chunk = 0;
+                if (!ParseChunkSize(data + m_lineStart, data + eol, chunk)) {
+                    return fail(HttpStatus::BAD_REQUEST);
+                }
+                if (chunk == 0) {
+                    m_state = TRAILERS;
+                } else if (chunk > GetMaxBodySize() || m_bodyLength + chunk > GetMaxBodySize()) {
+                    return fail(HttpStatus::PAYLOAD_TOO_LARGE);
+                } else {
+                    m_chunkRemain = chunk;
+                    m_state = CHUNK_DATA;
+                }
+                break;
+            }
+            case CHUNK_DATA_END:
+                if (eol != m_lineStart) {
+                    return fail(HttpStatus::BAD_REQUEST);
+                }
+                m_state = CHUNK_SIZE;
+                break;
+            case TRAILERS:
+                if (eol == m_lineStart) {
+                    finish(data);
+                }
+                break;
+            default:
+                break;
+        }
+        if (rt == FAILED) {
+            return FAILED;
+        }
+        m_lineStart = m_pos;
+    }
+    return DONE;
+}
+
+HttpRequestParser::Result HttpRequestParser::parseRequestLine(char *data, size_t eol) {
+    // 请求行之前的空行忽略
+    if (eol == m_lineStart) {
+        return AGAIN;
+    }
+    const char *begin = data + m_lineStart;
+    const char *end = data + eol;
+
+    const char *sp = static_cast<const char *>(memchr(begin, ' ', end - begin));
+    if (!sp) {
+        return fail(HttpStatus::BAD_REQUEST);
+    }
+    m_method = StringToHttpMethod(std::string_view(begin, sp - begin));
+    if (m_method == HttpMethod::INVALID_METHOD) {
+        return fail(HttpStatus::NOT_IMPLEMENTED);
+    }
+
+    const char *uri = sp + 1;
+    const char *uriEnd = static_cast<const char *>(memchr(uri, ' ', end - uri));
+    if (!uriEnd || uriEnd == uri) {
+        return fail(HttpStatus::BAD_REQUEST);
+    }
+
+    std::string_view version(uriEnd + 1, end - uriEnd - 1);
+    if (version == "HTTP/1.1") {
+        m_version = 0x11;
+    } else if (version == "HTTP/1.0") {
+        m_version = 0x10;
+    } else if (version.size() == 8 && version.substr(0, 5) == "HTTP/") {
+        return fail(HttpStatus::HTTP_VERSION_NOT_SUPPORTED);
+    } else {
+        return fail(HttpStatus::BAD_REQUEST);
+    }
+
+    // absolute-form只取其中的路径部分
+    const char *path = uri;
+    if (*uri != '/' && !(*uri == '*' && uriEnd - uri == 1)) {
+        std::string_view u(uri, uriEnd - uri);
+        size_t scheme = u.find("://");
+        if (scheme == std::string_view::npos) {
+            return fail(HttpStatus::BAD_REQUEST);
+        }
+        size_t slash = u.find('/', scheme + 3);
+        path = slash == std::string_view::npos ? uriEnd : uri + slash;
+    }
+    const char *fragment = static_cast<const char *>(memchr(path, '#', uriEnd - path));
+    const char *pathEnd = fragment ? fragment : uriEnd;
+    const char *query = static_cast<const char *>(memchr(path, '?', pathEnd - path));
+    m_path = Span{static_cast<size_t>(path - data), static_cast<size_t>((query ? query : pathEnd) - path)};
+    if (query) {
+        m_query = Span{static_cast<size_t>(query + 1 - data), static_cast<size_t>(pathEnd - query - 1)};
+    }
+    if (fragment) {
+        m_fragment = Span{static_cast<size_t>(fragment + 1 - data), static_cast<size_t>(uriEnd - fragment - 1)};
+    }
+
+    m_close = m_version == 0x10;
+    m_state = HEADERS;
+    return DONE;
+}
+
+HttpRequestParser::Result HttpRequestParser::parseHeader(char *data, size_t eol) {
+    if (eol == m_lineStart) {
+        return onHeadersComplete(data);
+    }
+
+    const char *begin = data + m_lineStart;
+    const char *end = data + eol;
+    // 不支持obs-fold; 名称中不允许空白和控制字符
+    if (*begin == ' ' || *begin == '\t') {
+        return fail(HttpStatus::BAD_REQUEST);
+    }
+    const char *colon = static_cast<const char *>(memchr(begin, ':', end - begin));
+    if (!colon || colon == begin) {
+        return fail(HttpStatus::BAD_REQUEST);
+    }
+    for (const char *p = begin; p < colon; ++p) {
+        if (static_cast<unsigned char>(*p) <= ' ' || *p == 0x7f) {
+            return fail(HttpStatus::BAD_REQUEST);
+        }
+    }
+    const char *value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        ++value;
+    }
+    const char *valueEnd = end;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        --valueEnd;
+    }
+    m_headers.emplace_back(Span{m_lineStart, static_cast<size_t>(colon - begin)},
+                           Span{static_cast<size_t>(value - data), static_cast<size_t>(valueEnd - value)});
+    return DONE;
+}
+
+HttpRequestParser::Result HttpRequestParser::onHeadersComplete(const char *data) {
+    bool hasLength = false;
+    bool hasEncoding = false;
+    for (const auto &header : m_headers) {
+        std::string_view name(data + header.first.m_offset, header.first.m_length);
+        std::string_view value(data + header.second.m_offset, header.second.m_length);
+        if (EqualsIgnoreCase(name, "connection")) {
+            if (HasToken(value, "close")) {
+                m_close = true;
+            } else if (HasToken(value, "keep-alive")) {
+                m_close = false;
+            }
+        } else if (EqualsIgnoreCase(name, "transfer-encoding")) {
+            if (!IsChunkedLast(value)) {
+                return fail(HttpStatus::BAD_REQUEST);
+            }
+            hasEncoding = true;
+        } else if (EqualsIgnoreCase(name, "content-length")) {
+            size_t length = 0;
+            if (!ParseContentLength(value, length)) {
+                return fail(HttpStatus::BAD_REQUEST);
+            }
+            if (hasLength && length != m_contentLength) {
+                return fail(HttpStatus::BAD_REQUEST);
+            }
+            hasLength = true;
+            m_contentLength = length;
+        }
+    }
+
+    m_bodyStart = m_pos;
+    if (hasEncoding) {
+        // 同时带Content-Length的请求可能被前后两级按不同长度解析, 处理完即关闭连接
+        m_close = m_close || hasLength;
+        m_chunked = true;
+        m_contentLength = 0;
+        m_state = CHUNK_SIZE;
+    } else if (m_contentLength > GetMaxBodySize()) {
+        return fail(HttpStatus::PAYLOAD_TOO_LARGE);
+    } else if (m_contentLength > 0) {
+        m_state = BODY;
+    } else {
+        finish(data);
+    }
+    return DONE;
+}
+
+void HttpRequestParser::finish(const char *data) {
+    auto view = [data](const Span &span) { return std::string_view(data + span.m_offset, span.m_length); };
+    HttpRequest &req = *m_request;
+    req.reset();
+    req.setMethod(m_method);
+    req.setVersion(m_version);
+    req.setPath(m_path.m_length ? view(m_path) : std::string_view("/"));
+    req.setQuery(view(m_query));
+    req.setFragment(view(m_fragment));
+    for (const auto &header : m_headers) {
+        req.addHeader(view(header.first), view(header.second));
+    }
+    req.setBody(std::string_view(data + m_bodyStart, m_bodyLength));
+    req.setClose(m_close);
+    req.setChunked(m_chunked);
+    m_state = COMPLETE;
+}
+
+HttpResponseParser::HttpResponseParser() { reset(); }
+
+void HttpResponseParser::reset(bool head) {
+    m_response = std::make_shared<HttpResponse>();
+    m_state = STATUS_LINE;
+    m_head = head;
+    m_pos = 0;
+    m_lineStart = 0;
+    m_bodyStart = 0;
+    m_contentLength = 0;
+    m_chunkRemain = 0;
+    m_body.clear();
+}
+
+HttpResponseParser::Result HttpResponseParser::execute(const char *data, size_t size) {
+    while (m_state != COMPLETE) {
+        if (m_state == BODY) {
+            if (size - m_bodyStart < m_contentLength) {
+                return Result::AGAIN;
+            }
+            m_response->setBody(std::string(data + m_bodyStart, m_contentLength));
+            m_pos = m_bodyStart + m_contentLength;
+            m_state = COMPLETE;
+            break;
+        }
+
+        if (m_state == BODY_UNTIL_EOF) {
+            m_pos = size;
+            return size - m_bodyStart > GetMaxBodySize() ? Result::FAILED : Result::AGAIN;
+        }
+
+        if (m_state == CHUNK_DATA) {
+            size_t n = std::min(size - m_pos, m_chunkRemain);
+            m_body.append(data + m_pos, n);
+            m_pos += n;
+            m_chunkRemain -= n;
+            if (m_chunkRemain > 0) {
+                return Result::AGAIN;
+            }
+            m_state = CHUNK_DATA_END;
+            m_lineStart = m_pos;
+            continue;
+        }
+
+        const char *nl = static_cast<const char *>(memchr(data + m_pos, '\n', size - m_pos));
+        if (!nl) {
+            m_pos = size;
+            if (m_state == STATUS_LINE || m_state == HEADERS) {
+                return size > HttpRequestParser::GetMaxHeaderSize() ? Result::FAILED : Result::AGAIN;
+            }
+            return size - m_lineStart > 1024 ? Result::FAILED : Result::AGAIN;
+        }
+
+        m_pos = nl - data + 1;
+        size_t eol = nl - data;
+        if (eol > m_lineStart && data[eol - 1] == '\r') {
+            --eol;
+        }
+
+        Result rt = Result::DONE;
+        switch (m_state) {
+            case STATUS_LINE:
+                rt = parseStatusLine(data, eol);
+                break;
+            case HEADERS:
+                rt = parseHeader(data, eol);
+                break;
+            case CHUNK_SIZE: {
+                size_t chunk = 0;
+                if (!ParseChunkSize(data + m_lineStart, data + eol, chunk) || chunk > GetMaxBodySize() ||
+                    m_body.size() + chunk > GetMaxBodySize()) {
+                    return Result::FAILED;
+                }
+                m_chunkRemain = chunk;
+                m_state = chunk ? CHUNK_DATA : TRAILERS;
+                break;
+            }
+            case CHUNK_DATA_END:
+                if (eol != m_lineStart) {
+                    return Result::FAILED;
+                }
+                m_state = CHUNK_SIZE;
+                break;
+            case TRAILERS:
+                if (eol == m_lineStart) {
+                    m_response->setBody(std::move(m_body));
+                    m_state = COMPLETE;
+                }
+                break;
+            default:
+                break;
+        }
+        if (rt == Result::FAILED) {
+            return Result::FAILED;
+        }
+        m_lineStart = m_pos;
+    }
+    return Result::DONE;
+}
+
+HttpResponseParser::Result HttpResponseParser::executeEof(const char *data, size_t size) {
+    if (m_state != BODY_UNTIL_EOF) {
+        return Result::FAILED;
+    }
+    m_response->setBody(std::string(data + m_bodyStart, size - m_bodyStart));
+    m_pos = size;
+    m_state = COMPLETE;
+    return Result::DONE;
+}
+
+HttpResponseParser::Result HttpResponseParser::parseStatusLine(const char *data, size_t eol) {
+    std::string_view line(data + m_lineStart, eol - m_lineStart);
+    if (line.empty()) {
+        return Result::AGAIN;
+    }
+    // HTTP/1.1 200 OK
+    if (line.size() < 12 || line.substr(0, 7) != "HTTP/1." || (line[7] != '0' && line[7] != '1') || line[8] != ' ' ||
+        !isdigit(line[9]) || !isdigit(line[10]) || !isdigit(line[11]) || (line.size() > 12 && line[12] != ' ')) {
+        return Result::FAILED;
+    }
+    uint8_t version = line[7] == '1' ? 0x11 : 0x10;
+    m_response->setVersion(version);
+    m_response->setClose(version == 0x10);
+    m_response->setStatus(static_cast<HttpStatus>((line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0')));
+    m_response->setReason(line.size() > 13 ? std::string(line.substr(13)) : std::string());
+    m_state = HEADERS;
+    return Result::DONE;
+}
+
+HttpResponseParser::Result HttpResponseParser::parseHeader(const char *data, size_t eol) {
+    if (eol == m_lineStart) {
+        return onHeadersComplete();
+    }
+    const char *begin = data + m_lineStart;
+    const char *end = data + eol;
+    const char *colon = static_cast<const char *>(memchr(begin, ':', end - begin));
+    if (*begin == ' ' || *begin == '\t' || !colon || colon == begin) {
+        return Result::FAILED;
+    }
+    const char *value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        ++value;
+    }
+    const char *valueEnd = end;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        --valueEnd;
+    }
+    m_response->addHeader(std::string_view(begin, colon - begin), std::string_view(value, valueEnd - value));
+    return Result::DONE;
+}
+
+HttpResponseParser::Result HttpResponseParser::onHeadersComplete() {
+    int status = static_cast<int>(m_response->getStatus());
+    // 跳过100 Continue等中间响应
+    if (status / 100 == 1 && status != 101) {
+        m_response = std::make_shared<HttpResponse>();
+        m_state = STATUS_LINE;
+        return Result::DONE;
+    }
+
+    bool close = m_response->isClose();
+    bool chunked = false;
+    bool hasLength = false;
+    for (const auto &header : m_response->getHeaders()) {
+        if (EqualsIgnoreCase(header.first, "connection")) {
+            if (HasToken(header.second, "close")) {
+                close = true;
+            } else if (HasToken(header.second, "keep-alive")) {
+                close = false;
+            }
+        } else if (EqualsIgnoreCase(header.first, "transfer-encoding")) {
+            chunked = IsChunkedLast(header.second);
+            // 最后一个编码不是chunked时body到连接关闭为止
+            close = close || !chunked;
+        } else if (EqualsIgnoreCase(header.first, "content-length")) {
+            size_t length = 0;
+            if (!ParseContentLength(header.second, length) || (hasLength && length != m_contentLength)) {
+                return Result::FAILED;
+            }
+            hasLength = true;
+            m_contentLength = length;
+        }
+    }
+
+    m_bodyStart = m_pos;
+    if (m_head || status / 100 == 1 || status == 204 || status == 304) {
+        m_state = COMPLETE;
+    } else if (chunked) {
+        m_state = CHUNK_SIZE;
+    } else if (m_response->hasHeader("transfer-encoding") || !hasLength) {
+        close = true;
+        m_state = BODY_UNTIL_EOF;
+    } else if (m_contentLength > GetMaxBodySize()) {
+        return Result::FAILED;
+    } else {
+        m_state = m_contentLength ? BODY : COMPLETE;
+    }
+    m_response->setClose(close);
+    return Result::DONE;
+}
+
+}  // namespace http
+}  // namespace sylar
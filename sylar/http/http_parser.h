@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "http.h"
+
+namespace sylar {
+namespace http {
+
+// 增量, 零拷贝的请求解析器
+// 解析过程只记录偏移, 完成时请求的各字段才指向缓冲区, 因此两次调用之间缓冲区可以被移动或扩容
+class HttpRequestParser {
+public:
+    enum Result {
+        FAILED = -1,
+        AGAIN = 0,
+        DONE = 1,
+    };
+
+    HttpRequestParser();
+
+    // data指向当前请求的第一个字节, size为已收到的字节数; 收到更多数据后以新的data/size再次调用
+    // chunked的body在缓冲区内原地解码, 因此data可写
+    Result execute(char *data, size_t size);
+
+    const HttpRequest::ptr &getRequest() const { return m_request; }
+
+    // DONE之后该请求在缓冲区中占用的字节数, 之后的字节属于下一个流水线请求
+    size_t getMessageSize() const { return m_pos; }
+
+    // FAILED时应答的状态码
+    HttpStatus getError() const { return m_error; }
+
+    void reset();
+
+    static uint64_t GetMaxHeaderSize();
+
+    static uint64_t GetMaxBodySize();
+
+private:
+    struct Span {
+        size_t m_offset = 0;
+        size_t m_length = 0;
+    };
+
+    enum State {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        COMPLETE,
+    };
+
+    Result parseRequestLine(char *data, size_t eol);
+
+    Result parseHeader(char *data, size_t eol);
+
+    // 头部结束, 确定body的长度和连接是否保持
+    Result onHeadersComplete(const char *data);
+
+    Result parseChunked(char *data, size_t size);
+
+    Result fail(HttpStatus status);
+
+    void finish(const char *data);
+
+private:
+    HttpRequest::ptr m_request;
+    State m_state;
+    HttpStatus m_error;
+    size_t m_pos;
+    // 当前行的起始偏移
+    size_t m_lineStart;
+    HttpMethod m_method;
+    uint8_t m_version;
+    Span m_path;
+    Span m_query;
+    Span m_fragment;
+    std::vector<std::pair<Span, Span>> m_headers;
+    bool m_chunked;
+    bool m_close;
+    size_t m_bodyStart;
+    // 已解码的body长度
+    size_t m_bodyLength;
+    size_t m_contentLength;
+    size_t m_chunkRemain;
+};
+
+// 客户端的增量响应解析器, 结果复制到新的HttpResponse中, 不引用接收缓冲区
+class HttpResponseParser {
+public:
+    using Result = HttpRequestParser::Result;
+
+    HttpResponseParser();
+
+    // 与HttpRequestParser相同, data指向响应的第一个字节, size为已收到的字节数
+    Result execute(const char *data, size_t size);
+
+    // 连接在响应完成前关闭; 没有长度的body以此结束, 其他状态下是错误
+    Result executeEof(const char *data, size_t size);
+
+    // DONE之后得到响应, 下一次reset会创建新的对象
+    const HttpResponse::ptr &getResponse() const { return m_response; }
+
+    size_t getMessageSize() const { return m_pos; }
+
+    // head: 对应的请求是HEAD, 响应没有body
+    void reset(bool head = false);
+
+    static uint64_t GetMaxBodySize();
+
+private:
+    enum State {
+        STATUS_LINE,
+        HEADERS,
+        BODY,
+        BODY_UNTIL_EOF,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        COMPLETE,
+    };
+
+    Result parseStatusLine(const char *data, size_t eol);
+
+    Result parseHeader(const char *data, size_t eol);
+
+    Result onHeadersComplete();
+
+private:
+    HttpResponse::ptr m_response;
+    State m_state;
+    bool m_head;
+    size_t m_pos;
+    size_t m_lineStart;
+    size_t m_bodyStart;
+    size_t m_contentLength;
+    size_t m_chunkRemain;
+    // chunked body解码后的数据
+    std::string m_body;
+};
+
+}  // namespace http
+}  // namespace sylar
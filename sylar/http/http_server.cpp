@@ -0,0 +1,40 @@
+#include "http_server.h"
+#include "sylar/log.h"
+#include "sylar/util.h"
+
+namespace sylar {
+namespace http {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+HttpServer::HttpServer(bool keepalive, IOManager *worker, IOManager *acceptWorker)
+    : TcpServer{worker, acceptWorker}, m_isKeepalive{keepalive}, m_dispatch{std::make_shared<ServletDispatch>()} {}
+
+HttpServer::HttpServer(bool keepalive, const std::vector<IOManager *> &workers, IOManager *acceptWorker)
+    : TcpServer{workers, acceptWorker}, m_isKeepalive{keepalive}, m_dispatch{std::make_shared<ServletDispatch>()} {}
+
+void HttpServer::handleClient(Socket::ptr client) {
+    SYLAR_LOG_DEBUG(g_logger) << "handleClient " << *client;
+    HttpSession::ptr session = std::make_shared<HttpSession>(client);
+    while (true) {
+        HttpRequest::ptr req = session->recvRequest();
+        if (!req) {
+            SYLAR_LOG_DEBUG(g_logger) << "recv http request fail, client:" << *client;
+            break;
+        }
+
+        // 停止时处理完当前请求即关闭, 使stop能尽快排空连接
+        bool close = req->isClose() || !m_isKeepalive || isStop();
+        HttpResponse::ptr rsp = std::make_shared<HttpResponse>(req->getVersion(), close);
+        rsp->setHeader("Server", getName());
+        m_dispatch->handle(req, rsp, session);
+        close = close || rsp->isClose();
+        if (!session->sendResponse(*rsp, close || !session->hasBufferedRequest()) || close) {
+            break;
+        }
+    }
+    session->flush();
+}
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "servlet.h"
+#include "sylar/tcp_server.h"
+
+namespace sylar {
+namespace http {
+
+// 长连接上按顺序处理流水线请求, 缓冲区中还有请求时响应暂不发送, 与后续响应一起写出
+class HttpServer : public TcpServer {
+public:
+    using ptr = std::shared_ptr<HttpServer>;
+
+    HttpServer(bool keepalive = false, IOManager *worker = IOManager::GetThis(),
+               IOManager *acceptWorker = IOManager::GetThis());
+
+    HttpServer(bool keepalive, const std::vector<IOManager *> &workers, IOManager *acceptWorker);
+
+    ServletDispatch::ptr getServletDispatch() const { return m_dispatch; }
+
+    void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v; }
+
+protected:
+    void handleClient(Socket::ptr client) override;
+
+private:
+    bool m_isKeepalive;
+    ServletDispatch::ptr m_dispatch;
+};
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,153 @@
+#include "http_session.h"
+#include <string.h>
+#include "sylar/config.h"
+#include "sylar/log.h"
+#include "sylar/macro.h"
+#include "sylar/util.h"
+
+namespace sylar {
+namespace http {
+
+static sylar::ConfigVar<uint64_t>::ptr g_http_request_buffer_size =
+    sylar::Config::Lookup("http.request.buffer_size", static_cast<uint64_t>(4 * 1024), "http request buffer size");
+
+static uint64_t s_http_request_buffer_size = 0;
+
+struct _RequestSizeIniter {
+    _RequestSizeIniter() {
+        s_http_request_buffer_size = g_http_request_buffer_size->getValue();
+        g_http_request_buffer_size->addListener(
+            [](const uint64_t &oldValue, const uint64_t &newValue) { s_http_request_buffer_size = newValue; });
+    }
+};
+
+static _RequestSizeIniter s_request_size_initer;
+
+// 超过该大小的body不复制到发送缓冲, 与头部一起用sendmsg发出
+static constexpr size_t LARGE_BODY_SIZE = 16 * 1024;
+// 发送缓冲超过该大小时立即发送
+static constexpr size_t MAX_PENDING_OUTPUT = 64 * 1024;
+
+HttpSession::HttpSession(Socket::ptr sock)
+    : m_sock{std::move(sock)},
+      m_buffer{new char[std::max<uint64_t>(s_http_request_buffer_size, 1024)]},
+      m_capacity{std::max<uint64_t>(s_http_request_buffer_size, 1024)} {}
+
+HttpRequest::ptr HttpSession::recvRequest() {
+    if (m_parsed) {
+        m_start += m_parser.getMessageSize();
+        m_parser.reset();
+        m_parsed = false;
+    }
+
+    while (true) {
+        if (m_start == m_end) {
+            m_start = m_end = 0;
+        }
+        auto rt = m_parser.execute(m_buffer.get() + m_start, m_end - m_start);
+        if (rt == HttpRequestParser::DONE) {
+            m_parsed = true;
+            return m_parser.getRequest();
+        }
+        if (rt == HttpRequestParser::FAILED) {
+            HttpResponse rsp{0x11, true};
+            rsp.setStatus(m_parser.getError());
+            sendResponse(rsp);
+            return nullptr;
+        }
+
+        // 等待更多数据之前先发出已缓存的响应
+        if (!flush()) {
+            return nullptr;
+        }
+        // 解析器只记录偏移, 可以移动未解析完的数据
+        if (m_start > 0) {
+            memmove(m_buffer.get(), m_buffer.get() + m_start, m_end - m_start);
+            m_end -= m_start;
+            m_start = 0;
+        }
+        if (m_end == m_capacity) {
+            std::unique_ptr<char[]> buffer{new char[m_capacity * 2]};
+            memcpy(buffer.get(), m_buffer.get(), m_end);
+            m_buffer.swap(buffer);
+            m_capacity *= 2;
+        }
+        ssize_t n = m_sock->recv(m_buffer.get() + m_end, m_capacity - m_end);
+        if (n <= 0) {
+            return nullptr;
+        }
+        m_end += n;
+    }
+}
+
+bool HttpSession::sendResponse(const HttpResponse &rsp, bool flush) {
+    bool withBody = !(m_parsed && m_parser.getRequest()->getMethod() == HttpMethod::HEAD);
+    const std::string &body = rsp.getBody();
+    const HttpResponse::Stream &stream = rsp.getStream();
+
+    if (!stream && withBody && body.size() >= LARGE_BODY_SIZE) {
+        rsp.serialize(m_out, false);
+        iovec iov[2] = {{&m_out[0], m_out.size()}, {const_cast<char *>(body.data()), body.size()}};
+        bool ok = sendAll(iov, 2);
+        m_out.clear();
+        return ok;
+    }
+
+    rsp.serialize(m_out, withBody);
+    if (stream && withBody) {
+        std::string chunk;
+        char head[32];
+        bool more = true;
+        while (more) {
+            chunk.clear();
+            more = stream(chunk);
+            if (chunk.empty()) {
+                continue;
+            }
+            snprintf(head, sizeof head, "%zx\r\n", chunk.size());
+            m_out.append(head).append(chunk).append("\r\n");
+            if (m_out.size() >= MAX_PENDING_OUTPUT && !this->flush()) {
+                return false;
+            }
+        }
+        m_out.append("0\r\n\r\n");
+        return this->flush();
+    }
+    return flush || m_out.size() >= MAX_PENDING_OUTPUT ? this->flush() : true;
+}
+
+bool HttpSession::flush() {
+    if (m_out.empty()) {
+        return true;
+    }
+    iovec iov{&m_out[0], m_out.size()};
+    bool ok = sendAll(&iov, 1);
+    m_out.clear();
+    return ok;
+}
+
+bool HttpSession::sendAll(const iovec *iov, size_t count) {
+    iovec buffers[2];
+    SYLAR_ASSERT(count <= 2);
+    memcpy(buffers, iov, sizeof(iovec) * count);
+    iovec *cur = buffers;
+    while (count > 0) {
+        ssize_t n = m_sock->sendv(cur, count, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        while (count > 0 && static_cast<size_t>(n) >= cur->iov_len) {
+            n -= cur->iov_len;
+            ++cur;
+            --count;
+        }
+        if (count > 0) {
+            cur->iov_base = static_cast<char *>(cur->iov_base) + n;
+            cur->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "http.h"
+#include "http_parser.h"
+#include "sylar/socket.h"
+
+namespace sylar {
+namespace http {
+
+// 服务端的一个HTTP连接
+// 请求直接在接收缓冲区中解析, 流水线上的后续请求留在缓冲区中; 响应先写入发送缓冲, 由flush批量发出
+class HttpSession {
+public:
+    using ptr = std::shared_ptr<HttpSession>;
+
+    HttpSession(Socket::ptr sock);
+
+    // 返回的请求对象在下一次调用前有效; 连接关闭, 超时或请求错误时返回nullptr(错误时已应答对应的状态码)
+    HttpRequest::ptr recvRequest();
+
+    // 缓冲区中是否还有流水线请求的数据, 没有时应立即flush
+    bool hasBufferedRequest() const { return m_end > m_start + m_parser.getMessageSize(); }
+
+    // flush为false时响应留在发送缓冲中, 与后续流水线请求的响应一起发送
+    bool sendResponse(const HttpResponse &rsp, bool flush = true);
+
+    bool flush();
+
+    const Socket::ptr &getSocket() const { return m_sock; }
+
+private:
+    bool sendAll(const iovec *iov, size_t count);
+
+private:
+    Socket::ptr m_sock;
+    HttpRequestParser m_parser;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_capacity;
+    // 当前请求的起始位置 / 已接收数据的结束位置
+    size_t m_start = 0;
+    size_t m_end = 0;
+    bool m_parsed = false;
+    std::string m_out;
+};
+
+}  // namespace http
+}  // namespace sylar
@@ -0,0 +1,129 @@
+#include "servlet.h"
+#include <fnmatch.h>
+#include <algorithm>
+
+namespace sylar {
+namespace http {
+
+FunctionServlet::FunctionServlet(callback cb) : Servlet{"FunctionServlet"}, m_cb{std::move(cb)} {}
+
+int32_t FunctionServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) {
+    return m_cb(request, response, session);
+}
+
+ServletDispatch::ServletDispatch() : Servlet{"ServletDispatch"} {
+    m_default = std::make_shared<NotFoundServlet>("sylar/1.0");
+}
+
+int32_t ServletDispatch::handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) {
+    Servlet::ptr slt = getMatchedServlet(request->getPath());
+    if (slt) {
+        slt->handle(request, response, session);
+    }
+    return 0;
+}
+
+void ServletDispatch::addServlet(const std::string &uri, Servlet::ptr slt) {
+    RWMutexType::WriteLock lock{m_mutex};
+    m_datas[uri] = slt;
+}
+
+void ServletDispatch::addServlet(const std::string &uri, FunctionServlet::callback cb) {
+    addServlet(uri, std::make_shared<FunctionServlet>(std::move(cb)));
+}
+
+void ServletDispatch::addPrefixServlet(const std::string &prefix, Servlet::ptr slt) {
+    RWMutexType::WriteLock lock{m_mutex};
+    auto it = std::find_if(m_prefixes.begin(), m_prefixes.end(),
+                           [&prefix](const std::pair<std::string, Servlet::ptr> &p) { return p.first == prefix; });
+    if (it != m_prefixes.end()) {
+        it->second = slt;
+        return;
+    }
+    // 保持按长度降序, 第一个命中的就是最长前缀
+    it = std::find_if(m_prefixes.begin(), m_prefixes.end(), [&prefix](const std::pair<std::string, Servlet::ptr> &p) {
+        return p.first.size() < prefix.size();
+    });
+    m_prefixes.emplace(it, prefix, slt);
+}
+
+void ServletDispatch::addPrefixServlet(const std::string &prefix, FunctionServlet::callback cb) {
+    addPrefixServlet(prefix, std::make_shared<FunctionServlet>(std::move(cb)));
+}
+
+void ServletDispatch::addGlobServlet(const std::string &pattern, Servlet::ptr slt) {
+    RWMutexType::WriteLock lock{m_mutex};
+    for (auto &glob : m_globs) {
+        if (glob.first == pattern) {
+            glob.second = slt;
+            return;
+        }
+    }
+    m_globs.emplace_back(pattern, slt);
+}
+
+void ServletDispatch::addGlobServlet(const std::string &pattern, FunctionServlet::callback cb) {
+    addGlobServlet(pattern, std::make_shared<FunctionServlet>(std::move(cb)));
+}
+
+void ServletDispatch::delServlet(const std::string &uri) {
+    RWMutexType::WriteLock lock{m_mutex};
+    m_datas.erase(uri);
+}
+
+void ServletDispatch::delPrefixServlet(const std::string &prefix) {
+    RWMutexType::WriteLock lock{m_mutex};
+    m_prefixes.erase(
+        std::remove_if(m_prefixes.begin(), m_prefixes.end(),
+                       [&prefix](const std::pair<std::string, Servlet::ptr> &p) { return p.first == prefix; }),
+        m_prefixes.end());
+}
+
+void ServletDispatch::delGlobServlet(const std::string &pattern) {
+    RWMutexType::WriteLock lock{m_mutex};
+    m_globs.erase(
+        std::remove_if(m_globs.begin(), m_globs.end(),
+                       [&pattern](const std::pair<std::string, Servlet::ptr> &p) { return p.first == pattern; }),
+        m_globs.end());
+}
+
+Servlet::ptr ServletDispatch::getMatchedServlet(std::string_view uri) {
+    RWMutexType::ReadLock lock{m_mutex};
+    if (!m_datas.empty()) {
+        auto it = m_datas.find(uri);
+        if (it != m_datas.end()) {
+            return it->second;
+        }
+    }
+    for (const auto &prefix : m_prefixes) {
+        if (uri.substr(0, prefix.first.size()) == prefix.first) {
+            return prefix.second;
+        }
+    }
+    if (!m_globs.empty()) {
+        std::string path(uri);
+        for (const auto &glob : m_globs) {
+            if (!fnmatch(glob.first.c_str(), path.c_str(), 0)) {
+                return glob.second;
+            }
+        }
+    }
+    return m_default;
+}
+
+NotFoundServlet::NotFoundServlet(const std::string &name) : Servlet{"NotFoundServlet"} {
+    m_content =
+        "<html><head><title>404 Not Found</title></head><body><center><h1>404 Not Found</h1></center>"
+        "<hr><center>" +
+        name + "</center></body></html>";
+}
+
+int32_t NotFoundServlet::handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) {
+    response->setStatus(HttpStatus::NOT_FOUND);
+    response->setHeader("Content-Type", "text/html");
+    response->setBody(m_content);
+    return 0;
+}
+
+}  // namespace http
+}  // namespace sylar
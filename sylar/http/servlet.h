@@ -0,0 +1,104 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "http.h"
+#include "http_session.h"
+#include "sylar/mutex.h"
+
+namespace sylar {
+namespace http {
+
+class Servlet {
+public:
+    using ptr = std::shared_ptr<Servlet>;
+
+    Servlet(const std::string &name) : m_name{name} {}
+
+    virtual ~Servlet() {}
+
+    virtual int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) = 0;
+
+    const std::string &getName() const { return m_name; }
+
+protected:
+    std::string m_name;
+};
+
+class FunctionServlet : public Servlet {
+public:
+    using ptr = std::shared_ptr<FunctionServlet>;
+    using callback = std::function<int32_t(HttpRequest::ptr request, HttpResponse::ptr response,
+                                           HttpSession::ptr session)>;
+
+    FunctionServlet(callback cb);
+
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) override;
+
+private:
+    callback m_cb;
+};
+
+// 按路径分发: 精确匹配 > 最长前缀匹配 > 通配符(fnmatch, 按添加顺序) > 默认servlet
+class ServletDispatch : public Servlet {
+public:
+    using ptr = std::shared_ptr<ServletDispatch>;
+    using RWMutexType = RWMutex;
+
+    ServletDispatch();
+
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) override;
+
+    void addServlet(const std::string &uri, Servlet::ptr slt);
+
+    void addServlet(const std::string &uri, FunctionServlet::callback cb);
+
+    // 匹配以prefix开头的路径
+    void addPrefixServlet(const std::string &prefix, Servlet::ptr slt);
+
+    void addPrefixServlet(const std::string &prefix, FunctionServlet::callback cb);
+
+    void addGlobServlet(const std::string &pattern, Servlet::ptr slt);
+
+    void addGlobServlet(const std::string &pattern, FunctionServlet::callback cb);
+
+    void delServlet(const std::string &uri);
+
+    void delPrefixServlet(const std::string &prefix);
+
+    void delGlobServlet(const std::string &pattern);
+
+    Servlet::ptr getDefault() const { return m_default; }
+
+    void setDefault(Servlet::ptr v) { m_default = v; }
+
+    Servlet::ptr getMatchedServlet(std::string_view uri);
+
+private:
+    RWMutexType m_mutex;
+    // 精确匹配, uri -> servlet; std::less<>可以直接用string_view查找
+    std::map<std::string, Servlet::ptr, std::less<>> m_datas;
+    // 前缀匹配, 按前缀长度降序
+    std::vector<std::pair<std::string, Servlet::ptr>> m_prefixes;
+    // 通配符匹配
+    std::vector<std::pair<std::string, Servlet::ptr>> m_globs;
+    Servlet::ptr m_default;
+};
+
+class NotFoundServlet : public Servlet {
+public:
+    using ptr = std::shared_ptr<NotFoundServlet>;
+
+    NotFoundServlet(const std::string &name);
+
+    int32_t handle(HttpRequest::ptr request, HttpResponse::ptr response, HttpSession::ptr session) override;
+
+private:
+    std::string m_content;
+};
+
+}  // namespace http
+}  // namespace sylar
@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <cstring>
 #include <limits>
+#include "log_limit.h"
 #include "macro.h"
 
 namespace sylar {
@@ -56,36 +57,38 @@ static std::ostream &operator<<(std::ostream &os, EPOLL_EVENTS events) {
     return os;
 }
 
-IOManager::FdContext::EventContext &IOManager::FdContext::getEventContext(IOManager::Event event) {
+FdCtx::EventContext &IOManager::GetEventContext(FdCtx *fdCtx, IOManager::Event event) {
     switch (event) {
         case IOManager::READ:
-            return m_readCtx;
+            return fdCtx->m_readCtx;
         case IOManager::WRITE:
-            return m_writeCtx;
+            return fdCtx->m_writeCtx;
+        case IOManager::ERROR:
+            return fdCtx->m_errorCtx;
         default:
             SYLAR_ASSERT2(false, "getContext");
     }
     throw std::invalid_argument{"getContext invalid event"};
 }
 
-void IOManager::FdContext::resetEventContext(EventContext &ctx) {
+void IOManager::ResetEventContext(FdCtx::EventContext &ctx) {
     ctx.m_scheduler = nullptr;
     ctx.m_fiber.reset();
     ctx.m_cb = nullptr;
 }
 
-void IOManager::FdContext::triggerEvent(IOManager::Event event) {
-    SYLAR_ASSERT(m_events & event);
+void IOManager::TriggerEvent(FdCtx *fdCtx, IOManager::Event event) {
+    SYLAR_ASSERT(fdCtx->m_events & event);
 
-    m_events = static_cast<Event>(m_events & ~event);
-    EventContext &ctx = getEventContext(event);
+    fdCtx->m_events &= ~event;
+    FdCtx::EventContext &ctx = GetEventContext(fdCtx, event);
     if (ctx.m_cb) {
         ctx.m_scheduler->schedule(ctx.m_cb);
     } else {
         ctx.m_scheduler->schedule(ctx.m_fiber);
     }
 
-    resetEventContext(ctx);
+    ResetEventContext(ctx);
 
     return;
 }
@@ -93,7 +96,11 @@ void IOManager::FdContext::triggerEvent(IOManager::Event event) {
 #define PIPE_R 0
 #define PIPE_W 1
 
-IOManager::IOManager(size_t threads, bool use_caller, const std::string &name) : Scheduler{threads, use_caller, name} {
+IOManager::IOManager(size_t threads, bool use_caller, const std::string &name)
+    : IOManager{threads, use_caller, name, Placement::FromConfig(name)} {}
+
+IOManager::IOManager(size_t threads, bool use_caller, const std::string &name, const Placement &placement)
+    : Scheduler{threads, use_caller, name, placement} {
     m_epfd = ::epoll_create1(EPOLL_CLOEXEC);
     SYLAR_ASSERT(m_epfd > 0);
 
@@ -111,8 +118,6 @@ IOManager::IOManager(size_t threads, bool use_caller, const std::string &name) :
     ret = ::epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_tickleFds[PIPE_R], &event);
     SYLAR_ASSERT(!ret);
 
-    contextResize(32);
-
     start();
 }
 
@@ -123,33 +128,17 @@ IOManager::~IOManager() {
     close(m_tickleFds[PIPE_W]);
 }
 
-void IOManager::contextResize(size_t size) {
-    m_fdContexts.resize(size);
-
-    for (size_t i = 0; i < m_fdContexts.size(); ++i) {
-        if (!m_fdContexts[i]) {
-            m_fdContexts[i] = std::make_unique<FdContext>();
-            m_fdContexts[i]->m_fd = i;
-        }
-    }
-}
-
 bool IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
-    FdContext *fdCtx{nullptr};
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (static_cast<int>(m_fdContexts.size()) <= fd) {
-            rlock.unlock();
-            RWMutexType::WriteLock wlock{m_mutex};
-            contextResize(fd * 1.5);
-        }
-        fdCtx = m_fdContexts[fd].get();
+    FdCtx *fdCtx = FdMgr::GetInstance()->slot(fd, true);
+    if (SYLAR_UNLIKELY(!fdCtx)) {
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "addEvent fd=" << fd << " out of range, max=" << FdManager::MAX_FD;
+        return false;
     }
 
-    FdContext::MutexType::Lock lock{fdCtx->m_mutex};
+    FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
     if (SYLAR_UNLIKELY(fdCtx->m_events & event)) {
-        SYLAR_LOG_ERROR(g_logger) << "addEvent assert fd=" << fd << " event=" << static_cast<EPOLL_EVENTS>(event)
-                                  << " fdCtx.event=" << static_cast<EPOLL_EVENTS>(fdCtx->m_events);
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "addEvent assert fd=" << fd << " event=" << static_cast<EPOLL_EVENTS>(event)
+                                        << " fdCtx.event=" << static_cast<EPOLL_EVENTS>(fdCtx->m_events);
         SYLAR_ASSERT(!(fdCtx->m_events & event));
     }
 
@@ -160,20 +149,22 @@ bool IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
 
     int ret = ::epoll_ctl(m_epfd, op, fd, &epEvent);
     if (ret) {
-        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd << ", "
-                                  << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " (" << errno << ") ("
-                                  << strerror(errno)
-                                  << ") fdCtx->events=" << static_cast<EPOLL_EVENTS>(fdCtx->m_events);
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd
+                                        << ", " << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " ("
+                                        << errno << ") (" << strerror(errno)
+                                        << ") fdCtx->events=" << static_cast<EPOLL_EVENTS>(fdCtx->m_events);
         return false;
     }
 
     ++m_pendingEventCount;
 
-    fdCtx->m_events = static_cast<Event>(fdCtx->m_events | event);
-    FdContext::EventContext &event_ctx = fdCtx->getEventContext(event);
+    fdCtx->m_events |= event;
+    fdCtx->m_iomanager = this;
+    FdCtx::EventContext &event_ctx = GetEventContext(fdCtx, event);
     SYLAR_ASSERT(!event_ctx.m_scheduler && !event_ctx.m_fiber && !event_ctx.m_cb);
 
-    event_ctx.m_scheduler = Scheduler::GetThis();
+    // 从调度器之外的线程注册时, 回调交给本IOManager执行
+    event_ctx.m_scheduler = Scheduler::GetThis() ? Scheduler::GetThis() : this;
     if (cb) {
         event_ctx.m_cb.swap(cb);
     } else {
@@ -185,16 +176,12 @@ bool IOManager::addEvent(int fd, Event event, std::function<void()> cb) {
 }
 
 bool IOManager::delEvent(int fd, Event event) {
-    FdContext *fdCtx = nullptr;
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (static_cast<int>(m_fdContexts.size()) <= fd) {
-            return false;
-        }
-        fdCtx = m_fdContexts[fd].get();
+    FdCtx *fdCtx = FdMgr::GetInstance()->slot(fd);
+    if (!fdCtx) {
+        return false;
     }
 
-    FdContext::MutexType::Lock lock{fdCtx->m_mutex};
+    FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
     if (SYLAR_UNLIKELY(!(fdCtx->m_events & event))) {
         return false;
     }
@@ -207,30 +194,42 @@ bool IOManager::delEvent(int fd, Event event) {
 
     int ret = ::epoll_ctl(m_epfd, op, fd, &epEvent);
     if (ret) {
-        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd << ", "
-                                  << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " (" << errno << ") ("
-                                  << strerror(errno) << ")";
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd
+                                        << ", " << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " ("
+                                        << errno << ") (" << strerror(errno) << ")";
         return false;
     }
 
     --m_pendingEventCount;
     fdCtx->m_events = new_events;
-    FdContext::EventContext &event_ctx = fdCtx->getEventContext(event);
-    fdCtx->resetEventContext(event_ctx);
+    ResetEventContext(GetEventContext(fdCtx, event));
     return true;
 }
 
 bool IOManager::cancelEvent(int fd, Event event) {
-    FdContext *fdCtx = nullptr;
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (static_cast<int>(m_fdContexts.size()) <= fd) {
-            return false;
-        }
-        fdCtx = m_fdContexts[fd].get();
+    FdCtx *fdCtx = FdMgr::GetInstance()->slot(fd);
+    if (!fdCtx) {
+        return false;
+    }
+
+    FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
+    return cancelEventLocked(fdCtx, event);
+}
+
+bool IOManager::cancelEvent(int fd, Event event, uint32_t generation) {
+    FdCtx *fdCtx = FdMgr::GetInstance()->slot(fd);
+    if (!fdCtx) {
+        return false;
     }
 
-    FdContext::MutexType::Lock lock{fdCtx->m_mutex};
+    FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
+    if (fdCtx->getGeneration() != generation) {
+        return false;
+    }
+    return cancelEventLocked(fdCtx, event);
+}
+
+bool IOManager::cancelEventLocked(FdCtx *fdCtx, Event event) {
     if (SYLAR_UNLIKELY(!(fdCtx->m_events & event))) {
         return false;
     }
@@ -241,30 +240,30 @@ bool IOManager::cancelEvent(int fd, Event event) {
     epEvent.events = EPOLLET | new_events;
     epEvent.data.ptr = fdCtx;
 
-    int ret = ::epoll_ctl(m_epfd, op, fd, &epEvent);
+    int ret = ::epoll_ctl(m_epfd, op, fdCtx->m_fd, &epEvent);
     if (ret) {
-        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd << ", "
-                                  << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " (" << errno << ") ("
-                                  << strerror(errno) << ")";
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", "
+                                        << fdCtx->m_fd << ", " << static_cast<EPOLL_EVENTS>(epEvent.events)
+                                        << "):" << ret << " (" << errno << ") (" << strerror(errno) << ")";
         return false;
     }
 
-    fdCtx->triggerEvent(event);
+    TriggerEvent(fdCtx, event);
     --m_pendingEventCount;
     return true;
 }
 
 bool IOManager::cancelAll(int fd) {
-    FdContext *fdCtx = nullptr;
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (static_cast<int>(m_fdContexts.size()) <= fd) {
-            return false;
-        }
-        fdCtx = m_fdContexts[fd].get();
+    FdCtx *fdCtx = FdMgr::GetInstance()->slot(fd);
+    if (!fdCtx) {
+        return false;
     }
 
-    FdContext::MutexType::Lock lock{fdCtx->m_mutex};
+    FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
+    return cancelAllLocked(fdCtx);
+}
+
+bool IOManager::cancelAllLocked(FdCtx *fdCtx) {
     if (!fdCtx->m_events) {
         return false;
     }
@@ -274,21 +273,26 @@ bool IOManager::cancelAll(int fd) {
     epEvent.events = NONE;
     epEvent.data.ptr = fdCtx;
 
-    int ret = ::epoll_ctl(m_epfd, op, fd, &epEvent);
+    int ret = ::epoll_ctl(m_epfd, op, fdCtx->m_fd, &epEvent);
     if (ret) {
-        SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", " << fd << ", "
-                                  << static_cast<EPOLL_EVENTS>(epEvent.events) << "):" << ret << " (" << errno << ") ("
-                                  << strerror(errno) << ")";
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", "
+                                        << fdCtx->m_fd << ", " << static_cast<EPOLL_EVENTS>(epEvent.events)
+                                        << "):" << ret << " (" << errno << ") (" << strerror(errno) << ")";
         return false;
     }
 
     if (fdCtx->m_events & READ) {
-        fdCtx->triggerEvent(READ);
+        TriggerEvent(fdCtx, READ);
         --m_pendingEventCount;
     }
 
     if (fdCtx->m_events & WRITE) {
-        fdCtx->triggerEvent(WRITE);
+        TriggerEvent(fdCtx, WRITE);
+        --m_pendingEventCount;
+    }
+
+    if (fdCtx->m_events & ERROR) {
+        TriggerEvent(fdCtx, ERROR);
         --m_pendingEventCount;
     }
 
@@ -366,8 +370,8 @@ void IOManager::idle() {
                 continue;
             }
 
-            FdContext *fdCtx = static_cast<FdContext *>(event.data.ptr);
-            FdContext::MutexType::Lock lock{fdCtx->m_mutex};
+            FdCtx *fdCtx = static_cast<FdCtx *>(event.data.ptr);
+            FdCtx::MutexType::Lock lock{fdCtx->m_mutex};
 
             if (event.events & (EPOLLERR | EPOLLHUP)) {
                 event.events |= (EPOLLIN | EPOLLOUT) & fdCtx->m_events;
@@ -382,6 +386,10 @@ void IOManager::idle() {
                 realEvents |= WRITE;
             }
 
+            if ((event.events & EPOLLERR) && (fdCtx->m_events & ERROR)) {
+                realEvents |= ERROR;
+            }
+
             if ((fdCtx->m_events & realEvents) == NONE) {
                 continue;
             }
@@ -390,21 +398,27 @@ void IOManager::idle() {
             int op = leftEvents ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
             event.events = EPOLLET | leftEvents;
 
-            ret = ::epoll_ctl(m_epfd, op, fdCtx->m_fd, &event);
-            if (ret) {
-                SYLAR_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op) << ", "
-                                          << fdCtx->m_fd << ", " << static_cast<EPOLL_EVENTS>(event.events)
-                                          << "):" << ret << " (" << errno << ") (" << strerror(errno) << ")";
+            // 不能复用ret, 它是本轮epoll_wait返回的事件数
+            int rt = ::epoll_ctl(m_epfd, op, fdCtx->m_fd, &event);
+            if (rt) {
+                SYLAR_LOG_LIMIT_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", " << static_cast<EpollCtlOp>(op)
+                                                << ", " << fdCtx->m_fd << ", " << static_cast<EPOLL_EVENTS>(event.events)
+                                                << "):" << rt << " (" << errno << ") (" << strerror(errno) << ")";
                 continue;
             }
 
             if (realEvents & READ) {
-                fdCtx->triggerEvent(READ);
+                TriggerEvent(fdCtx, READ);
                 --m_pendingEventCount;
             }
 
             if (realEvents & WRITE) {
-                fdCtx->triggerEvent(WRITE);
+                TriggerEvent(fdCtx, WRITE);
+                --m_pendingEventCount;
+            }
+
+            if (realEvents & ERROR) {
+                TriggerEvent(fdCtx, ERROR);
                 --m_pendingEventCount;
             }
         }
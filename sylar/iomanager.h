@@ -1,5 +1,6 @@
 #pragma once
 
+#include "fd_manager.h"
 #include "log.h"
 #include "scheduler.h"
 #include "timer.h"
@@ -7,41 +8,23 @@
 namespace sylar {
 
 class IOManager : public Scheduler, public TimerManager {
+    friend class FdCtx;
+
 public:
     using ptr = std::shared_ptr<IOManager>;
-    using RWMutexType = RWMutex;
 
     enum Event {
         NONE = 0X0,
         READ = 0X1,
         WRITE = 0x4,
+        // EPOLLERR, 用于等待socket错误队列中的消息(如MSG_ZEROCOPY的完成通知)
+        ERROR = 0x8,
     };
 
-private:
-    struct FdContext {
-        using MutexType = Mutex;
-        struct EventContext {
-            Scheduler *m_scheduler = nullptr;
-            Fiber::ptr m_fiber;
-            std::function<void()> m_cb;
-        };
-
-        EventContext &getEventContext(Event event);
-
-        void resetEventContext(EventContext &ctx);
-
-        void triggerEvent(Event event);
-
-        EventContext m_readCtx;
-        EventContext m_writeCtx;
-        int m_fd{0};
-        Event m_events{NONE};
-        MutexType m_mutex;
-    };
-
-public:
     IOManager(size_t threads = 1, bool use_caller = true, const std::string &name = "IOManager");
 
+    IOManager(size_t threads, bool use_caller, const std::string &name, const Placement &placement);
+
     ~IOManager();
 
     bool addEvent(int fd, Event event, std::function<void()> cb = nullptr);
@@ -50,6 +33,9 @@ public:
 
     bool cancelEvent(int fd, Event event);
 
+    // 仅当fd的generation仍为指定值时取消, 避免误取消fd被关闭复用后注册的事件
+    bool cancelEvent(int fd, Event event, uint32_t generation);
+
     bool cancelAll(int fd);
 
     static IOManager *GetThis();
@@ -65,14 +51,22 @@ protected:
 
     void onTimerInsertedAtFront() override;
 
-    void contextResize(size_t size);
+private:
+    // 以下函数需持有fdCtx->m_mutex
+    bool cancelEventLocked(FdCtx *fdCtx, Event event);
+
+    bool cancelAllLocked(FdCtx *fdCtx);
+
+    static FdCtx::EventContext &GetEventContext(FdCtx *fdCtx, Event event);
+
+    static void ResetEventContext(FdCtx::EventContext &ctx);
+
+    static void TriggerEvent(FdCtx *fdCtx, Event event);
 
 private:
     int m_epfd{0};
     int m_tickleFds[2];
     std::atomic<size_t> m_pendingEventCount{0};
-    RWMutexType m_mutex;
-    std::vector<std::unique_ptr<FdContext>> m_fdContexts;
 };
 
 }  // namespace sylar
\ No newline at end of file
@@ -1,4 +1,12 @@
 #include "log.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -12,11 +20,17 @@
 #include <string>
 #include <utility>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
+#include "binlog.h"
 #include "config.h"
 #include "env.h"
+#include "hook.h"
 #include "log.h"
 #include "mutex.h"
+#include "thread.h"
 #include "util.h"
 
 namespace sylar {
@@ -70,7 +84,8 @@ LogLevel::Level LogLevel::FromString(const std::string &str) {
 }
 
 LogEvent::LogEvent(const std::string &logger_name, LogLevel::Level level, const char *file, int32_t line,
-                   int64_t elapse, uint32_t thread_id, uint64_t fiber_id, time_t time, const std::string &thread_name)
+                   int64_t elapse, uint32_t thread_id, uint64_t fiber_id, time_t time, const std::string &thread_name,
+                   LogSiteCache *site_cache)
     : m_level{level},
       m_file{file},
       m_line{line},
@@ -79,7 +94,8 @@ LogEvent::LogEvent(const std::string &logger_name, LogLevel::Level level, const
       m_fiberId{fiber_id},
       m_time{time},
       m_threadName{thread_name},
-      m_loggerName{logger_name} {}
+      m_loggerName{logger_name},
+      m_siteCache{site_cache} {}
 
 void LogEvent::printf(const char *fmt, ...) {
     va_list ap;
@@ -98,6 +114,161 @@ void LogEvent::vprintf(const char *fmt, va_list ap) {
     }
 }
 
+LogField &LogEvent::addField(std::string_view key) {
+    if (m_fields.empty()) {
+        m_fields.reserve(8);
+    }
+    LogField &field = m_fields.emplace_back();
+    field.m_key = key;
+    return field;
+}
+
+// JSON需要转义引号、反斜杠和控制字符; logfmt的值含空格或'='时还需要加引号
+template <bool Logfmt>
+static inline bool NeedEscape(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20 || (Logfmt && (c == ' ' || c == '='));
+}
+
+// 返回第一个需要转义的字符位置, 长字符串每次比较16字节
+template <bool Logfmt>
+static size_t ScanEscape(const char *str, size_t len) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i equal = _mm_set1_epi8('=');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+        // max(v, 0x1f) == 0x1f 即 v <= 0x1f(无符号)
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+        if (Logfmt) {
+            hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, equal)));
+        }
+        if (int mask = _mm_movemask_epi8(hit); mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (NeedEscape<Logfmt>(str[i])) {
+            return i;
+        }
+    }
+    return len;
+}
+
+// 输出带引号的JSON字符串, 不需要转义的片段整段追加
+static void AppendQuoted(std::string &out, std::string_view str) {
+    static const char *s_hex = "0123456789abcdef";
+    out.push_back('"');
+    const char *p = str.data();
+    size_t len = str.size();
+    while (true) {
+        size_t pos = ScanEscape<false>(p, len);
+        out.append(p, pos);
+        if (pos == len) {
+            break;
+        }
+        unsigned char c = p[pos];
+        switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            default:
+                out.append("\\u00");
+                out.push_back(s_hex[c >> 4]);
+                out.push_back(s_hex[c & 0xf]);
+                break;
+        }
+        p += pos + 1;
+        len -= pos + 1;
+    }
+    out.push_back('"');
+}
+
+// logfmt的值只有在必要时才加引号
+static void AppendLogfmtValue(std::string &out, std::string_view str) {
+    if (str.empty() || ScanEscape<true>(str.data(), str.size()) != str.size()) {
+        AppendQuoted(out, str);
+    } else {
+        out.append(str);
+    }
+}
+
+// logfmt的键不能加引号, 需要转义的字符替换为'_'
+static void AppendLogfmtKey(std::string &out, std::string_view key) {
+    if (key.empty()) {
+        out.push_back('_');
+        return;
+    }
+    while (true) {
+        size_t pos = ScanEscape<true>(key.data(), key.size());
+        out.append(key.data(), pos);
+        if (pos == key.size()) {
+            break;
+        }
+        out.push_back('_');
+        key.remove_prefix(pos + 1);
+    }
+}
+
+template <typename T>
+static void AppendNumber(std::string &out, T val) {
+    char buf[32];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof buf, val);
+    out.append(buf, ec == std::errc{} ? end - buf : 0);
+}
+
+static void AppendFieldValue(std::string &out, const LogField &field, bool json) {
+    switch (field.m_type) {
+        case LogField::INT64:
+            AppendNumber(out, field.m_int);
+            break;
+        case LogField::UINT64:
+            AppendNumber(out, field.m_uint);
+            break;
+        case LogField::DOUBLE:
+            if (json && !std::isfinite(field.m_double)) {
+                out.append("null");
+            } else {
+                AppendNumber(out, field.m_double);
+            }
+            break;
+        case LogField::BOOL:
+            out.append(field.m_bool ? "true" : "false");
+            break;
+        case LogField::STRING:
+            if (json) {
+                AppendQuoted(out, field.m_str);
+            } else {
+                AppendLogfmtValue(out, field.m_str);
+            }
+            break;
+    }
+}
+
+static void AppendTime(std::string &out, time_t time) {
+    struct tm tm;
+    localtime_r(&time, &tm);
+    char buf[32];
+    out.append(buf, strftime(buf, sizeof buf, "%Y-%m-%d %H:%M:%S", &tm));
+}
+
 class MessageFormatItem : public LogFormatter::FormatItem {
 public:
     MessageFormatItem(const std::string &str) {}
@@ -196,6 +367,85 @@ public:
     void format(std::ostream &os, LogEvent::ptr event) override { os << "\t"; }
 };
 
+// 整条记录输出为一个JSON对象, 自定义字段跟在固定字段之后
+class JsonFormatItem : public LogFormatter::FormatItem {
+public:
+    JsonFormatItem(const std::string &str) {}
+
+    void format(std::ostream &os, LogEvent::ptr event) override {
+        thread_local std::string t_buf;
+        std::string &buf = t_buf;
+        buf.clear();
+        buf.append("{\"time\":\"");
+        AppendTime(buf, event->getTime());
+        buf.append("\",\"level\":\"");
+        buf.append(LogLevel::ToString(event->getLevel()));
+        buf.append("\",\"logger\":");
+        AppendQuoted(buf, event->getLoggerName());
+        buf.append(",\"file\":");
+        AppendQuoted(buf, event->getFile());
+        buf.append(",\"line\":");
+        AppendNumber(buf, event->getLine());
+        buf.append(",\"thread\":");
+        AppendNumber(buf, event->getThreadId());
+        buf.append(",\"thread_name\":");
+        AppendQuoted(buf, event->getThreadName());
+        buf.append(",\"fiber\":");
+        AppendNumber(buf, event->getFiberId());
+        buf.append(",\"elapse\":");
+        AppendNumber(buf, event->getElapse());
+        buf.append(",\"msg\":");
+        AppendQuoted(buf, event->getContent());
+        for (const auto &field : event->getFields()) {
+            buf.push_back(',');
+            AppendQuoted(buf, field.m_key);
+            buf.push_back(':');
+            AppendFieldValue(buf, field, true);
+        }
+        buf.push_back('}');
+        os.write(buf.data(), buf.size());
+    }
+};
+
+// 整条记录输出为logfmt格式: key=value, 以空格分隔
+class LogfmtFormatItem : public LogFormatter::FormatItem {
+public:
+    LogfmtFormatItem(const std::string &str) {}
+
+    void format(std::ostream &os, LogEvent::ptr event) override {
+        thread_local std::string t_buf;
+        std::string &buf = t_buf;
+        buf.clear();
+        buf.append("time=\"");
+        AppendTime(buf, event->getTime());
+        buf.append("\" level=");
+        buf.append(LogLevel::ToString(event->getLevel()));
+        buf.append(" logger=");
+        AppendLogfmtValue(buf, event->getLoggerName());
+        buf.append(" file=");
+        AppendLogfmtValue(buf, event->getFile());
+        buf.append(" line=");
+        AppendNumber(buf, event->getLine());
+        buf.append(" thread=");
+        AppendNumber(buf, event->getThreadId());
+        buf.append(" thread_name=");
+        AppendLogfmtValue(buf, event->getThreadName());
+        buf.append(" fiber=");
+        AppendNumber(buf, event->getFiberId());
+        buf.append(" elapse=");
+        AppendNumber(buf, event->getElapse());
+        buf.append(" msg=");
+        AppendLogfmtValue(buf, event->getContent());
+        for (const auto &field : event->getFields()) {
+            buf.push_back(' ');
+            AppendLogfmtKey(buf, field.m_key);
+            buf.push_back('=');
+            AppendFieldValue(buf, field, false);
+        }
+        os.write(buf.data(), buf.size());
+    }
+};
+
 class PercentSignFormatItem : public LogFormatter::FormatItem {
 public:
     PercentSignFormatItem(const std::string &str) {}
@@ -293,6 +543,8 @@ void LogFormatter::init() {
         XX(%, PercentSignFormatItem),  // %:百分号
         XX(T, TabFormatItem),          // T:制表符
         XX(n, NewLineFormatItem),      // n:换行符
+        XX(J, JsonFormatItem),         // J:JSON格式的整条记录
+        XX(K, LogfmtFormatItem),       // K:logfmt格式的整条记录
 #undef XX
     };
 
@@ -349,6 +601,12 @@ LogFormatter::ptr LogAppender::getFormatter() {
     return m_formatter ? m_formatter : m_defaultFormatter;
 }
 
+void LogAppender::logBinary(const LogSite *site, const char *data, size_t len) {
+    if (LogEvent::ptr event = binlog::DecodeRecord(site, data, len); event) {
+        log(event);
+    }
+}
+
 StdoutLogAppender::StdoutLogAppender() : LogAppender{std::make_shared<LogFormatter>()} {}
 
 void StdoutLogAppender::log(LogEvent::ptr event) {
@@ -421,42 +679,251 @@ std::string FileLogAppender::toYamlString() {
     return ss.str();
 }
 
-Logger::Logger(const std::string &name) : m_name{name}, m_level{LogLevel::INFO}, m_createTime{GetElapsedMS()} {}
+const char *ConsoleLogAppender::OverflowToString(Overflow overflow) {
+    return overflow == DROP_OLD ? "drop_old" : "drop_new";
+}
+
+ConsoleLogAppender::Overflow ConsoleLogAppender::OverflowFromString(const std::string &str) {
+    return ToLower(str) == "drop_old" ? DROP_OLD : DROP_NEW;
+}
+
+ConsoleLogAppender::ConsoleLogAppender(const std::string &stream, Overflow overflow, size_t maxQueueBytes)
+    : LogAppender{std::make_shared<LogFormatter>()},
+      m_stream{stream == "stderr" ? "stderr" : "stdout"},
+      m_overflow{overflow},
+      m_maxQueueBytes{maxQueueBytes} {
+    int fd = m_stream == "stderr" ? STDERR_FILENO : STDOUT_FILENO;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode))) {
+        // 重新打开得到独立的文件描述, 设置O_NONBLOCK不影响进程内其他使用者
+        m_fd = open(("/proc/self/fd/" + std::to_string(fd)).c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (m_fd == -1) {
+        // socket无法经/proc重新打开, 改用MSG_DONTWAIT; 普通文件写入不会长时间阻塞
+        m_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        m_isSocket = m_fd != -1 && fstat(m_fd, &st) == 0 && S_ISSOCK(st.st_mode);
+    }
+    m_thread.reset(new Thread{std::bind(&ConsoleLogAppender::run, this), "log_console"});
+}
+
+ConsoleLogAppender::~ConsoleLogAppender() {
+    {
+        QueueMutexType::Lock lock{m_queueMutex};
+        m_stopping = true;
+    }
+    m_semaphore.notify();
+    m_thread->join();
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+}
+
+void ConsoleLogAppender::log(LogEvent::ptr event) {
+    std::string data = getFormatter()->format(event);
+    if (data.empty()) {
+        return;
+    }
+
+    QueueMutexType::Lock lock{m_queueMutex};
+    if (!m_queue.empty()) {
+        enqueue(std::move(data));
+        return;
+    }
+
+    ssize_t n = writeSome(data.data(), data.size());
+    if (n < 0) {
+        drop(data.size());
+    } else if (static_cast<size_t>(n) < data.size()) {
+        // 写出一半的记录留在队首, 剩余部分由后台线程写完
+        m_queueBytes = data.size() - n;
+        m_frontOffset = n;
+        m_queue.push_back(std::move(data));
+        m_semaphore.notify();
+    }
+}
+
+size_t ConsoleLogAppender::getQueuedBytes() {
+    QueueMutexType::Lock lock{m_queueMutex};
+    return m_queueBytes;
+}
+
+ssize_t ConsoleLogAppender::writeSome(const char *data, size_t len) {
+    if (m_fd == -1) {
+        return -1;
+    }
+    ssize_t n = m_isSocket ? send_f(m_fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL) : write_f(m_fd, data, len);
+    if (n >= 0) {
+        return n;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+}
+
+bool ConsoleLogAppender::drain() {
+    while (!m_queue.empty()) {
+        const std::string &front = m_queue.front();
+        ssize_t n = writeSome(front.data() + m_frontOffset, front.size() - m_frontOffset);
+        if (n < 0) {
+            for (const auto &data : m_queue) {
+                drop(data.size());
+            }
+            m_queue.clear();
+            m_queueBytes = 0;
+            m_frontOffset = 0;
+            return true;
+        }
+        if (n == 0) {
+            return false;
+        }
+        m_queueBytes -= n;
+        m_frontOffset += n;
+        if (m_frontOffset == front.size()) {
+            m_queue.pop_front();
+            m_frontOffset = 0;
+        }
+    }
+    return true;
+}
+
+void ConsoleLogAppender::enqueue(std::string &&data) {
+    if (m_queueBytes + data.size() > m_maxQueueBytes) {
+        if (m_overflow == DROP_NEW) {
+            drop(data.size());
+            return;
+        }
+        // 已写出一部分的队首记录不能丢弃, 否则输出半行
+        auto it = m_queue.begin();
+        if (m_frontOffset) {
+            ++it;
+        }
+        while (it != m_queue.end() && m_queueBytes + data.size() > m_maxQueueBytes) {
+            drop(it->size());
+            m_queueBytes -= it->size();
+            it = m_queue.erase(it);
+        }
+        if (m_queueBytes + data.size() > m_maxQueueBytes) {
+            drop(data.size());
+            return;
+        }
+    }
+    bool wasEmpty = m_queue.empty();
+    m_queueBytes += data.size();
+    m_queue.push_back(std::move(data));
+    if (wasEmpty) {
+        m_semaphore.notify();
+    }
+}
+
+void ConsoleLogAppender::drop(size_t bytes) {
+    m_droppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ConsoleLogAppender::run() {
+    pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLOUT;
+    while (true) {
+        m_semaphore.wait();
+        // 停止时最多再等待1秒, 之后丢弃未写出的数据
+        int stopRounds = 10;
+        while (true) {
+            {
+                QueueMutexType::Lock lock{m_queueMutex};
+                bool empty = drain();
+                if (m_stopping && (empty || --stopRounds == 0)) {
+                    for (const auto &data : m_queue) {
+                        drop(data.size());
+                    }
+                    m_queue.clear();
+                    m_queueBytes = 0;
+                    return;
+                }
+                if (empty) {
+                    break;
+                }
+            }
+            pfd.revents = 0;
+            ::poll(&pfd, 1, 100);
+        }
+    }
+}
+
+std::string ConsoleLogAppender::toYamlString() {
+    MutexType::Lock lock{m_mutex};
+    YAML::Node node;
+    node["type"] = "ConsoleLogAppender";
+    node["stream"] = m_stream;
+    node["overflow"] = OverflowToString(m_overflow);
+    node["max_queue"] = m_maxQueueBytes;
+    node["pattern"] = m_formatter ? m_formatter->getPattern() : m_defaultFormatter->getPattern();
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+Logger::Logger(const std::string &name)
+    : m_name{name}, m_level{LogLevel::INFO}, m_appenders{new AppenderList}, m_createTime{GetElapsedMS()} {}
+
+void Logger::publish(AppenderList *appenders, MutexType::Lock &lock) {
+    std::unique_ptr<AppenderList> old{m_appenders.exchange(appenders)};
+    lock.unlock();
+    RcuDomain::Synchronize();
+}
 
 void Logger::addAppender(LogAppender::ptr appender) {
     MutexType::Lock lock{m_mutex};
-    m_appenders.push_back(appender);
+    auto appenders = new AppenderList{*m_appenders.get()};
+    appenders->push_back(appender);
+    publish(appenders, lock);
 }
 
 void Logger::delAppender(LogAppender::ptr appender) {
     MutexType::Lock lock{m_mutex};
-    for (auto it = m_appenders.begin(); it != m_appenders.end(); ++it) {
+    auto appenders = new AppenderList{*m_appenders.get()};
+    for (auto it = appenders->begin(); it != appenders->end(); ++it) {
         if (*it == appender) {
-            m_appenders.erase(it);
+            appenders->erase(it);
             break;
         }
     }
+    publish(appenders, lock);
 }
 
-void Logger::clearAppenders() {
+void Logger::clearAppenders() { setAppenders({}); }
+
+void Logger::setAppenders(AppenderList appenders) {
     MutexType::Lock lock{m_mutex};
-    m_appenders.clear();
+    publish(new AppenderList{std::move(appenders)}, lock);
 }
 
 void Logger::log(LogEvent::ptr event) {
-    if (event->getLevel() <= m_level) {
-        for (const auto &appender : m_appenders) {
+    if (event->getLevel() <= getLevel()) {
+        RcuReadGuard guard;
+        for (const auto &appender : *m_appenders.get()) {
             appender->log(event);
         }
     }
 }
 
+void Logger::logBinary(const LogSite *site, const char *data, size_t len) {
+    if (site->m_level <= getLevel()) {
+        RcuReadGuard guard;
+        for (const auto &appender : *m_appenders.get()) {
+            appender->logBinary(site, data, len);
+        }
+    }
+}
+
 std::string Logger::toYamlString() {
     MutexType::Lock lock{m_mutex};
     YAML::Node node;
     node["name"] = m_name;
-    node["level"] = LogLevel::ToString(m_level);
-    for (const auto &appender : m_appenders) {
+    node["level"] = LogLevel::ToString(getLevel());
+    if (getRateLimit()) {
+        node["rate_limit"] = getRateLimit();
+        node["rate_burst"] = getRateBurst();
+    }
+    for (const auto &appender : *m_appenders.get()) {
         node["appenders"].push_back(YAML::Load(appender->toYamlString()));
     }
     std::stringstream ss;
@@ -503,19 +970,26 @@ struct LogAppenderDefine {
     int m_type = 0;
     std::string m_pattern;
     std::string m_file;
+    std::string m_stream = "stdout";
+    ConsoleLogAppender::Overflow m_overflow = ConsoleLogAppender::DROP_NEW;
+    size_t m_maxQueue = 4 * 1024 * 1024;
 
     bool operator==(const LogAppenderDefine &other) const {
-        return m_type == other.m_type && m_pattern == other.m_pattern && m_file == other.m_file;
+        return m_type == other.m_type && m_pattern == other.m_pattern && m_file == other.m_file &&
+               m_stream == other.m_stream && m_overflow == other.m_overflow && m_maxQueue == other.m_maxQueue;
     }
 };
 
 struct LogDefine {
     std::string m_name;
     LogLevel::Level level = LogLevel::NOTSET;
+    uint32_t m_rateLimit = 0;
+    uint32_t m_rateBurst = 0;
     std::vector<LogAppenderDefine> m_appenders;
 
     bool operator==(const LogDefine &other) const {
-        return m_name == other.m_name && level == other.level && m_appenders == other.m_appenders;
+        return m_name == other.m_name && level == other.level && m_rateLimit == other.m_rateLimit &&
+               m_rateBurst == other.m_rateBurst && m_appenders == other.m_appenders;
     }
 
     bool operator<(const LogDefine &other) const { return m_name < other.m_name; }
@@ -524,10 +998,9 @@ struct LogDefine {
 };
 
 template <>
-class LexicalCast<std::string, LogDefine> {
+class YamlCast<LogDefine> {
 public:
-    LogDefine operator()(const std::string &val) {
-        YAML::Node node = YAML::Load(val);
+    LogDefine operator()(const YAML::Node &node) {
         LogDefine define;
         if (!node["name"].IsDefined()) {
             std::cout << "log config error: name is null, " << node << std::endl;
@@ -535,6 +1008,12 @@ public:
         }
         define.m_name = node["name"].as<std::string>();
         define.level = LogLevel::FromString(node["level"].IsDefined() ? node["level"].as<std::string>() : "");
+        if (node["rate_limit"].IsDefined()) {
+            define.m_rateLimit = node["rate_limit"].as<uint32_t>();
+        }
+        if (node["rate_burst"].IsDefined()) {
+            define.m_rateBurst = node["rate_burst"].as<uint32_t>();
+        }
 
         if (node["appenders"].IsDefined()) {
             for (std::size_t i = 0; i < node["appenders"].size(); ++i) {
@@ -559,10 +1038,46 @@ public:
                     if (appender["pattern"].IsDefined()) {
                         lad.m_pattern = appender["pattern"].as<std::string>();
                     }
+                } else if (type == "BinaryLogAppender") {
+                    lad.m_type = 3;
+                    if (!appender["file"].IsDefined()) {
+                        std::cout << "log appender config error: binary appender file is null, " << appender
+                                  << std::endl;
+                        continue;
+                    }
+                    lad.m_file = appender["file"].as<std::string>();
+                    if (appender["pattern"].IsDefined()) {
+                        lad.m_pattern = appender["pattern"].as<std::string>();
+                    }
+                } else if (type == "ConsoleLogAppender") {
+                    lad.m_type = 4;
+                    if (appender["stream"].IsDefined()) {
+                        lad.m_stream = appender["stream"].as<std::string>();
+                    }
+                    if (appender["overflow"].IsDefined()) {
+                        lad.m_overflow = ConsoleLogAppender::OverflowFromString(appender["overflow"].as<std::string>());
+                    }
+                    if (appender["max_queue"].IsDefined()) {
+                        lad.m_maxQueue = appender["max_queue"].as<size_t>();
+                    }
+                    if (appender["pattern"].IsDefined()) {
+                        lad.m_pattern = appender["pattern"].as<std::string>();
+                    }
                 } else {
                     std::cout << "log appender config error: appender type is invalid, " << appender << std::endl;
                     continue;
                 }
+                // format为json/logfmt时, 没有指定pattern则使用对应的整条记录格式
+                if (appender["format"].IsDefined() && lad.m_pattern.empty()) {
+                    std::string format = appender["format"].as<std::string>();
+                    if (format == "json") {
+                        lad.m_pattern = "%J%n";
+                    } else if (format == "logfmt") {
+                        lad.m_pattern = "%K%n";
+                    } else {
+                        std::cout << "log appender config error: format is invalid, " << appender << std::endl;
+                    }
+                }
                 define.m_appenders.push_back(lad);
             }
         }
@@ -570,6 +1085,12 @@ public:
     }
 };
 
+template <>
+class LexicalCast<std::string, LogDefine> {
+public:
+    LogDefine operator()(const std::string &val) { return YamlCast<LogDefine>{}(YAML::Load(val)); }
+};
+
 template <>
 class LexicalCast<LogDefine, std::string> {
 public:
@@ -577,6 +1098,10 @@ public:
         YAML::Node node;
         node["name"] = define.m_name;
         node["level"] = LogLevel::ToString(define.level);
+        if (define.m_rateLimit) {
+            node["rate_limit"] = define.m_rateLimit;
+            node["rate_burst"] = define.m_rateBurst;
+        }
         for (const auto &appender : define.m_appenders) {
             YAML::Node tmpNode;
             if (appender.m_type == 1) {
@@ -584,6 +1109,14 @@ public:
                 tmpNode["file"] = appender.m_file;
             } else if (appender.m_type == 2) {
                 tmpNode["type"] = "StdoutLogAppender";
+            } else if (appender.m_type == 3) {
+                tmpNode["type"] = "BinaryLogAppender";
+                tmpNode["file"] = appender.m_file;
+            } else if (appender.m_type == 4) {
+                tmpNode["type"] = "ConsoleLogAppender";
+                tmpNode["stream"] = appender.m_stream;
+                tmpNode["overflow"] = ConsoleLogAppender::OverflowToString(appender.m_overflow);
+                tmpNode["max_queue"] = appender.m_maxQueue;
             }
 
             if (!appender.m_pattern.empty()) {
@@ -618,11 +1151,21 @@ struct LogIniter {
                 }
 
                 logger->setLevel(logDef.level);
-                logger->clearAppenders();
+                logger->setRateLimit(logDef.m_rateLimit, logDef.m_rateBurst);
+                Logger::AppenderList appenders;
                 for (const auto &appender : logDef.m_appenders) {
                     sylar::LogAppender::ptr pAppender;
                     if (appender.m_type == 1) {
                         pAppender.reset(new FileLogAppender{appender.m_file});
+                    } else if (appender.m_type == 3) {
+                        pAppender.reset(new BinaryLogAppender{appender.m_file});
+                    } else if (appender.m_type == 4) {
+                        if (!sylar::EnvMgr::GetInstance()->has("d")) {
+                            pAppender.reset(
+                                new ConsoleLogAppender{appender.m_stream, appender.m_overflow, appender.m_maxQueue});
+                        } else {
+                            continue;
+                        }
                     } else if (appender.m_type) {
                         if (!sylar::EnvMgr::GetInstance()->has("d")) {
                             pAppender.reset(new StdoutLogAppender);
@@ -636,14 +1179,16 @@ struct LogIniter {
                     } else {
                         pAppender->setFormatter(LogFormatter::ptr(new LogFormatter));
                     }
-                    logger->addAppender(pAppender);
+                    appenders.push_back(pAppender);
                 }
+                logger->setAppenders(std::move(appenders));
             }
 
             for (const auto &logDef : old_value) {
                 if (auto it = new_value.find(logDef); it == new_value.end()) {
                     auto logger = SYLAR_LOG_NAME(logDef.m_name);
                     logger->setLevel(LogLevel::NOTSET);
+                    logger->setRateLimit(0, 0);
                     logger->clearAppenders();
                 }
             }
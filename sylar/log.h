@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <list>
 #include <map>
@@ -7,13 +9,23 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "mutex.h"
+#include "rcu.h"
 #include "singleton.h"
 
 #define SYLAR_LOG_ROOT() sylar::LoggerMgr::GetInstance()->getRoot()
 
+// 调用点缓存的二进制日志描述符, BinaryLogAppender首次写出该调用点的文本事件时填充
+#define SYLAR_LOG_SITE_CACHE()                      \
+    []() -> sylar::LogSiteCache * {                 \
+        static sylar::LogSiteCache s_site{nullptr}; \
+        return &s_site;                             \
+    }()
+
 #define SYLAR_LOG_NAME(name) sylar::LoggerMgr::GetInstance()->getLogger(name)
 
 #define SYLAR_LOG_LEVEL(logger, level)                                                                             \
@@ -21,7 +33,8 @@
     sylar::LogEventWrap(                                                                                           \
         logger, sylar::LogEvent::ptr(new sylar::LogEvent(                                                          \
                     logger->getName(), level, __FILE__, __LINE__, sylar::GetElapsedMS() - logger->getCreateTime(), \
-                    sylar::GetThreadId(), sylar::GetFiberId(), time(0), sylar::GetThreadName())))                  \
+                    sylar::GetThreadId(), sylar::GetFiberId(), time(0), sylar::GetThreadName(),                    \
+                    SYLAR_LOG_SITE_CACHE())))                                                                      \
         .getLogEvent()                                                                                             \
         ->getSS()
 
@@ -46,7 +59,8 @@
     sylar::LogEventWrap(                                                                                           \
         logger, sylar::LogEvent::ptr(new sylar::LogEvent(                                                          \
                     logger->getName(), level, __FILE__, __LINE__, sylar::GetElapsedMS() - logger->getCreateTime(), \
-                    sylar::GetThreadId(), sylar::GetFiberId(), time(0), sylar::GetThreadName())))                  \
+                    sylar::GetThreadId(), sylar::GetFiberId(), time(0), sylar::GetThreadName(),                    \
+                    SYLAR_LOG_SITE_CACHE())))                                                                      \
         .getLogEvent()                                                                                             \
         ->printf(fmt, __VA_ARGS__)
 
@@ -66,8 +80,38 @@
 
 #define SYLAR_LOG_FMT_DEBUG(logger, fmt, ...) SYLAR_LOG_FMT_LEVEL(logger, sylar::LogLevel::DEBUG, fmt, __VA_ARGS__)
 
+// 带结构化字段的日志: SYLAR_LOG_KV_INFO(logger).with("fd", fd).with("peer", addr) << "connect failed";
+#define SYLAR_LOG_KV_LEVEL(logger, level)                                                                          \
+    if (level <= logger->getLevel())                                                                               \
+    (*sylar::LogEventWrap(                                                                                         \
+          logger, sylar::LogEvent::ptr(new sylar::LogEvent(                                                        \
+                      logger->getName(), level, __FILE__, __LINE__, sylar::GetElapsedMS() - logger->getCreateTime(), \
+                      sylar::GetThreadId(), sylar::GetFiberId(), time(0), sylar::GetThreadName(),                  \
+                      SYLAR_LOG_SITE_CACHE())))                                                                    \
+          .getLogEvent())
+
+#define SYLAR_LOG_KV_FATAL(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::FATAL)
+
+#define SYLAR_LOG_KV_ALERT(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::ALERT)
+
+#define SYLAR_LOG_KV_CRIT(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::CRIT)
+
+#define SYLAR_LOG_KV_ERROR(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::ERROR)
+
+#define SYLAR_LOG_KV_WARN(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::WARN)
+
+#define SYLAR_LOG_KV_NOTICE(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::NOTICE)
+
+#define SYLAR_LOG_KV_INFO(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::INFO)
+
+#define SYLAR_LOG_KV_DEBUG(logger) SYLAR_LOG_KV_LEVEL(logger, sylar::LogLevel::DEBUG)
+
 namespace sylar {
 
+struct LogSite;
+
+using LogSiteCache = std::atomic<const LogSite *>;
+
 class LogLevel {
 public:
     enum Level {
@@ -87,11 +131,33 @@ public:
     static LogLevel::Level FromString(const std::string &str);
 };
 
+// 结构化字段, 保留原始类型, 由%J/%K按各自格式编码
+struct LogField {
+    enum Type : uint8_t {
+        INT64,
+        UINT64,
+        DOUBLE,
+        BOOL,
+        STRING,
+    };
+
+    std::string m_key;
+    Type m_type = STRING;
+    union {
+        int64_t m_int;
+        uint64_t m_uint;
+        double m_double;
+        bool m_bool;
+    };
+    std::string m_str;
+};
+
 class LogEvent {
 public:
     using ptr = std::shared_ptr<LogEvent>;
     LogEvent(const std::string &logger_name, LogLevel::Level level, const char *file, int32_t line, int64_t elapse,
-             uint32_t thread_id, uint64_t fiber_id, time_t time, const std::string &thread_name);
+             uint32_t thread_id, uint64_t fiber_id, time_t time, const std::string &thread_name,
+             LogSiteCache *site_cache = nullptr);
 
     LogLevel::Level getLevel() const { return m_level; }
 
@@ -115,13 +181,56 @@ public:
 
     const std::string &getLoggerName() const { return m_loggerName; }
 
+    LogSiteCache *getSiteCache() const { return m_siteCache; }
+
     void printf(const char *fmt, ...);
 
     void vprintf(const char *fmt, va_list ap);
 
+    const std::vector<LogField> &getFields() const { return m_fields; }
+
+    template <typename T>
+    LogEvent &with(std::string_view key, const T &val) {
+        using U = std::decay_t<T>;
+        LogField &field = addField(key);
+        if constexpr (std::is_same_v<U, bool>) {
+            field.m_type = LogField::BOOL;
+            field.m_bool = val;
+        } else if constexpr (std::is_enum_v<U>) {
+            field.m_type = LogField::INT64;
+            field.m_int = static_cast<int64_t>(val);
+        } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+            field.m_type = LogField::INT64;
+            field.m_int = val;
+        } else if constexpr (std::is_integral_v<U>) {
+            field.m_type = LogField::UINT64;
+            field.m_uint = val;
+        } else if constexpr (std::is_floating_point_v<U>) {
+            field.m_type = LogField::DOUBLE;
+            field.m_double = val;
+        } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            field.m_str = std::string_view{val};
+        } else {
+            std::ostringstream ss;
+            ss << val;
+            field.m_str = ss.str();
+        }
+        return *this;
+    }
+
+    template <typename T>
+    std::stringstream &operator<<(const T &val) {
+        m_ss << val;
+        return m_ss;
+    }
+
+private:
+    LogField &addField(std::string_view key);
+
 private:
     LogLevel::Level m_level;
     std::stringstream m_ss;
+    std::vector<LogField> m_fields;
     const char *m_file = nullptr;
     int32_t m_line = 0;
     int64_t m_elapse = 0;
@@ -130,6 +239,7 @@ private:
     time_t m_time;
     std::string m_threadName;
     std::string m_loggerName;
+    LogSiteCache *m_siteCache = nullptr;
 };
 
 class LogFormatter {
@@ -167,7 +277,7 @@ private:
 class LogAppender {
 public:
     using ptr = std::shared_ptr<LogAppender>;
-    using MutexType = SpinLock;
+    using MutexType = FutexMutex;
 
     LogAppender(LogFormatter::ptr default_formatter);
 
@@ -179,6 +289,9 @@ public:
 
     virtual void log(LogEvent::ptr event) = 0;
 
+    // 二进制日志记录, 默认还原为文本事件后走log()
+    virtual void logBinary(const LogSite *site, const char *data, size_t len);
+
     virtual std::string toYamlString() = 0;
 
 protected:
@@ -217,10 +330,75 @@ private:
     bool m_reopenError = false;
 };
 
+class Thread;
+
+// 控制台appender, 经非阻塞fd直接写出, 写不动时放入内存队列由后台线程排空, 不会阻塞工作线程
+class ConsoleLogAppender : public LogAppender {
+public:
+    using ptr = std::shared_ptr<ConsoleLogAppender>;
+    using QueueMutexType = Mutex;
+
+    // 队列超过上限时: 丢弃新记录, 或丢弃最早的记录
+    enum Overflow {
+        DROP_NEW = 0,
+        DROP_OLD = 1,
+    };
+
+    static const char *OverflowToString(Overflow overflow);
+
+    static Overflow OverflowFromString(const std::string &str);
+
+    ConsoleLogAppender(const std::string &stream = "stdout", Overflow overflow = DROP_NEW,
+                       size_t maxQueueBytes = 4 * 1024 * 1024);
+
+    ~ConsoleLogAppender();
+
+    void log(LogEvent::ptr event) override;
+
+    std::string toYamlString() override;
+
+    uint64_t getDroppedBytes() const { return m_droppedBytes.load(std::memory_order_relaxed); }
+
+    uint64_t getDroppedRecords() const { return m_droppedRecords.load(std::memory_order_relaxed); }
+
+    size_t getQueuedBytes();
+
+private:
+    // 非阻塞写, 返回写出的字节数, 写不动返回0, 出错返回-1
+    ssize_t writeSome(const char *data, size_t len);
+
+    // 在m_queueMutex下尽量写出队列中的数据, 返回队列是否已空
+    bool drain();
+
+    void enqueue(std::string &&data);
+
+    void drop(size_t bytes);
+
+    void run();
+
+private:
+    std::string m_stream;
+    Overflow m_overflow;
+    size_t m_maxQueueBytes;
+    int m_fd = -1;
+    bool m_isSocket = false;
+    QueueMutexType m_queueMutex;
+    std::deque<std::string> m_queue;
+    // 队首记录已写出的字节数
+    size_t m_frontOffset = 0;
+    size_t m_queueBytes = 0;
+    bool m_stopping = false;
+    Semaphore m_semaphore;
+    std::shared_ptr<Thread> m_thread;
+    std::atomic<uint64_t> m_droppedBytes{0};
+    std::atomic<uint64_t> m_droppedRecords{0};
+};
+
 class Logger {
 public:
     using ptr = std::shared_ptr<Logger>;
-    using MutexType = SpinLock;
+    using MutexType = FutexMutex;
+    using AppenderList = std::vector<LogAppender::ptr>;
 
     Logger(const std::string &name = "default");
 
@@ -228,9 +406,19 @@ public:
 
     uint64_t getCreateTime() const { return m_createTime; }
 
-    void setLevel(LogLevel::Level level) { m_level = level; }
+    void setLevel(LogLevel::Level level) { m_level.store(level, std::memory_order_relaxed); }
 
-    LogLevel::Level getLevel() const { return m_level; }
+    LogLevel::Level getLevel() const { return m_level.load(std::memory_order_relaxed); }
+
+    // 限流宏(SYLAR_LOG_LIMIT_*)每个调用点每秒允许的条数和突发量, rate为0表示不限流
+    void setRateLimit(uint32_t rate, uint32_t burst) {
+        m_rateLimit.store(rate, std::memory_order_relaxed);
+        m_rateBurst.store(burst ? burst : rate, std::memory_order_relaxed);
+    }
+
+    uint32_t getRateLimit() const { return m_rateLimit.load(std::memory_order_relaxed); }
+
+    uint32_t getRateBurst() const { return m_rateBurst.load(std::memory_order_relaxed); }
 
     void addAppender(LogAppender::ptr appender);
 
@@ -238,15 +426,26 @@ public:
 
     void clearAppenders();
 
+    // 一次性替换全部appender, 只发布一次新快照
+    void setAppenders(AppenderList appenders);
+
     void log(LogEvent::ptr event);
 
+    void logBinary(const LogSite *site, const char *data, size_t len);
+
     std::string toYamlString();
 
+private:
+    // 写端在m_mutex下复制并替换快照, 读端(log)只做一次原子读取
+    void publish(AppenderList *appenders, MutexType::Lock &lock);
+
 private:
     MutexType m_mutex;
     std::string m_name;
-    LogLevel::Level m_level;
-    std::list<LogAppender::ptr> m_appenders;
+    std::atomic<LogLevel::Level> m_level;
+    std::atomic<uint32_t> m_rateLimit{0};
+    std::atomic<uint32_t> m_rateBurst{0};
+    RcuPtr<AppenderList> m_appenders;
     uint64_t m_createTime;
 };
 
@@ -265,7 +464,7 @@ private:
 
 class LoggerManager {
 public:
-    using MutexType = SpinLock;
+    using MutexType = FutexMutex;
 
     LoggerManager();
 
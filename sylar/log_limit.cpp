@@ -0,0 +1,244 @@
+#include "log_limit.h"
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "config.h"
+#include "macro.h"
+#include "thread.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::ConfigVar<uint32_t>::ptr g_log_limit_summary_interval = sylar::Config::Lookup(
+    "log.limit.summary_interval", (uint32_t)10000, "log rate limit suppressed summary interval(ms)");
+
+static std::atomic<uint32_t> s_summary_interval{10000};
+
+// 令牌补充周期
+static constexpr uint64_t TICK_MS = 100;
+
+// 不限流时的令牌数, 足够大且补充时不会溢出
+static constexpr int64_t UNLIMITED_TOKENS = std::numeric_limits<int64_t>::max() / 2;
+
+namespace {
+
+// 每个线程一组被抑制条数的计数器, 按调用点序号分块按需分配; 只有所属线程写入, 后台线程汇总
+struct SuppressedBlock {
+    static constexpr uint32_t CHUNK_SIZE = 256;
+    static constexpr uint32_t MAX_CHUNKS = 64;
+
+    std::atomic<std::atomic<uint64_t> *> m_chunks[MAX_CHUNKS];
+    std::atomic<bool> m_inUse{true};
+    SuppressedBlock *m_next = nullptr;
+
+    SuppressedBlock() {
+        for (auto &chunk : m_chunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct BlockHolder {
+    SuppressedBlock *m_block = nullptr;
+
+    ~BlockHolder() {
+        if (m_block) {
+            m_block->m_inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+}  // namespace
+
+// 计数器块链表只增不减, 线程退出后可被新线程复用, 计数累计不清零
+static std::atomic<SuppressedBlock *> s_blocks{nullptr};
+static thread_local BlockHolder t_holder;
+// 平凡类型的thread_local访问不经过初始化检查, 热路径只读它
+static thread_local SuppressedBlock *t_block = nullptr;
+
+static SuppressedBlock *AcquireBlock() {
+    for (SuppressedBlock *block = s_blocks.load(std::memory_order_acquire); block; block = block->m_next) {
+        bool expected = false;
+        if (!block->m_inUse.load(std::memory_order_relaxed) &&
+            block->m_inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return block;
+        }
+    }
+
+    SuppressedBlock *block = new SuppressedBlock;
+    SuppressedBlock *head = s_blocks.load(std::memory_order_relaxed);
+    do {
+        block->m_next = head;
+    } while (!s_blocks.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+    return block;
+}
+
+// 所有线程上该调用点被抑制的条数之和
+static uint64_t SumSuppressed(uint32_t index) {
+    uint64_t sum = 0;
+    for (SuppressedBlock *block = s_blocks.load(std::memory_order_acquire); block; block = block->m_next) {
+        std::atomic<uint64_t> *chunk =
+            block->m_chunks[index / SuppressedBlock::CHUNK_SIZE].load(std::memory_order_acquire);
+        if (chunk) {
+            sum += chunk[index % SuppressedBlock::CHUNK_SIZE].load(std::memory_order_relaxed);
+        }
+    }
+    return sum;
+}
+
+struct LogLimitIniter {
+    LogLimitIniter() {
+        s_summary_interval = g_log_limit_summary_interval->getValue();
+        g_log_limit_summary_interval->addListener(
+            [](const uint32_t &, const uint32_t &new_value) { s_summary_interval = new_value; });
+    }
+};
+
+static LogLimitIniter __log_limit_init;
+
+class LogLimiter {
+public:
+    using MutexType = Mutex;
+
+    LogLimiter() : m_thread{new Thread{std::bind(&LogLimiter::run, this), "log_limit"}} {}
+
+    ~LogLimiter() {
+        m_stopping = true;
+        m_thread->join();
+    }
+
+    LogLimitSite *add(const char *file, int32_t line, Logger::ptr logger, uint32_t sampleN) {
+        auto site = new LogLimitSite{file, line, logger, sampleN};
+        MutexType::Lock lock{m_mutex};
+        site->m_index = m_sites.size();
+        m_sites.push_back(site);
+        return site;
+    }
+
+private:
+    void run() {
+        uint64_t lastTick = GetElapsedMS();
+        uint64_t lastSummary = lastTick;
+        while (!m_stopping) {
+            usleep(TICK_MS * 1000);
+            uint64_t now = GetElapsedMS();
+            std::vector<LogLimitSite *> sites;
+            {
+                MutexType::Lock lock{m_mutex};
+                sites = m_sites;
+            }
+            for (auto site : sites) {
+                refill(site, now - lastTick);
+            }
+            lastTick = now;
+            if (now - lastSummary >= s_summary_interval) {
+                for (auto site : sites) {
+                    summary(site, now - lastSummary);
+                }
+                lastSummary = now;
+            }
+        }
+    }
+
+    void refill(LogLimitSite *site, uint64_t elapse) {
+        if (site->m_sampleN) {
+            return;
+        }
+        uint32_t rate = site->m_logger->getRateLimit();
+        if (!rate) {
+            site->m_credit = 0;
+            int64_t old = site->m_tokens.exchange(UNLIMITED_TOKENS, std::memory_order_relaxed);
+            if (old < 0) {
+                site->m_suppressed += -old;
+            }
+            return;
+        }
+        int64_t burst = site->m_logger->getRateBurst();
+        site->m_credit += static_cast<double>(rate) * elapse / 1000;
+        int64_t add = static_cast<int64_t>(site->m_credit);
+        site->m_credit -= add;
+        // 一次CAS完成补充: 负数部分计为被抑制且不抵扣新令牌, 与acquire并发时重试
+        int64_t old = site->m_tokens.load(std::memory_order_relaxed);
+        int64_t tokens;
+        do {
+            tokens = std::min(std::max<int64_t>(old, 0) + add, burst);
+        } while (!site->m_tokens.compare_exchange_weak(old, tokens, std::memory_order_relaxed));
+        if (old < 0) {
+            site->m_suppressed += -old;
+        }
+        if (tokens == burst) {
+            site->m_credit = 0;
+        }
+    }
+
+    void summary(LogLimitSite *site, uint64_t elapse) {
+        uint64_t suppressed = 0;
+        if (site->m_sampleN) {
+            uint64_t count = site->m_count.load(std::memory_order_relaxed);
+            uint64_t n = site->m_sampleN;
+            uint64_t passed = (count + n - 1) / n - (site->m_lastCount + n - 1) / n;
+            suppressed = count - site->m_lastCount - passed;
+            site->m_lastCount = count;
+        } else {
+            uint64_t total = SumSuppressed(site->m_index);
+            std::swap(suppressed, site->m_suppressed);
+            suppressed += total - site->m_lastCount;
+            site->m_lastCount = total;
+        }
+        if (!suppressed) {
+            return;
+        }
+
+        const Logger::ptr &logger = site->m_logger;
+        if (LogLevel::WARN > logger->getLevel()) {
+            return;
+        }
+        LogEventWrap(logger,
+                     LogEvent::ptr(new LogEvent(logger->getName(), LogLevel::WARN, site->m_file, site->m_line,
+                                                GetElapsedMS() - logger->getCreateTime(), GetThreadId(), GetFiberId(),
+                                                time(0), GetThreadName())))
+                .getLogEvent()
+                ->getSS()
+            << "suppressed " << suppressed << " log records in last " << elapse << "ms";
+    }
+
+private:
+    MutexType m_mutex;
+    // 调用点对象随进程存在, 不回收
+    std::vector<LogLimitSite *> m_sites;
+    std::atomic<bool> m_stopping{false};
+    Thread::ptr m_thread;
+};
+
+LogLimitSite::LogLimitSite(const char *file, int32_t line, Logger::ptr logger, uint32_t sampleN)
+    : m_tokens{logger->getRateLimit() ? static_cast<int64_t>(logger->getRateBurst()) : UNLIMITED_TOKENS},
+      m_file{file},
+      m_line{line},
+      m_sampleN{sampleN},
+      m_logger{logger} {}
+
+void LogLimitSite::AddSuppressed(uint32_t index) {
+    if (index >= SuppressedBlock::CHUNK_SIZE * SuppressedBlock::MAX_CHUNKS) {
+        return;
+    }
+    SuppressedBlock *block = t_block;
+    if (SYLAR_UNLIKELY(!block)) {
+        block = t_block = t_holder.m_block = AcquireBlock();
+    }
+    std::atomic<std::atomic<uint64_t> *> &entry = block->m_chunks[index / SuppressedBlock::CHUNK_SIZE];
+    std::atomic<uint64_t> *chunk = entry.load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new std::atomic<uint64_t>[SuppressedBlock::CHUNK_SIZE]();
+        entry.store(chunk, std::memory_order_release);
+    }
+    futex::OwnerAdd(chunk[index % SuppressedBlock::CHUNK_SIZE], 1);
+}
+
+LogLimitSite *LogLimitSite::Register(const char *file, int32_t line, Logger::ptr logger, uint32_t sampleN) {
+    // 第一个调用点注册时才启动补充线程; 函数内静态对象先于全局配置析构
+    static LogLimiter s_limiter;
+    return s_limiter.add(file, line, logger, sampleN);
+}
+
+}  // namespace sylar
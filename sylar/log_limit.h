@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "log.h"
+
+// 每个调用点注册一次限流状态, 之后只返回静态指针
+#define SYLAR_LOG_LIMIT_SITE(logger, sample_n)                                                      \
+    [&]() {                                                                                         \
+        static sylar::LogLimitSite *s_site =                                                        \
+            sylar::LogLimitSite::Register(__FILE__, __LINE__, logger, sample_n);                    \
+        return s_site;                                                                              \
+    }()
+
+// 令牌桶限流, 速率取日志器的rate_limit/rate_burst配置, 被抑制的记录只有一次relaxed原子读
+#define SYLAR_LOG_LIMIT_LEVEL(logger, level) \
+    if (level <= logger->getLevel())          \
+        if (SYLAR_LOG_LIMIT_SITE(logger, 0)->acquire()) SYLAR_LOG_LEVEL(logger, level)
+
+#define SYLAR_LOG_LIMIT_FATAL(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::FATAL)
+
+#define SYLAR_LOG_LIMIT_ALERT(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::ALERT)
+
+#define SYLAR_LOG_LIMIT_CRIT(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::CRIT)
+
+#define SYLAR_LOG_LIMIT_ERROR(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::ERROR)
+
+#define SYLAR_LOG_LIMIT_WARN(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::WARN)
+
+#define SYLAR_LOG_LIMIT_NOTICE(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::NOTICE)
+
+#define SYLAR_LOG_LIMIT_INFO(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::INFO)
+
+#define SYLAR_LOG_LIMIT_DEBUG(logger) SYLAR_LOG_LIMIT_LEVEL(logger, sylar::LogLevel::DEBUG)
+
+// 每n条记录只输出1条, n须为大于0的常量
+#define SYLAR_LOG_SAMPLE_LEVEL(logger, level, n) \
+    if (level <= logger->getLevel())              \
+        if (SYLAR_LOG_LIMIT_SITE(logger, n)->sample()) SYLAR_LOG_LEVEL(logger, level)
+
+#define SYLAR_LOG_SAMPLE_FATAL(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::FATAL, n)
+
+#define SYLAR_LOG_SAMPLE_ALERT(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::ALERT, n)
+
+#define SYLAR_LOG_SAMPLE_CRIT(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::CRIT, n)
+
+#define SYLAR_LOG_SAMPLE_ERROR(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::ERROR, n)
+
+#define SYLAR_LOG_SAMPLE_WARN(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::WARN, n)
+
+#define SYLAR_LOG_SAMPLE_NOTICE(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::NOTICE, n)
+
+#define SYLAR_LOG_SAMPLE_INFO(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::INFO, n)
+
+#define SYLAR_LOG_SAMPLE_DEBUG(logger, n) SYLAR_LOG_SAMPLE_LEVEL(logger, sylar::LogLevel::DEBUG, n)
+
+namespace sylar {
+
+class LogLimitSite {
+    friend class LogLimiter;
+
+public:
+    static LogLimitSite *Register(const char *file, int32_t line, Logger::ptr logger, uint32_t sampleN);
+
+    // 令牌耗尽时只做一次relaxed读取, 被抑制的条数记在本线程的计数器上, 不写共享的cache line
+    // 并发取最后一个令牌时递减到负数, 负数部分由后台线程补充令牌时计为被抑制
+    bool acquire() {
+        if (m_tokens.load(std::memory_order_relaxed) <= 0) {
+            AddSuppressed(m_index);
+            return false;
+        }
+        return m_tokens.fetch_sub(1, std::memory_order_relaxed) > 0;
+    }
+
+    bool sample() { return m_count.fetch_add(1, std::memory_order_relaxed) % m_sampleN == 0; }
+
+    const char *getFile() const { return m_file; }
+
+    int32_t getLine() const { return m_line; }
+
+private:
+    LogLimitSite(const char *file, int32_t line, Logger::ptr logger, uint32_t sampleN);
+
+    static void AddSuppressed(uint32_t index);
+
+private:
+    alignas(64) std::atomic<int64_t> m_tokens;
+    std::atomic<uint64_t> m_count{0};
+    uint32_t m_index = 0;
+    // 以下字段只由后台线程访问
+    alignas(64) const char *m_file;
+    int32_t m_line;
+    uint32_t m_sampleN;
+    Logger::ptr m_logger;
+    double m_credit = 0;
+    // 上次汇总时的计数: 采样为m_count, 限流为各线程被抑制条数之和
+    uint64_t m_lastCount = 0;
+    uint64_t m_suppressed = 0;
+};
+
+}  // namespace sylar
@@ -1,4 +1,11 @@
 #include "mutex.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <ctime>
+#include <sstream>
 #include <stdexcept>
 
 namespace sylar {
@@ -23,4 +30,252 @@ void Semaphore::notify() {
     }
 }
 
-}  // namespace sylar
\ No newline at end of file
+std::string LockStats::toString() const {
+    std::stringstream ss;
+    ss << "acquisitions=" << m_acquisitions << " contentions=" << m_contentions << " spin_acquired=" << m_spinAcquired
+       << " wait_ns=" << m_waitNs;
+    return ss.str();
+}
+
+namespace futex {
+
+// 单次自旋等待的上限, 约几微秒
+static constexpr uint32_t SPIN_LIMIT = 100;
+
+void Wait(std::atomic<uint32_t> &addr, uint32_t val) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
+
+void Wake(std::atomic<uint32_t> &addr, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+uint32_t MaxSpin() {
+    // 单核上持锁线程不会在自旋期间运行, 自旋没有意义
+    static const uint32_t s_max_spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0;
+    return s_max_spin;
+}
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+LockStats Counters::snapshot() const {
+    LockStats stats;
+    stats.m_acquisitions = m_acquisitions.load(std::memory_order_relaxed);
+    stats.m_contentions = m_contentions.load(std::memory_order_relaxed);
+    stats.m_spinAcquired = m_spinAcquired.load(std::memory_order_relaxed);
+    stats.m_waitNs = m_waitNs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void Counters::reset() {
+    m_acquisitions.store(0, std::memory_order_relaxed);
+    m_contentions.store(0, std::memory_order_relaxed);
+    m_spinAcquired.store(0, std::memory_order_relaxed);
+    m_waitNs.store(0, std::memory_order_relaxed);
+}
+
+// 自适应自旋: 在上限内最多自旋最近平均次数的两倍, try成功时把平均值向本次次数靠拢, 失败时衰减
+template <typename F>
+static bool AdaptiveSpin(std::atomic<uint32_t> &avg, Counters &stats, F try_acquire) {
+    uint32_t max_spin = MaxSpin();
+    if (!max_spin) {
+        return false;
+    }
+    int32_t spin = avg.load(std::memory_order_relaxed);
+    uint32_t limit = std::min<uint32_t>(max_spin, spin * 2 + 10);
+    for (uint32_t i = 0; i < limit; ++i) {
+        if (try_acquire()) {
+            avg.store(spin + (static_cast<int32_t>(i) - spin) / 8, std::memory_order_relaxed);
+            stats.m_spinAcquired.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        CpuRelax();
+    }
+    avg.store(spin - spin / 8, std::memory_order_relaxed);
+    return false;
+}
+
+}  // namespace futex
+
+void FutexMutex::lockSlow() {
+    bool acquired = futex::AdaptiveSpin(m_spin, m_stats, [this]() {
+        uint32_t state = m_state.load(std::memory_order_relaxed);
+        return state == 0 &&
+               m_state.compare_exchange_weak(state, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    });
+    if (acquired) {
+        return;
+    }
+
+    // 进入等待后以2加锁, 解锁方据此决定是否唤醒
+    uint64_t start = futex::NowNs();
+    while (m_state.exchange(2, std::memory_order_acquire) != 0) {
+        futex::Wait(m_state, 2);
+    }
+    m_stats.m_contentions.fetch_add(1, std::memory_order_relaxed);
+    m_stats.m_waitNs.fetch_add(futex::NowNs() - start, std::memory_order_relaxed);
+}
+
+void FutexRWMutex::rdlockSlow() {
+    auto try_acquire = [this]() {
+        uint32_t state = m_state.load(std::memory_order_relaxed);
+        return !(state & (WRITER | WAITER_MASK)) &&
+               m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    };
+    if (futex::AdaptiveSpin(m_spin, m_stats, try_acquire)) {
+        return;
+    }
+
+    uint64_t start = futex::NowNs();
+    while (!try_acquire()) {
+        // 先取序号再登记休眠并复查状态, 解锁方改状态后看到休眠者就递增序号, 不会丢失唤醒
+        uint32_t seq = m_readSeq.load(std::memory_order_acquire);
+        m_sleepingReaders.fetch_add(1, std::memory_order_seq_cst);
+        if (m_state.load(std::memory_order_seq_cst) & (WRITER | WAITER_MASK)) {
+            futex::Wait(m_readSeq, seq);
+        }
+        m_sleepingReaders.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_stats.m_contentions.fetch_add(1, std::memory_order_relaxed);
+    m_stats.m_waitNs.fetch_add(futex::NowNs() - start, std::memory_order_relaxed);
+}
+
+void FutexRWMutex::wrlockSlow() {
+    // 先登记为等待中的写者, 之后到达的读者会阻塞
+    m_state.fetch_add(WAITER_ONE, std::memory_order_relaxed);
+    auto try_acquire = [this]() {
+        uint32_t state = m_state.load(std::memory_order_relaxed);
+        return !(state & (READER_MASK | WRITER)) &&
+               m_state.compare_exchange_weak(state, state - WAITER_ONE + WRITER, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    };
+    if (futex::AdaptiveSpin(m_spin, m_stats, try_acquire)) {
+        return;
+    }
+
+    uint64_t start = futex::NowNs();
+    while (!try_acquire()) {
+        uint32_t seq = m_writeSeq.load(std::memory_order_acquire);
+        m_sleepingWriters.fetch_add(1, std::memory_order_seq_cst);
+        if (m_state.load(std::memory_order_seq_cst) & (READER_MASK | WRITER)) {
+            futex::Wait(m_writeSeq, seq);
+        }
+        m_sleepingWriters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_stats.m_contentions.fetch_add(1, std::memory_order_relaxed);
+    m_stats.m_waitNs.fetch_add(futex::NowNs() - start, std::memory_order_relaxed);
+}
+
+void FutexRWMutex::unlock() {
+    uint32_t state = m_state.load(std::memory_order_relaxed);
+    if (state & WRITER) {
+        state = m_state.fetch_sub(WRITER, std::memory_order_seq_cst) - WRITER;
+        // 写优先: 还有写者等待时只唤醒一个写者, 否则唤醒全部读者
+        if (state & WAITER_MASK) {
+            wakeWriter();
+        } else {
+            wakeReaders();
+        }
+    } else {
+        state = m_state.fetch_sub(1, std::memory_order_seq_cst) - 1;
+        if (!(state & READER_MASK) && (state & WAITER_MASK)) {
+            wakeWriter();
+        }
+    }
+}
+
+void FutexRWMutex::wakeReaders() {
+    if (m_sleepingReaders.load(std::memory_order_seq_cst)) {
+        m_readSeq.fetch_add(1, std::memory_order_release);
+        futex::Wake(m_readSeq, INT_MAX);
+    }
+}
+
+void FutexRWMutex::wakeWriter() {
+    if (m_sleepingWriters.load(std::memory_order_seq_cst)) {
+        m_writeSeq.fetch_add(1, std::memory_order_release);
+        futex::Wake(m_writeSeq, 1);
+    }
+}
+
+void FutexSemaphore::waitSlow() {
+    auto try_acquire = [this]() {
+        uint32_t count = m_count.load(std::memory_order_relaxed);
+        return count &&
+               m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed);
+    };
+    if (futex::AdaptiveSpin(m_spin, m_stats, try_acquire)) {
+        return;
+    }
+
+    uint64_t start = futex::NowNs();
+    while (!try_acquire()) {
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (!m_count.load(std::memory_order_seq_cst)) {
+            futex::Wait(m_count, 0);
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_stats.m_contentions.fetch_add(1, std::memory_order_relaxed);
+    m_stats.m_waitNs.fetch_add(futex::NowNs() - start, std::memory_order_relaxed);
+}
+
+uint32_t BRRWMutex::AssignSlot() {
+    static std::atomic<uint32_t> s_next{0};
+    t_slot = s_next.fetch_add(1, std::memory_order_relaxed) % SLOTS;
+    return t_slot;
+}
+
+void BRRWMutex::rdlockSlow() {
+    std::atomic<int64_t> &readers = m_slots[Slot()].m_readers;
+    while (true) {
+        uint32_t writer = m_writer.load(std::memory_order_acquire);
+        if (writer) {
+            // 写者解锁时看到休眠的读者才唤醒
+            m_sleepingReaders.fetch_add(1, std::memory_order_seq_cst);
+            futex::Wait(m_writer, writer);
+            m_sleepingReaders.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!m_writer.load(std::memory_order_seq_cst)) {
+            return;
+        }
+        readers.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void BRRWMutex::wrlock() {
+    m_writerMutex.lock();
+    m_writer.store(PENDING, std::memory_order_seq_cst);
+    // 读者可能在其他线程解锁, 单个槽可以为负, 只看总和
+    for (uint32_t i = 0;; ++i) {
+        int64_t readers = 0;
+        for (const auto &slot : m_slots) {
+            readers += slot.m_readers.load(std::memory_order_seq_cst);
+        }
+        if (!readers) {
+            break;
+        }
+        if (i < futex::MaxSpin()) {
+            futex::CpuRelax();
+        } else {
+            sched_yield();
+        }
+    }
+    m_writer.store(HELD, std::memory_order_relaxed);
+}
+
+void BRRWMutex::wrunlock() {
+    m_writer.store(0, std::memory_order_seq_cst);
+    if (m_sleepingReaders.load(std::memory_order_seq_cst)) {
+        futex::Wake(m_writer, INT_MAX);
+    }
+    m_writerMutex.unlock();
+}
+
+}  // namespace sylar
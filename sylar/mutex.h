@@ -3,9 +3,11 @@
 #include "noncopyable.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
 #include <atomic>
 #include <cstdint>
+#include <string>
 
 namespace sylar {
 
@@ -206,4 +208,252 @@ private:
     volatile std::atomic_flag m_mutex;
 };
 
+// 锁的竞争统计, 获取次数在持锁方更新, 等待时间只在进入慢路径时统计
+struct LockStats {
+    uint64_t m_acquisitions = 0;
+    // 自旋阶段未能获取而进入futex等待的次数
+    uint64_t m_contentions = 0;
+    // 在自旋阶段获取成功的次数
+    uint64_t m_spinAcquired = 0;
+    uint64_t m_waitNs = 0;
+
+    std::string toString() const;
+};
+
+namespace futex {
+
+// 等待*addr不等于val, 被唤醒或值已变化时返回
+void Wait(std::atomic<uint32_t> &addr, uint32_t val);
+
+void Wake(std::atomic<uint32_t> &addr, int count);
+
+// 自旋上限, 单核机器上为0
+uint32_t MaxSpin();
+
+uint64_t NowNs();
+
+struct Counters {
+    std::atomic<uint64_t> m_acquisitions{0};
+    std::atomic<uint64_t> m_contentions{0};
+    std::atomic<uint64_t> m_spinAcquired{0};
+    std::atomic<uint64_t> m_waitNs{0};
+
+    LockStats snapshot() const;
+
+    void reset();
+};
+
+// 只有持锁方会更新的计数, 不需要原子加
+inline void OwnerAdd(std::atomic<uint64_t> &counter, uint64_t val) {
+    counter.store(counter.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+}
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+}  // namespace futex
+
+// 基于futex的互斥锁: 0未加锁, 1加锁无等待者, 2加锁有等待者
+// 先按本锁最近的自旋成功次数自适应自旋, 再进入futex等待
+class FutexMutex : Noncopyable {
+public:
+    using Lock = ScopedLockImpl<FutexMutex>;
+
+    void lock() {
+        uint32_t expected = 0;
+        if (!m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            lockSlow();
+        }
+        futex::OwnerAdd(m_stats.m_acquisitions, 1);
+    }
+
+    bool tryLock() {
+        uint32_t expected = 0;
+        if (!m_state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return false;
+        }
+        futex::OwnerAdd(m_stats.m_acquisitions, 1);
+        return true;
+    }
+
+    void unlock() {
+        if (m_state.exchange(0, std::memory_order_release) == 2) {
+            futex::Wake(m_state, 1);
+        }
+    }
+
+    LockStats getStats() const { return m_stats.snapshot(); }
+
+    void resetStats() { m_stats.reset(); }
+
+private:
+    void lockSlow();
+
+private:
+    std::atomic<uint32_t> m_state{0};
+    // 最近获取锁所需自旋次数的滑动平均
+    std::atomic<uint32_t> m_spin{0};
+    futex::Counters m_stats;
+};
+
+// 基于futex的读写锁, 写优先: 有写者等待时新的读者阻塞
+// 读锁不可重入: 持有读锁时再次rdlock, 若期间有写者排队就会死锁(glibc默认的读写锁读优先, 不会死锁)
+// 持有读锁时不要调用可能再取同一把锁的代码
+// 状态字: 低20位读者数, 第20位写锁, 高11位等待中的写者数
+class FutexRWMutex : Noncopyable {
+public:
+    using ReadLock = ReadScopedLockImpl<FutexRWMutex>;
+    using WriteLock = WriteScopedLockImpl<FutexRWMutex>;
+
+    void rdlock() {
+        uint32_t state = m_state.load(std::memory_order_relaxed);
+        if ((state & (WRITER | WAITER_MASK)) || !m_state.compare_exchange_weak(state, state + 1,
+                                                                                std::memory_order_acquire,
+                                                                                std::memory_order_relaxed)) {
+            rdlockSlow();
+        }
+        m_stats.m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void wrlock() {
+        uint32_t expected = 0;
+        if (!m_state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            wrlockSlow();
+        }
+        m_stats.m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unlock();
+
+    LockStats getStats() const { return m_stats.snapshot(); }
+
+    void resetStats() { m_stats.reset(); }
+
+private:
+    void rdlockSlow();
+
+    void wrlockSlow();
+
+    void wakeReaders();
+
+    void wakeWriter();
+
+private:
+    static constexpr uint32_t READER_MASK = (1u << 20) - 1;
+    static constexpr uint32_t WRITER = 1u << 20;
+    static constexpr uint32_t WAITER_ONE = 1u << 21;
+    static constexpr uint32_t WAITER_MASK = ~(READER_MASK | WRITER);
+
+    std::atomic<uint32_t> m_state{0};
+    // 读者/写者各自等待的futex序号, 以及正在futex上休眠的人数, 无人休眠时解锁不进内核
+    std::atomic<uint32_t> m_readSeq{0};
+    std::atomic<uint32_t> m_writeSeq{0};
+    std::atomic<uint32_t> m_sleepingReaders{0};
+    std::atomic<uint32_t> m_sleepingWriters{0};
+    std::atomic<uint32_t> m_spin{0};
+    futex::Counters m_stats;
+};
+
+// 基于futex的信号量, 有可用计数时不进入内核
+class FutexSemaphore : Noncopyable {
+public:
+    FutexSemaphore(uint32_t count = 0) : m_count{count} {}
+
+    void wait() {
+        uint32_t count = m_count.load(std::memory_order_relaxed);
+        if (!count || !m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+                                                     std::memory_order_relaxed)) {
+            waitSlow();
+        }
+        m_stats.m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void notify() {
+        m_count.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_seq_cst)) {
+            futex::Wake(m_count, 1);
+        }
+    }
+
+    LockStats getStats() const { return m_stats.snapshot(); }
+
+    void resetStats() { m_stats.reset(); }
+
+private:
+    void waitSlow();
+
+private:
+    std::atomic<uint32_t> m_count;
+    std::atomic<uint32_t> m_sleeping{0};
+    std::atomic<uint32_t> m_spin{0};
+    futex::Counters m_stats;
+};
+
+// 读者分散计数的读写锁(brlock): 每个线程固定使用一个独占缓存行的计数槽, 读锁不写共享的缓存行
+// 写锁先置写标志阻止新读者, 再等待全部槽的计数之和归零, 开销与槽数成正比, 只适合读远多于写的表
+// 写优先, 读锁与FutexRWMutex一样不可重入; 读锁期间协程被调度到其他线程也能正确解锁
+// 每个实例占用SLOTS个缓存行(4KB), 只用于全局的表, 不要用作对象内的锁
+class BRRWMutex : Noncopyable {
+public:
+    using ReadLock = ReadScopedLockImpl<BRRWMutex>;
+    using WriteLock = WriteScopedLockImpl<BRRWMutex>;
+
+    static constexpr uint32_t SLOTS = 64;
+
+    void rdlock() {
+        std::atomic<int64_t> &readers = m_slots[Slot()].m_readers;
+        readers.fetch_add(1, std::memory_order_seq_cst);
+        if (m_writer.load(std::memory_order_seq_cst)) {
+            readers.fetch_sub(1, std::memory_order_release);
+            rdlockSlow();
+        }
+    }
+
+    void wrlock();
+
+    void unlock() {
+        // 写锁持有期间不可能有读者, 因此HELD状态下解锁的一定是写者
+        if (m_writer.load(std::memory_order_acquire) == HELD) {
+            wrunlock();
+        } else {
+            m_slots[Slot()].m_readers.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+private:
+    void rdlockSlow();
+
+    void wrunlock();
+
+    static uint32_t Slot() {
+        int32_t slot = t_slot;
+        return slot >= 0 ? slot : AssignSlot();
+    }
+
+    static uint32_t AssignSlot();
+
+private:
+    static constexpr uint32_t PENDING = 1;
+    static constexpr uint32_t HELD = 2;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<int64_t> m_readers{0};
+    };
+
+    static inline thread_local int32_t t_slot = -1;
+
+    ReaderSlot m_slots[SLOTS];
+    // 0无写者, PENDING等待读者退出, HELD持有写锁; 读者在其上休眠
+    alignas(64) std::atomic<uint32_t> m_writer{0};
+    std::atomic<uint32_t> m_sleepingReaders{0};
+    // 写者之间互斥
+    FutexMutex m_writerMutex;
+};
+
 }  // namespace sylar
\ No newline at end of file
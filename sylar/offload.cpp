@@ -0,0 +1,147 @@
+#include "offload.h"
+#include <algorithm>
+#include <sstream>
+#include "config.h"
+#include "hook.h"
+#include "rcu.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::ConfigVar<uint32_t>::ptr g_offload_threads =
+    sylar::Config::Lookup("offload.threads", static_cast<uint32_t>(4), "offload pool threads");
+
+static sylar::ConfigVar<uint32_t>::ptr g_offload_max_queue = sylar::Config::Lookup(
+    "offload.max_queue", static_cast<uint32_t>(1024), "offload pool max queued tasks, run inline when full");
+
+std::string OffloadPool::Stats::toString() const {
+    std::stringstream ss;
+    ss << "tasks=" << m_tasks << " inline=" << m_inline << " queue_depth=" << m_queueDepth
+       << " max_queue_depth=" << m_maxQueueDepth << " avg_queue_us=" << (m_tasks ? m_queueTime / m_tasks : 0)
+       << " max_queue_us=" << m_maxQueueTime << " avg_run_us=" << (m_tasks ? m_runTime / m_tasks : 0);
+    return ss.str();
+}
+
+OffloadPool::OffloadPool() : OffloadPool{g_offload_threads->getValue(), g_offload_max_queue->getValue()} {}
+
+OffloadPool::OffloadPool(size_t threads, size_t maxQueue, const std::string &name)
+    : m_name{name}, m_maxQueue{maxQueue} {
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.push_back(
+            std::make_shared<Thread>(std::bind(&OffloadPool::work, this), m_name + "_" + std::to_string(i)));
+    }
+}
+
+OffloadPool::~OffloadPool() { stop(); }
+
+void OffloadPool::stop() {
+    {
+        MutexType::Lock lock{m_mutex};
+        if (m_stopping) {
+            return;
+        }
+        m_stopping = true;
+    }
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+        m_semaphore.notify();
+    }
+    for (auto &thread : m_threads) {
+        thread->join();
+    }
+    m_threads.clear();
+}
+
+void OffloadPool::run(std::function<void()> cb) {
+    // 只有开启了hook的调度线程上的协程可以挂起; RCU读临界区内不能让出协程
+    Scheduler *scheduler = Scheduler::GetThis();
+    if (!scheduler || !is_hook_enable() || RcuDomain::InReadSection()) {
+        ++m_inline;
+        cb();
+        return;
+    }
+
+    Task task;
+    task.m_cb = std::move(cb);
+    task.m_scheduler = scheduler;
+    task.m_fiber = Fiber::GetThis();
+    task.m_thread = GetThreadId();
+    task.m_enqueueTime = GetCurrentUS();
+    {
+        MutexType::Lock lock{m_mutex};
+        if (m_stopping || m_tasks.size() >= m_maxQueue) {
+            lock.unlock();
+            ++m_inline;
+            task.m_cb();
+            return;
+        }
+        m_tasks.push_back(&task);
+        m_maxQueueDepth = std::max<uint64_t>(m_maxQueueDepth, m_tasks.size());
+        // 任务完成前调度器不能停止, 否则协程被丢弃且work()访问已释放的调度器
+        scheduler->addPending();
+    }
+    m_semaphore.notify();
+    Fiber::GetThis()->yield();
+
+    if (task.m_exception) {
+        std::rethrow_exception(task.m_exception);
+    }
+    errno = task.m_errno;
+}
+
+void OffloadPool::work() {
+    while (true) {
+        m_semaphore.wait();
+        Task *task = nullptr;
+        {
+            MutexType::Lock lock{m_mutex};
+            if (m_tasks.empty()) {
+                if (m_stopping) {
+                    return;
+                }
+                continue;
+            }
+            task = m_tasks.front();
+            m_tasks.pop_front();
+        }
+
+        uint64_t start = GetCurrentUS();
+        uint64_t queued = start - task->m_enqueueTime;
+        errno = 0;
+        try {
+            task->m_cb();
+        } catch (...) {
+            task->m_exception = std::current_exception();
+        }
+        task->m_errno = errno;
+        m_runTime += GetCurrentUS() - start;
+        m_queueTime += queued;
+        ++m_completed;
+        {
+            MutexType::Lock lock{m_mutex};
+            m_maxQueueTime = std::max(m_maxQueueTime, queued);
+        }
+
+        // task在调用方协程的栈上, 唤醒后不能再访问
+        // 固定在挂起时的线程上恢复: 该线程要等协程yield返回后才会取到它, 不会与尚未完成的yield竞争
+        Scheduler *scheduler = task->m_scheduler;
+        Fiber::ptr fiber = std::move(task->m_fiber);
+        int thread = task->m_thread;
+        scheduler->schedulePending(std::move(fiber), thread);
+    }
+}
+
+OffloadPool::Stats OffloadPool::getStats() {
+    Stats stats;
+    stats.m_tasks = m_completed;
+    stats.m_inline = m_inline;
+    stats.m_queueTime = m_queueTime;
+    stats.m_runTime = m_runTime;
+    MutexType::Lock lock{m_mutex};
+    stats.m_queueDepth = m_tasks.size();
+    stats.m_maxQueueDepth = m_maxQueueDepth;
+    stats.m_maxQueueTime = m_maxQueueTime;
+    return stats;
+}
+
+}  // namespace sylar
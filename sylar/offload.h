@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "fiber.h"
+#include "mutex.h"
+#include "noncopyable.h"
+#include "scheduler.h"
+#include "singleton.h"
+#include "thread.h"
+
+namespace sylar {
+
+// 执行无法异步化的阻塞调用(磁盘文件读写、fsync、stat、getpwnam等)或CPU密集任务的线程池
+// 协程提交任务后挂起, 任务在池中线程上执行完后协程在原线程上恢复, 期间调度线程可以运行其他协程
+class OffloadPool : Noncopyable {
+public:
+    using MutexType = Mutex;
+
+    struct Stats {
+        uint64_t m_tasks = 0;          // 已完成的任务数
+        uint64_t m_inline = 0;         // 队列满或不在协程中而直接执行的任务数
+        uint64_t m_queueDepth = 0;     // 当前排队的任务数
+        uint64_t m_maxQueueDepth = 0;  // 排队数的历史最大值
+        uint64_t m_queueTime = 0;      // 排队总时长(us)
+        uint64_t m_maxQueueTime = 0;   // 单个任务的最长排队时长(us)
+        uint64_t m_runTime = 0;        // 执行总时长(us)
+
+        std::string toString() const;
+    };
+
+    // 线程数和队列长度来自offload.threads、offload.max_queue
+    OffloadPool();
+
+    OffloadPool(size_t threads, size_t maxQueue, const std::string &name = "offload");
+
+    ~OffloadPool();
+
+    // 在池中执行cb并挂起当前协程直到完成, cb中的errno和异常带回到调用方
+    // 不在协程中、在RCU读临界区内(如日志appender中)或队列已满时在当前线程直接执行
+    // 调用方不能持有锁: 挂起期间同一线程上的其他协程可能请求同一把锁而死锁
+    void run(std::function<void()> cb);
+
+    size_t getThreads() const { return m_threads.size(); }
+
+    size_t getMaxQueue() const { return m_maxQueue; }
+
+    Stats getStats();
+
+    void stop();
+
+private:
+    struct Task {
+        std::function<void()> m_cb;
+        Scheduler *m_scheduler;
+        Fiber::ptr m_fiber;
+        int m_thread;
+        uint64_t m_enqueueTime;
+        int m_errno = 0;
+        std::exception_ptr m_exception;
+    };
+
+    void work();
+
+private:
+    std::string m_name;
+    size_t m_maxQueue;
+    std::vector<Thread::ptr> m_threads;
+    MutexType m_mutex;
+    Semaphore m_semaphore;
+    std::deque<Task *> m_tasks;
+    bool m_stopping = false;
+    uint64_t m_maxQueueDepth = 0;
+    uint64_t m_maxQueueTime = 0;
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_inline{0};
+    std::atomic<uint64_t> m_queueTime{0};
+    std::atomic<uint64_t> m_runTime{0};
+};
+
+using OffloadMgr = Singleton<OffloadPool>;
+
+// 在全局OffloadPool中执行fn, 返回fn的返回值
+template <typename F>
+auto Offload(F &&fn) -> decltype(fn()) {
+    using Result = decltype(fn());
+    if constexpr (std::is_void_v<Result>) {
+        OffloadMgr::GetInstance()->run(std::forward<F>(fn));
+    } else {
+        std::optional<Result> result;
+        OffloadMgr::GetInstance()->run([&result, &fn]() { result.emplace(fn()); });
+        return std::move(*result);
+    }
+}
+
+}  // namespace sylar
@@ -0,0 +1,99 @@
+#include "rcu.h"
+#include <sched.h>
+#include <cassert>
+#include <cstdint>
+
+namespace sylar {
+
+namespace {
+
+struct alignas(64) ReaderSlot {
+    // 0表示不在读临界区, 否则为进入时的epoch
+    std::atomic<uint64_t> m_epoch{0};
+    std::atomic<bool> m_inUse{false};
+    ReaderSlot *m_next = nullptr;
+};
+
+struct SlotHolder {
+    ReaderSlot *m_slot = nullptr;
+    uint32_t m_depth = 0;
+
+    ~SlotHolder() {
+        if (m_slot) {
+            m_slot->m_epoch.store(0, std::memory_order_release);
+            m_slot->m_inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+}  // namespace
+
+// 槽位链表只增不减, 线程退出后槽位可被新线程复用
+static std::atomic<ReaderSlot *> s_slots{nullptr};
+static std::atomic<uint64_t> s_epoch{1};
+static thread_local SlotHolder t_holder;
+
+static ReaderSlot *AcquireSlot() {
+    for (ReaderSlot *slot = s_slots.load(std::memory_order_acquire); slot; slot = slot->m_next) {
+        bool expected = false;
+        if (!slot->m_inUse.load(std::memory_order_relaxed) &&
+            slot->m_inUse.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return slot;
+        }
+    }
+
+    ReaderSlot *slot = new ReaderSlot;
+    slot->m_inUse.store(true, std::memory_order_relaxed);
+    ReaderSlot *head = s_slots.load(std::memory_order_relaxed);
+    do {
+        slot->m_next = head;
+    } while (!s_slots.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+    return slot;
+}
+
+void RcuDomain::ReadLock() {
+    SlotHolder &holder = t_holder;
+    if (holder.m_depth++ != 0) {
+        return;
+    }
+    if (!holder.m_slot) {
+        holder.m_slot = AcquireSlot();
+    }
+    holder.m_slot->m_epoch.store(s_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    // 槽位的写入必须先于随后对被保护指针的读取对写端可见
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void RcuDomain::ReadUnlock() {
+    SlotHolder &holder = t_holder;
+    if (--holder.m_depth == 0) {
+        holder.m_slot->m_epoch.store(0, std::memory_order_release);
+    }
+}
+
+bool RcuDomain::InReadSection() { return t_holder.m_depth != 0; }
+
+void RcuDomain::Synchronize() {
+    // 在读临界区内等待自己会死锁
+    assert(t_holder.m_depth == 0);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t target = s_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    for (ReaderSlot *slot = s_slots.load(std::memory_order_acquire); slot; slot = slot->m_next) {
+        for (uint32_t spins = 0;; ++spins) {
+            uint64_t epoch = slot->m_epoch.load(std::memory_order_acquire);
+            if (epoch == 0 || epoch >= target) {
+                break;
+            }
+            if (spins < 128) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            } else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+}  // namespace sylar
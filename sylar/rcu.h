@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "noncopyable.h"
+
+namespace sylar {
+
+// 基于epoch的RCU: 读端只写本线程的槽位, 写端发布新指针后等待发布前进入的读者全部退出
+// 读临界区内不能让出协程, 否则协程可能被调度到其他线程
+class RcuDomain {
+public:
+    static void ReadLock();
+
+    static void ReadUnlock();
+
+    static void Synchronize();
+
+    // 当前线程是否在读临界区内
+    static bool InReadSection();
+};
+
+class RcuReadGuard : Noncopyable {
+public:
+    RcuReadGuard() { RcuDomain::ReadLock(); }
+
+    ~RcuReadGuard() { RcuDomain::ReadUnlock(); }
+};
+
+template <typename T>
+class RcuPtr : Noncopyable {
+public:
+    RcuPtr(T *val = nullptr) : m_ptr{val} {}
+
+    ~RcuPtr() { delete m_ptr.load(std::memory_order_relaxed); }
+
+    // 须在RcuReadGuard作用域内使用, 作用域结束后指针可能被回收
+    const T *get() const { return m_ptr.load(std::memory_order_acquire); }
+
+    // 只发布新值不等待, 调用方负责在Synchronize之后释放旧值
+    T *exchange(T *val) { return m_ptr.exchange(val, std::memory_order_seq_cst); }
+
+    void update(T *val) {
+        std::unique_ptr<T> old{exchange(val)};
+        RcuDomain::Synchronize();
+    }
+
+private:
+    std::atomic<T *> m_ptr;
+};
+
+}  // namespace sylar
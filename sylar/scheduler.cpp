@@ -1,4 +1,9 @@
 #include "scheduler.h"
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fstream>
+#include "config.h"
 #include "log.h"
 #include "macro.h"
 
@@ -6,11 +11,72 @@ namespace sylar {
 
 static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
 
+template <>
+class LexicalCast<std::string, Scheduler::Placement> {
+public:
+    Scheduler::Placement operator()(const std::string &val) {
+        YAML::Node node = YAML::Load(val);
+        Scheduler::Placement placement;
+        if (node["cpus"].IsDefined()) {
+            std::string cpus = node["cpus"].as<std::string>();
+            placement.m_cpus = ParseCpuList(cpus);
+            if (placement.m_cpus.empty()) {
+                throw std::invalid_argument{"invalid cpu list: " + cpus};
+            }
+        }
+        if (node["numa_bind"].IsDefined()) {
+            placement.m_numaBind = node["numa_bind"].as<bool>();
+        }
+        if (node["isolate_reactor"].IsDefined()) {
+            placement.m_isolateReactor = node["isolate_reactor"].as<bool>();
+        }
+        return placement;
+    }
+};
+
+template <>
+class LexicalCast<Scheduler::Placement, std::string> {
+public:
+    std::string operator()(const Scheduler::Placement &placement) {
+        YAML::Node node;
+        if (!placement.m_cpus.empty()) {
+            node["cpus"] = CpuListToString(placement.m_cpus);
+        }
+        node["numa_bind"] = placement.m_numaBind;
+        node["isolate_reactor"] = placement.m_isolateReactor;
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
+};
+
+// 按调度器名称配置, 未列出的调度器使用default项
+static sylar::ConfigVar<std::map<std::string, Scheduler::Placement>>::ptr g_scheduler_placement =
+    sylar::Config::Lookup("scheduler.placement", std::map<std::string, Scheduler::Placement>{},
+                          "scheduler worker placement");
+
+Scheduler::Placement Scheduler::Placement::FromConfig(const std::string &name) {
+    // 其他编译单元的静态调度器可能先于配置项构造
+    if (!g_scheduler_placement) {
+        return {};
+    }
+    auto placements = g_scheduler_placement->getShared();
+    auto it = placements->find(name);
+    if (it == placements->end()) {
+        it = placements->find("default");
+    }
+    return it == placements->end() ? Placement{} : it->second;
+}
+
 static thread_local Scheduler *t_scheduler = nullptr;
 
 static thread_local Fiber *t_scheduler_fiber = nullptr;
 
-Scheduler::Scheduler(size_t threads, bool use_caller, const std::string &name) : m_name{name}, m_useCaller{use_caller} {
+Scheduler::Scheduler(size_t threads, bool use_caller, const std::string &name)
+    : Scheduler{threads, use_caller, name, Placement::FromConfig(name)} {}
+
+Scheduler::Scheduler(size_t threads, bool use_caller, const std::string &name, const Placement &placement)
+    : m_name{name}, m_placement{placement}, m_useCaller{use_caller} {
     SYLAR_ASSERT(threads > 0);
 
     if (use_caller) {
@@ -56,15 +122,114 @@ void Scheduler::start() {
 
     SYLAR_ASSERT(m_threads.empty());
     m_threads.resize(m_threadCount);
+    m_workers.resize(m_threadCount);
     for (size_t i = 0; i < m_threadCount; ++i) {
-        m_threads[i].reset(new Thread{std::bind(&Scheduler::run, this), m_name + "_" + std::to_string(i)});
+        // 工作线程先完成绑定再创建协程栈, 栈内存才会落在本地节点
+        auto worker = [this, i]() {
+            applyPlacement(i);
+            run();
+        };
+        m_threads[i].reset(new Thread{worker, m_name + "_" + std::to_string(i)});
         m_threadIds.push_back(m_threads[i]->getId());
+        m_workers[i].m_name = m_threads[i]->getName();
+        m_workers[i].m_threadId = m_threads[i]->getId();
+    }
+}
+
+void Scheduler::applyPlacement(size_t index) {
+    const std::vector<int> &cpus = m_placement.m_cpus;
+    bool reactor = index == 0;
+    int cpu = -1;
+    if (m_placement.m_isolateReactor && cpus.size() > 1) {
+        cpu = reactor ? cpus[0] : cpus[1 + (index - 1) % (cpus.size() - 1)];
+    } else if (!cpus.empty()) {
+        cpu = cpus[index % cpus.size()];
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (int ret = pthread_setaffinity_np(pthread_self(), sizeof set, &set); ret) {
+            SYLAR_LOG_ERROR(g_logger) << "Scheduler " << m_name << " pin worker " << index << " to cpu " << cpu
+                                      << " failed, ret=" << ret;
+            cpu = -1;
+        }
+    }
+
+    int node = -1;
+    if (cpu >= 0 && m_placement.m_numaBind) {
+        node = GetCpuNode(cpu);
+        // 优先而不是强制绑定, 本地节点内存不足时仍可从其他节点分配
+        unsigned long mask[16] = {0};
+        if (node >= 0 && node < (int)sizeof(mask) * 8 - 1) {
+            mask[node / 64] |= 1ul << (node % 64);
+            if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8)) {
+                SYLAR_LOG_ERROR(g_logger) << "Scheduler " << m_name << " set_mempolicy node " << node
+                                          << " errno=" << errno << " errstr=" << strerror(errno);
+                node = -1;
+            }
+        } else {
+            node = -1;
+        }
+    }
+
+    SYLAR_LOG_INFO(g_logger) << "Scheduler " << m_name << " worker " << index << " tid=" << sylar::GetThreadId()
+                             << " cpu=" << cpu << " node=" << node << (reactor ? " reactor" : "");
+    MutexType::Lock lock{m_mutex};
+    m_workers[index].m_cpu = cpu;
+    m_workers[index].m_node = node;
+    m_workers[index].m_reactor = reactor;
+}
+
+std::vector<Scheduler::WorkerInfo> Scheduler::getWorkerInfos() {
+    std::vector<WorkerInfo> workers;
+    {
+        MutexType::Lock lock{m_mutex};
+        workers = m_workers;
+    }
+    for (auto &worker : workers) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (!sched_getaffinity(worker.m_threadId, sizeof set, &set)) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    worker.m_allowedCpus.push_back(cpu);
+                }
+            }
+        }
+
+        // /proc/<tid>/stat第39列为最近一次运行所在的CPU, 前两列之后从')'开始按空格分隔
+        std::ifstream ifs{"/proc/self/task/" + std::to_string(worker.m_threadId) + "/stat"};
+        std::string stat;
+        if (std::getline(ifs, stat)) {
+            std::stringstream ss{stat.substr(stat.rfind(')') + 2)};
+            std::string field;
+            for (int i = 3; i <= 39 && ss >> field; ++i) {
+                if (i == 39) {
+                    worker.m_lastCpu = TypeUtil::Atoi(field);
+                }
+            }
+        }
     }
+    return workers;
+}
+
+std::string Scheduler::dumpPlacement() {
+    std::stringstream ss;
+    ss << "Scheduler " << m_name << " cpus=" << CpuListToString(m_placement.m_cpus)
+       << " numa_bind=" << m_placement.m_numaBind << " isolate_reactor=" << m_placement.m_isolateReactor;
+    for (const auto &worker : getWorkerInfos()) {
+        ss << "\n    " << worker.m_name << " tid=" << worker.m_threadId << " cpu=" << worker.m_cpu
+           << " node=" << worker.m_node << (worker.m_reactor ? " reactor" : "")
+           << " allowed=" << CpuListToString(worker.m_allowedCpus) << " last_cpu=" << worker.m_lastCpu;
+    }
+    return ss.str();
 }
 
 bool Scheduler::stopping() {
     MutexType::Lock lock{m_mutex};
-    return m_stopping && m_tasks.empty() && m_activeThreadCount == 0;
+    return m_stopping && m_tasks.empty() && m_activeThreadCount == 0 && m_pendingCount == 0;
 }
 
 void Scheduler::tickle() { SYLAR_LOG_DEBUG(g_logger) << "tickle"; }
@@ -148,6 +313,10 @@ void Scheduler::run() {
                 break;
             }
             tickle_me = tickle_me || itTask != m_tasks.end();
+            // 在锁内登记空闲, 否则与schedule之间存在窗口, tickle看不到空闲线程而丢失唤醒
+            if (!task.m_fiber && !task.m_cb) {
+                ++m_idleThreadCount;
+            }
         }
 
         if (tickle_me) {
@@ -171,9 +340,9 @@ void Scheduler::run() {
         } else {
             if (idle_fiber->getState() == Fiber::TERM) {
                 SYLAR_LOG_DEBUG(g_logger) << "idle fiber term";
+                --m_idleThreadCount;
                 break;
             }
-            ++m_idleThreadCount;
             idle_fiber->resume();
             --m_idleThreadCount;
         }
@@ -2,6 +2,8 @@
 
 #include <list>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "fiber.h"
 #include "thread.h"
@@ -14,8 +16,39 @@ public:
     using ptr = std::shared_ptr<Scheduler>;
     using MutexType = Mutex;
 
+    // 工作线程的放置策略, 只作用于start()创建的线程, use_caller时调用线程不受影响
+    struct Placement {
+        // 可用的CPU, 工作线程按序号轮流绑定到其中一个; 为空时不绑定
+        std::vector<int> m_cpus;
+        // 工作线程之后的内存分配(协程栈、任务队列)优先放在所绑定CPU的NUMA节点
+        bool m_numaBind = false;
+        // 第0个工作线程(reactor)独占m_cpus[0], 其他工作线程轮流使用其余的CPU
+        bool m_isolateReactor = false;
+
+        bool operator==(const Placement &rhs) const {
+            return m_cpus == rhs.m_cpus && m_numaBind == rhs.m_numaBind && m_isolateReactor == rhs.m_isolateReactor;
+        }
+
+        // 配置scheduler.placement中该名称的策略, 没有时使用default项
+        static Placement FromConfig(const std::string &name);
+    };
+
+    struct WorkerInfo {
+        std::string m_name;
+        pid_t m_threadId = -1;
+        // 绑定的CPU和NUMA节点, -1表示未绑定
+        int m_cpu = -1;
+        int m_node = -1;
+        bool m_reactor = false;
+        // 查询时的实际状态: 允许运行的CPU和最近一次运行所在的CPU
+        std::vector<int> m_allowedCpus;
+        int m_lastCpu = -1;
+    };
+
     Scheduler(size_t threads = 1, bool use_caller = true, const std::string &name = "Scheduler");
 
+    Scheduler(size_t threads, bool use_caller, const std::string &name, const Placement &placement);
+
     virtual ~Scheduler();
 
     const std::string &getName() const { return m_name; }
@@ -42,6 +75,28 @@ public:
 
     void stop();
 
+    const Placement &getPlacement() const { return m_placement; }
+
+    // start()创建的工作线程的放置情况, 用于确认线上的实际布局
+    std::vector<WorkerInfo> getWorkerInfos();
+
+    std::string dumpPlacement();
+
+    // 协程挂起等待外部线程(如OffloadPool)把它重新schedule时计数, 计数归零前stop()不会返回
+    void addPending() { ++m_pendingCount; }
+
+    // 重新schedule由addPending登记的协程并注销计数, 返回后不能再访问调度器
+    template <typename FiberOrCb>
+    void schedulePending(FiberOrCb fc, int threadId = -1) {
+        MutexType::Lock lock{m_mutex};
+        bool need_tickle = scheduleNoLock(fc, threadId);
+        --m_pendingCount;
+        // 在锁内tickle: 解锁前stopping()不会成立, 调度器不会被销毁
+        if (need_tickle) {
+            tickle();
+        }
+    }
+
 protected:
     virtual void tickle();
 
@@ -55,6 +110,10 @@ protected:
 
     bool hasIdleThreads() { return m_idleThreadCount > 0; }
 
+private:
+    // 在第index个工作线程上执行, 绑定CPU和NUMA内存策略
+    void applyPlacement(size_t index);
+
 private:
     template <typename FiberOrCb>
     bool scheduleNoLock(FiberOrCb fc, int threadId) {
@@ -91,11 +150,14 @@ private:
     std::string m_name;
     MutexType m_mutex;
     std::vector<Thread::ptr> m_threads;
+    Placement m_placement;
+    std::vector<WorkerInfo> m_workers;
     std::list<ScheduleTask> m_tasks;
     std::vector<int> m_threadIds;
     size_t m_threadCount{0};
     std::atomic<size_t> m_activeThreadCount{0};
     std::atomic<size_t> m_idleThreadCount{0};
+    std::atomic<size_t> m_pendingCount{0};
 
     bool m_useCaller;
     Fiber::ptr m_rootFiber;
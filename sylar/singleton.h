@@ -3,7 +3,8 @@
 #include <memory>
 
 namespace sylar {
-namespace {
+
+// 不能放在匿名命名空间中, 否则每个编译单元各有一份实例
 
 template <typename T, typename X, int N>
 T &GetInstanceX() {
@@ -35,5 +36,4 @@ public:
     }
 };
 
-}  // namespace
 }  // namespace sylar
\ No newline at end of file
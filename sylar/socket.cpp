@@ -0,0 +1,623 @@
+#include "socket.h"
+#include <sys/sendfile.h>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include "fd_manager.h"
+#include "hook.h"
+#include "iomanager.h"
+#include "log.h"
+#include "log_limit.h"
+#include "macro.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+Socket::ptr Socket::CreateTCP(const Address::ptr &address) {
+    return std::make_shared<Socket>(address->getFamily(), TCP, 0);
+}
+
+Socket::ptr Socket::CreateUDP(const Address::ptr &address) {
+    Socket::ptr sock = std::make_shared<Socket>(address->getFamily(), UDP, 0);
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket() { return std::make_shared<Socket>(IPv4, TCP, 0); }
+
+Socket::ptr Socket::CreateUDPSocket() {
+    Socket::ptr sock = std::make_shared<Socket>(IPv4, UDP, 0);
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket6() { return std::make_shared<Socket>(IPv6, TCP, 0); }
+
+Socket::ptr Socket::CreateUDPSocket6() {
+    Socket::ptr sock = std::make_shared<Socket>(IPv6, UDP, 0);
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixTCPSocket() { return std::make_shared<Socket>(UNIX, TCP, 0); }
+
+Socket::ptr Socket::CreateUnixUDPSocket() {
+    Socket::ptr sock = std::make_shared<Socket>(UNIX, UDP, 0);
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+bool Socket::CreateUnixPair(Socket::ptr &first, Socket::ptr &second, int type) {
+    int fds[2];
+    if (::socketpair(AF_UNIX, type | SOCK_CLOEXEC, 0, fds)) {
+        SYLAR_LOG_ERROR(g_logger) << "socketpair(AF_UNIX, " << type << ") errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        return false;
+    }
+    FdMgr::GetInstance()->attach(fds[0]);
+    FdMgr::GetInstance()->attach(fds[1]);
+    first = std::make_shared<Socket>(UNIX, type, 0);
+    second = std::make_shared<Socket>(UNIX, type, 0);
+    if (first->init(fds[0]) && second->init(fds[1])) {
+        return true;
+    }
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return false;
+}
+
+Socket::ptr Socket::FromFd(int fd) {
+    int family = 0;
+    int type = 0;
+    int protocol = 0;
+    socklen_t len = sizeof(int);
+    if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &family, &len) || getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) ||
+        getsockopt(fd, SOL_SOCKET, SO_PROTOCOL, &protocol, &len)) {
+        SYLAR_LOG_ERROR(g_logger) << "FromFd(" << fd << ") errno=" << errno << " errstr=" << strerror(errno);
+        return nullptr;
+    }
+    Socket::ptr sock = std::make_shared<Socket>(family, type, protocol);
+    return sock->init(fd) ? sock : nullptr;
+}
+
+Socket::Socket(int family, int type, int protocol)
+    : m_sock{-1}, m_family{family}, m_type{type}, m_protocol{protocol}, m_isConnected{false} {}
+
+Socket::~Socket() { close(); }
+
+uint64_t Socket::getSendTimeout() const {
+    FdCtx *ctx = FdMgr::GetInstance()->get(m_sock);
+    return ctx ? ctx->getTimeout(SO_SNDTIMEO) : std::numeric_limits<uint64_t>::max();
+}
+
+void Socket::setSendTimeout(uint64_t timeoutMs) {
+    if (FdCtx *ctx = FdMgr::GetInstance()->get(m_sock)) {
+        ctx->setTimeout(SO_SNDTIMEO, timeoutMs);
+    }
+}
+
+uint64_t Socket::getRecvTimeout() const {
+    FdCtx *ctx = FdMgr::GetInstance()->get(m_sock);
+    return ctx ? ctx->getTimeout(SO_RCVTIMEO) : std::numeric_limits<uint64_t>::max();
+}
+
+void Socket::setRecvTimeout(uint64_t timeoutMs) {
+    if (FdCtx *ctx = FdMgr::GetInstance()->get(m_sock)) {
+        ctx->setTimeout(SO_RCVTIMEO, timeoutMs);
+    }
+}
+
+bool Socket::getOption(int level, int option, void *result, socklen_t *len) const {
+    int ret = getsockopt(m_sock, level, option, result, len);
+    if (ret) {
+        SYLAR_LOG_DEBUG(g_logger) << "getOption sock=" << m_sock << " level=" << level << " option=" << option
+                                  << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setOption(int level, int option, const void *value, socklen_t len) {
+    if (setsockopt(m_sock, level, option, value, len)) {
+        SYLAR_LOG_DEBUG(g_logger) << "setOption sock=" << m_sock << " level=" << level << " option=" << option
+                                  << " errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setNoDelay(bool on) {
+    int val = on;
+    return setOption(IPPROTO_TCP, TCP_NODELAY, val);
+}
+
+bool Socket::setReusePort(bool on) {
+    if (!isValid()) {
+        newSock();
+        if (SYLAR_UNLIKELY(!isValid())) {
+            return false;
+        }
+    }
+    int val = on;
+    return setOption(SOL_SOCKET, SO_REUSEPORT, val);
+}
+
+bool Socket::setKeepAlive(bool on, int idleSec, int intervalSec, int count) {
+    int val = on;
+    if (!setOption(SOL_SOCKET, SO_KEEPALIVE, val)) {
+        return false;
+    }
+    if (!on) {
+        return true;
+    }
+    return (idleSec <= 0 || setOption(IPPROTO_TCP, TCP_KEEPIDLE, idleSec)) &&
+           (intervalSec <= 0 || setOption(IPPROTO_TCP, TCP_KEEPINTVL, intervalSec)) &&
+           (count <= 0 || setOption(IPPROTO_TCP, TCP_KEEPCNT, count));
+}
+
+Socket::ptr Socket::accept() {
+    int newSock = ::accept(m_sock, nullptr, nullptr);
+    if (newSock == -1) {
+        // fd耗尽时调用方会反复重试, 限流日志; errno留给调用方判断
+        int err = errno;
+        SYLAR_LOG_LIMIT_ERROR(g_logger) << "accept(" << m_sock << ") errno=" << err << " errstr=" << strerror(err);
+        errno = err;
+        return nullptr;
+    }
+
+    Socket::ptr sock = std::make_shared<Socket>(m_family, m_type, m_protocol);
+    if (sock->init(newSock)) {
+        return sock;
+    }
+    ::close(newSock);
+    return nullptr;
+}
+
+bool Socket::init(int sock) {
+    FdCtx *ctx = FdMgr::GetInstance()->get(sock, true);
+    if (ctx && ctx->isSocket() && !ctx->isClose()) {
+        m_sock = sock;
+        m_isConnected = true;
+        initSock();
+        getLocalAddress();
+        getRemoteAddress();
+        return true;
+    }
+    return false;
+}
+
+bool Socket::bind(const Address::ptr &addr) {
+    if (!isValid()) {
+        newSock();
+        if (SYLAR_UNLIKELY(!isValid())) {
+            return false;
+        }
+    }
+
+    if (SYLAR_UNLIKELY(addr->getFamily() != m_family)) {
+        SYLAR_LOG_ERROR(g_logger) << "bind sock.family(" << m_family << ") addr.family(" << addr->getFamily()
+                                  << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    // 残留的unix socket文件: 用同类型的非阻塞socket探测, 只有ECONNREFUSED(没有进程在监听)时才删除
+    // 连接队列满(EAGAIN)等其他错误不删除, 交给bind报错
+    if (UnixAddress::ptr uaddr = std::dynamic_pointer_cast<UnixAddress>(addr)) {
+        std::string path = uaddr->getPath();
+        if (!path.empty() && path[0] != '\0') {
+            int probe = socket_f(AF_UNIX, m_type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (probe != -1) {
+                int rt = connect_f(probe, uaddr->getAddr(), uaddr->getAddrLen());
+                int err = errno;
+                close_f(probe);
+                if (rt == 0) {
+                    SYLAR_LOG_ERROR(g_logger) << "bind " << path << " is in use";
+                    return false;
+                }
+                if (err == ECONNREFUSED) {
+                    FSUtil::Unlink(path, true);
+                }
+            }
+        }
+    }
+
+    if (::bind(m_sock, addr->getAddr(), addr->getAddrLen())) {
+        SYLAR_LOG_ERROR(g_logger) << "bind " << addr->toString() << " error errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        return false;
+    }
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::reconnect(uint64_t timeoutMs) {
+    if (!m_remoteAddress) {
+        SYLAR_LOG_ERROR(g_logger) << "reconnect m_remoteAddress is null";
+        return false;
+    }
+    m_localAddress.reset();
+    return connect(m_remoteAddress, timeoutMs);
+}
+
+bool Socket::connect(const Address::ptr &addr, uint64_t timeoutMs) {
+    m_remoteAddress = addr;
+    if (!isValid()) {
+        newSock();
+        if (SYLAR_UNLIKELY(!isValid())) {
+            return false;
+        }
+    }
+
+    if (SYLAR_UNLIKELY(addr->getFamily() != m_family)) {
+        SYLAR_LOG_ERROR(g_logger) << "connect sock.family(" << m_family << ") addr.family(" << addr->getFamily()
+                                  << ") not equal, addr=" << addr->toString();
+        return false;
+    }
+
+    int ret = timeoutMs == std::numeric_limits<uint64_t>::max()
+                  ? ::connect(m_sock, addr->getAddr(), addr->getAddrLen())
+                  : ::connect_with_timeout(m_sock, addr->getAddr(), addr->getAddrLen(), timeoutMs);
+    if (ret) {
+        SYLAR_LOG_ERROR(g_logger) << "sock=" << m_sock << " connect(" << addr->toString()
+                                  << ") timeout=" << timeoutMs << " error errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        close();
+        return false;
+    }
+
+    m_isConnected = true;
+    getRemoteAddress();
+    getLocalAddress();
+    return true;
+}
+
+bool Socket::listen(int backlog) {
+    if (!isValid()) {
+        SYLAR_LOG_ERROR(g_logger) << "listen error sock=-1";
+        return false;
+    }
+    if (::listen(m_sock, backlog)) {
+        SYLAR_LOG_ERROR(g_logger) << "listen error errno=" << errno << " errstr=" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool Socket::close() {
+    if (!m_isConnected && m_sock == -1) {
+        return true;
+    }
+    m_isConnected = false;
+    if (m_sock != -1) {
+        ::close(m_sock);
+        m_sock = -1;
+    }
+    return true;
+}
+
+ssize_t Socket::send(const void *buffer, size_t length, int flags) {
+    if (isConnected()) {
+        return ::send(m_sock, buffer, length, flags);
+    }
+    return -1;
+}
+
+ssize_t Socket::sendv(const iovec *buffers, size_t count, int flags) {
+    if (isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = const_cast<iovec *>(buffers);
+        msg.msg_iovlen = count;
+        return ::sendmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+ssize_t Socket::sendTo(const void *buffer, size_t length, const Address::ptr &to, int flags) {
+    if (isConnected()) {
+        return ::sendto(m_sock, buffer, length, flags, to->getAddr(), to->getAddrLen());
+    }
+    return -1;
+}
+
+ssize_t Socket::recv(void *buffer, size_t length, int flags) {
+    if (isConnected()) {
+        return ::recv(m_sock, buffer, length, flags);
+    }
+    return -1;
+}
+
+ssize_t Socket::recvv(iovec *buffers, size_t count, int flags) {
+    if (isConnected()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = buffers;
+        msg.msg_iovlen = count;
+        return ::recvmsg(m_sock, &msg, flags);
+    }
+    return -1;
+}
+
+int Socket::recvMulti(mmsghdr *msgs, size_t count, int flags) {
+    if (isConnected()) {
+        return ::recvmmsg(m_sock, msgs, count, flags, nullptr);
+    }
+    return -1;
+}
+
+int Socket::sendMulti(mmsghdr *msgs, size_t count, int flags) {
+    if (isConnected()) {
+        return ::sendmmsg(m_sock, msgs, count, flags);
+    }
+    return -1;
+}
+
+ssize_t Socket::sendFile(int fd, off_t offset, size_t length) {
+    if (!isConnected()) {
+        return -1;
+    }
+    size_t total = 0;
+    bool fallback = false;
+    std::vector<char> buffer;
+    while (total < length) {
+        size_t count = std::min<size_t>(length - total, 0x7ffff000);
+        ssize_t n = -1;
+        if (!fallback) {
+            // EAGAIN由hook挂起当前协程
+            n = ::sendfile(m_sock, fd, &offset, count);
+            if (n == -1 && (errno == EINVAL || errno == ENOSYS) && total == 0) {
+                fallback = true;
+                continue;
+            }
+        } else {
+            // 协程栈较小, 缓冲区放在堆上
+            buffer.resize(64 * 1024);
+            n = ::pread(fd, buffer.data(), std::min(count, buffer.size()), offset);
+            if (n > 0) {
+                // 部分发送时只前移实际发出的字节, 剩余部分下一轮重新读取
+                n = ::send(m_sock, buffer.data(), n, MSG_NOSIGNAL);
+                if (n > 0) {
+                    offset += n;
+                }
+            }
+        }
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            return total ? static_cast<ssize_t>(total) : -1;
+        }
+        total += n;
+    }
+    return total;
+}
+
+ssize_t Socket::sendFds(const void *buffer, size_t length, const std::vector<int> &fds, bool withCred, int flags) {
+    if (!isConnected()) {
+        return -1;
+    }
+    iovec iov{const_cast<void *>(buffer), length};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    size_t fdsLen = fds.size() * sizeof(int);
+    std::vector<char> control((fds.empty() ? 0 : CMSG_SPACE(fdsLen)) + (withCred ? CMSG_SPACE(sizeof(ucred)) : 0));
+    if (!control.empty()) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+        if (!fds.empty()) {
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_RIGHTS;
+            cm->cmsg_len = CMSG_LEN(fdsLen);
+            memcpy(CMSG_DATA(cm), fds.data(), fdsLen);
+            cm = CMSG_NXTHDR(&msg, cm);
+        }
+        if (withCred) {
+            ucred cred{getpid(), getuid(), getgid()};
+            cm->cmsg_level = SOL_SOCKET;
+            cm->cmsg_type = SCM_CREDENTIALS;
+            cm->cmsg_len = CMSG_LEN(sizeof(ucred));
+            memcpy(CMSG_DATA(cm), &cred, sizeof(cred));
+        }
+    }
+    return ::sendmsg(m_sock, &msg, flags | MSG_NOSIGNAL);
+}
+
+ssize_t Socket::recvFds(void *buffer, size_t length, std::vector<int> &fds, ucred *cred, int flags) {
+    if (!isConnected()) {
+        return -1;
+    }
+    iovec iov{buffer, length};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    // 内核单条消息最多传递SCM_MAX_FD(253)个fd
+    union {
+        cmsghdr m_align;
+        char m_buf[CMSG_SPACE(sizeof(int) * 253) + CMSG_SPACE(sizeof(ucred))];
+    } control;
+    msg.msg_control = control.m_buf;
+    msg.msg_controllen = sizeof(control.m_buf);
+    if (cred) {
+        *cred = ucred{0, static_cast<uid_t>(-1), static_cast<gid_t>(-1)};
+    }
+
+    ssize_t n = ::recvmsg(m_sock, &msg, flags | MSG_CMSG_CLOEXEC);
+    if (n < 0) {
+        return n;
+    }
+    size_t first = fds.size();
+    for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cm->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const char *data = reinterpret_cast<const char *>(CMSG_DATA(cm));
+            for (size_t i = 0; i < count; ++i) {
+                int fd;
+                memcpy(&fd, data + i * sizeof(int), sizeof(int));
+                fds.push_back(fd);
+            }
+        } else if (cm->cmsg_type == SCM_CREDENTIALS && cred) {
+            memcpy(cred, CMSG_DATA(cm), sizeof(ucred));
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC) {
+        for (size_t i = first; i < fds.size(); ++i) {
+            ::close(fds[i]);
+        }
+        fds.resize(first);
+        errno = EMSGSIZE;
+        return -1;
+    }
+    // 收到的socket与本进程创建的一样交给hook管理
+    for (size_t i = first; i < fds.size(); ++i) {
+        FdMgr::GetInstance()->attach(fds[i]);
+    }
+    return n;
+}
+
+bool Socket::setPassCred(bool on) {
+    int val = on;
+    return setOption(SOL_SOCKET, SO_PASSCRED, val);
+}
+
+bool Socket::getPeerCred(ucred &cred) const { return getOption(SOL_SOCKET, SO_PEERCRED, cred); }
+
+ssize_t Socket::recvFrom(void *buffer, size_t length, Address::ptr &from, int flags) {
+    if (isConnected()) {
+        if (!from || from->getFamily() != m_family) {
+            from = newAddress();
+        }
+        socklen_t len = from->getAddrLen();
+        ssize_t n = ::recvfrom(m_sock, buffer, length, flags, from->getAddr(), &len);
+        if (n >= 0) {
+            // from可能是上次调用复用的地址, 内容已被内核改写
+            if (m_family == AF_UNIX) {
+                std::static_pointer_cast<UnixAddress>(from)->setAddrLen(len);
+            } else {
+                from->resetString();
+            }
+        }
+        return n;
+    }
+    return -1;
+}
+
+Address::ptr Socket::newAddress() const {
+    switch (m_family) {
+        case AF_INET:
+            return std::make_shared<IPv4Address>();
+        case AF_INET6:
+            return std::make_shared<IPv6Address>();
+        case AF_UNIX:
+            return std::make_shared<UnixAddress>();
+        default:
+            return std::make_shared<UnknownAddress>(m_family);
+    }
+}
+
+const Address::ptr &Socket::getRemoteAddress() {
+    if (m_remoteAddress || !isValid()) {
+        return m_remoteAddress;
+    }
+
+    Address::ptr result = newAddress();
+    socklen_t addrlen = result->getAddrLen();
+    if (getpeername(m_sock, result->getAddr(), &addrlen)) {
+        return m_remoteAddress;
+    }
+    if (m_family == AF_UNIX) {
+        std::static_pointer_cast<UnixAddress>(result)->setAddrLen(addrlen);
+    }
+    m_remoteAddress = result;
+    return m_remoteAddress;
+}
+
+const Address::ptr &Socket::getLocalAddress() {
+    if (m_localAddress || !isValid()) {
+        return m_localAddress;
+    }
+
+    Address::ptr result = newAddress();
+    socklen_t addrlen = result->getAddrLen();
+    if (getsockname(m_sock, result->getAddr(), &addrlen)) {
+        SYLAR_LOG_ERROR(g_logger) << "getsockname error sock=" << m_sock << " errno=" << errno
+                                  << " errstr=" << strerror(errno);
+        return m_localAddress;
+    }
+    if (m_family == AF_UNIX) {
+        std::static_pointer_cast<UnixAddress>(result)->setAddrLen(addrlen);
+    }
+    m_localAddress = result;
+    return m_localAddress;
+}
+
+int Socket::getError() const {
+    int error = 0;
+    if (!getOption(SOL_SOCKET, SO_ERROR, error)) {
+        error = errno;
+    }
+    return error;
+}
+
+std::ostream &Socket::dump(std::ostream &os) const {
+    os << "[Socket sock=" << m_sock << " is_connected=" << m_isConnected << " family=" << m_family
+       << " type=" << m_type << " protocol=" << m_protocol;
+    if (m_localAddress) {
+        os << " local_address=" << m_localAddress->toString();
+    }
+    if (m_remoteAddress) {
+        os << " remote_address=" << m_remoteAddress->toString();
+    }
+    return os << "]";
+}
+
+std::string Socket::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+bool Socket::cancelRead() { return IOManager::GetThis()->cancelEvent(m_sock, IOManager::READ); }
+
+bool Socket::cancelWrite() { return IOManager::GetThis()->cancelEvent(m_sock, IOManager::WRITE); }
+
+bool Socket::cancelAccept() { return IOManager::GetThis()->cancelEvent(m_sock, IOManager::READ); }
+
+bool Socket::cancelAll() { return IOManager::GetThis()->cancelAll(m_sock); }
+
+void Socket::initSock() {
+    int val = 1;
+    setOption(SOL_SOCKET, SO_REUSEADDR, val);
+    if (m_type == SOCK_STREAM && m_family != AF_UNIX) {
+        setOption(IPPROTO_TCP, TCP_NODELAY, val);
+    }
+}
+
+void Socket::newSock() {
+    m_sock = ::socket(m_family, m_type, m_protocol);
+    if (SYLAR_LIKELY(m_sock != -1)) {
+        // 未开启hook的线程创建的socket也登记到fd表, 之后交给IOManager使用时不会阻塞工作线程
+        FdMgr::GetInstance()->attach(m_sock);
+        initSock();
+    } else {
+        SYLAR_LOG_ERROR(g_logger) << "socket(" << m_family << ", " << m_type << ", " << m_protocol
+                                  << ") errno=" << errno << " errstr=" << strerror(errno);
+    }
+}
+
+std::ostream &operator<<(std::ostream &os, const Socket &sock) { return sock.dump(os); }
+
+}  // namespace sylar
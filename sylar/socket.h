@@ -0,0 +1,195 @@
+#pragma once
+
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "address.h"
+#include "noncopyable.h"
+
+namespace sylar {
+
+// 基于hook的socket封装, 在IOManager的协程中使用时阻塞调用会自动让出
+// I/O接口只使用fd与调用方传入的引用, 共享的Socket对象不会在每次调用时增减引用计数
+class Socket : public std::enable_shared_from_this<Socket>, Noncopyable {
+public:
+    using ptr = std::shared_ptr<Socket>;
+    using weak_ptr = std::weak_ptr<Socket>;
+
+    enum Type {
+        TCP = SOCK_STREAM,
+        UDP = SOCK_DGRAM,
+    };
+
+    enum Family {
+        IPv4 = AF_INET,
+        IPv6 = AF_INET6,
+        UNIX = AF_UNIX,
+    };
+
+    // 与address的地址族一致的socket
+    static Socket::ptr CreateTCP(const Address::ptr &address);
+
+    static Socket::ptr CreateUDP(const Address::ptr &address);
+
+    static Socket::ptr CreateTCPSocket();
+
+    static Socket::ptr CreateUDPSocket();
+
+    static Socket::ptr CreateTCPSocket6();
+
+    static Socket::ptr CreateUDPSocket6();
+
+    static Socket::ptr CreateUnixTCPSocket();
+
+    static Socket::ptr CreateUnixUDPSocket();
+
+    // socketpair创建一对互相连接的unix socket, 都已登记到fd表
+    static bool CreateUnixPair(Socket::ptr &first, Socket::ptr &second, int type = TCP);
+
+    // 接管已打开的socket fd(如通过SCM_RIGHTS收到的监听socket), 地址族与类型从fd查询; 失败时不关闭fd
+    static Socket::ptr FromFd(int fd);
+
+    Socket(int family, int type, int protocol = 0);
+
+    virtual ~Socket();
+
+    // 超时时间(ms)直接记录在fd表的槽位中, 由hook的do_io使用; max表示不超时
+    uint64_t getSendTimeout() const;
+
+    void setSendTimeout(uint64_t timeoutMs);
+
+    uint64_t getRecvTimeout() const;
+
+    void setRecvTimeout(uint64_t timeoutMs);
+
+    bool getOption(int level, int option, void *result, socklen_t *len) const;
+
+    template <typename T>
+    bool getOption(int level, int option, T &result) const {
+        socklen_t length = sizeof(T);
+        return getOption(level, option, &result, &length);
+    }
+
+    bool setOption(int level, int option, const void *value, socklen_t len);
+
+    template <typename T>
+    bool setOption(int level, int option, const T &value) {
+        return setOption(level, option, &value, sizeof(T));
+    }
+
+    bool setNoDelay(bool on);
+
+    // SO_REUSEPORT须在bind之前设置, 还没有fd时先创建
+    bool setReusePort(bool on);
+
+    // idle/interval/count为0时使用系统默认值
+    bool setKeepAlive(bool on, int idleSec = 0, int intervalSec = 0, int count = 0);
+
+    virtual Socket::ptr accept();
+
+    virtual bool bind(const Address::ptr &addr);
+
+    // timeoutMs为max时使用tcp.connect.timeout配置
+    virtual bool connect(const Address::ptr &addr, uint64_t timeoutMs = std::numeric_limits<uint64_t>::max());
+
+    virtual bool reconnect(uint64_t timeoutMs = std::numeric_limits<uint64_t>::max());
+
+    virtual bool listen(int backlog = SOMAXCONN);
+
+    virtual bool close();
+
+    virtual ssize_t send(const void *buffer, size_t length, int flags = 0);
+
+    virtual ssize_t sendv(const iovec *buffers, size_t count, int flags = 0);
+
+    virtual ssize_t sendTo(const void *buffer, size_t length, const Address::ptr &to, int flags = 0);
+
+    virtual ssize_t recv(void *buffer, size_t length, int flags = 0);
+
+    virtual ssize_t recvv(iovec *buffers, size_t count, int flags = 0);
+
+    virtual ssize_t recvFrom(void *buffer, size_t length, Address::ptr &from, int flags = 0);
+
+    // recvmmsg/sendmmsg, 一次系统调用收发多个数据报; 返回消息数, 每条消息的字节数在msg_len中
+    virtual int recvMulti(mmsghdr *msgs, size_t count, int flags = 0);
+
+    virtual int sendMulti(mmsghdr *msgs, size_t count, int flags = 0);
+
+    // 用sendfile把文件fd从offset起的length字节发出, 处理部分发送; 文件不支持sendfile时退回pread+send
+    // 返回发出的字节数, 文件提前结束时小于length; 出错且一个字节都没发出时返回-1
+    virtual ssize_t sendFile(int fd, off_t offset, size_t length);
+
+    // 以下用于unix socket
+    // 随数据用SCM_RIGHTS发送fds, withCred时附带本进程的SCM_CREDENTIALS; 流式socket上length不能为0
+    virtual ssize_t sendFds(const void *buffer, size_t length, const std::vector<int> &fds, bool withCred = false,
+                            int flags = 0);
+
+    // 接收数据与随附的fd, 收到的fd带CLOEXEC并已登记到fd表, 由调用方负责关闭
+    // cred非空时取出对端凭证(需先setPassCred); 控制消息被截断时关闭收到的fd, 返回-1且errno为EMSGSIZE
+    virtual ssize_t recvFds(void *buffer, size_t length, std::vector<int> &fds, ucred *cred = nullptr,
+                            int flags = 0);
+
+    // SO_PASSCRED, 开启后recvFds才能取到对端凭证
+    bool setPassCred(bool on);
+
+    // SO_PEERCRED, 建立连接时对端进程的pid/uid/gid
+    bool getPeerCred(ucred &cred) const;
+
+    const Address::ptr &getRemoteAddress();
+
+    const Address::ptr &getLocalAddress();
+
+    int getFamily() const { return m_family; }
+
+    int getType() const { return m_type; }
+
+    int getProtocol() const { return m_protocol; }
+
+    bool isConnected() const { return m_isConnected; }
+
+    bool isValid() const { return m_sock != -1; }
+
+    int getError() const;
+
+    virtual std::ostream &dump(std::ostream &os) const;
+
+    virtual std::string toString() const;
+
+    int getSocket() const { return m_sock; }
+
+    bool cancelRead();
+
+    bool cancelWrite();
+
+    bool cancelAccept();
+
+    bool cancelAll();
+
+protected:
+    void initSock();
+
+    void newSock();
+
+    // 接管accept得到的fd
+    virtual bool init(int sock);
+
+    Address::ptr newAddress() const;
+
+protected:
+    int m_sock;
+    int m_family;
+    int m_type;
+    int m_protocol;
+    bool m_isConnected;
+    Address::ptr m_localAddress;
+    Address::ptr m_remoteAddress;
+};
+
+std::ostream &operator<<(std::ostream &os, const Socket &sock);
+
+}  // namespace sylar
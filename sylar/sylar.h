@@ -1,16 +1,27 @@
 #pragma once
 
+#include "address.h"
+#include "binlog.h"
+#include "bytearray.h"
 #include "config.h"
+#include "config_watcher.h"
 #include "env.h"
 #include "fd_manager.h"
 #include "fiber.h"
 #include "hook.h"
 #include "iomanager.h"
 #include "log.h"
+#include "log_limit.h"
 #include "macro.h"
 #include "mutex.h"
 #include "noncopyable.h"
+#include "offload.h"
+#include "rcu.h"
 #include "scheduler.h"
 #include "singleton.h"
+#include "socket.h"
+#include "tcp_server.h"
 #include "thread.h"
-#include "util.h"
\ No newline at end of file
+#include "udp_server.h"
+#include "util.h"
+#include "zerocopy.h"
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "tcp_server.h"
+#include <algorithm>
+#include <sstream>
+#include "config.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint64_t>::ptr g_tcp_server_read_timeout =
+    sylar::Config::Lookup("tcp_server.read_timeout", static_cast<uint64_t>(60 * 1000 * 2), "tcp server read timeout");
+
+static sylar::ConfigVar<uint32_t>::ptr g_tcp_server_max_connections =
+    sylar::Config::Lookup("tcp_server.max_connections", static_cast<uint32_t>(0), "tcp server max connections");
+
+static sylar::ConfigVar<uint32_t>::ptr g_tcp_server_acceptors =
+    sylar::Config::Lookup("tcp_server.acceptors", static_cast<uint32_t>(1), "tcp server listeners per address");
+
+// accept因fd或内存耗尽失败后暂停的时间范围
+static constexpr uint64_t ACCEPT_BACKOFF_MIN_MS = 10;
+static constexpr uint64_t ACCEPT_BACKOFF_MAX_MS = 1000;
+
+TcpServer::TcpServer(IOManager *worker, IOManager *acceptWorker)
+    : TcpServer{std::vector<IOManager *>{worker}, acceptWorker} {}
+
+TcpServer::TcpServer(const std::vector<IOManager *> &workers, IOManager *acceptWorker)
+    : m_name{"sylar/1.0.0"},
+      m_acceptWorker{acceptWorker},
+      m_recvTimeout{g_tcp_server_read_timeout->getValue()},
+      m_maxConnections{g_tcp_server_max_connections->getValue()},
+      m_acceptors{std::max<uint32_t>(g_tcp_server_acceptors->getValue(), 1)} {
+    SYLAR_ASSERT(!workers.empty() && acceptWorker);
+    for (auto *iom : workers) {
+        SYLAR_ASSERT(iom);
+        m_workers.emplace_back(new Worker);
+        m_workers.back()->m_iom = iom;
+    }
+}
+
+TcpServer::~TcpServer() {
+    for (auto &sock : m_socks) {
+        sock->close();
+    }
+    m_socks.clear();
+}
+
+bool TcpServer::bind(const Address::ptr &addr) {
+    std::vector<Address::ptr> addrs;
+    std::vector<Address::ptr> fails;
+    addrs.push_back(addr);
+    return bind(addrs, fails);
+}
+
+bool TcpServer::bind(const std::vector<Address::ptr> &addrs, std::vector<Address::ptr> &fails) {
+    for (const auto &addr : addrs) {
+        // 端口为0时由第一个socket确定实际端口, 其余socket绑定到同一端口
+        Address::ptr bindAddr = addr;
+        for (uint32_t i = 0; i < m_acceptors; ++i) {
+            Socket::ptr sock = Socket::CreateTCP(bindAddr);
+            if (m_acceptors > 1 && !sock->setReusePort(true)) {
+                SYLAR_LOG_ERROR(g_logger) << "setReusePort fail errno=" << errno << " errstr=" << strerror(errno);
+            }
+            if (!sock->bind(bindAddr)) {
+                SYLAR_LOG_ERROR(g_logger) << "bind fail errno=" << errno << " errstr=" << strerror(errno)
+                                          << " addr=[" << addr->toString() << "]";
+                fails.push_back(addr);
+                break;
+            }
+            if (!sock->listen()) {
+                SYLAR_LOG_ERROR(g_logger) << "listen fail errno=" << errno << " errstr=" << strerror(errno)
+                                          << " addr=[" << addr->toString() << "]";
+                fails.push_back(addr);
+                break;
+            }
+            bindAddr = sock->getLocalAddress();
+            m_socks.push_back(sock);
+        }
+    }
+
+    if (!fails.empty()) {
+        for (auto &sock : m_socks) {
+            sock->close();
+        }
+        m_socks.clear();
+        return false;
+    }
+
+    for (const auto &sock : m_socks) {
+        SYLAR_LOG_INFO(g_logger) << "server " << m_name << " bind success: " << *sock;
+    }
+    return true;
+}
+
+bool TcpServer::start() {
+    if (!m_isStop) {
+        return true;
+    }
+    m_isStop = false;
+    for (const auto &sock : m_socks) {
+        m_acceptWorker->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), sock));
+    }
+    return true;
+}
+
+void TcpServer::startAccept(Socket::ptr sock) {
+    while (!m_isStop) {
+        {
+            // 先预留名额再accept, 多个acceptor并发时也不会超过上限
+            MutexType::Lock lock{m_mutex};
+            if (m_maxConnections && m_connections >= m_maxConnections) {
+                m_paused.push_back(sock);
+                return;
+            }
+            ++m_connections;
+        }
+
+        Socket::ptr client = sock->accept();
+        if (!client) {
+            int err = errno;
+            release();
+            if (m_isStop || !sock->isValid()) {
+                break;
+            }
+            // fd或内存耗尽时连接仍在监听队列中, 立即重试只会空转; 暂停该acceptor, 等待时间逐次翻倍
+            if (err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM) {
+                uint64_t delay = std::min(std::max<uint64_t>(m_acceptBackoff * 2, ACCEPT_BACKOFF_MIN_MS),
+                                          ACCEPT_BACKOFF_MAX_MS);
+                m_acceptBackoff = delay;
+                m_acceptWorker->addTimer(delay, std::bind(&TcpServer::startAccept, shared_from_this(), sock));
+                return;
+            }
+            continue;
+        }
+
+        if (m_acceptBackoff.load(std::memory_order_relaxed)) {
+            m_acceptBackoff = 0;
+        }
+        ++m_accepted;
+        client->setRecvTimeout(m_recvTimeout);
+        dispatch(client);
+    }
+}
+
+TcpServer::Worker *TcpServer::selectWorker() {
+    if (m_workers.size() == 1) {
+        return m_workers[0].get();
+    }
+
+    if (m_balance == LEAST_CONNECTIONS) {
+        Worker *result = m_workers[0].get();
+        for (const auto &worker : m_workers) {
+            if (worker->m_connections.load(std::memory_order_relaxed) <
+                result->m_connections.load(std::memory_order_relaxed)) {
+                result = worker.get();
+            }
+        }
+        return result;
+    }
+    return m_workers[m_next.fetch_add(1, std::memory_order_relaxed) % m_workers.size()].get();
+}
+
+void TcpServer::dispatch(Socket::ptr client) {
+    Worker *worker = selectWorker();
+    ++worker->m_connections;
+    {
+        MutexType::Lock lock{m_mutex};
+        m_clients.insert(client);
+    }
+
+    worker->m_iom->schedule([self = shared_from_this(), client, worker]() {
+        self->handleClient(client);
+        {
+            // 先移出再close, stop不会shutdown已被复用的fd
+            MutexType::Lock lock{self->m_mutex};
+            self->m_clients.erase(client);
+        }
+        client->close();
+        --worker->m_connections;
+        self->release();
+    });
+}
+
+void TcpServer::release() {
+    std::vector<Socket::ptr> paused;
+    {
+        MutexType::Lock lock{m_mutex};
+        --m_connections;
+        if (!m_isStop) {
+            paused.swap(m_paused);
+        }
+    }
+
+    for (const auto &sock : paused) {
+        m_acceptWorker->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), sock));
+    }
+}
+
+uint32_t TcpServer::getConnections() {
+    MutexType::Lock lock{m_mutex};
+    return m_connections;
+}
+
+void TcpServer::handleClient(Socket::ptr client) { SYLAR_LOG_INFO(g_logger) << "handleClient: " << *client; }
+
+void TcpServer::stop(uint64_t drainTimeoutMs) {
+    if (m_isStop.exchange(true)) {
+        return;
+    }
+
+    // hook的close会取消监听socket上等待的accept, 使acceptor协程退出
+    auto self = shared_from_this();
+    m_acceptWorker->schedule([this, self]() {
+        for (auto &sock : m_socks) {
+            sock->close();
+        }
+        m_socks.clear();
+    });
+    {
+        MutexType::Lock lock{m_mutex};
+        m_paused.clear();
+    }
+
+    uint64_t deadline = GetCurrentMS() + drainTimeoutMs;
+    while (getConnections() > 0 && GetCurrentMS() < deadline) {
+        usleep(10 * 1000);
+    }
+
+    // shutdown而不是close: 处理协程仍持有fd, 读写会立即返回并自行结束
+    std::vector<Socket::ptr> clients;
+    {
+        MutexType::Lock lock{m_mutex};
+        clients.assign(m_clients.begin(), m_clients.end());
+    }
+    for (const auto &client : clients) {
+        ::shutdown(client->getSocket(), SHUT_RDWR);
+    }
+    if (!clients.empty()) {
+        SYLAR_LOG_INFO(g_logger) << "server " << m_name << " stop, shutdown " << clients.size()
+                                 << " connections after " << drainTimeoutMs << "ms";
+    }
+}
+
+std::string TcpServer::toString(const std::string &prefix) {
+    std::stringstream ss;
+    ss << prefix << "[name=" << m_name << " workers=" << m_workers.size() << " accept=" << m_acceptWorker->getName()
+       << " recv_timeout=" << m_recvTimeout << " max_connections=" << m_maxConnections
+       << " acceptors=" << m_acceptors << " balance=" << (m_balance == ROUND_ROBIN ? "round_robin" : "least_conn")
+       << " connections=" << getConnections() << " accepted=" << m_accepted << "]" << std::endl;
+    std::string pfx = prefix.empty() ? "    " : prefix;
+    for (const auto &sock : m_socks) {
+        ss << pfx << pfx << *sock << std::endl;
+    }
+    return ss.str();
+}
+
+}  // namespace sylar
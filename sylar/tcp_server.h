@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <set>
+#include <vector>
+#include "address.h"
+#include "iomanager.h"
+#include "noncopyable.h"
+#include "socket.h"
+
+namespace sylar {
+
+// 在acceptWorker上accept, 连接交给workers中的某个IOManager处理
+class TcpServer : public std::enable_shared_from_this<TcpServer>, Noncopyable {
+public:
+    using ptr = std::shared_ptr<TcpServer>;
+    using MutexType = Mutex;
+
+    enum Balance {
+        ROUND_ROBIN = 0,
+        LEAST_CONNECTIONS = 1,
+    };
+
+    TcpServer(IOManager *worker = IOManager::GetThis(), IOManager *acceptWorker = IOManager::GetThis());
+
+    TcpServer(const std::vector<IOManager *> &workers, IOManager *acceptWorker);
+
+    virtual ~TcpServer();
+
+    // 每个地址绑定getAcceptors()个SO_REUSEPORT监听socket, 各自在一个协程中accept
+    virtual bool bind(const Address::ptr &addr);
+
+    virtual bool bind(const std::vector<Address::ptr> &addrs, std::vector<Address::ptr> &fails);
+
+    virtual bool start();
+
+    // 停止accept并等待已建立的连接结束, 超过drainTimeoutMs后shutdown剩余连接
+    virtual void stop(uint64_t drainTimeoutMs = 0);
+
+    const std::string &getName() const { return m_name; }
+
+    void setName(const std::string &name) { m_name = name; }
+
+    uint64_t getRecvTimeout() const { return m_recvTimeout; }
+
+    void setRecvTimeout(uint64_t timeoutMs) { m_recvTimeout = timeoutMs; }
+
+    // 0表示不限制; 达到上限后暂停accept, 新连接在内核的backlog中排队
+    uint32_t getMaxConnections() const { return m_maxConnections; }
+
+    void setMaxConnections(uint32_t val) { m_maxConnections = val; }
+
+    uint32_t getAcceptors() const { return m_acceptors; }
+
+    void setAcceptors(uint32_t val) { m_acceptors = val ? val : 1; }
+
+    Balance getBalance() const { return m_balance; }
+
+    void setBalance(Balance balance) { m_balance = balance; }
+
+    bool isStop() const { return m_isStop; }
+
+    // 正在处理的连接数, 包括正在accept的预留名额
+    uint32_t getConnections();
+
+    uint64_t getAccepted() const { return m_accepted; }
+
+    std::vector<Socket::ptr> getSocks() const { return m_socks; }
+
+    virtual std::string toString(const std::string &prefix = "");
+
+protected:
+    virtual void handleClient(Socket::ptr client);
+
+    virtual void startAccept(Socket::ptr sock);
+
+private:
+    struct Worker {
+        IOManager *m_iom = nullptr;
+        std::atomic<uint32_t> m_connections{0};
+    };
+
+    Worker *selectWorker();
+
+    void dispatch(Socket::ptr client);
+
+    // 归还一个连接名额, 唤醒因达到上限而暂停的acceptor
+    void release();
+
+private:
+    std::string m_name;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    IOManager *m_acceptWorker;
+    std::vector<Socket::ptr> m_socks;
+    uint64_t m_recvTimeout;
+    uint32_t m_maxConnections;
+    uint32_t m_acceptors;
+    Balance m_balance = ROUND_ROBIN;
+    std::atomic<bool> m_isStop{true};
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_next{0};
+    // accept因资源耗尽失败后的暂停时间(毫秒), 成功accept后清零
+    std::atomic<uint64_t> m_acceptBackoff{0};
+
+    MutexType m_mutex;
+    uint32_t m_connections = 0;
+    std::vector<Socket::ptr> m_paused;
+    std::set<Socket::ptr> m_clients;
+};
+
+}  // namespace sylar
@@ -1,4 +1,5 @@
 #include "thread.h"
+#include <unistd.h>
 #include "log.h"
 #include "util.h"
 
@@ -9,6 +10,19 @@ static thread_local std::string t_thread_name = "UNKNOW";
 
 static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
 
+// 内核线程名最长15个字符, 过长时保留"_序号"后缀, 便于在top/perf中区分工作线程
+static std::string KernelThreadName(const std::string &name) {
+    static constexpr size_t MAX_LEN = 15;
+    if (name.size() <= MAX_LEN) {
+        return name;
+    }
+    size_t pos = name.rfind('_');
+    if (pos == std::string::npos || name.size() - pos >= MAX_LEN) {
+        return name.substr(0, MAX_LEN);
+    }
+    return name.substr(0, MAX_LEN - (name.size() - pos)) + name.substr(pos);
+}
+
 Thread *Thread::GetThis() { return t_thread; }
 
 const std::string &Thread::GetName() { return t_thread_name; }
@@ -22,6 +36,10 @@ void Thread::SetName(const std::string &name) {
         t_thread->m_name = name;
     }
     t_thread_name = name;
+    // 主线程的名称即进程名, 保持不变以免影响ps/pkill
+    if (sylar::GetThreadId() != getpid()) {
+        pthread_setname_np(pthread_self(), KernelThreadName(name).c_str());
+    }
 }
 
 Thread::Thread(std::function<void()> cb, const std::string &name) : m_cb{cb}, m_name{name} {
@@ -62,7 +80,7 @@ void *Thread::run(void *arg) {
     t_thread = thread;
     t_thread_name = thread->m_name;
     thread->m_id = sylar::GetThreadId();
-    pthread_setname_np(pthread_self(), thread->m_name.substr(0, 15).c_str());
+    pthread_setname_np(pthread_self(), KernelThreadName(thread->m_name).c_str());
 
     std::function<void()> cb;
     cb.swap(thread->m_cb);
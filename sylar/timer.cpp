@@ -37,6 +37,7 @@ bool Timer::cancel() {
         m_cb = nullptr;
         auto it = m_manager->m_timers.find(shared_from_this());
         m_manager->m_timers.erase(it);
+        m_manager->updateNextTime();
         return true;
     }
     return false;
@@ -56,6 +57,7 @@ bool Timer::refresh() {
     m_manager->m_timers.erase(it);
     m_next = sylar::GetElapsedMS() + m_interval;
     m_manager->m_timers.insert(shared_from_this());
+    m_manager->updateNextTime();
     return true;
 }
 
@@ -87,7 +89,9 @@ bool Timer::reset(uint64_t interval, bool fromNow) {
     return true;
 }
 
-TimerManager::TimerManager() { m_previousTime = sylar::GetElapsedMS(); }
+TimerManager::TimerManager() : m_nextTime{std::numeric_limits<uint64_t>::max()} {
+    m_previousTime = sylar::GetElapsedMS();
+}
 
 TimerManager::~TimerManager() {}
 
@@ -110,29 +114,24 @@ Timer::ptr TimerManager::addConditionTimer(uint64_t interval, std::function<void
 }
 
 uint64_t TimerManager::getNextTimer() {
-    RWMutexType::ReadLock rlock{m_mutex};
-    m_tickled = false;
-    if (m_timers.empty()) {
-        return std::numeric_limits<uint64_t>::max();
+    m_tickled.store(false, std::memory_order_relaxed);
+    uint64_t next = m_nextTime.load(std::memory_order_acquire);
+    if (next == std::numeric_limits<uint64_t>::max()) {
+        return next;
     }
 
-    const Timer::ptr &next = *m_timers.begin();
     uint64_t nowMs = sylar::GetElapsedMS();
-    if (nowMs >= next->m_next) {
+    if (nowMs >= next) {
         return 0;
     }
 
-    return next->m_next - nowMs;
+    return next - nowMs;
 }
 
 void TimerManager::listExpiredCb(std::vector<std::function<void()>> &cbs) {
-    ;
     std::vector<Timer::ptr> expired;
-    {
-        RWMutexType::ReadLock rlock{m_mutex};
-        if (m_timers.empty()) {
-            return;
-        }
+    if (!hasTimer()) {
+        return;
     }
 
     RWMutexType::WriteLock wlock{m_mutex};
@@ -169,13 +168,15 @@ void TimerManager::listExpiredCb(std::vector<std::function<void()>> &cbs) {
             timer->m_cb = nullptr;
         }
     }
+    updateNextTime();
 }
 
 void TimerManager::addTimer(Timer::ptr val, RWMutexType::WriteLock &wlock) {
     auto [it, res] = m_timers.insert(val);
-    bool atFront = (it == m_timers.begin()) && !m_tickled;
+    updateNextTime();
+    bool atFront = (it == m_timers.begin()) && !m_tickled.load(std::memory_order_relaxed);
     if (atFront) {
-        m_tickled = true;
+        m_tickled.store(true, std::memory_order_relaxed);
     }
     wlock.unlock();
 
@@ -194,8 +195,12 @@ bool TimerManager::detectClockRollover(uint64_t nowMs) {
 }
 
 bool TimerManager::hasTimer() {
-    RWMutexType::ReadLock rlock{m_mutex};
-    return !m_timers.empty();
+    return m_nextTime.load(std::memory_order_acquire) != std::numeric_limits<uint64_t>::max();
+}
+
+void TimerManager::updateNextTime() {
+    m_nextTime.store(m_timers.empty() ? std::numeric_limits<uint64_t>::max() : (*m_timers.begin())->m_next,
+                     std::memory_order_release);
 }
 
 }  // namespace sylar
\ No newline at end of file
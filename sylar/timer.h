@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <set>
@@ -68,10 +69,15 @@ protected:
 private:
     bool detectClockRollover(uint64_t now_ms);
 
+    // 持有写锁时调用, 定时器集合修改后更新最近的到期时间
+    void updateNextTime();
+
 private:
     RWMutexType m_mutex;
     std::set<Timer::ptr, Timer::Comparator> m_timers;
-    bool m_tickled{false};
+    // 最近的到期时间, 没有定时器时为uint64_t最大值; idle每轮都要读取, 不加锁
+    std::atomic<uint64_t> m_nextTime;
+    std::atomic<bool> m_tickled{false};
     uint64_t m_previousTime{0};
 };
 
@@ -0,0 +1,339 @@
+#include "udp_server.h"
+#include <netinet/udp.h>
+#include <string.h>
+#include <sstream>
+#include "config.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint32_t>::ptr g_udp_server_batch_size =
+    sylar::Config::Lookup("udp_server.batch_size", static_cast<uint32_t>(64), "udp server datagrams per recvmmsg");
+
+static sylar::ConfigVar<uint32_t>::ptr g_udp_server_datagram_size =
+    sylar::Config::Lookup("udp_server.datagram_size", static_cast<uint32_t>(2048), "udp server datagram buffer size");
+
+static sylar::ConfigVar<uint32_t>::ptr g_udp_server_receivers =
+    sylar::Config::Lookup("udp_server.receivers", static_cast<uint32_t>(1), "udp server sockets per address");
+
+static sylar::ConfigVar<uint32_t>::ptr g_udp_server_inflight = sylar::Config::Lookup(
+    "udp_server.inflight", static_cast<uint32_t>(4), "udp server batches in handling per receiver");
+
+static sylar::ConfigVar<bool>::ptr g_udp_server_gro =
+    sylar::Config::Lookup("udp_server.gro", false, "udp server enable UDP_GRO");
+
+// 单次UDP_SEGMENT发送的最大段数
+static constexpr size_t MAX_GSO_SEGMENTS = 64;
+static constexpr size_t MAX_SEND_BATCH = 64;
+
+static std::atomic<bool> s_gso_supported{true};
+
+UdpBatch::UdpBatch(size_t count, size_t datagramSize, bool gro)
+    : m_count{count},
+      m_datagramSize{datagramSize},
+      m_gro{gro},
+      m_buffer{new char[count * datagramSize]},
+      m_msgs(count),
+      m_iovs(count),
+      m_addrs(count),
+      m_controls(gro ? count : 0) {
+    // GRO时一条消息可能拆成多个数据报
+    m_packets.reserve(count);
+}
+
+void UdpBatch::prepare() {
+    m_packets.clear();
+    for (size_t i = 0; i < m_count; ++i) {
+        m_iovs[i].iov_base = m_buffer.get() + i * m_datagramSize;
+        m_iovs[i].iov_len = m_datagramSize;
+        msghdr &hdr = m_msgs[i].msg_hdr;
+        hdr.msg_name = &m_addrs[i];
+        hdr.msg_namelen = sizeof(sockaddr_storage);
+        hdr.msg_iov = &m_iovs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = m_gro ? m_controls[i].m_buf : nullptr;
+        hdr.msg_controllen = m_gro ? sizeof(Control) : 0;
+        hdr.msg_flags = 0;
+        m_msgs[i].msg_len = 0;
+    }
+}
+
+size_t UdpBatch::parse(int n) {
+    size_t truncated = 0;
+    for (int i = 0; i < n; ++i) {
+        msghdr &hdr = m_msgs[i].msg_hdr;
+        if (hdr.msg_flags & MSG_TRUNC) {
+            ++truncated;
+            continue;
+        }
+        const char *data = static_cast<const char *>(m_iovs[i].iov_base);
+        size_t length = m_msgs[i].msg_len;
+        size_t segment = length;
+        if (m_gro) {
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int gso = 0;
+                    memcpy(&gso, CMSG_DATA(cmsg), sizeof(gso));
+                    segment = gso > 0 ? gso : length;
+                }
+            }
+        }
+        const sockaddr *addr = reinterpret_cast<const sockaddr *>(&m_addrs[i]);
+        if (segment >= length) {
+            m_packets.push_back(UdpPacket{data, length, addr, hdr.msg_namelen});
+            continue;
+        }
+        // 只有最后一段可能比段长短
+        for (size_t offset = 0; offset < length; offset += segment) {
+            m_packets.push_back(UdpPacket{data + offset, std::min(segment, length - offset), addr, hdr.msg_namelen});
+        }
+    }
+    return truncated;
+}
+
+UdpServer::UdpServer(IOManager *worker, IOManager *ioWorker)
+    : m_name{"sylar/1.0.0"},
+      m_worker{worker},
+      m_ioWorker{ioWorker},
+      m_batchSize{std::max<uint32_t>(g_udp_server_batch_size->getValue(), 1)},
+      m_datagramSize{g_udp_server_datagram_size->getValue()},
+      m_receivers{std::max<uint32_t>(g_udp_server_receivers->getValue(), 1)},
+      m_inflight{g_udp_server_inflight->getValue()},
+      m_gro{g_udp_server_gro->getValue()} {
+    SYLAR_ASSERT(worker && ioWorker);
+}
+
+UdpServer::~UdpServer() {
+    for (auto &sock : m_socks) {
+        sock->close();
+    }
+    m_socks.clear();
+}
+
+bool UdpServer::bind(const Address::ptr &addr) {
+    // 端口为0时由第一个socket确定实际端口
+    Address::ptr bindAddr = addr;
+    for (uint32_t i = 0; i < m_receivers; ++i) {
+        Socket::ptr sock = Socket::CreateUDP(bindAddr);
+        if (m_receivers > 1 && !sock->setReusePort(true)) {
+            SYLAR_LOG_ERROR(g_logger) << "setReusePort fail errno=" << errno << " errstr=" << strerror(errno);
+        }
+        int on = 1;
+        if (m_gro && !sock->setOption(SOL_UDP, UDP_GRO, on)) {
+            SYLAR_LOG_WARN(g_logger) << "setsockopt UDP_GRO fail errno=" << errno << " errstr=" << strerror(errno);
+        }
+        if (!sock->bind(bindAddr)) {
+            SYLAR_LOG_ERROR(g_logger) << "bind fail errno=" << errno << " errstr=" << strerror(errno) << " addr=["
+                                      << addr->toString() << "]";
+            for (auto &s : m_socks) {
+                s->close();
+            }
+            m_socks.clear();
+            return false;
+        }
+        bindAddr = sock->getLocalAddress();
+        m_socks.push_back(sock);
+    }
+    for (const auto &sock : m_socks) {
+        SYLAR_LOG_INFO(g_logger) << "udp server " << m_name << " bind success: " << *sock;
+    }
+    return true;
+}
+
+bool UdpServer::start() {
+    if (!m_isStop) {
+        return true;
+    }
+    m_isStop = false;
+    for (const auto &sock : m_socks) {
+        ++m_running;
+        m_ioWorker->schedule(std::bind(&UdpServer::startReceive, shared_from_this(), sock));
+    }
+    return true;
+}
+
+namespace {
+
+// 一个receiver的空闲批次, 处理协程结束后放回
+struct BatchPool {
+    using ptr = std::shared_ptr<BatchPool>;
+
+    UdpBatch::ptr pop() {
+        Mutex::Lock lock{m_mutex};
+        if (m_free.empty()) {
+            return nullptr;
+        }
+        UdpBatch::ptr batch = m_free.back();
+        m_free.pop_back();
+        return batch;
+    }
+
+    void push(UdpBatch::ptr batch) {
+        Mutex::Lock lock{m_mutex};
+        m_free.push_back(std::move(batch));
+    }
+
+    Mutex m_mutex;
+    std::vector<UdpBatch::ptr> m_free;
+};
+
+}  // namespace
+
+void UdpServer::startReceive(Socket::ptr sock) {
+    size_t count = m_batchSize;
+    size_t size = getDatagramSize();
+    auto pool = std::make_shared<BatchPool>();
+    for (uint32_t i = 0; i < m_inflight; ++i) {
+        pool->push(std::make_shared<UdpBatch>(count, size, m_gro));
+    }
+    auto local = std::make_shared<UdpBatch>(count, size, m_gro);
+
+    while (!m_isStop) {
+        UdpBatch::ptr batch = pool->pop();
+        if (!batch) {
+            batch = local;
+        }
+        batch->m_sock = sock;
+        batch->prepare();
+        int n = sock->recvMulti(batch->m_msgs.data(), count);
+        if (n <= 0) {
+            if (batch != local) {
+                pool->push(batch);
+            }
+            if (m_isStop || !sock->isValid()) {
+                break;
+            }
+            SYLAR_LOG_ERROR(g_logger) << "recvmmsg fail errno=" << errno << " errstr=" << strerror(errno) << " "
+                                      << *sock;
+            continue;
+        }
+
+        ++m_syscalls;
+        m_truncated += batch->parse(n);
+        m_packets += batch->size();
+        if (batch == local) {
+            handleBatch(*batch);
+            continue;
+        }
+        ++m_running;
+        m_worker->schedule([self = shared_from_this(), batch, pool]() {
+            self->handleBatch(*batch);
+            pool->push(batch);
+            --self->m_running;
+        });
+    }
+    --m_running;
+}
+
+void UdpServer::handleBatch(UdpBatch &batch) {
+    SYLAR_LOG_DEBUG(g_logger) << "handleBatch: " << batch.size() << " datagrams from " << *batch.getSocket();
+}
+
+void UdpServer::stop() {
+    if (m_isStop.exchange(true)) {
+        return;
+    }
+    // hook的close会取消等待中的recvmmsg, 使接收协程退出
+    auto self = shared_from_this();
+    m_ioWorker->schedule([this, self]() {
+        for (auto &sock : m_socks) {
+            sock->close();
+        }
+        m_socks.clear();
+    });
+    while (m_running > 0) {
+        usleep(1000);
+    }
+}
+
+std::string UdpServer::toString(const std::string &prefix) {
+    std::stringstream ss;
+    ss << prefix << "[name=" << m_name << " worker=" << m_worker->getName() << " io_worker=" << m_ioWorker->getName()
+       << " batch_size=" << m_batchSize << " datagram_size=" << getDatagramSize() << " receivers=" << m_receivers
+       << " inflight=" << m_inflight << " gro=" << m_gro << " packets=" << m_packets << " syscalls=" << m_syscalls
+       << " truncated=" << m_truncated << "]" << std::endl;
+    std::string pfx = prefix.empty() ? "    " : prefix;
+    for (const auto &sock : m_socks) {
+        ss << pfx << pfx << *sock << std::endl;
+    }
+    return ss.str();
+}
+
+size_t UdpServer::SendBatch(const Socket::ptr &sock, const UdpPacket *packets, size_t count) {
+    mmsghdr msgs[MAX_SEND_BATCH];
+    iovec iovs[MAX_SEND_BATCH];
+    size_t sent = 0;
+    while (sent < count) {
+        size_t n = std::min(count - sent, MAX_SEND_BATCH);
+        memset(msgs, 0, sizeof(mmsghdr) * n);
+        for (size_t i = 0; i < n; ++i) {
+            const UdpPacket &packet = packets[sent + i];
+            iovs[i].iov_base = const_cast<char *>(packet.m_data);
+            iovs[i].iov_len = packet.m_length;
+            msgs[i].msg_hdr.msg_name = const_cast<sockaddr *>(packet.m_addr);
+            msgs[i].msg_hdr.msg_namelen = packet.m_addrlen;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int rt = sock->sendMulti(msgs, n);
+        if (rt <= 0) {
+            break;
+        }
+        sent += rt;
+    }
+    return sent;
+}
+
+bool UdpServer::SendSegments(const Socket::ptr &sock, const Address::ptr &to, const char *data, size_t length,
+                             uint16_t segmentSize) {
+    if (segmentSize == 0) {
+        return false;
+    }
+    // 一次UDP_SEGMENT发送的总长度不能超过一个IP包
+    size_t maxSend = segmentSize * std::min<size_t>(MAX_GSO_SEGMENTS, std::max<size_t>(65000 / segmentSize, 1));
+    size_t offset = 0;
+    while (offset < length && s_gso_supported.load(std::memory_order_relaxed)) {
+        size_t n = std::min(length - offset, maxSend);
+        iovec iov{const_cast<char *>(data + offset), n};
+        union {
+            cmsghdr m_align;
+            char m_buf[CMSG_SPACE(sizeof(uint16_t))];
+        } control;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = const_cast<sockaddr *>(to->getAddr());
+        msg.msg_namelen = to->getAddrLen();
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.m_buf;
+        msg.msg_controllen = sizeof(control.m_buf);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof(uint16_t));
+
+        if (::sendmsg(sock->getSocket(), &msg, 0) < 0) {
+            if (errno != EIO && errno != EINVAL && errno != ENOPROTOOPT && errno != EOPNOTSUPP) {
+                return false;
+            }
+            SYLAR_LOG_WARN(g_logger) << "UDP_SEGMENT not supported, errno=" << errno << " errstr=" << strerror(errno);
+            s_gso_supported = false;
+            break;
+        }
+        offset += n;
+    }
+
+    std::vector<UdpPacket> packets;
+    for (; offset < length; offset += segmentSize) {
+        packets.push_back(
+            UdpPacket{data + offset, std::min<size_t>(segmentSize, length - offset), to->getAddr(), to->getAddrLen()});
+    }
+    return SendBatch(sock, packets.data(), packets.size()) == packets.size();
+}
+
+}  // namespace sylar
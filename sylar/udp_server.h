@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "address.h"
+#include "iomanager.h"
+#include "noncopyable.h"
+#include "socket.h"
+
+namespace sylar {
+
+struct UdpPacket {
+    const char *m_data;
+    size_t m_length;
+    const sockaddr *m_addr;
+    socklen_t m_addrlen;
+};
+
+// 一次recvmmsg收到的一批数据报
+// 缓冲区预先分配并在批次之间复用, 数据和地址只在handleBatch期间有效; GRO合并的数据报已按段长拆开
+class UdpBatch : Noncopyable {
+public:
+    using ptr = std::shared_ptr<UdpBatch>;
+
+    UdpBatch(size_t count, size_t datagramSize, bool gro);
+
+    size_t size() const { return m_packets.size(); }
+
+    bool empty() const { return m_packets.empty(); }
+
+    const UdpPacket &operator[](size_t i) const { return m_packets[i]; }
+
+    std::vector<UdpPacket>::const_iterator begin() const { return m_packets.begin(); }
+
+    std::vector<UdpPacket>::const_iterator end() const { return m_packets.end(); }
+
+    // 收到这批数据的socket, 可以用它应答
+    const Socket::ptr &getSocket() const { return m_sock; }
+
+private:
+    friend class UdpServer;
+
+    union Control {
+        cmsghdr m_align;
+        char m_buf[CMSG_SPACE(sizeof(int))];
+    };
+
+    // 重置内核会改写的msg_namelen/msg_controllen
+    void prepare();
+
+    // recvmmsg返回n条消息后拆出数据报, 返回被截断而丢弃的数量
+    size_t parse(int n);
+
+private:
+    size_t m_count;
+    size_t m_datagramSize;
+    bool m_gro;
+    std::unique_ptr<char[]> m_buffer;
+    std::vector<mmsghdr> m_msgs;
+    std::vector<iovec> m_iovs;
+    std::vector<sockaddr_storage> m_addrs;
+    std::vector<Control> m_controls;
+    std::vector<UdpPacket> m_packets;
+    Socket::ptr m_sock;
+};
+
+// 在ioWorker上用recvmmsg批量接收, 每批交给worker上的一个协程处理
+// 每个receiver有固定数量的批次缓冲, 都在处理中时在接收协程内直接处理, 让socket缓冲区承担积压
+class UdpServer : public std::enable_shared_from_this<UdpServer>, Noncopyable {
+public:
+    using ptr = std::shared_ptr<UdpServer>;
+    using MutexType = Mutex;
+
+    UdpServer(IOManager *worker = IOManager::GetThis(), IOManager *ioWorker = IOManager::GetThis());
+
+    virtual ~UdpServer();
+
+    // 绑定getReceivers()个SO_REUSEPORT socket, 内核按源地址哈希分发数据报
+    virtual bool bind(const Address::ptr &addr);
+
+    virtual bool start();
+
+    // 关闭socket, 等待已分发的批次处理完
+    virtual void stop();
+
+    const std::string &getName() const { return m_name; }
+
+    void setName(const std::string &name) { m_name = name; }
+
+    // 每次recvmmsg最多接收的数据报数
+    uint32_t getBatchSize() const { return m_batchSize; }
+
+    void setBatchSize(uint32_t val) { m_batchSize = val ? val : 1; }
+
+    // 单个数据报的缓冲区大小; 开启GRO时为64KB
+    uint32_t getDatagramSize() const { return m_gro ? 65535 : m_datagramSize; }
+
+    void setDatagramSize(uint32_t val) { m_datagramSize = val; }
+
+    uint32_t getReceivers() const { return m_receivers; }
+
+    void setReceivers(uint32_t val) { m_receivers = val ? val : 1; }
+
+    // 每个receiver可同时交给worker处理的批次数, 0表示都在接收协程中处理
+    uint32_t getInflight() const { return m_inflight; }
+
+    void setInflight(uint32_t val) { m_inflight = val; }
+
+    // 须在bind之前设置; 内核不支持时忽略
+    bool isGro() const { return m_gro; }
+
+    void setGro(bool v) { m_gro = v; }
+
+    uint64_t getPackets() const { return m_packets; }
+
+    // 收到数据的recvmmsg调用次数
+    uint64_t getSyscalls() const { return m_syscalls; }
+
+    uint64_t getTruncated() const { return m_truncated; }
+
+    std::vector<Socket::ptr> getSocks() const { return m_socks; }
+
+    virtual std::string toString(const std::string &prefix = "");
+
+    // sendmmsg批量发送, 返回发出的数据报数
+    static size_t SendBatch(const Socket::ptr &sock, const UdpPacket *packets, size_t count);
+
+    // 把data按segmentSize切分后发给to; 支持UDP_SEGMENT时由内核切分, 否则退回SendBatch
+    static bool SendSegments(const Socket::ptr &sock, const Address::ptr &to, const char *data, size_t length,
+                             uint16_t segmentSize);
+
+protected:
+    virtual void handleBatch(UdpBatch &batch);
+
+    virtual void startReceive(Socket::ptr sock);
+
+private:
+    std::string m_name;
+    IOManager *m_worker;
+    IOManager *m_ioWorker;
+    std::vector<Socket::ptr> m_socks;
+    uint32_t m_batchSize;
+    uint32_t m_datagramSize;
+    uint32_t m_receivers;
+    uint32_t m_inflight;
+    bool m_gro;
+    std::atomic<bool> m_isStop{true};
+    std::atomic<uint32_t> m_running{0};
+    std::atomic<uint64_t> m_packets{0};
+    std::atomic<uint64_t> m_syscalls{0};
+    std::atomic<uint64_t> m_truncated{0};
+};
+
+}  // namespace sylar
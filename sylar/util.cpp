@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <csignal>  // for kill()
 #include <cstring>
+#include <sstream>
 #include "fiber.h"
 #include "log.h"
 
@@ -125,6 +126,70 @@ time_t Str2Time(const char *str, const char *format) {
     return mktime(&t);
 }
 
+std::vector<int> ParseCpuList(const std::string &str) {
+    std::vector<int> cpus;
+    std::stringstream ss{str};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const char *begin = item.c_str();
+        char *end = nullptr;
+        long first = strtol(begin, &end, 10);
+        long last = first;
+        if (end == begin) {
+            return {};
+        }
+        if (*end == '-') {
+            begin = end + 1;
+            last = strtol(begin, &end, 10);
+            if (end == begin) {
+                return {};
+            }
+        }
+        if (*end || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return {};
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string CpuListToString(const std::vector<int> &cpus) {
+    std::stringstream ss;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        ss << (i ? "," : "") << cpus[i];
+        if (j > i) {
+            ss << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return ss.str();
+}
+
+int GetCpuNode(int cpu) {
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dir = opendir(path.c_str());
+    if (!dir) {
+        return -1;
+    }
+    int node = -1;
+    while (struct dirent *dp = readdir(dir)) {
+        if (sscanf(dp->d_name, "node%d", &node) == 1) {
+            break;
+        }
+        node = -1;
+    }
+    closedir(dir);
+    return node;
+}
+
 void FSUtil::ListAllFile(std::vector<std::string> &files, const std::string &path, const std::string &subfix) {
     if (access(path.c_str(), 0) != 0) {
         return;
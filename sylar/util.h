@@ -36,6 +36,14 @@ std::string Time2Str(time_t ts = time(0), const std::string &format = "%Y-%m-%d
 
 time_t Str2Time(const char *str, const char *format = "%Y-%m-%d %H:%M:%S");
 
+// 解析"0-3,8,10-11"形式的CPU列表, 结果有序且去重, 格式错误时返回空
+std::vector<int> ParseCpuList(const std::string &str);
+
+std::string CpuListToString(const std::vector<int> &cpus);
+
+// CPU所在的NUMA节点, 无法确定时返回-1
+int GetCpuNode(int cpu);
+
 class FSUtil {
 public:
     static void ListAllFile(std::vector<std::string> &files, const std::string &path, const std::string &subfix);
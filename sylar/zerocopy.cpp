@@ -0,0 +1,262 @@
+#include "zerocopy.h"
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <vector>
+#include "config.h"
+#include "hook.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace sylar {
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_NAME("system");
+
+static sylar::ConfigVar<uint32_t>::ptr g_tcp_zerocopy_threshold = sylar::Config::Lookup(
+    "tcp.zerocopy.threshold", static_cast<uint32_t>(16 * 1024), "tcp sends below this size use the copy path");
+
+ZeroCopySender::ZeroCopySender(Socket::ptr sock, IOManager *iom)
+    : m_sock{std::move(sock)}, m_iom{iom}, m_threshold{g_tcp_zerocopy_threshold->getValue()} {
+    int val = 1;
+    m_enabled = m_iom && m_sock->getType() == Socket::TCP && m_sock->setOption(SOL_SOCKET, SO_ZEROCOPY, val);
+    if (!m_enabled) {
+        SYLAR_LOG_DEBUG(g_logger) << "zerocopy disabled on " << *m_sock << ", use copy path";
+    }
+}
+
+ZeroCopySender::~ZeroCopySender() {
+    if (m_armed && m_sock->isValid()) {
+        m_iom->delEvent(m_sock->getSocket(), IOManager::ERROR);
+    }
+    // 已到达的完成通知照常释放; 其余缓冲区可能仍在发送, 不能交还给调用方
+    std::vector<ReleaseCb> releases;
+    if (m_sock->isValid()) {
+        drain(releases);
+    }
+    for (auto &cb : releases) {
+        cb();
+    }
+    if (!m_inflight.empty()) {
+        SYLAR_LOG_WARN(g_logger) << "ZeroCopySender destroyed with " << m_inflight.size()
+                                 << " sends in flight on " << *m_sock << ", their buffers are not released";
+    }
+}
+
+size_t ZeroCopySender::getInflight() {
+    MutexType::Lock lock{m_mutex};
+    return m_inflight.size();
+}
+
+ssize_t ZeroCopySender::sendCopy(const char *buffer, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = m_sock->send(buffer + sent, length - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    ++m_copySends;
+    return sent;
+}
+
+ssize_t ZeroCopySender::send(const void *buffer, size_t length, ReleaseCb release) {
+    const char *data = static_cast<const char *>(buffer);
+    if (!m_enabled || length < m_threshold) {
+        size_t sent = sendCopy(data, length);
+        int error = errno;
+        if (release) {
+            release();
+        }
+        errno = error;
+        return sent || !length ? static_cast<ssize_t>(sent) : -1;
+    }
+
+    auto pending = std::make_shared<Pending>();
+    pending->m_release = std::move(release);
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = m_sock->send(data + sent, length - sent, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n > 0) {
+            MutexType::Lock lock{m_mutex};
+            ++pending->m_refs;
+            m_inflight[m_nextId++] = pending;
+            ++m_zeroCopySends;
+            sent += n;
+            continue;
+        }
+        if (n < 0 && errno == ENOBUFS) {
+            // 完成通知占满了socket的optmem, 等待一部分完成后重试; 没有在途发送时余下部分拷贝发送
+            size_t inflight = getInflight();
+            if (!inflight) {
+                sent += sendCopy(data + sent, length - sent);
+                break;
+            }
+            if (wait(inflight - 1, m_sock->getSendTimeout())) {
+                continue;
+            }
+            errno = ETIMEDOUT;
+        }
+        break;
+    }
+
+    int error = errno;
+    ReleaseCb cb;
+    {
+        MutexType::Lock lock{m_mutex};
+        cb = unref(pending);
+    }
+    if (cb) {
+        cb();
+    }
+    arm();
+    errno = error;
+    return sent ? static_cast<ssize_t>(sent) : -1;
+}
+
+bool ZeroCopySender::flush(uint64_t timeoutMs) { return wait(0, timeoutMs); }
+
+bool ZeroCopySender::wait(size_t target, uint64_t timeoutMs) {
+    MutexType::Lock lock{m_mutex};
+    if (m_inflight.size() <= target) {
+        return true;
+    }
+    SYLAR_ASSERT2(!m_waiter, "only one fiber may wait on a ZeroCopySender");
+    auto waiter = std::make_shared<Waiter>(Waiter{Scheduler::GetThis(), Fiber::GetThis(), GetThreadId(), target});
+    m_waiter = waiter;
+    Timer::ptr timer;
+    if (timeoutMs != std::numeric_limits<uint64_t>::max()) {
+        std::weak_ptr<Waiter> weak{waiter};
+        timer = m_iom->addConditionTimer(
+            timeoutMs,
+            [this, weak]() {
+                auto waiter = weak.lock();
+                MutexType::Lock lock{m_mutex};
+                if (!waiter || m_waiter != waiter) {
+                    return;
+                }
+                m_waiter.reset();
+                waiter->m_scheduler->schedule(waiter->m_fiber, waiter->m_thread);
+            },
+            weak);
+    }
+    lock.unlock();
+    arm();
+    Fiber::GetThis()->yield();
+    if (timer) {
+        timer->cancel();
+    }
+    lock.lock();
+    return m_inflight.size() <= target;
+}
+
+void ZeroCopySender::arm() {
+    {
+        MutexType::Lock lock{m_mutex};
+        if (m_armed || m_inflight.empty() || !m_sock->isValid()) {
+            return;
+        }
+        m_armed = true;
+    }
+    std::weak_ptr<ZeroCopySender> weak{shared_from_this()};
+    bool ok = m_iom->addEvent(m_sock->getSocket(), IOManager::ERROR, [weak]() {
+        if (auto self = weak.lock()) {
+            self->reap();
+        }
+    });
+    if (!ok) {
+        MutexType::Lock lock{m_mutex};
+        m_armed = false;
+    }
+}
+
+void ZeroCopySender::reap() {
+    {
+        MutexType::Lock lock{m_mutex};
+        m_armed = false;
+    }
+
+    std::vector<ReleaseCb> releases;
+    size_t notifications = drain(releases);
+
+    std::shared_ptr<Waiter> waiter;
+    {
+        MutexType::Lock lock{m_mutex};
+        if (m_waiter && m_inflight.size() <= m_waiter->m_target) {
+            waiter.swap(m_waiter);
+        }
+    }
+    for (auto &cb : releases) {
+        cb();
+    }
+    if (waiter) {
+        waiter->m_scheduler->schedule(waiter->m_fiber, waiter->m_thread);
+    }
+
+    if (notifications) {
+        arm();
+    } else {
+        // 错误队列为空却报告EPOLLERR, 说明socket本身出错; 立即重新注册会忙等, 稍后再注册
+        std::weak_ptr<ZeroCopySender> weak{shared_from_this()};
+        m_iom->addTimer(1, [weak]() {
+            if (auto self = weak.lock()) {
+                self->arm();
+            }
+        });
+    }
+}
+
+size_t ZeroCopySender::drain(std::vector<ReleaseCb> &releases) {
+    size_t notifications = 0;
+    while (true) {
+        char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        // 错误队列为空时返回EAGAIN, 不能经过hook挂起
+        if (recvmsg_f(m_sock->getSocket(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            break;
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cm), sizeof(err));
+            if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            ++notifications;
+            // [ee_info, ee_data]是一段连续完成的发送编号, 编号回绕时同样适用
+            MutexType::Lock lock{m_mutex};
+            for (uint32_t id = err.ee_info;; ++id) {
+                auto it = m_inflight.find(id);
+                if (it != m_inflight.end()) {
+                    if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                        ++m_kernelCopied;
+                    }
+                    if (ReleaseCb cb = unref(it->second)) {
+                        releases.push_back(std::move(cb));
+                    }
+                    m_inflight.erase(it);
+                }
+                if (id == err.ee_data) {
+                    break;
+                }
+            }
+        }
+    }
+    return notifications;
+}
+
+ZeroCopySender::ReleaseCb ZeroCopySender::unref(const std::shared_ptr<Pending> &pending) {
+    if (--pending->m_refs == 0) {
+        return std::move(pending->m_release);
+    }
+    return nullptr;
+}
+
+}  // namespace sylar
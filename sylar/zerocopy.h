@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+#include "iomanager.h"
+#include "mutex.h"
+#include "noncopyable.h"
+#include "socket.h"
+
+namespace sylar {
+
+// 基于SO_ZEROCOPY/MSG_ZEROCOPY的TCP发送
+// 内核直接引用用户缓冲区, 发送返回后缓冲区仍不能修改或释放, 直到socket错误队列中出现完成通知;
+// 通知通过IOManager的ERROR事件收割, 随后调用每个缓冲区的release回调
+// 同一个socket上的MSG_ZEROCOPY发送都必须经过同一个ZeroCopySender, 否则通知编号会错位
+class ZeroCopySender : public std::enable_shared_from_this<ZeroCopySender>, Noncopyable {
+public:
+    using ptr = std::shared_ptr<ZeroCopySender>;
+    using MutexType = Mutex;
+    using ReleaseCb = std::function<void()>;
+
+    // 对sock开启SO_ZEROCOPY; 内核不支持或不在IOManager中时所有发送走普通拷贝路径
+    explicit ZeroCopySender(Socket::ptr sock, IOManager *iom = IOManager::GetThis());
+
+    // 析构前应flush; 析构时仍被内核引用的缓冲区不会调用release, 只记录日志, 由调用方保证其生命周期
+    ~ZeroCopySender();
+
+    // 发出全部length字节, 内核不再引用buffer后调用release; 小于阈值时拷贝发送并在返回前调用release
+    // 返回发出的字节数, 未全部发出时errno为出错原因; 一个字节都没发出时返回-1
+    ssize_t send(const void *buffer, size_t length, ReleaseCb release);
+
+    // 等待所有在途缓冲区释放, 超时返回false
+    bool flush(uint64_t timeoutMs = std::numeric_limits<uint64_t>::max());
+
+    bool isEnabled() const { return m_enabled; }
+
+    // 小于该字节数的发送走拷贝路径, 默认tcp.zerocopy.threshold
+    size_t getThreshold() const { return m_threshold; }
+
+    void setThreshold(size_t val) { m_threshold = val; }
+
+    // 尚未收到完成通知的MSG_ZEROCOPY发送次数
+    size_t getInflight();
+
+    uint64_t getZeroCopySends() const { return m_zeroCopySends; }
+
+    uint64_t getCopySends() const { return m_copySends; }
+
+    // 内核退回拷贝(如回环或网卡不支持)的发送次数
+    uint64_t getKernelCopied() const { return m_kernelCopied; }
+
+private:
+    struct Pending {
+        // send本身也持有一个引用, 避免部分完成时提前释放
+        uint32_t m_refs = 1;
+        ReleaseCb m_release;
+    };
+
+    struct Waiter {
+        Scheduler *m_scheduler;
+        Fiber::ptr m_fiber;
+        // 固定在挂起时的线程上恢复, 避免与尚未完成的yield竞争
+        int m_thread;
+        size_t m_target;
+    };
+
+    ssize_t sendCopy(const char *buffer, size_t length);
+
+    // 在途数降到target及以下前挂起当前协程
+    bool wait(size_t target, uint64_t timeoutMs);
+
+    // 注册ERROR事件, 通知到达时在IOManager中收割
+    void arm();
+
+    // 读空错误队列, 调用已完成缓冲区的release
+    void reap();
+
+    // 不阻塞地读空错误队列, 收集已完成缓冲区的release, 返回读到的通知数
+    size_t drain(std::vector<ReleaseCb> &releases);
+
+    // 需持有锁, 返回引用归零后应调用的release
+    ReleaseCb unref(const std::shared_ptr<Pending> &pending);
+
+private:
+    Socket::ptr m_sock;
+    IOManager *m_iom;
+    bool m_enabled = false;
+    size_t m_threshold;
+    MutexType m_mutex;
+    // 内核为每次成功的MSG_ZEROCOPY发送分配递增编号
+    uint32_t m_nextId = 0;
+    std::map<uint32_t, std::shared_ptr<Pending>> m_inflight;
+    std::shared_ptr<Waiter> m_waiter;
+    bool m_armed = false;
+    std::atomic<uint64_t> m_zeroCopySends{0};
+    std::atomic<uint64_t> m_copySends{0};
+    std::atomic<uint64_t> m_kernelCopied{0};
+};
+
+}  // namespace sylar
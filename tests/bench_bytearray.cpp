@@ -0,0 +1,70 @@
+#include <functional>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 每轮写入count个值再全部读出, 统计吞吐和块分配次数
+static void bench(const std::string &name, int rounds, int count,
+                  const std::function<void(sylar::ByteArray &, int)> &write,
+                  const std::function<void(sylar::ByteArray &)> &read) {
+    uint64_t allocs = sylar::ByteArray::GetBlockAllocs();
+    uint64_t reuses = sylar::ByteArray::GetBlockReuses();
+    uint64_t bytes = 0;
+    uint64_t encodeUs = 0;
+    uint64_t decodeUs = 0;
+    for (int r = 0; r < rounds; ++r) {
+        sylar::ByteArray ba;
+        uint64_t start = sylar::GetCurrentUS();
+        for (int i = 0; i < count; ++i) {
+            write(ba, i);
+        }
+        uint64_t mid = sylar::GetCurrentUS();
+        bytes += ba.size();
+        for (int i = 0; i < count; ++i) {
+            read(ba);
+        }
+        encodeUs += mid - start;
+        decodeUs += sylar::GetCurrentUS() - mid;
+        SYLAR_ASSERT(ba.empty());
+    }
+
+    uint64_t ops = static_cast<uint64_t>(rounds) * count;
+    SYLAR_LOG_INFO(g_logger) << name << ": bytes=" << bytes
+                             << " encode=" << ops * 1000 / std::max<uint64_t>(encodeUs, 1) << "Kops/s "
+                             << bytes / std::max<uint64_t>(encodeUs, 1) << "MB/s"
+                             << " decode=" << ops * 1000 / std::max<uint64_t>(decodeUs, 1) << "Kops/s "
+                             << bytes / std::max<uint64_t>(decodeUs, 1) << "MB/s"
+                             << " block_allocs=" << sylar::ByteArray::GetBlockAllocs() - allocs
+                             << " block_reuses=" << sylar::ByteArray::GetBlockReuses() - reuses;
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Env *env = sylar::EnvMgr::GetInstance();
+    env->addHelp("r", "rounds, default 20");
+    env->addHelp("n", "values per round, default 100000");
+    env->addHelp("h", "print this help message");
+    if (!env->init(argc, argv) || env->has("h")) {
+        env->printHelp();
+        return 1;
+    }
+    int rounds = sylar::TypeUtil::Atoi(env->get("r", "20"));
+    int count = sylar::TypeUtil::Atoi(env->get("n", "100000"));
+
+    bench(
+        "fint32", rounds, count, [](sylar::ByteArray &ba, int i) { ba.writeFint32(i); },
+        [](sylar::ByteArray &ba) { ba.readFint32(); });
+    bench(
+        "fint64", rounds, count, [](sylar::ByteArray &ba, int i) { ba.writeFint64(i); },
+        [](sylar::ByteArray &ba) { ba.readFint64(); });
+    bench(
+        "varint32", rounds, count, [](sylar::ByteArray &ba, int i) { ba.writeUint32(i); },
+        [](sylar::ByteArray &ba) { ba.readUint32(); });
+    bench(
+        "zigzag64", rounds, count, [](sylar::ByteArray &ba, int i) { ba.writeInt64(-static_cast<int64_t>(i) << 20); },
+        [](sylar::ByteArray &ba) { ba.readInt64(); });
+    const std::string str(32, 's');
+    bench(
+        "string_vint", rounds, count, [&str](sylar::ByteArray &ba, int i) { ba.writeStringVint(str); },
+        [](sylar::ByteArray &ba) { ba.readStringVint(); });
+    return 0;
+}
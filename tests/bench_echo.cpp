@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static void serve(sylar::Socket::ptr client, size_t size) {
+    std::string buf(size, '\0');
+    while (true) {
+        ssize_t n = client->recv(&buf[0], buf.size());
+        if (n <= 0 || client->send(buf.data(), n) != n) {
+            break;
+        }
+    }
+    client->close();
+}
+
+// 每个连接串行地发送请求并等待完整回显, 记录每个请求的延迟(us)
+static void run_client(const sylar::Address::ptr &addr, int requests, size_t size, std::vector<uint64_t> &latencies) {
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 3000)) {
+        return;
+    }
+
+    std::string req(size, 'x');
+    std::string rsp(size, '\0');
+    latencies.reserve(requests);
+    for (int i = 0; i < requests; ++i) {
+        uint64_t start = sylar::GetCurrentUS();
+        if (sock->send(req.data(), req.size()) != static_cast<ssize_t>(req.size())) {
+            break;
+        }
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = sock->recv(&rsp[got], size - got);
+            if (n <= 0) {
+                return;
+            }
+            got += n;
+        }
+        latencies.push_back(sylar::GetCurrentUS() - start);
+    }
+    sock->close();
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Env *env = sylar::EnvMgr::GetInstance();
+    env->addHelp("c", "connections, default 50");
+    env->addHelp("n", "requests per connection, default 2000");
+    env->addHelp("s", "message size, default 64");
+    env->addHelp("t", "threads of server and client IOManager, default 1");
+    env->addHelp("h", "print this help message");
+    if (!env->init(argc, argv) || env->has("h")) {
+        env->printHelp();
+        return 1;
+    }
+
+    int conns = sylar::TypeUtil::Atoi(env->get("c", "50"));
+    int requests = sylar::TypeUtil::Atoi(env->get("n", "2000"));
+    size_t size = sylar::TypeUtil::Atoi(env->get("s", "64"));
+    int threads = sylar::TypeUtil::Atoi(env->get("t", "1"));
+
+    sylar::IOManager server{static_cast<size_t>(threads), false, "echo_server"};
+    sylar::Socket::ptr listener = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(listener->bind(sylar::IPAddress::Create("127.0.0.1", 0)) && listener->listen());
+    sylar::Address::ptr addr = listener->getLocalAddress();
+    server.schedule([listener, size] {
+        while (sylar::Socket::ptr client = listener->accept()) {
+            sylar::IOManager::GetThis()->schedule(std::bind(serve, client, size));
+        }
+    });
+
+    std::vector<std::vector<uint64_t>> latencies(conns);
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    uint64_t start = sylar::GetCurrentUS();
+    {
+        sylar::IOManager client{static_cast<size_t>(threads), false, "echo_client"};
+        for (int i = 0; i < conns; ++i) {
+            client.schedule([&, i] {
+                run_client(addr, requests, size, latencies[i]);
+                if (++done == conns) {
+                    sem.notify();
+                }
+            });
+        }
+        sem.wait();
+    }
+    uint64_t elapsed = sylar::GetCurrentUS() - start;
+
+    server.schedule([listener] {
+        listener->cancelAccept();
+        listener->close();
+    });
+
+    std::vector<uint64_t> all;
+    for (const auto &l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    if (all.empty()) {
+        SYLAR_LOG_ERROR(g_logger) << "no request finished";
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    SYLAR_LOG_INFO(g_logger) << "connections=" << conns << " requests=" << all.size() << " size=" << size
+                             << " threads=" << threads << " elapsed=" << elapsed / 1000 << "ms"
+                             << " req/s=" << all.size() * 1000000 / std::max<uint64_t>(elapsed, 1)
+                             << " p50=" << all[all.size() / 2] << "us p99=" << all[all.size() * 99 / 100]
+                             << "us max=" << all.back() << "us";
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include "sylar/http/http_server.h"
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 每个连接一次发出pipeline个请求, 再收齐对应的响应; 响应长度固定, 由第一个响应得出
+static uint64_t run_client(const sylar::Address::ptr &addr, int requests, int pipeline) {
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 3000)) {
+        return 0;
+    }
+    sock->setRecvTimeout(5000);
+    const std::string one = "GET /hello HTTP/1.1\r\nHost: bench\r\nUser-Agent: bench_http\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < pipeline; ++i) {
+        batch += one;
+    }
+
+    std::string buf(64 * 1024, '\0');
+    size_t rspSize = 0;
+    uint64_t done = 0;
+    while (done < static_cast<uint64_t>(requests)) {
+        int count = std::min<int>(pipeline, requests - done);
+        size_t len = one.size() * count;
+        if (sock->send(batch.data(), len) != static_cast<ssize_t>(len)) {
+            break;
+        }
+        size_t got = 0;
+        while (rspSize == 0 || got < rspSize * count) {
+            ssize_t n = sock->recv(&buf[got], buf.size() - got);
+            if (n <= 0) {
+                return done;
+            }
+            got += n;
+            if (rspSize == 0) {
+                size_t pos = buf.find("\r\n\r\n");
+                if (pos < got) {
+                    size_t cl = buf.find("Content-Length: ");
+                    rspSize = pos + 4 + atoi(buf.c_str() + cl + 16);
+                    buf.resize(std::max(buf.size(), rspSize * pipeline));
+                }
+            }
+        }
+        done += count;
+    }
+    sock->close();
+    return done;
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Env *env = sylar::EnvMgr::GetInstance();
+    env->addHelp("c", "comma separated connection counts, default 1,8,32,128");
+    env->addHelp("n", "requests per connection, default 2000");
+    env->addHelp("p", "pipeline depth, default 1");
+    env->addHelp("t", "threads of server and client IOManager, default 1");
+    env->addHelp("h", "print this help message");
+    if (!env->init(argc, argv) || env->has("h")) {
+        env->printHelp();
+        return 1;
+    }
+
+    int requests = sylar::TypeUtil::Atoi(env->get("n", "2000"));
+    int pipeline = std::max(1, static_cast<int>(sylar::TypeUtil::Atoi(env->get("p", "1"))));
+    size_t threads = sylar::TypeUtil::Atoi(env->get("t", "1"));
+
+    sylar::IOManager worker{threads, false, "http_server"};
+    auto server = std::make_shared<sylar::http::HttpServer>(true, &worker, &worker);
+    server->getServletDispatch()->addServlet(
+        "/hello", [](sylar::http::HttpRequest::ptr, sylar::http::HttpResponse::ptr rsp, sylar::http::HttpSession::ptr) {
+            rsp->setHeader("Content-Type", "text/plain");
+            rsp->setBody("hello world");
+            return 0;
+        });
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)) && server->start());
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+
+    std::stringstream ss{env->get("c", "1,8,32,128")};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int conns = sylar::TypeUtil::Atoi(item);
+        if (conns <= 0) {
+            continue;
+        }
+        std::atomic<uint64_t> total{0};
+        std::atomic<int> done{0};
+        sylar::Semaphore sem;
+        uint64_t start = sylar::GetCurrentUS();
+        {
+            sylar::IOManager client{threads, false, "http_client"};
+            for (int i = 0; i < conns; ++i) {
+                client.schedule([&] {
+                    total += run_client(addr, requests, pipeline);
+                    if (++done == conns) {
+                        sem.notify();
+                    }
+                });
+            }
+            sem.wait();
+        }
+        uint64_t elapsed = std::max<uint64_t>(sylar::GetCurrentUS() - start, 1);
+        SYLAR_LOG_INFO(g_logger) << "connections=" << conns << " pipeline=" << pipeline << " threads=" << threads
+                                 << " requests=" << total << " elapsed=" << elapsed / 1000 << "ms"
+                                 << " req/s=" << total * 1000000 / elapsed;
+    }
+    server->stop(1000);
+    return 0;
+}
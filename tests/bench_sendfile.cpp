@@ -0,0 +1,136 @@
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 准备size字节的文件, 已存在且大小一致时复用
+static bool prepare_file(const std::string &path, uint64_t size) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) == size) {
+        return true;
+    }
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    std::string block(1024 * 1024, 'x');
+    for (uint64_t written = 0; written < size;) {
+        ssize_t n = ::write(fd, block.data(), std::min<uint64_t>(block.size(), size - written));
+        if (n <= 0) {
+            ::close(fd);
+            return false;
+        }
+        written += n;
+    }
+    ::close(fd);
+    return true;
+}
+
+static uint64_t cpu_us() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1000000ULL + usage.ru_utime.tv_usec + usage.ru_stime.tv_sec * 1000000ULL +
+           usage.ru_stime.tv_usec;
+}
+
+// read到用户态缓冲区再send
+static uint64_t send_copy(sylar::Socket::ptr sock, int fd, uint64_t size, size_t bufSize) {
+    std::vector<char> buffer(bufSize);
+    uint64_t total = 0;
+    while (total < size) {
+        ssize_t n = ::read(fd, buffer.data(), std::min<uint64_t>(bufSize, size - total));
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t off = 0; off < n;) {
+            ssize_t m = sock->send(buffer.data() + off, n - off, MSG_NOSIGNAL);
+            if (m <= 0) {
+                return total;
+            }
+            off += m;
+        }
+        total += n;
+    }
+    return total;
+}
+
+static void run(const std::string &mode, const std::string &path, uint64_t size, size_t bufSize) {
+    sylar::IOManager sender{1, false, "sender"};
+    sylar::IOManager receiver{1, false, "receiver"};
+
+    sylar::Socket::ptr server = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)) && server->listen());
+    sylar::Address::ptr addr = server->getLocalAddress();
+
+    sylar::Semaphore sem;
+    uint64_t received = 0;
+    receiver.schedule([&] {
+        sylar::Socket::ptr client = server->accept();
+        std::vector<char> buffer(bufSize);
+        ssize_t n;
+        while ((n = client->recv(buffer.data(), buffer.size())) > 0) {
+            received += n;
+        }
+        sem.notify();
+    });
+
+    uint64_t cpuStart = cpu_us();
+    uint64_t start = sylar::GetCurrentUS();
+    uint64_t sent = 0;
+    sender.schedule([&] {
+        sylar::Socket::ptr sock = sylar::Socket::CreateTCPSocket();
+        SYLAR_ASSERT(sock->connect(addr, 1000));
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (mode == "sendfile") {
+            ssize_t n = sock->sendFile(fd, 0, size);
+            sent = n > 0 ? n : 0;
+        } else {
+            sent = send_copy(sock, fd, size, bufSize);
+        }
+        ::close(fd);
+        sock->close();
+    });
+    sem.wait();
+    uint64_t elapsed = std::max<uint64_t>(sylar::GetCurrentUS() - start, 1);
+    uint64_t cpu = cpu_us() - cpuStart;
+    server->close();
+
+    SYLAR_LOG_INFO(g_logger) << "mode=" << mode << " size=" << size << " sent=" << sent << " received=" << received
+                             << " elapsed=" << elapsed / 1000 << "ms"
+                             << " MB/s=" << received / elapsed << " cpu=" << cpu / 1000 << "ms"
+                             << " cpu/GB=" << cpu * 1000 / std::max<uint64_t>(received >> 20, 1) << "us";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Env *env = sylar::EnvMgr::GetInstance();
+    env->addHelp("f", "file path, default /tmp/sylar_bench_sendfile.dat");
+    env->addHelp("s", "file size in MB, default 1024");
+    env->addHelp("b", "read/recv buffer size in KB, default 64");
+    env->addHelp("m", "comma separated modes (copy,sendfile), default copy,sendfile");
+    env->addHelp("k", "keep the file after the benchmark");
+    env->addHelp("h", "print this help message");
+    if (!env->init(argc, argv) || env->has("h")) {
+        env->printHelp();
+        return 1;
+    }
+
+    std::string path = env->get("f", "/tmp/sylar_bench_sendfile.dat");
+    uint64_t size = sylar::TypeUtil::Atoi(env->get("s", "1024")) * 1024 * 1024;
+    size_t bufSize = sylar::TypeUtil::Atoi(env->get("b", "64")) * 1024;
+    if (!prepare_file(path, size)) {
+        SYLAR_LOG_ERROR(g_logger) << "prepare " << path << " failed, errno=" << errno;
+        return 1;
+    }
+
+    std::stringstream ss{env->get("m", "copy,sendfile")};
+    std::string mode;
+    while (std::getline(ss, mode, ',')) {
+        run(mode, path, size, bufSize);
+    }
+    if (!env->has("k")) {
+        ::unlink(path.c_str());
+    }
+    return 0;
+}
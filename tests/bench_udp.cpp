@@ -0,0 +1,125 @@
+#include <atomic>
+#include <sstream>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 只计数, 测量接收路径本身的开销
+class CountServer : public sylar::UdpServer {
+public:
+    using UdpServer::UdpServer;
+
+    std::atomic<uint64_t> m_bytes{0};
+
+protected:
+    void handleBatch(sylar::UdpBatch &batch) override {
+        uint64_t bytes = 0;
+        for (const auto &packet : batch) {
+            bytes += packet.m_length;
+        }
+        m_bytes += bytes;
+    }
+};
+
+// 每个发送协程用sendmmsg(或UDP_SEGMENT)发出packets个数据报
+static void run_sender(const sylar::Address::ptr &addr, uint64_t packets, size_t size, bool gso) {
+    sylar::Socket::ptr sock = sylar::Socket::CreateUDP(addr);
+    int sndbuf = 4 * 1024 * 1024;
+    sock->setOption(SOL_SOCKET, SO_SNDBUF, sndbuf);
+    const size_t batch = 64;
+    std::string data(size * batch, 'x');
+    std::vector<sylar::UdpPacket> msgs;
+    for (size_t i = 0; i < batch; ++i) {
+        msgs.push_back(sylar::UdpPacket{&data[i * size], size, addr->getAddr(), addr->getAddrLen()});
+    }
+    for (uint64_t sent = 0; sent < packets; sent += batch) {
+        size_t n = std::min<uint64_t>(batch, packets - sent);
+        if (gso) {
+            sylar::UdpServer::SendSegments(sock, addr, data.data(), n * size, size);
+        } else {
+            sylar::UdpServer::SendBatch(sock, msgs.data(), n);
+        }
+    }
+    sock->close();
+}
+
+static void run(size_t batchSize, size_t threads, uint32_t receivers, int senders, uint64_t packets, size_t size,
+                bool gro) {
+    sylar::IOManager server{threads, false, "udp_server"};
+    auto udp = std::make_shared<CountServer>(&server, &server);
+    udp->setBatchSize(batchSize);
+    udp->setReceivers(receivers);
+    udp->setGro(gro);
+    SYLAR_ASSERT(udp->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    for (const auto &sock : udp->getSocks()) {
+        int rcvbuf = 16 * 1024 * 1024;
+        sock->setOption(SOL_SOCKET, SO_RCVBUF, rcvbuf);
+    }
+    sylar::Address::ptr addr = udp->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(udp->start());
+
+    uint64_t start = sylar::GetCurrentUS();
+    {
+        sylar::IOManager client{static_cast<size_t>(senders), false, "udp_client"};
+        for (int i = 0; i < senders; ++i) {
+            client.schedule(std::bind(run_sender, addr, packets, size, gro));
+        }
+    }
+    // 发送结束后等到不再有新数据
+    uint64_t last = udp->getPackets();
+    uint64_t lastUs = sylar::GetCurrentUS();
+    while (last < packets * senders) {
+        usleep(20 * 1000);
+        uint64_t now = udp->getPackets();
+        if (now == last) {
+            break;
+        }
+        last = now;
+        lastUs = sylar::GetCurrentUS();
+    }
+    uint64_t elapsed = std::max<uint64_t>(lastUs - start, 1);
+    uint64_t received = udp->getPackets();
+    udp->stop();
+
+    uint64_t total = packets * senders;
+    SYLAR_LOG_INFO(g_logger) << "batch=" << batchSize << " gro=" << gro << " threads=" << threads
+                             << " receivers=" << receivers << " size=" << size << " received=" << received << "/"
+                             << total << " loss=" << (total - received) * 100 / total << "%"
+                             << " syscalls=" << udp->getSyscalls()
+                             << " per_syscall=" << received / std::max<uint64_t>(udp->getSyscalls(), 1)
+                             << " pps=" << received * 1000000 / elapsed
+                             << " pps/core=" << received * 1000000 / elapsed / threads;
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Env *env = sylar::EnvMgr::GetInstance();
+    env->addHelp("b", "comma separated recvmmsg batch sizes, default 1,8,64");
+    env->addHelp("n", "datagrams per sender, default 200000");
+    env->addHelp("s", "datagram size, default 64");
+    env->addHelp("c", "senders, default 1");
+    env->addHelp("t", "server threads, default 1");
+    env->addHelp("r", "receivers (SO_REUSEPORT sockets), default same as threads");
+    env->addHelp("g", "enable UDP_GRO on server and UDP_SEGMENT on senders");
+    env->addHelp("h", "print this help message");
+    if (!env->init(argc, argv) || env->has("h")) {
+        env->printHelp();
+        return 1;
+    }
+
+    uint64_t packets = sylar::TypeUtil::Atoi(env->get("n", "200000"));
+    size_t size = sylar::TypeUtil::Atoi(env->get("s", "64"));
+    int senders = sylar::TypeUtil::Atoi(env->get("c", "1"));
+    size_t threads = sylar::TypeUtil::Atoi(env->get("t", "1"));
+    uint32_t receivers = sylar::TypeUtil::Atoi(env->get("r", std::to_string(threads)));
+    bool gro = env->has("g");
+
+    std::stringstream ss{env->get("b", "1,8,64")};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t batch = sylar::TypeUtil::Atoi(item);
+        if (batch > 0) {
+            run(batch, threads, receivers, senders, packets, size, gro);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+void test_lookup() {
+    std::vector<sylar::Address::ptr> addrs;
+    SYLAR_ASSERT(sylar::Address::Lookup(addrs, "localhost:8080", AF_UNSPEC, SOCK_STREAM));
+    for (const auto &addr : addrs) {
+        SYLAR_LOG_INFO(g_logger) << "localhost:8080 -> " << addr->toString();
+    }
+
+    sylar::Address::ptr addr = sylar::Address::LookupAny("[::1]:8080", AF_INET6);
+    SYLAR_ASSERT(addr && addr->toString() == "[::1]:8080");
+
+    sylar::IPAddress::ptr ip = sylar::Address::LookupAnyIPAddress("127.0.0.1:80");
+    SYLAR_ASSERT(ip && ip->getPort() == 80 && ip->toString() == "127.0.0.1:80");
+
+    // 修改端口后缓存的字符串随之更新
+    ip->setPort(8081);
+    SYLAR_ASSERT(ip->toString() == "127.0.0.1:8081");
+}
+
+void test_ipv4() {
+    sylar::IPAddress::ptr addr = sylar::IPAddress::Create("192.168.10.77", 80);
+    SYLAR_ASSERT(addr);
+    SYLAR_ASSERT(addr->networkAddress(24)->toString() == "192.168.10.0:80");
+    SYLAR_ASSERT(addr->broadcastAddress(24)->toString() == "192.168.10.255:80");
+    SYLAR_ASSERT(addr->subnetMask(20)->toString() == "255.255.240.0:0");
+    SYLAR_ASSERT(addr->subnetMask(0)->toString() == "0.0.0.0:0");
+    SYLAR_ASSERT(addr->subnetMask(32)->toString() == "255.255.255.255:0");
+
+    sylar::IPAddress::ptr addr6 = sylar::IPAddress::Create("fe80::1234:5678", 443);
+    SYLAR_ASSERT(addr6 && addr6->getFamily() == AF_INET6);
+    SYLAR_ASSERT(addr6->networkAddress(64)->toString() == "[fe80::]:443");
+    SYLAR_ASSERT(addr6->subnetMask(64)->toString() == "[ffff:ffff:ffff:ffff::]:0");
+    SYLAR_ASSERT(!sylar::IPAddress::Create("not-an-ip"));
+}
+
+void test_unix() {
+    sylar::UnixAddress::ptr addr = std::make_shared<sylar::UnixAddress>("/tmp/sylar_test.sock");
+    SYLAR_ASSERT(addr->getPath() == "/tmp/sylar_test.sock" && addr->toString() == "/tmp/sylar_test.sock");
+
+    sylar::UnixAddress::ptr abstract = std::make_shared<sylar::UnixAddress>(std::string{"\0sylar", 6});
+    SYLAR_ASSERT(abstract->toString() == "\\0sylar");
+    SYLAR_ASSERT(*addr != *abstract);
+}
+
+void test_iface() {
+    std::multimap<std::string, std::pair<sylar::Address::ptr, uint32_t>> results;
+    if (!sylar::Address::GetInterfaceAddresses(results, AF_UNSPEC)) {
+        SYLAR_LOG_ERROR(g_logger) << "GetInterfaceAddresses fail";
+        return;
+    }
+    for (const auto &i : results) {
+        SYLAR_LOG_INFO(g_logger) << i.first << " - " << i.second.first->toString() << " - " << i.second.second;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    test_lookup();
+    test_ipv4();
+    test_unix();
+    test_iface();
+    SYLAR_LOG_INFO(g_logger) << "test_address ok";
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "sylar/binlog.h"
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int N = 100000;
+
+void test_write() {
+    sylar::Logger::ptr binLogger = SYLAR_LOG_NAME("binlog");
+    sylar::BinaryLogAppender::ptr binAppender{new sylar::BinaryLogAppender{"./binlog.bin"}};
+    binLogger->setLevel(sylar::LogLevel::DEBUG);
+    binLogger->addAppender(binAppender);
+
+    sylar::Logger::ptr textLogger = SYLAR_LOG_NAME("textlog");
+    textLogger->setLevel(sylar::LogLevel::DEBUG);
+    textLogger->addAppender(std::make_shared<sylar::FileLogAppender>("./textlog.txt"));
+
+    uint64_t begin = sylar::GetCurrentUS();
+    for (int i = 0; i < N; ++i) {
+        SYLAR_LOG_BIN_DEBUG(binLogger, "request id=%d user=%s cost=%.3fms ok=%d", i, "sylar", i * 0.001, i % 2 == 0);
+    }
+    uint64_t binCost = sylar::GetCurrentUS() - begin;
+
+    begin = sylar::GetCurrentUS();
+    for (int i = 0; i < N; ++i) {
+        SYLAR_LOG_FMT_DEBUG(textLogger, "request id=%d user=%s cost=%.3fms ok=%d", i, "sylar", i * 0.001, i % 2 == 0);
+    }
+    uint64_t textCost = sylar::GetCurrentUS() - begin;
+
+    SYLAR_LOG_BIN_INFO(binLogger, "no argument record");
+    // 文本事件的描述符缓存在调用点, 同一调用点只注册一次
+    for (int i = 0; i < 3; ++i) {
+        SYLAR_LOG_INFO(binLogger) << "text record through binary appender " << i;
+    }
+    binAppender->flush();
+
+    SYLAR_LOG_INFO(g_logger) << N << " records, binary: " << binCost << "us, text: " << textCost << "us";
+}
+
+void test_read() {
+    sylar::BinLogReader reader{"./binlog.bin"};
+    sylar::LogFormatter::ptr formatter{new sylar::LogFormatter{"%d%T[%p]%T[%c]%T%f:%l%T%m%n"}};
+    int count = 0;
+    sylar::LogEvent::ptr last;
+    while (sylar::LogEvent::ptr event = reader.next()) {
+        if (count++ < 3) {
+            SYLAR_LOG_INFO(g_logger) << "decoded: " << formatter->format(event);
+        }
+        last = event;
+    }
+    SYLAR_LOG_INFO(g_logger) << "decoded " << count << " records, last: " << formatter->format(last);
+    SYLAR_ASSERT(count == N + 4 && last->getContent() == "text record through binary appender 2");
+}
+
+static size_t count_headers(const std::string &file) {
+    std::ifstream ifs{file, std::ios::binary};
+    std::string data{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+    size_t count = 0;
+    for (size_t pos = data.find(sylar::binlog::MAGIC); pos != std::string::npos;
+         pos = data.find(sylar::binlog::MAGIC, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// 定期重新打开时路径仍是同一个文件, 不重复写头和描述符; 文件被轮转后新文件可以独立解码
+void test_reopen() {
+    sylar::FSUtil::Unlink("./binlog_reopen.bin");
+    sylar::FSUtil::Unlink("./binlog_rotated.bin");
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("binlog_reopen");
+    sylar::BinaryLogAppender::ptr appender{new sylar::BinaryLogAppender{"./binlog_reopen.bin"}};
+    logger->setLevel(sylar::LogLevel::DEBUG);
+    logger->addAppender(appender);
+
+    SYLAR_LOG_BIN_INFO(logger, "before rotate %d", 1);
+    for (int i = 0; i < 3; ++i) {
+        SYLAR_ASSERT(appender->reopen());
+    }
+    SYLAR_LOG_BIN_INFO(logger, "before rotate %d", 2);
+    appender->flush();
+    SYLAR_ASSERT(count_headers("./binlog_reopen.bin") == 1);
+
+    rename("./binlog_reopen.bin", "./binlog_rotated.bin");
+    SYLAR_ASSERT(appender->reopen());
+    SYLAR_LOG_BIN_INFO(logger, "after rotate %d", 3);
+    appender->flush();
+
+    sylar::BinLogReader reader{"./binlog_reopen.bin"};
+    sylar::LogEvent::ptr event = reader.next();
+    SYLAR_ASSERT(event && event->getContent() == "after rotate 3" && !reader.next());
+    SYLAR_ASSERT(count_headers("./binlog_rotated.bin") == 1);
+    logger->clearAppenders();
+    sylar::FSUtil::Unlink("./binlog_reopen.bin");
+    sylar::FSUtil::Unlink("./binlog_rotated.bin");
+    SYLAR_LOG_INFO(g_logger) << "reopen ok";
+}
+
+// 损坏的块长度不能导致按该长度分配内存
+void test_corrupt() {
+    for (uint32_t len : {0xffffffffu, sylar::binlog::MAX_CHUNK_LEN, 64u}) {
+        {
+            std::ofstream ofs{"./binlog_corrupt.bin", std::ios::binary | std::ios::trunc};
+            ofs.put(sylar::binlog::CHUNK_RECORD);
+            ofs.write(reinterpret_cast<const char *>(&len), sizeof len);
+            ofs.write("short", 5);
+        }
+        sylar::BinLogReader reader{"./binlog_corrupt.bin"};
+        SYLAR_ASSERT(reader.isOpen() && !reader.next());
+    }
+    sylar::FSUtil::Unlink("./binlog_corrupt.bin");
+    SYLAR_LOG_INFO(g_logger) << "corrupt ok";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::EnvMgr::GetInstance()->init(argc, argv);
+    sylar::FSUtil::Unlink("./binlog.bin");
+
+    test_write();
+    test_read();
+    test_reopen();
+    test_corrupt();
+
+    return 0;
+}
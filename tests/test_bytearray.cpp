@@ -0,0 +1,159 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 块很小时所有编码都会跨块
+static void test_codec(size_t blockSize, bool littleEndian) {
+    sylar::ByteArray ba{blockSize};
+    ba.setLittleEndian(littleEndian);
+    for (int i = 0; i < 100; ++i) {
+        ba.writeFint8(-i);
+        ba.writeFuint16(static_cast<uint16_t>(i * 631));
+        ba.writeFint32(-i * 100003);
+        ba.writeFuint64(0x0102030405060708ull * i);
+        ba.writeFloat(i * 0.5f);
+        ba.writeDouble(-i * 0.25);
+        ba.writeInt32(-i * 7919);
+        ba.writeUint32(i * 104729u);
+        ba.writeInt64(std::numeric_limits<int64_t>::min() + i);
+        ba.writeUint64(std::numeric_limits<uint64_t>::max() - i);
+        ba.writeStringF16("f16-" + std::to_string(i));
+        ba.writeStringF32(std::string(i, 'x'));
+        ba.writeStringVint("vint-" + std::to_string(i));
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        SYLAR_ASSERT(ba.readFint8() == static_cast<int8_t>(-i));
+        SYLAR_ASSERT(ba.readFuint16() == static_cast<uint16_t>(i * 631));
+        SYLAR_ASSERT(ba.readFint32() == -i * 100003);
+        SYLAR_ASSERT(ba.readFuint64() == 0x0102030405060708ull * i);
+        SYLAR_ASSERT(ba.readFloat() == i * 0.5f);
+        SYLAR_ASSERT(ba.readDouble() == -i * 0.25);
+        SYLAR_ASSERT(ba.readInt32() == -i * 7919);
+        SYLAR_ASSERT(ba.readUint32() == i * 104729u);
+        SYLAR_ASSERT(ba.readInt64() == std::numeric_limits<int64_t>::min() + i);
+        SYLAR_ASSERT(ba.readUint64() == std::numeric_limits<uint64_t>::max() - i);
+        SYLAR_ASSERT(ba.readStringF16() == "f16-" + std::to_string(i));
+        SYLAR_ASSERT(ba.readStringF32() == std::string(i, 'x'));
+        SYLAR_ASSERT(ba.readStringVint() == "vint-" + std::to_string(i));
+    }
+    SYLAR_ASSERT(ba.empty());
+}
+
+static void test_layout() {
+    sylar::ByteArray ba;
+    ba.writeFuint32(0x01020304);
+    SYLAR_ASSERT(ba.toString() == std::string("\x01\x02\x03\x04", 4));
+    ba.clear();
+    ba.writeUint32(300);
+    SYLAR_ASSERT(ba.toString() == "\xac\x02");
+    ba.clear();
+    ba.writeInt32(-1);
+    SYLAR_ASSERT(ba.toString() == "\x01");
+
+    // 数据不足时抛出异常且不消费
+    ba.clear();
+    ba.writeFuint16(7);
+    bool thrown = false;
+    try {
+        ba.readFuint32();
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    SYLAR_ASSERT(thrown && ba.size() == 2 && ba.readFuint16() == 7);
+
+    ba.writeFuint32(100);
+    ba.append("short");
+    thrown = false;
+    try {
+        ba.readStringF32();
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    SYLAR_ASSERT(thrown && ba.size() == 9);
+}
+
+static void test_chain() {
+    sylar::ByteArray body{16};
+    for (int i = 0; i < 10; ++i) {
+        body.append("0123456789");
+    }
+    // 在已有数据前插入长度头
+    body.prepend("HEAD", 4);
+    body.prepend("<", 1);
+    SYLAR_ASSERT(body.size() == 105 && body.toString().substr(0, 7) == "<HEAD01");
+
+    uint64_t allocs = sylar::ByteArray::GetBlockAllocs();
+    uint64_t reuses = sylar::ByteArray::GetBlockReuses();
+    sylar::ByteArray copy = body;
+    sylar::ByteArray view = body.slice(5, 20);
+    sylar::ByteArray head = body.split(5);
+    SYLAR_ASSERT(head.toString() == "<HEAD" && body.size() == 100);
+    SYLAR_ASSERT(view.toString() == "01234567890123456789");
+    SYLAR_ASSERT(copy.size() == 105);
+    sylar::ByteArray joined = head;
+    joined.append(body);
+    SYLAR_ASSERT(joined.toString() == copy.toString());
+    // 以上操作都不分配新块
+    SYLAR_ASSERT(sylar::ByteArray::GetBlockAllocs() == allocs && sylar::ByteArray::GetBlockReuses() == reuses);
+
+    // 共享的块不会被原地改写
+    head.append("!");
+    SYLAR_ASSERT(head.toString() == "<HEAD!" && copy.toString().substr(0, 6) == "<HEAD0");
+    view.consume(15);
+    SYLAR_ASSERT(view.toString() == "56789");
+
+    std::vector<iovec> iovs;
+    SYLAR_ASSERT(body.getReadBuffers(iovs, 50) == 50);
+    size_t total = 0;
+    for (const auto &iov : iovs) {
+        total += iov.iov_len;
+    }
+    SYLAR_ASSERT(total == 50 && iovs.size() > 1);
+}
+
+static void test_fd() {
+    int fds[2];
+    SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    sylar::ByteArray out;
+    std::string expect;
+    for (int i = 0; i < 2000; ++i) {
+        std::string line = "line " + std::to_string(i) + "\n";
+        out.append(line);
+        expect += line;
+    }
+
+    sylar::ByteArray in;
+    while (!out.empty() || in.size() < expect.size()) {
+        if (!out.empty()) {
+            SYLAR_ASSERT(out.writeFd(fds[0]) > 0 || errno == EAGAIN);
+        }
+        ssize_t n = in.readFd(fds[1], 8192);
+        SYLAR_ASSERT(n > 0 || errno == EAGAIN);
+    }
+    SYLAR_ASSERT(in.toString() == expect);
+    SYLAR_LOG_INFO(g_logger) << "fd ok size=" << in.size();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char *argv[]) {
+    for (size_t blockSize : {1, 16, 4096}) {
+        test_codec(blockSize, false);
+        test_codec(blockSize, true);
+    }
+    test_layout();
+    test_chain();
+    test_fd();
+    SYLAR_LOG_INFO(g_logger) << "allocs=" << sylar::ByteArray::GetBlockAllocs()
+                             << " reuses=" << sylar::ByteArray::GetBlockReuses();
+    return 0;
+}
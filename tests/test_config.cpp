@@ -166,6 +166,9 @@ int main(int argc, char *argv[]) {
     sylar::Config::Visit([](sylar::ConfigVarBase::ptr var) {
         SYLAR_LOG_INFO(g_logger) << "name=" << var->getName() << " description=" << var->getDescription()
                                  << " typename=" << var->getTypeName() << " value=" << var->toString();
+        // 回调中可以再查找或注册配置项
+        SYLAR_ASSERT(sylar::Config::LookupBase(var->getName()) == var);
+        sylar::Config::Lookup("visit.registered", 0, "registered inside Visit");
     });
 
     return 0;
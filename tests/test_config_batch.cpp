@@ -0,0 +1,103 @@
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int READERS = 4;
+static constexpr int RELOADS = 500;
+
+// 两个配置项总是在同一个文件中一起修改, 读者应看到相同的值
+static sylar::ConfigVar<int>::ptr g_low = sylar::Config::Lookup("batch.low", (int)0, "batch low");
+
+static sylar::ConfigVar<int>::ptr g_high = sylar::Config::Lookup("batch.high", (int)0, "batch high");
+
+// 同一批次中的更多配置项, 拉长发布窗口
+static constexpr int FILLERS = 26;
+static std::vector<sylar::ConfigVar<int>::ptr> s_fillers = []() {
+    std::vector<sylar::ConfigVar<int>::ptr> vars;
+    for (int i = 0; i < FILLERS; ++i) {
+        vars.push_back(sylar::Config::Lookup(std::string{"batch.filler_"} + char('a' + i), (int)0, "batch filler"));
+    }
+    return vars;
+}();
+
+static std::atomic<bool> s_stop{false};
+
+static void load(int val) {
+    YAML::Node root;
+    root["batch"]["low"] = val;
+    root["batch"]["high"] = val;
+    for (int i = 0; i < FILLERS; ++i) {
+        root["batch"][std::string{"filler_"} + char('a' + i)] = val;
+    }
+    sylar::Config::LoadFromYaml(root);
+}
+
+static void test_consistent() {
+    std::atomic<uint64_t> torn{0};
+    std::atomic<uint64_t> partial{0};
+    std::atomic<uint64_t> consistent_torn{0};
+    auto read = [&]() {
+        while (!s_stop.load(std::memory_order_relaxed)) {
+            int low = *g_low->getSnapshot();
+            int high = *g_high->getSnapshot();
+            torn += low != high;
+            // 值只增不减, 先读到的配置项已是新批次时, 后读的不能是旧值
+            int seen = 0;
+            for (auto &var : s_fillers) {
+                int val = var->getValue();
+                partial += val < seen;
+                seen = std::max(seen, *var->getShared());
+            }
+
+            sylar::Config::ReadConsistent([&]() {
+                low = *g_low->getSnapshot();
+                high = *g_high->getSnapshot();
+            });
+            consistent_torn += low != high;
+        }
+    };
+    std::vector<sylar::Thread::ptr> threads;
+    for (int i = 0; i < READERS; ++i) {
+        threads.emplace_back(new sylar::Thread{read, "reader_" + std::to_string(i)});
+    }
+
+    for (int i = 1; i <= RELOADS; ++i) {
+        load(i);
+    }
+    s_stop = true;
+    for (auto &thread : threads) {
+        thread->join();
+    }
+    SYLAR_LOG_INFO(g_logger) << RELOADS << " reloads version=" << sylar::Config::GetVersion()
+                             << " plain reads torn=" << torn << " partial=" << partial
+                             << " consistent reads torn=" << consistent_torn;
+    SYLAR_ASSERT(partial == 0);
+    SYLAR_ASSERT(consistent_torn == 0);
+}
+
+static void test_executor() {
+    sylar::IOManager iom{1, false, "config_listener"};
+    sylar::Config::SetListenerExecutor([&iom](std::function<void()> cb) { iom.schedule(cb); });
+
+    // 模拟重新打开文件等耗时操作, 监听器执行时同一批次的其他配置项已经生效
+    uint64_t id = g_low->addListener([](const int &old_value, const int &new_value) {
+        SYLAR_LOG_INFO(g_logger) << "low changed " << old_value << " -> " << new_value
+                                 << " high=" << g_high->getValue() << " on thread " << sylar::GetThreadName();
+        usleep(100 * 1000);
+    });
+
+    uint64_t start = sylar::GetCurrentMS();
+    load(-1);
+    SYLAR_LOG_INFO(g_logger) << "reload with slow listener cost " << sylar::GetCurrentMS() - start << "ms";
+
+    usleep(200 * 1000);
+    g_low->delListener(id);
+    sylar::Config::SetListenerExecutor(nullptr);
+}
+
+int main(int argc, char *argv[]) {
+    test_consistent();
+    test_executor();
+    return 0;
+}
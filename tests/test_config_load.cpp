@@ -0,0 +1,156 @@
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int GROUPS = 100;
+static constexpr int KEYS = 100;
+
+// 配置名不允许数字9, 用字母编号
+static std::string Name(int i) {
+    std::string name;
+    do {
+        name.push_back('a' + i % 26);
+        i /= 26;
+    } while (i);
+    return name;
+}
+
+static std::vector<sylar::ConfigVarBase::ptr> s_vars;
+
+static void register_vars() {
+    for (int g = 0; g < GROUPS; ++g) {
+        for (int k = 0; k < KEYS; ++k) {
+            std::string name = "bench.g" + Name(g) + ".k" + Name(k);
+            switch (k % 4) {
+                case 0:
+                case 1:
+                    s_vars.push_back(sylar::Config::Lookup(name, 0, ""));
+                    break;
+                case 2:
+                    s_vars.push_back(sylar::Config::Lookup(name, std::string{}, ""));
+                    break;
+                default:
+                    s_vars.push_back(sylar::Config::Lookup(name, std::map<std::string, int>{}, ""));
+                    break;
+            }
+        }
+    }
+}
+
+static YAML::Node make_conf(int version) {
+    YAML::Node root;
+    for (int g = 0; g < GROUPS; ++g) {
+        YAML::Node group;
+        for (int k = 0; k < KEYS; ++k) {
+            std::string key = "k" + Name(k);
+            switch (k % 4) {
+                case 0:
+                case 1:
+                    group[key] = g * KEYS + k + version;
+                    break;
+                case 2:
+                    group[key] = "value_" + Name(g * KEYS + k + version);
+                    break;
+                default:
+                    for (int i = 0; i < 8; ++i) {
+                        group[key]["item" + Name(i)] = i + version;
+                    }
+                    break;
+            }
+        }
+        root["bench"]["g" + Name(g)] = group;
+    }
+    return root;
+}
+
+// 改造前的加载方式: 展开整棵树, 逐项加锁查找, 非标量序列化成字符串再解析
+static void ListAllMember(const std::string &prefix, const YAML::Node &node,
+                          std::list<std::pair<std::string, const YAML::Node>> &output) {
+    output.push_back({prefix, node});
+    if (node.IsMap()) {
+        for (auto it = node.begin(); it != node.end(); ++it) {
+            ListAllMember(prefix.empty() ? it->first.Scalar() : prefix + "." + it->first.Scalar(), it->second, output);
+        }
+    }
+}
+
+static void legacy_load(const YAML::Node &root) {
+    std::list<std::pair<std::string, const YAML::Node>> all_nodes;
+    ListAllMember("", root, all_nodes);
+    for (auto &[name, node] : all_nodes) {
+        if (name.empty()) {
+            continue;
+        }
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (sylar::ConfigVarBase::ptr var = sylar::Config::LookupBase(name); var) {
+            if (node.IsScalar()) {
+                var->fromString(node.Scalar());
+            } else {
+                std::stringstream ss;
+                ss << node;
+                var->fromString(ss.str());
+            }
+        }
+    }
+}
+
+template <typename F>
+static void bench(const std::string &name, F load) {
+    uint64_t start = sylar::GetCurrentUS();
+    size_t applied = load();
+    SYLAR_LOG_INFO(g_logger) << name << ": applied=" << applied << " cost " << (sylar::GetCurrentUS() - start) / 1000.0
+                             << "ms";
+}
+
+// 两个来源设置同一配置项: 只重新加载a时, a中没有变化的键不会覆盖b的值
+static void test_sources() {
+    auto shared = sylar::Config::Lookup("source.shared", 0, "");
+    auto onlyA = sylar::Config::Lookup("source.only_a", 0, "");
+    sylar::Config::YamlHashes hashesA, hashesB;
+    YAML::Node a = YAML::Load("source: {shared: 1, only_a: 1}");
+    YAML::Node b = YAML::Load("source: {shared: 2}");
+    SYLAR_ASSERT(sylar::Config::LoadFromYaml(a, hashesA) == 2);
+    SYLAR_ASSERT(sylar::Config::LoadFromYaml(b, hashesB) == 1 && shared->getValue() == 2);
+    a["source"]["only_a"] = 3;
+    SYLAR_ASSERT(sylar::Config::LoadFromYaml(a, hashesA) == 1);
+    SYLAR_ASSERT(shared->getValue() == 2 && onlyA->getValue() == 3);
+
+    // 强制重新应用a后, a的哈希表仍然有效, 再次加载没有变化
+    SYLAR_ASSERT(sylar::Config::LoadFromYaml(a, hashesA, true) == 2 && shared->getValue() == 1);
+    SYLAR_ASSERT(sylar::Config::LoadFromYaml(a, hashesA) == 0);
+    SYLAR_LOG_INFO(g_logger) << "sources ok";
+}
+
+int main(int argc, char *argv[]) {
+    register_vars();
+    YAML::Node v1 = make_conf(1);
+    YAML::Node v2 = make_conf(2);
+    YAML::Node v3 = make_conf(2);
+    v3["bench"]["g" + Name(0)]["k" + Name(0)] = -1;
+
+    bench("legacy load v1", [&]() {
+        legacy_load(v1);
+        return s_vars.size();
+    });
+    bench("legacy load v2", [&]() {
+        legacy_load(v2);
+        return s_vars.size();
+    });
+    bench("legacy reload v2", [&]() {
+        legacy_load(v2);
+        return s_vars.size();
+    });
+
+    bench("load v1", [&]() { return sylar::Config::LoadFromYaml(v1); });
+    bench("load v2", [&]() { return sylar::Config::LoadFromYaml(v2); });
+    bench("reload v2 unchanged", [&]() { return sylar::Config::LoadFromYaml(v2); });
+    bench("load v2 with one key changed", [&]() { return sylar::Config::LoadFromYaml(v3); });
+    bench("force reload", [&]() { return sylar::Config::LoadFromYaml(v3, true); });
+
+    auto var = sylar::Config::Lookup<int>("bench.g" + Name(0) + ".k" + Name(0));
+    auto map = sylar::Config::Lookup<std::map<std::string, int>>("bench.g" + Name(1) + ".k" + Name(3));
+    SYLAR_LOG_INFO(g_logger) << "first=" << var->getValue() << " map=" << map->toString();
+
+    test_sources();
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int THREADS = 32;
+static constexpr uint64_t DURATION_MS = 1000;
+
+using ValueMap = std::map<std::string, int>;
+
+static sylar::ConfigVar<ValueMap>::ptr g_map_value = sylar::Config::Lookup("bench.map", ValueMap{}, "bench map");
+
+static sylar::ConfigVar<uint32_t>::ptr g_int_value =
+    sylar::Config::Lookup("bench.int", (uint32_t)128 * 1024, "bench int");
+
+// 改造之前的读路径: 读锁 + 按值拷贝
+class RWLockValue {
+public:
+    ValueMap getValue() {
+        sylar::RWMutex::ReadLock lock{m_mutex};
+        return m_val;
+    }
+
+    void setValue(const ValueMap &val) {
+        sylar::RWMutex::WriteLock lock{m_mutex};
+        m_val = val;
+    }
+
+private:
+    sylar::RWMutex m_mutex;
+    ValueMap m_val;
+};
+
+static RWLockValue s_rwlock_value;
+static std::atomic<bool> s_stop{false};
+static std::atomic<uint64_t> s_reads{0};
+
+template <typename F>
+void bench(const std::string &name, F read) {
+    s_stop = false;
+    s_reads = 0;
+    auto loop = [read]() {
+        uint64_t reads = 0;
+        size_t sum = 0;
+        while (!s_stop.load(std::memory_order_relaxed)) {
+            sum += read();
+            ++reads;
+        }
+        s_reads += reads + (sum == 0);
+    };
+    std::vector<sylar::Thread::ptr> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back(new sylar::Thread{loop, "bench_" + std::to_string(i)});
+    }
+    usleep(DURATION_MS * 1000);
+    s_stop = true;
+    for (auto &thread : threads) {
+        thread->join();
+    }
+    SYLAR_LOG_INFO(g_logger) << name << ": " << s_reads * 1000 / DURATION_MS << " reads/s with " << THREADS
+                             << " threads";
+}
+
+int main(int argc, char *argv[]) {
+    ValueMap map;
+    for (int i = 0; i < 64; ++i) {
+        map["key_" + std::to_string(i)] = i;
+    }
+    g_map_value->setValue(map);
+    s_rwlock_value.setValue(map);
+
+    bench("rwlock map copy", []() { return s_rwlock_value.getValue().size(); });
+    bench("rcu map copy", []() { return g_map_value->getValue().size(); });
+    bench("rcu map snapshot", []() { return g_map_value->getSnapshot()->size(); });
+    bench("rcu uint32 getValue", []() { return static_cast<size_t>(g_int_value->getValue()); });
+
+    // 读的同时不断发布新值
+    std::atomic<bool> stopWriter{false};
+    auto write = [&stopWriter]() {
+        uint32_t i = 0;
+        while (!stopWriter) {
+            g_int_value->setValue(++i);
+        }
+    };
+    sylar::Thread writer{write, "writer"};
+    bench("rcu uint32 getValue with writer", []() { return static_cast<size_t>(g_int_value->getValue()); });
+    stopWriter = true;
+    writer.join();
+    return 0;
+}
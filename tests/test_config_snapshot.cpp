@@ -0,0 +1,80 @@
+#include <unistd.h>
+#include <fstream>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int KEYS = 3000;
+
+static std::string Name(int i) {
+    std::string name;
+    do {
+        name.push_back('a' + i % 26);
+        i /= 26;
+    } while (i);
+    return name;
+}
+
+static sylar::ConfigVar<std::vector<int>>::ptr g_vec =
+    sylar::Config::Lookup("snap.vec", std::vector<int>{}, "snapshot vec");
+
+static sylar::ConfigVar<std::map<std::string, std::string>>::ptr g_map =
+    sylar::Config::Lookup("snap.map", std::map<std::string, std::string>{}, "snapshot map");
+
+static std::vector<sylar::ConfigVar<int>::ptr> s_ints;
+
+static void write_conf(const std::string &file, int version) {
+    std::ofstream ofs{file, std::ios::trunc};
+    ofs << "snap:\n    vec: [1, 2, 3, " << version << "]\n    map:\n        host: \"127.0.0.1\"\n        name: \"v"
+        << version << "\"\n    ints:\n";
+    for (int i = 0; i < KEYS; ++i) {
+        ofs << "        k" << Name(i) << ": " << i + version << "\n";
+    }
+}
+
+static void reset() {
+    g_vec->setValue({});
+    g_map->setValue({});
+    for (auto &var : s_ints) {
+        var->setValue(0);
+    }
+}
+
+static void load(const std::string &name, const std::string &dir, const std::string &snapshot) {
+    uint64_t start = sylar::GetCurrentUS();
+    sylar::Config::LoadFromConfDirCached(dir, snapshot);
+    SYLAR_LOG_INFO(g_logger) << name << " cost " << (sylar::GetCurrentUS() - start) / 1000.0 << "ms vec.size="
+                             << g_vec->getValue().size() << " map.name=" << g_map->getSnapshot()->at("name")
+                             << " last=" << s_ints.back()->getValue();
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 0; i < KEYS; ++i) {
+        s_ints.push_back(sylar::Config::Lookup("snap.ints.k" + Name(i), 0, ""));
+    }
+
+    char dir[] = "/tmp/sylar_snap_XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    std::string file = std::string(dir) + "/snap.yml";
+    std::string snapshot = std::string(dir) + "/config.snapshot";
+    write_conf(file, 1);
+
+    load("cold start from yaml", dir, snapshot);
+    reset();
+    load("restart from snapshot", dir, snapshot);
+
+    // 配置文件变化后快照失效, 回退到YAML并重新生成
+    usleep(10 * 1000);
+    write_conf(file, 2);
+    reset();
+    load("restart after conf changed", dir, snapshot);
+    reset();
+    load("restart from new snapshot", dir, snapshot);
+
+    unlink(file.c_str());
+    unlink(snapshot.c_str());
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <unistd.h>
+#include <fstream>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static sylar::ConfigVar<int>::ptr g_port = sylar::Config::Lookup("watch.port", (int)8080, "watch port");
+
+static sylar::ConfigVar<std::string>::ptr g_name =
+    sylar::Config::Lookup("watch.name", std::string("sylar"), "watch name");
+
+static void write_conf(const std::string &file, int port, const std::string &name) {
+    std::ofstream ofs{file, std::ios::trunc};
+    ofs << "watch:\n    port: " << port << "\n    name: " << name << "\n";
+}
+
+int main(int argc, char *argv[]) {
+    char dir[] = "/tmp/sylar_watch_XXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    std::string file = std::string(dir) + "/watch.yml";
+    write_conf(file, 8080, "sylar");
+
+    g_port->addListener([](const int &old_value, const int &new_value) {
+        SYLAR_LOG_INFO(g_logger) << "port changed " << old_value << " -> " << new_value << " on thread "
+                                 << sylar::GetThreadName();
+    });
+    g_name->addListener([](const std::string &old_value, const std::string &new_value) {
+        SYLAR_LOG_INFO(g_logger) << "name changed " << old_value << " -> " << new_value;
+    });
+
+    sylar::IOManager iom{1, false, "reactor"};
+    auto watcher = std::make_shared<sylar::ConfigWatcher>(dir, &iom);
+    watcher->start();
+    SYLAR_LOG_INFO(g_logger) << "initial reloads=" << watcher->getReloadCount();
+
+    // 连续写入只触发一次重新加载, 只有port发生变化
+    for (int i = 1; i <= 5; ++i) {
+        write_conf(file, 8080 + i, "sylar");
+        usleep(20 * 1000);
+    }
+    usleep(500 * 1000);
+    SYLAR_LOG_INFO(g_logger) << "after burst reloads=" << watcher->getReloadCount() << " port=" << g_port->getValue()
+                             << " name=" << g_name->getValue();
+
+    // 编辑器常用的写临时文件再改名
+    std::string tmp = std::string(dir) + "/.watch.yml.tmp";
+    write_conf(tmp, 8085, "renamed");
+    rename(tmp.c_str(), file.c_str());
+    usleep(500 * 1000);
+    SYLAR_LOG_INFO(g_logger) << "after rename reloads=" << watcher->getReloadCount() << " port=" << g_port->getValue()
+                             << " name=" << g_name->getValue();
+
+    watcher->stop();
+    watcher.reset();
+
+    // 写入的同时停止: 停止后fd被复用时不会残留该watcher注册的事件
+    for (int i = 0; i < 20; ++i) {
+        auto stress = std::make_shared<sylar::ConfigWatcher>(dir, &iom);
+        SYLAR_ASSERT(stress->start());
+        write_conf(file, 9000 + i, "stress");
+        stress->stop();
+        int fds[2];
+        SYLAR_ASSERT(pipe(fds) == 0);
+        sylar::Semaphore sem;
+        SYLAR_ASSERT(iom.addEvent(fds[0], sylar::IOManager::READ, [&sem] { sem.notify(); }));
+        SYLAR_ASSERT(write(fds[1], "x", 1) == 1);
+        sem.wait();
+        close(fds[0]);
+        close(fds[1]);
+    }
+    unlink(file.c_str());
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr uint64_t DURATION_MS = 200;
+static constexpr int THREAD_COUNTS[] = {1, 2, 4};
+
+void test_slot() {
+    sylar::FdManager *mgr = sylar::FdMgr::GetInstance();
+    int fds[2];
+    SYLAR_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    sylar::FdCtx *ctx = mgr->get(fds[0], true);
+    SYLAR_ASSERT(ctx && ctx->isSocket() && ctx->getSysNonBlock() && ctx->getFd() == fds[0]);
+    SYLAR_ASSERT(mgr->get(fds[0]) == ctx);
+
+    // 扩展到其他段不会移动已有槽位
+    int high = sylar::FdManager::SEGMENT_SIZE * 3 + 5;
+    SYLAR_ASSERT(dup2(fds[1], high) == high);
+    sylar::FdCtx *highCtx = mgr->get(high, true);
+    SYLAR_ASSERT(highCtx && highCtx->getFd() == high);
+    SYLAR_ASSERT(mgr->get(fds[0]) == ctx);
+    SYLAR_ASSERT(mgr->get(sylar::FdManager::MAX_FD) == nullptr && mgr->get(-1) == nullptr);
+
+    // 关闭后槽位失效, fd复用时地址不变但generation改变
+    uint32_t generation = ctx->getGeneration();
+    int fd = fds[0];
+    close(fd);
+    SYLAR_ASSERT(mgr->get(fd) == nullptr && ctx->isClose());
+    SYLAR_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0 && fds[0] == fd);
+    SYLAR_ASSERT(mgr->get(fd, true) == ctx && ctx->getGeneration() != generation);
+    SYLAR_LOG_INFO(g_logger) << "slot ok, generation " << generation << " -> " << ctx->getGeneration();
+
+    close(fds[0]);
+    close(fds[1]);
+    close(high);
+
+    // 经hook看不到的途径(如fclose)关闭后槽位残留, 新建的socket重新初始化该槽位
+    int file = open("/dev/null", O_RDONLY);
+    sylar::FdCtx *stale = mgr->get(file, true);
+    SYLAR_ASSERT(stale && !stale->isSocket());
+    close_f(file);
+    sylar::set_hook_enable(true);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sylar::set_hook_enable(false);
+    SYLAR_ASSERT(sock == file && mgr->get(file) == stale && stale->isSocket());
+    close(sock);
+    SYLAR_LOG_INFO(g_logger) << "stale slot ok";
+}
+
+void test_io() {
+    sylar::IOManager iom{1, true, "fd_table"};
+
+    iom.schedule([] {
+        int fds[2];
+        SYLAR_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        sylar::FdMgr::GetInstance()->get(fds[0], true);
+        sylar::FdMgr::GetInstance()->get(fds[1], true);
+
+        timeval tv{0, 100 * 1000};
+        setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        char buf[16];
+        uint64_t start = sylar::GetCurrentMS();
+        ssize_t n = recv(fds[0], buf, sizeof buf, 0);
+        SYLAR_LOG_INFO(g_logger) << "recv timeout n=" << n << " errno=" << errno
+                                 << " elapsed=" << sylar::GetCurrentMS() - start << "ms";
+        SYLAR_ASSERT(n == -1 && errno == ETIMEDOUT);
+
+        // 另一个协程写入后唤醒
+        sylar::IOManager::GetThis()->schedule([fd = fds[1]] { SYLAR_ASSERT(write(fd, "ping", 4) == 4); });
+        tv.tv_usec = 0;
+        tv.tv_sec = 1;
+        setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+        n = recv(fds[0], buf, sizeof buf, 0);
+        SYLAR_ASSERT(n == 4);
+
+#ifdef SYLAR_FD_STATS
+        sylar::FdCtx::Stats stats = sylar::FdMgr::GetInstance()->get(fds[0])->getStats();
+        SYLAR_LOG_INFO(g_logger) << stats.toString();
+        SYLAR_ASSERT(stats.m_values[sylar::FdCtx::BYTES_READ] == 4 && stats.m_values[sylar::FdCtx::PARKS] == 2);
+        SYLAR_ASSERT(stats.m_values[sylar::FdCtx::TIMEOUTS] == 1 && stats.m_values[sylar::FdCtx::PARK_TIME] >= 90000);
+        auto top = sylar::FdMgr::GetInstance()->topN(sylar::FdCtx::PARK_TIME, 1);
+        SYLAR_ASSERT(top.size() == 1 && top[0].m_fd == fds[0]);
+#endif
+
+        // 等待期间被另一个协程关闭, 返回EBADF而不是在复用的fd上继续读
+        sylar::IOManager::GetThis()->schedule([fd = fds[0]] { close(fd); });
+        n = recv(fds[0], buf, sizeof buf, 0);
+        SYLAR_LOG_INFO(g_logger) << "recv after close n=" << n << " errno=" << errno;
+        SYLAR_ASSERT(n == -1 && errno == EBADF);
+        close(fds[1]);
+
+        // 未开启hook的线程关闭时同样唤醒等待者, 否则IOManager的待处理事件数不归零而无法退出
+        SYLAR_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        sylar::FdMgr::GetInstance()->get(fds[0], true);
+        sylar::Thread::ptr closer{new sylar::Thread{[fd = fds[0]] {
+                                                        usleep(50 * 1000);
+                                                        close(fd);
+                                                    },
+                                                    "closer"}};
+        n = recv(fds[0], buf, sizeof buf, 0);
+        SYLAR_LOG_INFO(g_logger) << "recv after foreign close n=" << n << " errno=" << errno;
+        SYLAR_ASSERT(n == -1 && errno == EBADF);
+        closer->join();
+        close(fds[1]);
+    });
+}
+
+static uint64_t lookup_loop(int fd, const std::atomic<bool> &stop) {
+    uint64_t n = 0;
+    uint64_t sink = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        sylar::FdCtx *ctx = sylar::FdMgr::GetInstance()->get(fd);
+        sink += ctx->getTimeout(SO_RCVTIMEO) + ctx->isSocket();
+        ++n;
+    }
+    return sink ? n : n;
+}
+
+void bench_lookup() {
+    int fds[2];
+    SYLAR_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    sylar::FdMgr::GetInstance()->get(fds[0], true);
+
+    for (int threads : THREAD_COUNTS) {
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> ops{0};
+        std::vector<sylar::Thread::ptr> thrs;
+        for (int i = 0; i < threads; ++i) {
+            thrs.emplace_back(new sylar::Thread{[&, fd = fds[0]]() { ops += lookup_loop(fd, stop); },
+                                                "lookup_" + std::to_string(i)});
+        }
+        usleep(DURATION_MS * 1000);
+        stop = true;
+        for (auto &thr : thrs) {
+            thr->join();
+        }
+        SYLAR_LOG_INFO(g_logger) << "lookup threads=" << threads << " ops/s=" << ops * 1000 / DURATION_MS;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main(int argc, char *argv[]) {
+    test_slot();
+    bench_lookup();
+    // use_caller的IOManager会在主线程开启hook, 放在最后
+    test_io();
+    return 0;
+}
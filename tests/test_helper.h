@@ -0,0 +1,15 @@
+#pragma once
+
+#include <functional>
+#include "sylar/iomanager.h"
+#include "sylar/mutex.h"
+
+// 在iom的协程中执行cb, 调用线程等待其完成
+inline void run_in(sylar::IOManager &iom, std::function<void()> cb) {
+    sylar::Semaphore sem;
+    iom.schedule([&] {
+        cb();
+        sem.notify();
+    });
+    sem.wait();
+}
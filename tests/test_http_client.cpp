@@ -0,0 +1,225 @@
+#include <atomic>
+#include "sylar/http/http_connection.h"
+#include "sylar/http/http_server.h"
+#include "sylar/sylar.h"
+#include "tests/test_helper.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+using namespace sylar::http;
+
+static HttpServer::ptr start_server(sylar::IOManager &worker, sylar::Address::ptr &addr) {
+    auto server = std::make_shared<HttpServer>(true, &worker, &worker);
+    auto dispatch = server->getServletDispatch();
+    dispatch->addServlet("/hello", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody("hello " + std::string(req->getQuery()));
+        return 0;
+    });
+    dispatch->addServlet("/echo", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setHeader("X-Host", req->getHeader("host"));
+        rsp->setBody(std::string(req->getBody()));
+        return 0;
+    });
+    // /slow?ms
+    dispatch->addServlet("/slow", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        usleep(atoi(std::string(req->getQuery()).c_str()) * 1000);
+        rsp->setBody("slow");
+        return 0;
+    });
+    dispatch->addServlet("/stream", [](HttpRequest::ptr, HttpResponse::ptr rsp, HttpSession::ptr) {
+        auto n = std::make_shared<int>(0);
+        rsp->setStream([n](std::string &chunk) {
+            chunk = std::string(1000, 'a' + *n);
+            return ++*n < 5;
+        });
+        return 0;
+    });
+    dispatch->addServlet("/close", [](HttpRequest::ptr, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setClose(true);
+        rsp->setBody("bye");
+        return 0;
+    });
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+    return server;
+}
+
+static uint16_t port_of(const sylar::Address::ptr &addr) {
+    return std::static_pointer_cast<sylar::IPAddress>(addr)->getPort();
+}
+
+// 顺序请求只建立一个连接
+static void test_reuse(sylar::IOManager &client, const sylar::Address::ptr &addr) {
+    auto pool = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 4, 4, 30000, 0, &client);
+    run_in(client, [&] {
+        for (int i = 0; i < 20; ++i) {
+            auto rt = pool->doGet("/hello?" + std::to_string(i), 1000);
+            SYLAR_ASSERT2(rt->m_result == HttpResult::Error::OK, rt->toString());
+            SYLAR_ASSERT(rt->m_response->getBody() == "hello " + std::to_string(i));
+        }
+        auto rt = pool->doPost("/echo", 1000, {{"Content-Type", "text/plain"}}, "post body");
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody() == "post body");
+        SYLAR_ASSERT(rt->m_response->getHeader("X-Host") == "127.0.0.1:" + std::to_string(port_of(addr)));
+        rt = pool->doGet("/stream", 1000);
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody().size() == 5000);
+        rt = pool->doRequest(HttpMethod::HEAD, "/hello", 1000);
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody().empty());
+        rt = pool->doGet("/hello", 1000);
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody() == "hello ");
+    });
+    SYLAR_ASSERT(pool->getCreated() == 1 && pool->getTotal() == 1 && pool->getIdle() == 1);
+
+    // 服务端要求关闭的连接不放回池中
+    run_in(client, [&] {
+        auto rt = pool->doGet("/close", 1000);
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody() == "bye");
+    });
+    SYLAR_ASSERT(pool->getTotal() == 0 && pool->getIdle() == 0);
+    SYLAR_LOG_INFO(g_logger) << "reuse ok, created=" << pool->getCreated() << " reused=" << pool->getReused();
+}
+
+// 连接数达到上限时协程挂起等待, 不阻塞线程
+static void test_park(sylar::IOManager &client, const sylar::Address::ptr &addr) {
+    auto pool = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 2, 2, 30000, 0, &client);
+    const int count = 8;
+    std::atomic<int> ok{0};
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    uint64_t start = sylar::GetCurrentMS();
+    for (int i = 0; i < count; ++i) {
+        client.schedule([&] {
+            auto rt = pool->doGet("/slow?50", 3000);
+            if (rt->m_result == HttpResult::Error::OK && rt->m_response->getBody() == "slow") {
+                ++ok;
+            }
+            if (++done == count) {
+                sem.notify();
+            }
+        });
+    }
+    // 挂起期间同一线程上的其他协程仍可运行
+    std::atomic<bool> ran{false};
+    client.schedule([&] { ran = pool->getWaiters() > 0; });
+    sem.wait();
+    uint64_t elapsed = sylar::GetCurrentMS() - start;
+    SYLAR_ASSERT(ok == count && ran);
+    SYLAR_ASSERT(pool->getCreated() == 2 && pool->getTotal() == 2 && pool->getWaiters() == 0);
+    // 8个请求2个连接, 至少4轮
+    SYLAR_ASSERT(elapsed >= 200);
+    SYLAR_LOG_INFO(g_logger) << "park ok, elapsed=" << elapsed << "ms reused=" << pool->getReused();
+}
+
+static void test_timeout(sylar::IOManager &client, const sylar::Address::ptr &addr) {
+    auto pool = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 1, 1, 30000, 0, &client);
+
+    // 请求超时: 由fd的超时设置生效
+    run_in(client, [&] {
+        uint64_t start = sylar::GetCurrentMS();
+        auto rt = pool->doGet("/slow?300", 50);
+        SYLAR_ASSERT2(rt->m_result == HttpResult::Error::TIMEOUT, rt->toString());
+        SYLAR_ASSERT(sylar::GetCurrentMS() - start < 250);
+    });
+    SYLAR_ASSERT(pool->getTotal() == 0);
+
+    // 等待连接超时
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    client.schedule([&] {
+        auto rt = pool->doGet("/slow?300", 2000);
+        SYLAR_ASSERT(rt->m_result == HttpResult::Error::OK);
+        if (++done == 2) {
+            sem.notify();
+        }
+    });
+    client.schedule([&] {
+        usleep(20 * 1000);
+        auto rt = pool->doGet("/hello", 50);
+        SYLAR_ASSERT2(rt->m_result == HttpResult::Error::POOL_TIMEOUT, rt->toString());
+        if (++done == 2) {
+            sem.notify();
+        }
+    });
+    sem.wait();
+    SYLAR_ASSERT(pool->getWaiters() == 0 && pool->getTotal() == 1);
+    SYLAR_LOG_INFO(g_logger) << "timeout ok";
+}
+
+// 空闲连接到期由定时器关闭
+static void test_idle(sylar::IOManager &client, const sylar::Address::ptr &addr) {
+    auto pool = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 4, 4, 100, 0, &client);
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    for (int i = 0; i < 3; ++i) {
+        client.schedule([&] {
+            SYLAR_ASSERT(pool->doGet("/slow?20", 1000)->m_result == HttpResult::Error::OK);
+            if (++done == 3) {
+                sem.notify();
+            }
+        });
+    }
+    sem.wait();
+    SYLAR_ASSERT(pool->getIdle() == 3);
+    usleep(300 * 1000);
+    SYLAR_ASSERT(pool->getIdle() == 0 && pool->getTotal() == 0);
+
+    // idle_timeout为0时不淘汰, 空闲连接照常复用
+    auto keep = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 4, 4, 0, 0, &client);
+    run_in(client, [&] {
+        for (int i = 0; i < 3; ++i) {
+            SYLAR_ASSERT(keep->doGet("/slow?1", 1000)->m_result == HttpResult::Error::OK);
+        }
+    });
+    SYLAR_ASSERT(keep->getCreated() == 1 && keep->getReused() == 2);
+    SYLAR_LOG_INFO(g_logger) << "idle eviction ok";
+}
+
+// 服务端关闭了空闲连接, 检出时发现并新建连接
+static void test_health(sylar::IOManager &client, const sylar::Address::ptr &addr, HttpServer::ptr server) {
+    auto pool = std::make_shared<HttpConnectionPool>("127.0.0.1", port_of(addr), 4, 4, 30000, 0, &client);
+    server->setRecvTimeout(50);
+    run_in(client, [&] {
+        SYLAR_ASSERT(pool->doGet("/hello", 1000)->m_result == HttpResult::Error::OK);
+        usleep(200 * 1000);
+        SYLAR_ASSERT(pool->doGet("/hello", 1000)->m_result == HttpResult::Error::OK);
+    });
+    SYLAR_ASSERT(pool->getCreated() == 2 && pool->getTotal() == 1);
+    server->setRecvTimeout(120 * 1000);
+    SYLAR_LOG_INFO(g_logger) << "health check ok";
+}
+
+static void test_client(sylar::IOManager &client, const sylar::Address::ptr &addr) {
+    HttpClient http{&client};
+    std::string base = "http://127.0.0.1:" + std::to_string(port_of(addr));
+    run_in(client, [&] {
+        auto rt = http.doGet(base + "/hello?x=1#frag", 1000);
+        SYLAR_ASSERT2(rt->m_result == HttpResult::Error::OK && rt->m_response->getBody() == "hello x=1",
+                      rt->toString());
+        SYLAR_ASSERT(http.doGet(base + "?y", 1000)->m_response->getStatus() == HttpStatus::NOT_FOUND);
+        SYLAR_ASSERT(http.doGet("ftp://127.0.0.1/", 1000)->m_result == HttpResult::Error::INVALID_URL);
+        SYLAR_ASSERT(http.doGet("http://127.0.0.1:0/", 1000)->m_result == HttpResult::Error::INVALID_URL);
+        // 没有监听的端口
+        auto refused = http.doGet("http://127.0.0.1:1/", 1000);
+        SYLAR_ASSERT(refused->m_result == HttpResult::Error::CONNECT_FAIL);
+        SYLAR_ASSERT(http.getPool("127.0.0.1", 1)->getTotal() == 0);
+    });
+    SYLAR_ASSERT(http.getPool("127.0.0.1", port_of(addr))->getCreated() == 1);
+    SYLAR_LOG_INFO(g_logger) << "client ok";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::IOManager worker{1, false, "worker"};
+    sylar::IOManager client{1, false, "client"};
+    sylar::Address::ptr addr;
+    HttpServer::ptr server = start_server(worker, addr);
+
+    test_reuse(client, addr);
+    test_park(client, addr);
+    test_timeout(client, addr);
+    test_idle(client, addr);
+    test_health(client, addr, server);
+    test_client(client, addr);
+
+    server->stop(1000);
+    return 0;
+}
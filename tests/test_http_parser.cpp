@@ -0,0 +1,141 @@
+#include "sylar/http/http_parser.h"
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+using sylar::http::HttpRequestParser;
+using sylar::http::HttpStatus;
+
+// 每次只多给一个字节, 并且每次都换一块缓冲区, 检查增量解析和偏移记录
+static HttpRequestParser::Result feed_bytewise(HttpRequestParser &parser, const std::string &msg, std::string &buf) {
+    HttpRequestParser::Result rt = HttpRequestParser::AGAIN;
+    std::string moved;
+    for (size_t i = 1; i <= msg.size() && rt == HttpRequestParser::AGAIN; ++i) {
+        moved = buf;
+        moved.append(msg, i - 1, 1);
+        buf.swap(moved);
+        rt = parser.execute(&buf[0], buf.size());
+    }
+    return rt;
+}
+
+static void test_request() {
+    const std::string msg =
+        "GET /index.html?a=1&b=2#top HTTP/1.1\r\n"
+        "Host: example.com\r\n"
+        "X-Spaces:   padded value  \r\n"
+        "Content-Length: 5\r\n"
+        "\r\n"
+        "hello";
+
+    HttpRequestParser parser;
+    std::string buf = msg;
+    SYLAR_ASSERT(parser.execute(&buf[0], buf.size()) == HttpRequestParser::DONE);
+    auto req = parser.getRequest();
+    SYLAR_ASSERT(req->getMethod() == sylar::http::HttpMethod::GET);
+    SYLAR_ASSERT(req->getPath() == "/index.html" && req->getQuery() == "a=1&b=2" && req->getFragment() == "top");
+    SYLAR_ASSERT(req->getHeader("host") == "example.com" && req->getHeader("x-spaces") == "padded value");
+    SYLAR_ASSERT(req->getBody() == "hello" && !req->isClose());
+    SYLAR_ASSERT(parser.getMessageSize() == msg.size());
+    // 零拷贝: 字段指向接收缓冲区
+    SYLAR_ASSERT(req->getPath().data() >= buf.data() && req->getPath().data() < buf.data() + buf.size());
+
+    parser.reset();
+    buf.clear();
+    SYLAR_ASSERT(feed_bytewise(parser, msg, buf) == HttpRequestParser::DONE);
+    SYLAR_ASSERT(parser.getRequest()->getBody() == "hello" && parser.getRequest()->getHeader("Host") == "example.com");
+    SYLAR_LOG_INFO(g_logger) << "\n" << *parser.getRequest();
+}
+
+static void test_chunked() {
+    const std::string msg =
+        "POST /upload HTTP/1.1\r\n"
+        "Transfer-Encoding: gzip, chunked\r\n"
+        "\r\n"
+        "5;ext=1\r\nhello\r\n"
+        "1\r\n \r\n"
+        "a\r\n0123456789\r\n"
+        "0\r\n"
+        "Trailer: x\r\n"
+        "\r\n";
+    for (int bytewise = 0; bytewise < 2; ++bytewise) {
+        HttpRequestParser parser;
+        std::string buf = bytewise ? "" : msg;
+        auto rt = bytewise ? feed_bytewise(parser, msg, buf) : parser.execute(&buf[0], buf.size());
+        SYLAR_ASSERT(rt == HttpRequestParser::DONE);
+        SYLAR_ASSERT(parser.getRequest()->isChunked());
+        SYLAR_ASSERT(parser.getRequest()->getBody() == "hello 0123456789");
+        SYLAR_ASSERT(parser.getMessageSize() == msg.size());
+    }
+}
+
+static void test_pipeline() {
+    std::string buf =
+        "GET /a HTTP/1.1\r\n\r\n"
+        "GET /b HTTP/1.0\r\n\r\n"
+        "GET /c HTTP/1.0\r\nConnection: keep-alive\r\n\r\n";
+    HttpRequestParser parser;
+    size_t start = 0;
+    const char *paths[] = {"/a", "/b", "/c"};
+    const bool closes[] = {false, true, false};
+    for (int i = 0; i < 3; ++i) {
+        parser.reset();
+        SYLAR_ASSERT(parser.execute(&buf[start], buf.size() - start) == HttpRequestParser::DONE);
+        SYLAR_ASSERT(parser.getRequest()->getPath() == paths[i] && parser.getRequest()->isClose() == closes[i]);
+        start += parser.getMessageSize();
+    }
+    SYLAR_ASSERT(start == buf.size());
+}
+
+static void expect_error(std::string msg, HttpStatus status) {
+    HttpRequestParser parser;
+    SYLAR_ASSERT2(parser.execute(&msg[0], msg.size()) == HttpRequestParser::FAILED, msg.substr(0, 64));
+    SYLAR_ASSERT2(parser.getError() == status, msg.substr(0, 64));
+}
+
+static void test_errors() {
+    expect_error("BREW /pot HTTP/1.1\r\n\r\n", HttpStatus::NOT_IMPLEMENTED);
+    expect_error("GET / HTTP/2.0\r\n\r\n", HttpStatus::HTTP_VERSION_NOT_SUPPORTED);
+    expect_error("GET / FTP\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nBad Name: x\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", HttpStatus::BAD_REQUEST);
+    expect_error("GET / HTTP/1.1\r\nX: " + std::string(70000, 'x'), HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+    expect_error("POST / HTTP/1.1\r\nContent-Length: 999999999999\r\n\r\n", HttpStatus::PAYLOAD_TOO_LARGE);
+}
+
+// 解析吞吐, 对比不同的扫描实现
+static void bench_parse() {
+    std::string msg =
+        "GET /api/v1/users/12345/profile?fields=name,email HTTP/1.1\r\n"
+        "Host: api.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+        "Chrome/120.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.9\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=en\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    HttpRequestParser parser;
+    const int n = 100000;
+    uint64_t start = sylar::GetCurrentUS();
+    for (int i = 0; i < n; ++i) {
+        parser.reset();
+        SYLAR_ASSERT(parser.execute(&msg[0], msg.size()) == HttpRequestParser::DONE);
+    }
+    uint64_t us = std::max<uint64_t>(sylar::GetCurrentUS() - start, 1);
+    SYLAR_LOG_INFO(g_logger) << "parse " << n * 1000000ull / us << " req/s " << msg.size() * n / us << " MB/s";
+}
+
+int main(int argc, char *argv[]) {
+    test_request();
+    test_chunked();
+    test_pipeline();
+    test_errors();
+    bench_parse();
+    return 0;
+}
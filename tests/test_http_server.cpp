@@ -0,0 +1,240 @@
+#include "sylar/http/http_server.h"
+#include "sylar/sylar.h"
+#include "tests/test_helper.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+using namespace sylar::http;
+
+struct Reply {
+    int m_status = 0;
+    bool m_close = false;
+    std::string m_headers;
+    std::string m_body;
+};
+
+// 简单的客户端: 从buf中取出一个完整响应, 数据不够时继续接收
+class RawClient {
+public:
+    bool connect(const sylar::Address::ptr &addr) {
+        m_sock = sylar::Socket::CreateTCP(addr);
+        if (!m_sock->connect(addr, 1000)) {
+            return false;
+        }
+        m_sock->setRecvTimeout(3000);
+        return true;
+    }
+
+    bool send(const std::string &data) {
+        return m_sock->send(data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    }
+
+    // HEAD请求的响应只有头部
+    bool recvReply(Reply &reply, bool head = false) {
+        size_t pos;
+        while ((pos = m_buf.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        reply.m_headers = m_buf.substr(0, pos + 2);
+        m_buf.erase(0, pos + 4);
+        reply.m_status = atoi(reply.m_headers.c_str() + 9);
+        reply.m_close = reply.m_headers.find("Connection: close\r\n") != std::string::npos;
+        reply.m_body.clear();
+        if (head) {
+            return true;
+        }
+
+        if (reply.m_headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos) {
+            while (true) {
+                while ((pos = m_buf.find("\r\n")) == std::string::npos) {
+                    if (!fill()) {
+                        return false;
+                    }
+                }
+                size_t len = strtoul(m_buf.c_str(), nullptr, 16);
+                if (!readExactly(pos + 2 + len + 2)) {
+                    return false;
+                }
+                reply.m_body.append(m_buf, pos + 2, len);
+                m_buf.erase(0, pos + 2 + len + 2);
+                if (len == 0) {
+                    return true;
+                }
+            }
+        }
+        pos = reply.m_headers.find("Content-Length: ");
+        size_t len = pos == std::string::npos ? 0 : atoi(reply.m_headers.c_str() + pos + 16);
+        if (!readExactly(len)) {
+            return false;
+        }
+        reply.m_body = m_buf.substr(0, len);
+        m_buf.erase(0, len);
+        return true;
+    }
+
+    // 对端是否已关闭连接
+    bool isPeerClosed() {
+        char c;
+        return m_buf.empty() && m_sock->recv(&c, 1) == 0;
+    }
+
+private:
+    bool fill() {
+        char buf[4096];
+        ssize_t n = m_sock->recv(buf, sizeof buf);
+        if (n <= 0) {
+            return false;
+        }
+        m_buf.append(buf, n);
+        return true;
+    }
+
+    bool readExactly(size_t len) {
+        while (m_buf.size() < len) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    sylar::Socket::ptr m_sock;
+    std::string m_buf;
+};
+
+static void setup_routes(ServletDispatch::ptr dispatch) {
+    dispatch->addServlet("/hello", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("hello " + std::string(req->getQuery()));
+        return 0;
+    });
+    dispatch->addPrefixServlet("/static/", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody("static:" + std::string(req->getPath()));
+        return 0;
+    });
+    dispatch->addPrefixServlet("/static/img/", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody("img:" + std::string(req->getPath()));
+        return 0;
+    });
+    dispatch->addGlobServlet("/api/*/info", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody("glob:" + std::string(req->getPath()));
+        return 0;
+    });
+    dispatch->addServlet("/echo", [](HttpRequest::ptr req, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody(std::string(req->getBody()));
+        return 0;
+    });
+    dispatch->addServlet("/large", [](HttpRequest::ptr, HttpResponse::ptr rsp, HttpSession::ptr) {
+        rsp->setBody(std::string(100000, 'L'));
+        return 0;
+    });
+    dispatch->addServlet("/stream", [](HttpRequest::ptr, HttpResponse::ptr rsp, HttpSession::ptr) {
+        auto n = std::make_shared<int>(0);
+        rsp->setStream([n](std::string &chunk) {
+            chunk = "part" + std::to_string(*n);
+            return ++*n < 3;
+        });
+        return 0;
+    });
+}
+
+static void test_server() {
+    sylar::IOManager acceptor{1, false, "accept"};
+    sylar::IOManager worker{1, false, "worker"};
+    sylar::IOManager client{1, false, "client"};
+
+    auto server = std::make_shared<HttpServer>(true, &worker, &acceptor);
+    setup_routes(server->getServletDispatch());
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    // 路由和长连接
+    run_in(client, [&] {
+        RawClient c;
+        SYLAR_ASSERT(c.connect(addr));
+        struct {
+            const char *m_path;
+            int m_status;
+            const char *m_body;
+        } cases[] = {
+            {"/hello?x=1", 200, "hello x=1"},
+            {"/static/a.css", 200, "static:/static/a.css"},
+            {"/static/img/b.png", 200, "img:/static/img/b.png"},
+            {"/api/v1/info", 200, "glob:/api/v1/info"},
+            {"/nothing", 404, nullptr},
+        };
+        Reply reply;
+        for (auto &i : cases) {
+            SYLAR_ASSERT(c.send(std::string("GET ") + i.m_path + " HTTP/1.1\r\nHost: test\r\n\r\n"));
+            SYLAR_ASSERT(c.recvReply(reply));
+            SYLAR_ASSERT2(reply.m_status == i.m_status, i.m_path);
+            SYLAR_ASSERT(!i.m_body || reply.m_body == i.m_body);
+            SYLAR_ASSERT(!reply.m_close);
+        }
+        SYLAR_LOG_INFO(g_logger) << "routes ok";
+    });
+
+    // 流水线: 一次发出多个请求, 按顺序收到响应
+    run_in(client, [&] {
+        RawClient c;
+        SYLAR_ASSERT(c.connect(addr));
+        SYLAR_ASSERT(c.send("GET /hello?1 HTTP/1.1\r\n\r\n"
+                            "POST /echo HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody"
+                            "GET /hello?3 HTTP/1.1\r\n\r\n"
+                            "HEAD /large HTTP/1.1\r\n\r\n"
+                            "GET /large HTTP/1.1\r\n\r\n"));
+        Reply reply;
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == "hello 1");
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == "body");
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == "hello 3");
+        SYLAR_ASSERT(c.recvReply(reply, true));
+        SYLAR_ASSERT(reply.m_headers.find("Content-Length: 100000\r\n") != std::string::npos);
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == std::string(100000, 'L'));
+        SYLAR_LOG_INFO(g_logger) << "pipeline ok";
+    });
+
+    // chunked请求体和流式响应
+    run_in(client, [&] {
+        RawClient c;
+        SYLAR_ASSERT(c.connect(addr));
+        SYLAR_ASSERT(c.send("POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                            "3\r\nabc\r\n4\r\ndefg\r\n0\r\n\r\n"));
+        Reply reply;
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == "abcdefg");
+        SYLAR_ASSERT(c.send("GET /stream HTTP/1.1\r\n\r\n"));
+        SYLAR_ASSERT(c.recvReply(reply) && reply.m_body == "part0part1part2");
+        SYLAR_ASSERT(reply.m_headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+        SYLAR_LOG_INFO(g_logger) << "chunked ok";
+    });
+
+    // Connection: close, HTTP/1.0和错误请求之后服务端关闭连接
+    const char *closing[] = {
+        "GET /hello HTTP/1.1\r\nConnection: close\r\n\r\n",
+        "GET /hello HTTP/1.0\r\n\r\n",
+        "GET /hello HTTP/1.1\r\nContent-Length: x\r\n\r\n",
+    };
+    const int statuses[] = {200, 200, 400};
+    for (int i = 0; i < 3; ++i) {
+        run_in(client, [&] {
+            RawClient c;
+            SYLAR_ASSERT(c.connect(addr));
+            SYLAR_ASSERT(c.send(closing[i]));
+            Reply reply;
+            SYLAR_ASSERT(c.recvReply(reply) && reply.m_status == statuses[i] && reply.m_close);
+            SYLAR_ASSERT(c.isPeerClosed());
+        });
+    }
+    SYLAR_LOG_INFO(g_logger) << "close ok";
+
+    server->stop(1000);
+    SYLAR_ASSERT(server->getConnections() == 0);
+}
+
+int main(int argc, char *argv[]) {
+    test_server();
+    return 0;
+}
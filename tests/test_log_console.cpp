@@ -0,0 +1,78 @@
+#include <unistd.h>
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static const char *s_conf = R"(
+logs:
+    - name: console
+      level: info
+      appenders:
+          - type: ConsoleLogAppender
+            stream: stderr
+            overflow: drop_old
+            max_queue: 65536
+            pattern: "%d%T%t%T%m%n"
+)";
+
+static std::atomic<bool> s_reading{false};
+static std::atomic<uint64_t> s_readBytes{0};
+
+// 模拟一个消费很慢的日志收集端: 开始读取之前管道一直是满的
+void collector(int fd) {
+    char buf[4096];
+    while (!s_reading) {
+        usleep(10 * 1000);
+    }
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof buf)) > 0) {
+        s_readBytes += n;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int fds[2];
+    if (pipe(fds)) {
+        return 1;
+    }
+    dup2(fds[1], STDERR_FILENO);
+    close(fds[1]);
+    sylar::Thread::ptr thread{new sylar::Thread{std::bind(collector, fds[0]), "collector"}};
+
+    sylar::Config::LoadFromYaml(YAML::Load(s_conf));
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("console");
+    SYLAR_LOG_INFO(g_logger) << logger->toYamlString();
+
+    static constexpr int COUNT = 100000;
+    uint64_t start = sylar::GetElapsedMS();
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_INFO(logger) << "console record " << i;
+    }
+    SYLAR_LOG_INFO(g_logger) << COUNT << " records to a full pipe cost " << sylar::GetElapsedMS() - start << "ms";
+
+    // 换成直接创建的appender, 以便读取丢弃统计
+    sylar::Config::LoadFromYaml(YAML::Load("logs: []"));
+    sylar::ConsoleLogAppender::ptr appender{
+        new sylar::ConsoleLogAppender{"stderr", sylar::ConsoleLogAppender::DROP_NEW, 1024 * 1024}};
+    appender->setFormatter(std::make_shared<sylar::LogFormatter>("%m%n"));
+    logger->addAppender(appender);
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_INFO(logger) << "console record " << i;
+    }
+    SYLAR_LOG_INFO(g_logger) << "queued=" << appender->getQueuedBytes()
+                             << " dropped_bytes=" << appender->getDroppedBytes()
+                             << " dropped_records=" << appender->getDroppedRecords();
+
+    s_reading = true;
+    while (appender->getQueuedBytes()) {
+        usleep(10 * 1000);
+    }
+    SYLAR_LOG_INFO(g_logger) << "queue drained, collector read " << s_readBytes << " bytes";
+
+    logger->clearAppenders();
+    appender.reset();
+    close(STDERR_FILENO);
+    thread->join();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <limits>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static const char *s_conf = R"(
+logs:
+    - name: json
+      level: debug
+      appenders:
+          - type: StdoutLogAppender
+            format: json
+    - name: logfmt
+      level: debug
+      appenders:
+          - type: StdoutLogAppender
+            format: logfmt
+    - name: bench
+      level: debug
+      appenders:
+          - type: FileLogAppender
+            file: /dev/null
+            format: json
+)";
+
+void test_fields(sylar::Logger::ptr logger) {
+    SYLAR_LOG_KV_INFO(logger)
+            .with("fd", 12)
+            .with("bytes", 4096UL)
+            .with("ratio", 0.25)
+            .with("nan", std::numeric_limits<double>::quiet_NaN())
+            .with("ok", true)
+            .with("peer", "127.0.0.1:8020")
+            .with("path", std::string{"/a b/\"c\"=d"})
+        << "recv done";
+    SYLAR_LOG_KV_WARN(logger).with("raw", std::string{"tab\there\nnewline\x01 and a long tail without escapes"})
+        << "long message that is scanned sixteen bytes at a time \"quoted\"";
+    SYLAR_LOG_INFO(logger) << "plain record without fields";
+}
+
+// logfmt的键不能加引号, 特殊字符替换为'_'
+void test_logfmt_key() {
+    sylar::LogFormatter::ptr formatter{new sylar::LogFormatter{"%K"}};
+    sylar::LogEvent::ptr event{new sylar::LogEvent{"logfmt", sylar::LogLevel::INFO, __FILE__, __LINE__, 0, 0, 0,
+                                                   time(0), "main"}};
+    event->with("a b=c", 1).with("", 2).with("x\"y\n", 3);
+    std::string line = formatter->format(event);
+    SYLAR_ASSERT2(line.find(" a_b_c=1 _=2 x_y_=3") != std::string::npos, line);
+}
+
+void test_benchmark() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("bench");
+    static constexpr int COUNT = 100000;
+    std::string payload(256, 'x');
+    uint64_t start = sylar::GetElapsedMS();
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_KV_INFO(logger).with("id", i).with("payload", payload).with("ok", true) << "json record";
+    }
+    SYLAR_LOG_INFO(g_logger) << COUNT << " json records with fields cost " << sylar::GetElapsedMS() - start << "ms";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Config::LoadFromYaml(YAML::Load(s_conf));
+    test_fields(SYLAR_LOG_NAME("json"));
+    test_fields(SYLAR_LOG_NAME("logfmt"));
+    test_logfmt_key();
+    test_benchmark();
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <unistd.h>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static const char *s_conf = R"(
+log:
+    limit:
+        summary_interval: 1000
+logs:
+    - name: limit
+      level: debug
+      rate_limit: 10
+      rate_burst: 5
+      appenders:
+          - type: StdoutLogAppender
+            pattern: "%d%T%f:%l%T%p%T%m%n"
+)";
+
+void test_limit() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("limit");
+    // 1.5秒内打出10000条, 预期约5 + 15条被输出, 其余在摘要中统计
+    for (int i = 0; i < 10000; ++i) {
+        SYLAR_LOG_LIMIT_WARN(logger) << "limited record " << i;
+        usleep(150);
+    }
+}
+
+void test_sample() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("limit");
+    for (int i = 0; i < 1000; ++i) {
+        SYLAR_LOG_SAMPLE_INFO(logger, 100) << "sampled record " << i;
+    }
+}
+
+// 统计输出的记录和摘要中被抑制的条数
+class CountAppender : public sylar::LogAppender {
+public:
+    CountAppender() : sylar::LogAppender{std::make_shared<sylar::LogFormatter>("%m")} {}
+
+    void log(sylar::LogEvent::ptr event) override {
+        std::string msg = event->getContent();
+        if (msg.compare(0, 11, "suppressed ") == 0) {
+            m_suppressed += std::stoull(msg.substr(11));
+        } else {
+            ++m_logged;
+        }
+    }
+
+    std::string toYamlString() override { return ""; }
+
+    std::atomic<uint64_t> m_logged{0};
+    std::atomic<uint64_t> m_suppressed{0};
+};
+
+// 多线程下输出的条数与被抑制的条数之和等于总条数
+void test_accounting() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("limit_count");
+    logger->setLevel(sylar::LogLevel::DEBUG);
+    logger->setRateLimit(10, 5);
+    auto appender = std::make_shared<CountAppender>();
+    logger->addAppender(appender);
+    static constexpr int THREADS = 4;
+    static constexpr int COUNT = 20000;
+    std::vector<sylar::Thread::ptr> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.push_back(std::make_shared<sylar::Thread>(
+            [logger] {
+                for (int j = 0; j < COUNT; ++j) {
+                    SYLAR_LOG_LIMIT_INFO(logger) << "counted record " << j;
+                }
+            },
+            "limit_" + std::to_string(i)));
+    }
+    for (auto &thread : threads) {
+        thread->join();
+    }
+    // 等待一次完整的摘要周期
+    usleep(1300 * 1000);
+    SYLAR_LOG_INFO(g_logger) << "accounting logged=" << appender->m_logged << " suppressed=" << appender->m_suppressed;
+    SYLAR_ASSERT(appender->m_logged + appender->m_suppressed == THREADS * COUNT);
+}
+
+void test_benchmark() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("limit");
+    logger->setRateLimit(1, 1);
+    usleep(200 * 1000);
+    // 令牌耗尽后被抑制的记录只剩下级别判断、一次relaxed原子读和本线程计数
+    static constexpr int COUNT = 10000000;
+    uint64_t start = sylar::GetElapsedMS();
+    for (int i = 0; i < COUNT; ++i) {
+        SYLAR_LOG_LIMIT_DEBUG(logger) << "suppressed record " << i;
+    }
+    SYLAR_LOG_INFO(g_logger) << COUNT << " limited records cost " << sylar::GetElapsedMS() - start << "ms";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::Config::LoadFromYaml(YAML::Load(s_conf));
+    SYLAR_LOG_INFO(g_logger) << sylar::LoggerMgr::GetInstance()->getLogger("limit")->toYamlString();
+
+    test_limit();
+    test_sample();
+    test_accounting();
+    test_benchmark();
+    // 等待补充线程输出被抑制条数的摘要
+    sleep(2);
+    return 0;
+}
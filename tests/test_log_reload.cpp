@@ -0,0 +1,66 @@
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr int THREADS = 16;
+static constexpr int RELOADS = 500;
+
+static const char *s_conf_file = R"(
+logs:
+    - name: reload
+      level: debug
+      appenders:
+          - type: FileLogAppender
+            file: /dev/null
+            pattern: "%d%T%t%T%m%n"
+)";
+
+static const char *s_conf_binary = R"(
+logs:
+    - name: reload
+      level: info
+      appenders:
+          - type: BinaryLogAppender
+            file: /dev/null
+          - type: FileLogAppender
+            file: /dev/null
+)";
+
+static std::atomic<bool> s_stop{false};
+static std::atomic<uint64_t> s_records{0};
+
+void log_loop() {
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("reload");
+    uint64_t count = 0;
+    while (!s_stop.load(std::memory_order_relaxed)) {
+        SYLAR_LOG_INFO(logger) << "stress record " << count;
+        SYLAR_LOG_BIN_INFO(logger, "stress binary record %lu", count);
+        ++count;
+    }
+    s_records += count;
+}
+
+int main(int argc, char *argv[]) {
+    sylar::EnvMgr::GetInstance()->init(argc, argv);
+
+    std::vector<sylar::Thread::ptr> thrs;
+    for (int i = 0; i < THREADS; ++i) {
+        thrs.emplace_back(new sylar::Thread{log_loop, "log_" + std::to_string(i)});
+    }
+
+    uint64_t begin = sylar::GetCurrentMS();
+    for (int i = 0; i < RELOADS; ++i) {
+        sylar::Config::LoadFromYaml(YAML::Load(i % 2 ? s_conf_binary : s_conf_file));
+    }
+    uint64_t cost = sylar::GetCurrentMS() - begin;
+
+    s_stop = true;
+    for (auto &thr : thrs) {
+        thr->join();
+    }
+
+    SYLAR_LOG_INFO(g_logger) << RELOADS << " reloads in " << cost << "ms while " << THREADS << " threads logged "
+                             << s_records << " records";
+    return 0;
+}
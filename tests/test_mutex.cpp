@@ -0,0 +1,169 @@
+#include <atomic>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static constexpr uint64_t DURATION_MS = 200;
+static constexpr int THREAD_COUNTS[] = {1, 2, 4, 8};
+// 临界区内的工作量, 0表示只递增计数
+static constexpr int WORKS[] = {0, 200};
+static constexpr int PING_PONGS = 100000;
+
+static std::atomic<bool> s_stop{false};
+// 防止临界区内的计算被优化掉
+static volatile uint64_t s_sink = 0;
+
+static uint64_t work(int n) {
+    uint64_t val = 0;
+    for (int i = 0; i < n; ++i) {
+        val = val * 31 + i;
+    }
+    return val;
+}
+
+template <typename F>
+static uint64_t run(int threads, F loop) {
+    s_stop = false;
+    std::atomic<uint64_t> ops{0};
+    std::vector<sylar::Thread::ptr> thrs;
+    for (int i = 0; i < threads; ++i) {
+        thrs.emplace_back(new sylar::Thread{[&ops, &loop, i]() { ops += loop(i); }, "bench_" + std::to_string(i)});
+    }
+    usleep(DURATION_MS * 1000);
+    s_stop = true;
+    for (auto &thr : thrs) {
+        thr->join();
+    }
+    return ops * 1000 / DURATION_MS;
+}
+
+template <typename M>
+static void print_stats(M &mutex) {
+    if constexpr (std::is_same_v<M, sylar::FutexMutex> || std::is_same_v<M, sylar::FutexRWMutex>) {
+        SYLAR_LOG_INFO(g_logger) << "    " << mutex.getStats().toString();
+    }
+}
+
+template <typename M>
+static void bench_mutex(const std::string &name) {
+    for (int threads : THREAD_COUNTS) {
+        for (int cs : WORKS) {
+            M mutex;
+            uint64_t counter = 0;
+            uint64_t ops = run(threads, [&](int) {
+                uint64_t n = 0;
+                while (!s_stop.load(std::memory_order_relaxed)) {
+                    typename M::Lock lock{mutex};
+                    ++counter;
+                    s_sink = work(cs);
+                    ++n;
+                }
+                return n;
+            });
+            SYLAR_LOG_INFO(g_logger) << name << " threads=" << threads << " cs=" << cs << ": " << ops << " ops/s"
+                                     << (counter * 1000 / DURATION_MS == ops ? "" : " COUNTER MISMATCH");
+            print_stats(mutex);
+        }
+    }
+}
+
+// 每16次操作中1次写
+template <typename M>
+static void bench_rwmutex(const std::string &name) {
+    for (int threads : THREAD_COUNTS) {
+        for (int cs : WORKS) {
+            M mutex;
+            uint64_t value = 0;
+            std::atomic<uint64_t> torn{0};
+            uint64_t ops = run(threads, [&](int id) {
+                uint64_t n = 0;
+                uint64_t local = 0;
+                uint64_t local_torn = 0;
+                while (!s_stop.load(std::memory_order_relaxed)) {
+                    if ((n + id) % 16 == 0) {
+                        // 读者只应看到偶数
+                        typename M::WriteLock lock{mutex};
+                        ++value;
+                        s_sink = work(cs);
+                        ++value;
+                    } else {
+                        typename M::ReadLock lock{mutex};
+                        local_torn += value & 1;
+                        local += value + work(cs);
+                    }
+                    ++n;
+                }
+                s_sink = local;
+                torn += local_torn;
+                return n;
+            });
+            SYLAR_LOG_INFO(g_logger) << name << " threads=" << threads << " cs=" << cs << ": " << ops << " ops/s"
+                                     << (torn ? " TORN READS" : "");
+            print_stats(mutex);
+        }
+    }
+}
+
+// 只读: 读者计数不共享缓存行时吞吐应随核数线性增长
+template <typename M>
+static void bench_read_scaling(const std::string &name) {
+    uint64_t base = 0;
+    for (int threads : THREAD_COUNTS) {
+        M mutex;
+        uint64_t value = 1;
+        uint64_t ops = run(threads, [&](int) {
+            uint64_t n = 0;
+            uint64_t local = 0;
+            while (!s_stop.load(std::memory_order_relaxed)) {
+                typename M::ReadLock lock{mutex};
+                local += value;
+                ++n;
+            }
+            s_sink = local;
+            return n;
+        });
+        base = base ? base : ops;
+        SYLAR_LOG_INFO(g_logger) << name << " read only threads=" << threads << ": " << ops << " ops/s scale "
+                                 << (double)ops / base;
+    }
+}
+
+// 两个线程轮流notify/wait, 每次交接都需要唤醒对方
+template <typename S>
+static void bench_semaphore(const std::string &name) {
+    S ping;
+    S pong;
+    uint64_t start = sylar::GetCurrentMS();
+    auto echo = [&]() {
+        for (int i = 0; i < PING_PONGS; ++i) {
+            ping.wait();
+            pong.notify();
+        }
+    };
+    sylar::Thread thr{echo, "pong"};
+    for (int i = 0; i < PING_PONGS; ++i) {
+        ping.notify();
+        pong.wait();
+    }
+    thr.join();
+    uint64_t cost = std::max<uint64_t>(sylar::GetCurrentMS() - start, 1);
+    SYLAR_LOG_INFO(g_logger) << name << " ping-pong: " << PING_PONGS * 1000 / cost << " round trips/s";
+}
+
+int main(int argc, char *argv[]) {
+    bench_mutex<sylar::Mutex>("pthread mutex");
+    bench_mutex<sylar::SpinLock>("spinlock");
+    bench_mutex<sylar::FutexMutex>("futex mutex");
+
+    bench_rwmutex<sylar::RWMutex>("pthread rwlock");
+    bench_rwmutex<sylar::FutexRWMutex>("futex rwlock");
+    bench_rwmutex<sylar::BRRWMutex>("brlock");
+
+    bench_read_scaling<sylar::RWMutex>("pthread rwlock");
+    bench_read_scaling<sylar::FutexRWMutex>("futex rwlock");
+    bench_read_scaling<sylar::BRRWMutex>("brlock");
+
+    bench_semaphore<sylar::Semaphore>("sem_t");
+    bench_semaphore<sylar::FutexSemaphore>("futex semaphore");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <fstream>
+#include "sylar/sylar.h"
+#include "tests/test_helper.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+// 返回值、errno和异常都带回调用方
+static void test_result(sylar::IOManager &iom) {
+    run_in(iom, [] {
+        int n = sylar::Offload([] { return 40 + 2; });
+        SYLAR_ASSERT(n == 42);
+        struct stat st;
+        SYLAR_ASSERT(sylar::Offload([&st] { return ::stat("/nonexistent/sylar", &st); }) == -1);
+        SYLAR_ASSERT(errno == ENOENT);
+        std::string name = sylar::Offload([] { return sylar::Thread::GetName(); });
+        SYLAR_ASSERT(name != sylar::Thread::GetName());
+        bool caught = false;
+        try {
+            sylar::Offload([] { throw std::runtime_error("offload"); });
+        } catch (const std::runtime_error &e) {
+            caught = std::string(e.what()) == "offload";
+        }
+        SYLAR_ASSERT(caught);
+    });
+    // 不在协程中时直接执行
+    SYLAR_ASSERT(sylar::Offload([] { return sylar::Thread::GetName(); }) == sylar::Thread::GetName());
+    SYLAR_LOG_INFO(g_logger) << "result ok";
+}
+
+// 阻塞任务执行期间, 同一调度线程上的其他协程继续运行
+static void test_parallel(sylar::IOManager &iom) {
+    sylar::OffloadPool pool{4, 16, "test_offload"};
+    const int count = 8;
+    std::atomic<int> done{0};
+    std::atomic<int> ticks{0};
+    sylar::Semaphore sem;
+    sylar::Semaphore tickerDone;
+    uint64_t start = sylar::GetCurrentMS();
+    for (int i = 0; i < count; ++i) {
+        iom.schedule([&] {
+            pool.run([] { usleep_f(50 * 1000); });
+            if (++done == count) {
+                sem.notify();
+            }
+        });
+    }
+    iom.schedule([&] {
+        while (done < count) {
+            ++ticks;
+            usleep(5 * 1000);
+        }
+        tickerDone.notify();
+    });
+    sem.wait();
+    // ticker引用了栈上的变量, 等它退出后再返回
+    tickerDone.wait();
+    uint64_t elapsed = sylar::GetCurrentMS() - start;
+    auto stats = pool.getStats();
+    SYLAR_LOG_INFO(g_logger) << "parallel elapsed=" << elapsed << "ms ticks=" << ticks << " " << stats.toString();
+    // 8个50ms的任务在4个线程上约两轮
+    SYLAR_ASSERT(elapsed >= 100 && elapsed < 300);
+    SYLAR_ASSERT(ticks >= 10);
+    SYLAR_ASSERT(stats.m_tasks == count && stats.m_inline == 0 && stats.m_queueDepth == 0);
+    SYLAR_ASSERT(stats.m_maxQueueDepth >= 4 && stats.m_maxQueueTime >= 30 * 1000);
+}
+
+// 队列满时在调用方直接执行
+static void test_full(sylar::IOManager &iom) {
+    sylar::OffloadPool pool{1, 1, "test_full"};
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    for (int i = 0; i < 3; ++i) {
+        iom.schedule([&] {
+            pool.run([] { usleep_f(30 * 1000); });
+            if (++done == 3) {
+                sem.notify();
+            }
+        });
+    }
+    sem.wait();
+    auto stats = pool.getStats();
+    SYLAR_ASSERT(stats.m_tasks + stats.m_inline == 3 && stats.m_inline >= 1);
+    SYLAR_LOG_INFO(g_logger) << "full ok " << stats.toString();
+}
+
+// 开启offload.file_io后普通文件读写经过线程池, socket不受影响
+static void test_file_io(sylar::IOManager &iom) {
+    auto fileIo = sylar::Config::Lookup<bool>("offload.file_io");
+    fileIo->setValue(true);
+    char path[] = "/tmp/sylar_offload_XXXXXX";
+    int fd = mkstemp(path);
+    SYLAR_ASSERT(fd >= 0);
+    uint64_t before = sylar::OffloadMgr::GetInstance()->getStats().m_tasks;
+    run_in(iom, [&] {
+        std::string data(4096, 'o');
+        SYLAR_ASSERT(::write(fd, data.data(), data.size()) == 4096);
+        SYLAR_ASSERT(::pwrite(fd, "xyz", 3, 100) == 3);
+        char buf[8] = {0};
+        SYLAR_ASSERT(::pread(fd, buf, 5, 98) == 5 && std::string(buf) == "ooxyz");
+        SYLAR_ASSERT(::lseek(fd, 0, SEEK_SET) == 0);
+        std::string readBack(4096, '\0');
+        SYLAR_ASSERT(::read(fd, &readBack[0], readBack.size()) == 4096 && readBack[100] == 'x');
+        SYLAR_ASSERT(::read(-1, buf, 1) == -1 && errno == EBADF);
+    });
+    uint64_t after = sylar::OffloadMgr::GetInstance()->getStats().m_tasks;
+    SYLAR_ASSERT(after - before == 4);
+    fileIo->setValue(false);
+    ::close(fd);
+    ::unlink(path);
+    SYLAR_LOG_INFO(g_logger) << "file io ok " << sylar::OffloadMgr::GetInstance()->getStats().toString();
+}
+
+// 日志appender在RCU读临界区内写文件, 不能挂起; 否则同一线程上其他写日志的协程会死锁
+static void test_file_log(sylar::IOManager &iom) {
+    auto fileIo = sylar::Config::Lookup<bool>("offload.file_io");
+    fileIo->setValue(true);
+    const char *path = "/tmp/sylar_offload_log.txt";
+    ::unlink(path);
+    sylar::Logger::ptr logger = SYLAR_LOG_NAME("offload_file");
+    logger->addAppender(std::make_shared<sylar::FileLogAppender>(path));
+    const int fibers = 4;
+    const int lines = 50;
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    for (int i = 0; i < fibers; ++i) {
+        iom.schedule([&, i] {
+            for (int j = 0; j < lines; ++j) {
+                SYLAR_LOG_INFO(logger) << "fiber " << i << " line " << j;
+            }
+            if (++done == fibers) {
+                sem.notify();
+            }
+        });
+    }
+    sem.wait();
+    fileIo->setValue(false);
+    logger->clearAppenders();
+
+    std::ifstream ifs{path};
+    std::string line;
+    int count = 0;
+    while (std::getline(ifs, line)) {
+        ++count;
+    }
+    SYLAR_ASSERT2(count == fibers * lines, std::to_string(count));
+    ::unlink(path);
+    SYLAR_LOG_INFO(g_logger) << "file log ok";
+}
+
+// 调度器停止时等待池中未完成的任务, 挂起的协程恢复后才退出
+static void test_stop() {
+    std::atomic<bool> resumed{false};
+    {
+        sylar::IOManager iom{1, false, "offload_stop"};
+        iom.schedule([&] {
+            sylar::Offload([] { usleep_f(100 * 1000); });
+            resumed = true;
+        });
+        usleep(20 * 1000);
+    }
+    SYLAR_ASSERT(resumed);
+    SYLAR_LOG_INFO(g_logger) << "stop ok";
+}
+
+int main(int argc, char *argv[]) {
+    sylar::IOManager iom{1, false, "offload"};
+    test_result(iom);
+    test_parallel(iom);
+    test_full(iom);
+    test_file_io(iom);
+    test_file_log(iom);
+    test_stop();
+    return 0;
+}
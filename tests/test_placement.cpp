@@ -0,0 +1,40 @@
+#include <unistd.h>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static const char *s_conf = R"(
+scheduler:
+    placement:
+        default:
+            cpus: 0
+        io_worker:
+            cpus: 0-1
+            numa_bind: true
+            isolate_reactor: true
+)";
+
+int main(int argc, char *argv[]) {
+    SYLAR_LOG_INFO(g_logger) << "cpu list " << sylar::CpuListToString(sylar::ParseCpuList("10,0-3,5,6,7,3"))
+                             << " invalid=" << sylar::ParseCpuList("1-x").size()
+                             << " node(cpu0)=" << sylar::GetCpuNode(0);
+
+    sylar::Config::LoadFromYaml(YAML::Load(s_conf));
+    SYLAR_LOG_INFO(g_logger) << sylar::Config::LookupBase("scheduler.placement")->toString();
+
+    // 名称在配置中, 使用io_worker项; reactor独占cpu 0, 其余工作线程使用cpu 1, 单核机器上绑定失败
+    sylar::IOManager iom{3, false, "io_worker"};
+    usleep(100 * 1000);
+    SYLAR_LOG_INFO(g_logger) << iom.dumpPlacement();
+
+    // 未配置的名称使用default项
+    sylar::IOManager other{1, false, "unlisted_scheduler"};
+    usleep(100 * 1000);
+    SYLAR_LOG_INFO(g_logger) << other.dumpPlacement();
+
+    // 构造参数指定时忽略配置
+    sylar::IOManager plain{1, false, "plain", sylar::Scheduler::Placement{}};
+    usleep(100 * 1000);
+    SYLAR_LOG_INFO(g_logger) << plain.dumpPlacement();
+    return 0;
+}
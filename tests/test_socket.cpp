@@ -0,0 +1,97 @@
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static void echo(sylar::Socket::ptr client) {
+    char head[4];
+    char body[64];
+    while (true) {
+        // 分两段接收, 验证recvv/sendv
+        iovec iov[2] = {{head, sizeof head}, {body, sizeof body}};
+        ssize_t n = client->recvv(iov, 2);
+        if (n <= 0) {
+            break;
+        }
+        iov[1].iov_len = n > static_cast<ssize_t>(sizeof head) ? n - sizeof head : 0;
+        iov[0].iov_len = n - iov[1].iov_len;
+        if (client->sendv(iov, 2) != n) {
+            break;
+        }
+    }
+    client->close();
+}
+
+static void test_echo(sylar::Address::ptr addr) {
+    sylar::Socket::ptr server = sylar::Socket::CreateTCP(addr);
+    SYLAR_ASSERT(server->bind(addr) && server->listen());
+    SYLAR_LOG_INFO(g_logger) << "listen " << *server;
+
+    sylar::IOManager::GetThis()->schedule([server] {
+        while (sylar::Socket::ptr client = server->accept()) {
+            SYLAR_LOG_INFO(g_logger) << "accept " << *client;
+            sylar::IOManager::GetThis()->schedule(std::bind(echo, client));
+        }
+    });
+
+    sylar::Socket::ptr client = sylar::Socket::CreateTCP(addr);
+    SYLAR_ASSERT(client->connect(server->getLocalAddress(), 1000));
+    client->setRecvTimeout(100);
+    SYLAR_ASSERT(client->getRecvTimeout() == 100);
+
+    const std::string msg = "hello sylar socket";
+    for (int i = 0; i < 3; ++i) {
+        SYLAR_ASSERT(client->send(msg.data(), msg.size()) == static_cast<ssize_t>(msg.size()));
+        std::string buf(msg.size(), '\0');
+        size_t got = 0;
+        while (got < buf.size()) {
+            ssize_t n = client->recv(&buf[got], buf.size() - got);
+            SYLAR_ASSERT(n > 0);
+            got += n;
+        }
+        SYLAR_ASSERT(buf == msg);
+    }
+
+    // 没有数据时按recv超时返回
+    char c;
+    SYLAR_ASSERT(client->recv(&c, 1) == -1 && errno == ETIMEDOUT);
+    SYLAR_LOG_INFO(g_logger) << "echo ok " << *client;
+
+    client->close();
+    server->cancelAccept();
+    server->close();
+}
+
+// 复用同一个from接收两个发送方的数据报, toString随之更新
+static void test_recv_from() {
+    sylar::Socket::ptr server = sylar::Socket::CreateUDP(sylar::IPAddress::Create("127.0.0.1", 0));
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr from;
+    char buf[8];
+    for (int i = 0; i < 2; ++i) {
+        sylar::Socket::ptr sender = sylar::Socket::CreateUDP(server->getLocalAddress());
+        SYLAR_ASSERT(sender->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+        SYLAR_ASSERT(sender->sendTo("udp", 3, server->getLocalAddress()) == 3);
+        SYLAR_ASSERT(server->recvFrom(buf, sizeof buf, from) == 3);
+        SYLAR_ASSERT(from->toString() == sender->getLocalAddress()->toString());
+    }
+    SYLAR_LOG_INFO(g_logger) << "recvFrom ok " << *from;
+}
+
+void run() {
+    test_recv_from();
+    test_echo(sylar::IPAddress::Create("127.0.0.1", 0));
+
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(sock->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(sock->setReusePort(true) && sock->setNoDelay(true) && sock->setKeepAlive(true, 60, 10, 3));
+    int val = 0;
+    SYLAR_ASSERT(sock->getOption(SOL_SOCKET, SO_KEEPALIVE, val) && val == 1);
+
+    test_echo(std::make_shared<sylar::UnixAddress>("/tmp/sylar_test_socket.sock"));
+}
+
+int main(int argc, char *argv[]) {
+    sylar::IOManager iom{1, true, "test_socket"};
+    iom.schedule(run);
+    return 0;
+}
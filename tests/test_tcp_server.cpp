@@ -0,0 +1,207 @@
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <map>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+class EchoServer : public sylar::TcpServer {
+public:
+    using TcpServer::TcpServer;
+
+    std::atomic<int> m_active{0};
+    std::atomic<int> m_maxActive{0};
+
+    sylar::Mutex m_mutex;
+    std::map<std::string, int> m_handled;
+
+protected:
+    void handleClient(sylar::Socket::ptr client) override {
+        int active = ++m_active;
+        int prev = m_maxActive;
+        while (active > prev && !m_maxActive.compare_exchange_weak(prev, active)) {
+        }
+        {
+            sylar::Mutex::Lock lock{m_mutex};
+            ++m_handled[sylar::IOManager::GetThis()->getName()];
+        }
+
+        char buf[64];
+        while (true) {
+            ssize_t n = client->recv(buf, sizeof buf);
+            if (n <= 0 || client->send(buf, n) != n) {
+                break;
+            }
+        }
+        --m_active;
+    }
+};
+
+// 连接后发一条消息, 收到回显后保持连接holdMs再关闭
+static bool echo_once(const sylar::Address::ptr &addr, uint64_t holdMs) {
+    sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 1000)) {
+        return false;
+    }
+    sock->setRecvTimeout(5000);
+    const std::string msg = "hello tcp server";
+    if (sock->send(msg.data(), msg.size()) != static_cast<ssize_t>(msg.size())) {
+        return false;
+    }
+    std::string buf(msg.size(), '\0');
+    size_t got = 0;
+    while (got < buf.size()) {
+        ssize_t n = sock->recv(&buf[got], buf.size() - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    usleep(holdMs * 1000);
+    sock->close();
+    return buf == msg;
+}
+
+static void run_clients(sylar::IOManager &iom, const sylar::Address::ptr &addr, int count, uint64_t holdMs) {
+    std::atomic<int> ok{0};
+    std::atomic<int> done{0};
+    sylar::Semaphore sem;
+    for (int i = 0; i < count; ++i) {
+        iom.schedule([&] {
+            if (echo_once(addr, holdMs)) {
+                ++ok;
+            }
+            if (++done == count) {
+                sem.notify();
+            }
+        });
+    }
+    sem.wait();
+    SYLAR_ASSERT(ok == count);
+}
+
+static void test_limit(sylar::TcpServer::Balance balance) {
+    sylar::IOManager acceptor{1, false, "accept"};
+    sylar::IOManager worker1{1, false, "worker1"};
+    sylar::IOManager worker2{1, false, "worker2"};
+    sylar::IOManager client{1, false, "client"};
+
+    auto server = std::make_shared<EchoServer>(std::vector<sylar::IOManager *>{&worker1, &worker2}, &acceptor);
+    server->setAcceptors(2);
+    server->setMaxConnections(4);
+    server->setBalance(balance);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(server->getSocks().size() == 2);
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->getSocks()[1]->getLocalAddress()->toString() == addr->toString());
+    SYLAR_ASSERT(server->start());
+    SYLAR_LOG_INFO(g_logger) << server->toString();
+
+    run_clients(client, addr, 16, 50);
+    SYLAR_ASSERT(server->m_maxActive <= 4);
+    SYLAR_ASSERT(server->getAccepted() == 16);
+    SYLAR_ASSERT(server->m_handled["worker1"] > 0 && server->m_handled["worker2"] > 0);
+    SYLAR_LOG_INFO(g_logger) << "balance=" << balance << " max_active=" << server->m_maxActive
+                             << " worker1=" << server->m_handled["worker1"]
+                             << " worker2=" << server->m_handled["worker2"];
+    server->stop(1000);
+    SYLAR_ASSERT(server->getConnections() == 0);
+}
+
+// 停止时不再accept, 超过drain时间仍未结束的连接被shutdown
+static void test_drain() {
+    sylar::IOManager worker{1, false, "worker"};
+    sylar::IOManager client{1, false, "client"};
+
+    auto server = std::make_shared<EchoServer>(&worker, &worker);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    sylar::Socket::ptr idle = sylar::Socket::CreateTCP(addr);
+    sylar::Semaphore sem;
+    client.schedule([&] {
+        SYLAR_ASSERT(idle->connect(addr, 1000));
+        sem.notify();
+    });
+    sem.wait();
+    while (server->m_active == 0) {
+        usleep(1000);
+    }
+
+    uint64_t start = sylar::GetCurrentMS();
+    server->stop(100);
+    SYLAR_ASSERT(sylar::GetCurrentMS() - start >= 100);
+    while (server->getConnections() > 0) {
+        usleep(1000);
+    }
+    SYLAR_ASSERT(server->m_active == 0);
+
+    // 监听socket已关闭, 新连接被拒绝
+    client.schedule([&] {
+        sylar::Socket::ptr sock = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(!sock->connect(addr, 1000));
+        idle->close();
+        sem.notify();
+    });
+    sem.wait();
+    SYLAR_LOG_INFO(g_logger) << "drain ok";
+}
+
+static uint64_t cpu_ms() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+// fd耗尽时acceptor暂停而不是空转, fd释放后积压的连接仍被接受
+static void test_emfile() {
+    sylar::IOManager worker{1, false, "worker"};
+    auto server = std::make_shared<EchoServer>(&worker, &worker);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    rlimit old;
+    getrlimit(RLIMIT_NOFILE, &old);
+    rlimit low = old;
+    low.rlim_cur = 256;
+    setrlimit(RLIMIT_NOFILE, &low);
+    // 先建好客户端socket, 再占满剩余的fd
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    std::vector<int> fillers;
+    for (int fd; (fd = open("/dev/null", O_RDONLY)) != -1;) {
+        fillers.push_back(fd);
+    }
+    SYLAR_ASSERT(errno == EMFILE);
+    SYLAR_ASSERT(connect(client, addr->getAddr(), addr->getAddrLen()) == 0);
+
+    uint64_t cpu = cpu_ms();
+    usleep(300 * 1000);
+    cpu = cpu_ms() - cpu;
+    SYLAR_ASSERT(server->getAccepted() == 0);
+
+    for (int fd : fillers) {
+        close(fd);
+    }
+    setrlimit(RLIMIT_NOFILE, &old);
+    uint64_t start = sylar::GetCurrentMS();
+    while (server->getAccepted() == 0 && sylar::GetCurrentMS() - start < 3000) {
+        usleep(1000);
+    }
+    SYLAR_LOG_INFO(g_logger) << "emfile cpu=" << cpu << "ms accepted after " << sylar::GetCurrentMS() - start << "ms";
+    SYLAR_ASSERT(server->getAccepted() == 1);
+    SYLAR_ASSERT(cpu < 100);
+    close(client);
+    server->stop(100);
+}
+
+int main(int argc, char *argv[]) {
+    test_limit(sylar::TcpServer::ROUND_ROBIN);
+    test_limit(sylar::TcpServer::LEAST_CONNECTIONS);
+    test_drain();
+    test_emfile();
+    return 0;
+}
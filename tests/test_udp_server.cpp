@@ -0,0 +1,163 @@
+#include <atomic>
+#include <set>
+#include "sylar/sylar.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+class EchoServer : public sylar::UdpServer {
+public:
+    using UdpServer::UdpServer;
+
+    sylar::Mutex m_mutex;
+    std::vector<std::string> m_received;
+
+protected:
+    void handleBatch(sylar::UdpBatch &batch) override {
+        {
+            sylar::Mutex::Lock lock{m_mutex};
+            for (const auto &packet : batch) {
+                m_received.emplace_back(packet.m_data, packet.m_length);
+            }
+        }
+        std::vector<sylar::UdpPacket> packets(batch.begin(), batch.end());
+        SYLAR_ASSERT(SendBatch(batch.getSocket(), packets.data(), packets.size()) == packets.size());
+    }
+};
+
+// 一次recvmmsg尽量多收, 直到收齐count个或超时
+static std::vector<std::string> recv_all(sylar::Socket::ptr sock, size_t count) {
+    std::vector<std::string> result;
+    const size_t batch = 16;
+    std::vector<char> buffer(batch * 2048);
+    std::vector<mmsghdr> msgs(batch);
+    std::vector<iovec> iovs(batch);
+    while (result.size() < count) {
+        memset(msgs.data(), 0, sizeof(mmsghdr) * batch);
+        for (size_t i = 0; i < batch; ++i) {
+            iovs[i] = {&buffer[i * 2048], 2048};
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = sock->recvMulti(msgs.data(), batch);
+        if (n <= 0) {
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            result.emplace_back(&buffer[i * 2048], msgs[i].msg_len);
+        }
+    }
+    return result;
+}
+
+static void test_echo() {
+    sylar::IOManager io{1, false, "udp_io"};
+    sylar::IOManager worker{1, false, "udp_worker"};
+    sylar::IOManager client{1, false, "client"};
+
+    auto server = std::make_shared<EchoServer>(&worker, &io);
+    server->setReceivers(2);
+    server->setBatchSize(32);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    SYLAR_ASSERT(server->getSocks().size() == 2);
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    const size_t count = 200;
+    sylar::Semaphore sem;
+    client.schedule([&] {
+        sylar::Socket::ptr sock = sylar::Socket::CreateUDP(addr);
+        sock->setRecvTimeout(2000);
+        std::vector<std::string> msgs;
+        std::vector<sylar::UdpPacket> packets;
+        for (size_t i = 0; i < count; ++i) {
+            msgs.push_back("datagram-" + std::to_string(i));
+        }
+        for (const auto &msg : msgs) {
+            packets.push_back(sylar::UdpPacket{msg.data(), msg.size(), addr->getAddr(), addr->getAddrLen()});
+        }
+        SYLAR_ASSERT(sylar::UdpServer::SendBatch(sock, packets.data(), packets.size()) == count);
+        std::vector<std::string> echoes = recv_all(sock, count);
+        SYLAR_ASSERT(echoes.size() == count);
+        SYLAR_ASSERT(std::set<std::string>(echoes.begin(), echoes.end()) ==
+                     std::set<std::string>(msgs.begin(), msgs.end()));
+        sem.notify();
+    });
+    sem.wait();
+    SYLAR_ASSERT(server->getPackets() == count);
+    SYLAR_LOG_INFO(g_logger) << server->toString();
+    SYLAR_LOG_INFO(g_logger) << "echo ok, packets=" << server->getPackets() << " syscalls=" << server->getSyscalls();
+    server->stop();
+}
+
+// 发送端用UDP_SEGMENT, 接收端开启GRO; 不论内核是否合并, 收到的都是原来的数据报
+static void test_segments() {
+    sylar::IOManager io{1, false, "udp_io"};
+    sylar::IOManager client{1, false, "client"};
+
+    auto server = std::make_shared<EchoServer>(&io, &io);
+    server->setGro(true);
+    server->setDatagramSize(64);
+    SYLAR_ASSERT(server->getDatagramSize() == 65535);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    std::string data;
+    for (int i = 0; i < 10; ++i) {
+        data.append(100, 'a' + i);
+    }
+    data.append(30, 'z');
+    sylar::Semaphore sem;
+    client.schedule([&] {
+        sylar::Socket::ptr sock = sylar::Socket::CreateUDP(addr);
+        sock->setRecvTimeout(2000);
+        SYLAR_ASSERT(sylar::UdpServer::SendSegments(sock, addr, data.data(), data.size(), 100));
+        SYLAR_ASSERT(recv_all(sock, 11).size() == 11);
+        sem.notify();
+    });
+    sem.wait();
+
+    sylar::Mutex::Lock lock{server->m_mutex};
+    SYLAR_ASSERT(server->m_received.size() == 11);
+    std::sort(server->m_received.begin(), server->m_received.end());
+    for (int i = 0; i < 10; ++i) {
+        SYLAR_ASSERT(server->m_received[i] == std::string(100, 'a' + i));
+    }
+    SYLAR_ASSERT(server->m_received[10] == std::string(30, 'z'));
+    lock.unlock();
+    SYLAR_LOG_INFO(g_logger) << "segments ok, packets=" << server->getPackets()
+                             << " syscalls=" << server->getSyscalls();
+    server->stop();
+}
+
+// 超过缓冲区的数据报被丢弃并计数
+static void test_truncate() {
+    sylar::IOManager io{1, false, "udp_io"};
+
+    auto server = std::make_shared<EchoServer>(&io, &io);
+    server->setDatagramSize(64);
+    server->setInflight(0);
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)));
+    sylar::Address::ptr addr = server->getSocks()[0]->getLocalAddress();
+    SYLAR_ASSERT(server->start());
+
+    sylar::Socket::ptr sock = sylar::Socket::CreateUDP(addr);
+    std::string big(100, 'x');
+    std::string small(10, 'y');
+    SYLAR_ASSERT(sock->sendTo(big.data(), big.size(), addr) == 100);
+    SYLAR_ASSERT(sock->sendTo(small.data(), small.size(), addr) == 10);
+    uint64_t deadline = sylar::GetCurrentMS() + 2000;
+    while (server->getPackets() + server->getTruncated() < 2 && sylar::GetCurrentMS() < deadline) {
+        usleep(1000);
+    }
+    SYLAR_ASSERT(server->getTruncated() == 1 && server->getPackets() == 1);
+    server->stop();
+    SYLAR_LOG_INFO(g_logger) << "truncate ok";
+}
+
+int main(int argc, char *argv[]) {
+    test_echo();
+    test_segments();
+    test_truncate();
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include <fcntl.h>
+#include "sylar/sylar.h"
+#include "tests/test_helper.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static void test_pair() {
+    sylar::Socket::ptr a, b;
+    SYLAR_ASSERT(sylar::Socket::CreateUnixPair(a, b));
+    SYLAR_ASSERT(a->send("ping", 4) == 4);
+    char buf[8] = {0};
+    SYLAR_ASSERT(b->recv(buf, sizeof(buf)) == 4 && std::string(buf) == "ping");
+
+    ucred cred;
+    SYLAR_ASSERT(b->getPeerCred(cred) && cred.pid == getpid() && cred.uid == getuid());
+
+    // 没有数据时按recv超时返回, 说明经过了hook
+    b->setRecvTimeout(50);
+    std::vector<int> fds;
+    uint64_t start = sylar::GetCurrentMS();
+    SYLAR_ASSERT(b->recvFds(buf, sizeof(buf), fds) == -1 && errno == ETIMEDOUT);
+    SYLAR_ASSERT(sylar::GetCurrentMS() - start >= 50);
+    SYLAR_LOG_INFO(g_logger) << "pair ok " << *a;
+}
+
+// 抽象命名空间的数据报socket, recvFrom得到对端地址后回复
+static void test_datagram() {
+    std::string suffix = std::to_string(getpid());
+    auto serverAddr = sylar::UnixAddress::CreateAbstract("sylar_test_dgram_server_" + suffix);
+    auto clientAddr = sylar::UnixAddress::CreateAbstract("sylar_test_dgram_client_" + suffix);
+    SYLAR_ASSERT(serverAddr->isAbstract() && serverAddr->toString() == "\\0sylar_test_dgram_server_" + suffix);
+
+    sylar::Socket::ptr server = sylar::Socket::CreateUnixUDPSocket();
+    sylar::Socket::ptr client = sylar::Socket::CreateUnixUDPSocket();
+    SYLAR_ASSERT(server->bind(serverAddr) && client->bind(clientAddr));
+    SYLAR_ASSERT(client->sendTo("hello", 5, serverAddr) == 5);
+
+    char buf[16] = {0};
+    sylar::Address::ptr from;
+    SYLAR_ASSERT(server->recvFrom(buf, sizeof(buf), from) == 5 && std::string(buf) == "hello");
+    SYLAR_ASSERT(std::static_pointer_cast<sylar::UnixAddress>(from)->getPath() == clientAddr->getPath());
+    SYLAR_ASSERT(server->sendTo("world", 5, from) == 5);
+    SYLAR_ASSERT(client->recv(buf, sizeof(buf)) == 5 && std::string(buf, 5) == "world");
+    SYLAR_LOG_INFO(g_logger) << "datagram ok " << *server;
+}
+
+// 仍在使用的数据报socket文件不会被删除, 对端关闭后残留的文件可以重新bind
+static void test_stale_path() {
+    std::string path = "/tmp/sylar_test_dgram_" + std::to_string(getpid()) + ".sock";
+    auto addr = std::make_shared<sylar::UnixAddress>(path);
+    sylar::Socket::ptr live = sylar::Socket::CreateUnixUDPSocket();
+    SYLAR_ASSERT(live->bind(addr));
+    sylar::Socket::ptr other = sylar::Socket::CreateUnixUDPSocket();
+    SYLAR_ASSERT(!other->bind(addr));
+    sylar::Socket::ptr sender = sylar::Socket::CreateUnixUDPSocket();
+    char buf[8] = {0};
+    SYLAR_ASSERT(sender->sendTo("ping", 4, addr) == 4 && live->recv(buf, sizeof(buf)) == 4);
+
+    live->close();
+    sylar::Socket::ptr rebound = sylar::Socket::CreateUnixUDPSocket();
+    SYLAR_ASSERT(rebound->bind(addr));
+    rebound->close();
+    ::unlink(path.c_str());
+    SYLAR_LOG_INFO(g_logger) << "stale path ok";
+}
+
+// 传递管道的写端和凭证
+static void test_fds() {
+    sylar::Socket::ptr a, b;
+    SYLAR_ASSERT(sylar::Socket::CreateUnixPair(a, b));
+    SYLAR_ASSERT(b->setPassCred(true));
+    int pipes[2];
+    SYLAR_ASSERT(pipe(pipes) == 0);
+
+    SYLAR_ASSERT(a->sendFds("f", 1, {pipes[1], pipes[1]}, true) == 1);
+    ::close(pipes[1]);
+
+    char c = 0;
+    std::vector<int> fds;
+    ucred cred;
+    SYLAR_ASSERT(b->recvFds(&c, 1, fds, &cred) == 1 && c == 'f');
+    SYLAR_ASSERT(fds.size() == 2 && cred.pid == getpid() && cred.gid == getgid());
+    for (int fd : fds) {
+        SYLAR_ASSERT(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+        SYLAR_ASSERT(sylar::FdMgr::GetInstance()->get(fd));
+    }
+    SYLAR_ASSERT(::write(fds[0], "via fd", 6) == 6);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    char buf[8] = {0};
+    SYLAR_ASSERT(::read(pipes[0], buf, sizeof(buf)) == 6 && std::string(buf) == "via fd");
+    ::close(pipes[0]);
+
+    // 没有附带fd时结果为空
+    SYLAR_ASSERT(a->sendFds("x", 1, {}) == 1);
+    fds.clear();
+    SYLAR_ASSERT(b->recvFds(&c, 1, fds) == 1 && c == 'x' && fds.empty());
+    SYLAR_LOG_INFO(g_logger) << "fds ok";
+}
+
+// 热重启: 把监听socket交给"新进程"后由它继续accept
+static void test_handoff() {
+    sylar::Socket::ptr listener = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(listener->bind(sylar::IPAddress::Create("127.0.0.1", 0)) && listener->listen());
+    sylar::Address::ptr addr = listener->getLocalAddress();
+
+    sylar::Socket::ptr a, b;
+    SYLAR_ASSERT(sylar::Socket::CreateUnixPair(a, b));
+    SYLAR_ASSERT(a->sendFds("L", 1, {listener->getSocket()}) == 1);
+    listener->close();
+
+    char c;
+    std::vector<int> fds;
+    SYLAR_ASSERT(b->recvFds(&c, 1, fds) == 1 && fds.size() == 1);
+    sylar::Socket::ptr inherited = sylar::Socket::FromFd(fds[0]);
+    SYLAR_ASSERT(inherited && inherited->getFamily() == AF_INET && inherited->getType() == SOCK_STREAM);
+    SYLAR_ASSERT(inherited->getLocalAddress()->toString() == addr->toString());
+
+    sylar::IOManager::GetThis()->schedule([addr] {
+        sylar::Socket::ptr client = sylar::Socket::CreateTCP(addr);
+        SYLAR_ASSERT(client->connect(addr, 1000));
+        client->send("hi", 2);
+    });
+    sylar::Socket::ptr conn = inherited->accept();
+    SYLAR_ASSERT(conn);
+    char buf[4] = {0};
+    SYLAR_ASSERT(conn->recv(buf, 2) == 2 && std::string(buf) == "hi");
+    SYLAR_LOG_INFO(g_logger) << "handoff ok " << *inherited;
+}
+
+int main(int argc, char *argv[]) {
+    sylar::IOManager iom{1, false, "unix"};
+    run_in(iom, test_pair);
+    run_in(iom, test_datagram);
+    run_in(iom, test_stale_path);
+    run_in(iom, test_fds);
+    run_in(iom, test_handoff);
+    return 0;
+}
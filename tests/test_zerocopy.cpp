@@ -0,0 +1,132 @@
+#include <atomic>
+#include "sylar/sylar.h"
+#include "tests/test_helper.h"
+
+static sylar::Logger::ptr g_logger = SYLAR_LOG_ROOT();
+
+static void make_pair(sylar::Socket::ptr &a, sylar::Socket::ptr &b) {
+    sylar::Socket::ptr server = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(server->bind(sylar::IPAddress::Create("127.0.0.1", 0)) && server->listen());
+    a = sylar::Socket::CreateTCPSocket();
+    SYLAR_ASSERT(a->connect(server->getLocalAddress(), 1000));
+    b = server->accept();
+    SYLAR_ASSERT(b);
+    server->close();
+}
+
+// 多个大缓冲区零拷贝发送, 对端校验数据; 每个缓冲区在完成通知后恰好释放一次
+static void test_send(sylar::IOManager &io, sylar::IOManager &peer) {
+    sylar::Socket::ptr sender, receiver;
+    run_in(io, [&] { make_pair(sender, receiver); });
+
+    const int count = 16;
+    const size_t size = 1024 * 1024;
+    std::vector<std::string> buffers;
+    for (int i = 0; i < count; ++i) {
+        buffers.emplace_back(size, 'a' + i);
+    }
+
+    std::string received;
+    sylar::Semaphore sem;
+    peer.schedule([&] {
+        std::vector<char> buf(64 * 1024);
+        ssize_t n;
+        while (received.size() < count * size && (n = receiver->recv(buf.data(), buf.size())) > 0) {
+            received.append(buf.data(), n);
+        }
+        sem.notify();
+    });
+
+    std::atomic<int> released[count] = {};
+    std::shared_ptr<sylar::ZeroCopySender> zc;
+    run_in(io, [&] {
+        zc = std::make_shared<sylar::ZeroCopySender>(sender);
+        SYLAR_ASSERT(zc->isEnabled());
+        for (int i = 0; i < count; ++i) {
+            SYLAR_ASSERT(zc->send(buffers[i].data(), size, [&released, i] { ++released[i]; }) ==
+                         static_cast<ssize_t>(size));
+        }
+        SYLAR_ASSERT(zc->flush(2000));
+        SYLAR_ASSERT(zc->getInflight() == 0);
+    });
+    sem.wait();
+    for (int i = 0; i < count; ++i) {
+        SYLAR_ASSERT(released[i] == 1);
+        SYLAR_ASSERT(received.compare(i * size, size, buffers[i]) == 0);
+    }
+    SYLAR_ASSERT(zc->getZeroCopySends() >= static_cast<uint64_t>(count) && zc->getCopySends() == 0);
+    SYLAR_LOG_INFO(g_logger) << "zerocopy send ok, sends=" << zc->getZeroCopySends()
+                             << " kernel_copied=" << zc->getKernelCopied();
+    zc.reset();
+}
+
+// 小于阈值的发送拷贝发出, 返回前已释放
+static void test_threshold(sylar::IOManager &io) {
+    sylar::Socket::ptr sender, receiver;
+    run_in(io, [&] { make_pair(sender, receiver); });
+    run_in(io, [&] {
+        auto zc = std::make_shared<sylar::ZeroCopySender>(sender);
+        zc->setThreshold(4096);
+        std::string small(100, 'x');
+        bool released = false;
+        SYLAR_ASSERT(zc->send(small.data(), small.size(), [&released] { released = true; }) == 100);
+        SYLAR_ASSERT(released && zc->getCopySends() == 1 && zc->getZeroCopySends() == 0);
+        char buf[128];
+        SYLAR_ASSERT(receiver->recv(buf, sizeof(buf)) == 100);
+    });
+
+    // UDP等不支持的socket退回拷贝路径
+    sylar::Socket::ptr udp = sylar::Socket::CreateUDP(sylar::IPAddress::Create("127.0.0.1", 0));
+    auto zc = std::make_shared<sylar::ZeroCopySender>(udp, &io);
+    SYLAR_ASSERT(!zc->isEnabled());
+    SYLAR_LOG_INFO(g_logger) << "threshold ok";
+}
+
+// 对端不读时发送超时, 已发出部分在关闭连接后仍能通过通知释放
+static void test_timeout(sylar::IOManager &io) {
+    sylar::Socket::ptr sender, receiver;
+    run_in(io, [&] { make_pair(sender, receiver); });
+    sender->setSendTimeout(100);
+    std::string big(16 * 1024 * 1024, 'z');
+    std::atomic<int> released{0};
+    std::shared_ptr<sylar::ZeroCopySender> zc;
+    run_in(io, [&] {
+        zc = std::make_shared<sylar::ZeroCopySender>(sender);
+        ssize_t n = zc->send(big.data(), big.size(), [&released] { ++released; });
+        SYLAR_ASSERT(n > 0 && n < static_cast<ssize_t>(big.size()) && errno == ETIMEDOUT);
+    });
+    receiver->close();
+    run_in(io, [&] { SYLAR_ASSERT(zc->flush(2000)); });
+    SYLAR_ASSERT(released == 1);
+    SYLAR_LOG_INFO(g_logger) << "timeout ok";
+}
+
+// 未flush就析构时, 仍在途的缓冲区不调用release
+static void test_destroy(sylar::IOManager &io) {
+    sylar::Socket::ptr sender, receiver;
+    run_in(io, [&] { make_pair(sender, receiver); });
+    sender->setSendTimeout(100);
+    // 析构后内核可能仍引用该缓冲区, 保持到进程退出
+    static std::string big(16 * 1024 * 1024, 'd');
+    std::atomic<int> released{0};
+    size_t inflight = 0;
+    run_in(io, [&] {
+        auto zc = std::make_shared<sylar::ZeroCopySender>(sender);
+        SYLAR_ASSERT(zc->send(big.data(), big.size(), [&released] { ++released; }) > 0);
+        inflight = zc->getInflight();
+    });
+    SYLAR_LOG_INFO(g_logger) << "destroy inflight=" << inflight << " released=" << released;
+    SYLAR_ASSERT(inflight > 0 && released == 0);
+    sender->close();
+    receiver->close();
+}
+
+int main(int argc, char *argv[]) {
+    sylar::IOManager io{1, false, "io"};
+    sylar::IOManager peer{1, false, "peer"};
+    test_send(io, peer);
+    test_threshold(io);
+    test_timeout(io);
+    test_destroy(io);
+    return 0;
+}
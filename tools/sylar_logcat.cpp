@@ -0,0 +1,97 @@
+#include <iostream>
+#include "sylar/binlog.h"
+#include "sylar/sylar.h"
+
+static sylar::Env *g_env = sylar::EnvMgr::GetInstance();
+
+// 从配置目录中查找写入该文件的BinaryLogAppender, 使用其pattern还原
+static std::string FindPattern(const std::string &confDir, const std::string &file) {
+    std::string target;
+    if (!sylar::FSUtil::Realpath(file, target)) {
+        target = file;
+    }
+
+    std::vector<std::string> files;
+    sylar::FSUtil::ListAllFile(files, g_env->getAbsolutePath(confDir), ".yml");
+    for (const auto &confFile : files) {
+        try {
+            YAML::Node root = YAML::LoadFile(confFile);
+            for (const auto &logger : root["logs"]) {
+                for (const auto &appender : logger["appenders"]) {
+                    if (!appender["type"].IsDefined() || appender["type"].as<std::string>() != "BinaryLogAppender" ||
+                        !appender["file"].IsDefined()) {
+                        continue;
+                    }
+                    std::string path;
+                    if (!sylar::FSUtil::Realpath(appender["file"].as<std::string>(), path)) {
+                        path = appender["file"].as<std::string>();
+                    }
+                    if (path == target && appender["pattern"].IsDefined()) {
+                        return appender["pattern"].as<std::string>();
+                    }
+                }
+            }
+        } catch (...) {
+            std::cerr << "load conf file " << confFile << " failed" << std::endl;
+        }
+    }
+    return "";
+}
+
+int main(int argc, char *argv[]) {
+    g_env->addHelp("f", "binary log file to decode");
+    g_env->addHelp("p", "output pattern, overrides the pattern found by -c");
+    g_env->addHelp("c", "config dir, use the pattern of the BinaryLogAppender writing -f");
+    g_env->addHelp("l", "print records up to this level, e.g. warn");
+    g_env->addHelp("n", "print records of this logger only");
+    g_env->addHelp("t", "print records of this thread id only");
+    g_env->addHelp("g", "print records whose message contains this string only");
+    g_env->addHelp("h", "print this help message");
+
+    if (!g_env->init(argc, argv) || g_env->has("h") || !g_env->has("f")) {
+        g_env->printHelp();
+        return 1;
+    }
+
+    std::string file = g_env->get("f");
+    std::string pattern = g_env->get("p");
+    if (pattern.empty() && g_env->has("c")) {
+        pattern = FindPattern(g_env->get("c"), file);
+    }
+
+    sylar::LogFormatter::ptr formatter =
+        pattern.empty() ? std::make_shared<sylar::LogFormatter>() : std::make_shared<sylar::LogFormatter>(pattern);
+    if (formatter->isError()) {
+        std::cerr << "invalid pattern: " << pattern << std::endl;
+        return 1;
+    }
+
+    sylar::LogLevel::Level level = g_env->has("l") ? sylar::LogLevel::FromString(g_env->get("l")) : sylar::LogLevel::NOTSET;
+    std::string loggerName = g_env->get("n");
+    int64_t threadId = g_env->has("t") ? sylar::TypeUtil::Atoi(g_env->get("t")) : -1;
+    std::string grep = g_env->get("g");
+
+    sylar::BinLogReader reader{file};
+    if (!reader.isOpen()) {
+        std::cerr << "open " << file << " failed" << std::endl;
+        return 1;
+    }
+
+    while (sylar::LogEvent::ptr event = reader.next()) {
+        if (event->getLevel() > level) {
+            continue;
+        }
+        if (!loggerName.empty() && event->getLoggerName() != loggerName) {
+            continue;
+        }
+        if (threadId != -1 && event->getThreadId() != threadId) {
+            continue;
+        }
+        if (!grep.empty() && event->getContent().find(grep) == std::string::npos) {
+            continue;
+        }
+        formatter->format(std::cout, event);
+    }
+
+    return 0;
+}